@@ -0,0 +1,254 @@
+/*
+ * Filename: arena.c
+ * Project: DocketMaster
+ *
+ * Description: Per-request arenas and counted heap allocation.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:11:19 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Called by the server manager and the output manager.
+ * File Format:
+ * Restrictions:
+ * Error Handling:
+ * References:
+ * Notes: The counters are updated with relaxed atomics; they are totals for
+ * reporting, and nothing is ordered by them.
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdlib.h>
+#include "arena.h"
+
+/* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ################ */
+
+#define SPILLHEADER ROUNDUP(sizeof(struct ArenaSpill), ARENA_ALIGN)
+    /* room before the memory of a spill, keeping it aligned */
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ########################### */
+
+#define ROUNDUP(len, unit) (((len) + (unit) - 1) / (unit) * (unit))
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* Memory borrowed from the heap when an arena's block ran out.  The memory
+handed out follows the header. */
+struct ArenaSpill {
+    struct ArenaSpill *next;
+};
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
+
+static unsigned long allocations;
+static unsigned long frees;
+static unsigned long long bytes;
+static unsigned long resets;
+static unsigned long long arenabytes;
+static __thread unsigned long myallocations; /* allocations by this thread */
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static void freespills (struct Arena *arena);
+    /* Returns what an arena borrowed to the heap */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description:  Sets up an arena.
+ * Parameters:  The arena and the size of its first block.
+ * Returns:  AR_OK, or AR_ENOMEM.
+ */
+
+int arenainit (struct Arena *arena, size_t size)
+{
+    size = ROUNDUP((size > 0) ? size : 1, ARENA_MINBLOCK);
+    arena->used = arena->wanted = 0;
+    arena->spills = NULL;
+    arena->block = countedmalloc(size);
+    if (arena->block == NULL) {
+        arena->size = 0;
+        return AR_ENOMEM;
+    }
+    arena->size = size;
+    __atomic_fetch_add(&arenabytes, size, __ATOMIC_RELAXED);
+    return AR_OK;
+}		/* -----  end of function arenainit  ----- */
+
+/*
+ * Description:  Hands out memory from an arena.
+ *
+ * Parameters:  The arena and the number of bytes wanted.
+ *
+ * Returns:  The memory, or NULL if out of memory.
+ *
+ * Algorithm:  The memory comes from the block if it fits in what is left.
+ * If it does not, it is borrowed from the heap as a spill, and the spill is
+ * kept on a list until the arena is reset.  Either way, the bytes are added
+ * to what the arena was asked for, which is the size arenareset() grows the
+ * block to.
+ */
+
+void *arenaalloc (struct Arena *arena, size_t len)
+{
+    struct ArenaSpill *spill;
+    char *memory;
+
+    len = ROUNDUP((len > 0) ? len : 1, ARENA_ALIGN);
+    arena->wanted += len;
+    if (arena->size - arena->used >= len) {
+        memory = arena->block + arena->used;
+        arena->used += len;
+        return memory;
+    }
+
+    spill = countedmalloc(SPILLHEADER + len);
+    if (spill == NULL)
+        return NULL;
+    spill->next = arena->spills;
+    arena->spills = spill;
+    return (char *) spill + SPILLHEADER;
+}		/* -----  end of function arenaalloc  ----- */
+
+/*
+ * Description:  Takes back everything handed out by an arena, growing its
+ * block if it had to borrow.
+ * Parameters:  The arena.
+ * Returns:  Nothing.
+ */
+
+void arenareset (struct Arena *arena)
+{
+    char *block;
+    size_t size;
+
+    if (arena->spills != NULL) {
+        freespills(arena);
+        size = ROUNDUP(arena->wanted, ARENA_MINBLOCK);
+        if ((block = countedmalloc(size)) != NULL) {
+            countedfree(arena->block);
+            __atomic_fetch_add(&arenabytes, size - arena->size,
+                               __ATOMIC_RELAXED);
+            arena->block = block;
+            arena->size = size;
+        }
+    }
+    arena->used = arena->wanted = 0;
+    __atomic_fetch_add(&resets, 1, __ATOMIC_RELAXED);
+    return;
+}		/* -----  end of function arenareset  ----- */
+
+/*
+ * Description:  Releases an arena's memory.
+ * Parameters:  The arena.
+ * Returns:  Nothing.
+ */
+
+void arenafree (struct Arena *arena)
+{
+    freespills(arena);
+    countedfree(arena->block);
+    __atomic_fetch_sub(&arenabytes, arena->size, __ATOMIC_RELAXED);
+    arena->block = NULL;
+    arena->size = arena->used = arena->wanted = 0;
+    return;
+}		/* -----  end of function arenafree  ----- */
+
+/*
+ * Description:  malloc(), counted.
+ */
+
+void *countedmalloc (size_t len)
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&bytes, len, __ATOMIC_RELAXED);
+    myallocations++;
+    return malloc(len);
+}		/* -----  end of function countedmalloc  ----- */
+
+/*
+ * Description:  calloc(), counted.
+ */
+
+void *countedcalloc (size_t count, size_t len)
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&bytes, count * len, __ATOMIC_RELAXED);
+    myallocations++;
+    return calloc(count, len);
+}		/* -----  end of function countedcalloc  ----- */
+
+/*
+ * Description:  realloc(), counted.
+ */
+
+void *countedrealloc (void *memory, size_t len)
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&bytes, len, __ATOMIC_RELAXED);
+    myallocations++;
+    return realloc(memory, len);
+}		/* -----  end of function countedrealloc  ----- */
+
+/*
+ * Description:  free(), counted.
+ */
+
+void countedfree (void *memory)
+{
+    if (memory == NULL)
+        return;
+    __atomic_fetch_add(&frees, 1, __ATOMIC_RELAXED);
+    free(memory);
+    return;
+}		/* -----  end of function countedfree  ----- */
+
+/*
+ * Description:  Counts the allocations the calling thread has made.
+ * Returns:  The count.
+ */
+
+unsigned long threadallocations (void)
+{
+    return myallocations;
+}		/* -----  end of function threadallocations  ----- */
+
+/*
+ * Description:  Reports the heap allocations counted so far.
+ * Parameters:  The report to fill in.
+ * Returns:  Nothing.
+ */
+
+void allocstats (struct AllocStats *stats)
+{
+    stats->allocations = __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+    stats->frees = __atomic_load_n(&frees, __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&bytes, __ATOMIC_RELAXED);
+    stats->resets = __atomic_load_n(&resets, __ATOMIC_RELAXED);
+    stats->arenabytes = __atomic_load_n(&arenabytes, __ATOMIC_RELAXED);
+    return;
+}		/* -----  end of function allocstats  ----- */
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description:  Returns what an arena borrowed to the heap.
+ */
+
+static void freespills (struct Arena *arena)
+{
+    struct ArenaSpill *spill;
+
+    while ((spill = arena->spills) != NULL) {
+        arena->spills = spill->next;
+        countedfree(spill);
+    }
+    return;
+}		/* -----  end of function freespills  ----- */
@@ -0,0 +1,149 @@
+/*
+ * Filename: arena.h
+ * Project: DocketMaster
+ *
+ * Description: An arena hands out memory for the length of one request by
+ * bumping a pointer through a block, and takes it all back at once when the
+ * request is done.  An arena that runs out of room borrows more from the
+ * heap, and when it is reset it grows its block to fit, so once it has seen
+ * its largest request it never goes to the heap again.
+ *
+ * The module also counts the heap allocations made through it, so a
+ * long-running process can show that it has stopped allocating.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:11:19 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: arenainit() an arena, arenaalloc() from it while answering a
+ * request, arenareset() it when the request is done, and arenafree() it
+ * when no more requests are coming.  Code on the server's path allocates
+ * from the heap with countedmalloc(), countedrealloc() and countedfree()
+ * rather than malloc(), realloc() and free(), so its allocations show in
+ * allocstats().
+ *
+ * File Format:
+ * Restrictions: An arena belongs to one thread at a time.  The counters are
+ * shared and may be read from any thread.
+ *
+ * Error Handling: arenainit() returns AR_OK or a negative AR_E code;
+ * arenaalloc() returns NULL when out of memory.
+ * References:
+ * Notes:
+ */
+
+#ifndef _ARENA_H_INCLUDED_
+#define _ARENA_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stddef.h>
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define ARENA_ALIGN 16 /* every allocation starts on this boundary */
+#define ARENA_MINBLOCK 4096 /* smallest block an arena grows by */
+
+/*------------------------------------------------------------------------------
+ *  Arena error codes
+ *----------------------------------------------------------------------------*/
+#define AR_OK 0
+#define AR_ENOMEM -1 /* out of memory */
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+struct ArenaSpill; /* memory borrowed from the heap; see arena.c */
+
+struct Arena {
+    char *block; /* the memory handed out */
+    size_t size; /* size of block */
+    size_t used; /* bytes of block handed out since the last reset */
+    size_t wanted; /* bytes asked for since the last reset, spills included */
+    struct ArenaSpill *spills; /* borrowed when block ran out */
+};
+
+/* Heap allocations made through this module since the process started. */
+struct AllocStats {
+    unsigned long allocations; /* countedmalloc() and countedrealloc() */
+    unsigned long frees; /* countedfree() */
+    unsigned long long bytes; /* asked for by those allocations */
+    unsigned long resets; /* requests done with, by arenareset() */
+    unsigned long long arenabytes; /* held in the blocks of live arenas */
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Sets up an arena.
+ * Parameters: The arena and the size of its first block.
+ * Returns: AR_OK, or AR_ENOMEM.
+ */
+
+int arenainit (struct Arena *arena, size_t size);
+
+/*
+ * Description: Hands out memory from an arena.
+ *
+ * Parameters: The arena and the number of bytes wanted.
+ *
+ * Returns: The memory, aligned to ARENA_ALIGN, or NULL if out of memory.  It
+ * is good until the arena is reset.
+ */
+
+void *arenaalloc (struct Arena *arena, size_t len);
+
+/*
+ * Description: Takes back everything handed out by an arena.
+ *
+ * Parameters: The arena.
+ *
+ * Returns: Nothing.
+ *
+ * Notes: If the arena had to borrow from the heap since the last reset, its
+ * block is replaced by one big enough for everything asked of it, so the
+ * same request will not borrow again.
+ */
+
+void arenareset (struct Arena *arena);
+
+/*
+ * Description: Releases an arena's memory.
+ * Parameters: The arena.
+ * Returns: Nothing.
+ */
+
+void arenafree (struct Arena *arena);
+
+/*
+ * Description: malloc(), calloc(), realloc() and free() that are counted in
+ * allocstats().  Memory from one may be passed to the others or to free().
+ */
+
+void *countedmalloc (size_t len);
+void *countedcalloc (size_t count, size_t len);
+void *countedrealloc (void *memory, size_t len);
+void countedfree (void *memory);
+
+/*
+ * Description: Counts the allocations the calling thread has made.
+ * Parameters: None.
+ * Returns: The counted allocations made by this thread so far.
+ */
+
+unsigned long threadallocations (void);
+
+/*
+ * Description: Reports the heap allocations counted so far.
+ * Parameters: The report to fill in.
+ * Returns: Nothing.
+ */
+
+void allocstats (struct AllocStats *stats);
+
+#endif	/* _ARENA_H_INCLUDED_ */
@@ -0,0 +1,586 @@
+/*
+ * Filename: batchmgr.c
+ * Project: DocketMaster
+ *
+ * Description: The batch manager computes the schedules of a stream of
+ * trigger records and writes them as they are computed.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:06:33 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Called by main() for the batch command.
+ * File Format: See batchmgr.h.
+ * Restrictions:
+ * Error Handling:
+ * References:
+ * Notes: Records travel between the threads in blocks of BATCH_RECORDS, so
+ * the queues are locked once per block rather than once per record.  The
+ * blocks are allocated up front and recycled, so the memory a batch uses
+ * does not depend on its size.
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include "batchmgr.h"
+#include "workqueue.h"
+#include "taskpool.h"
+#include "datetools.h"
+#include "metrics.h"
+
+/* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ################ */
+
+#define BATCH_GRAIN 4 /* records of a block computed by one task */
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* Records passed from one stage of the pipeline to the next. */
+struct BatchBlock {
+    int numrecords;
+    struct TriggerRecord records[BATCH_RECORDS];
+    unsigned long lines[BATCH_RECORDS]; /* line number of each record */
+    int results[BATCH_RECORDS]; /* number of events scheduled for each
+                                   record, or a negative BT_E code */
+    struct ScheduledEvent *events; /* maxevents for each record */
+};
+
+/* A block being computed, shared by the tasks computing it. */
+struct BlockWork {
+    struct Batch *batch;
+    struct BatchBlock *block;
+};
+
+/* A batch being run, shared by its threads. */
+struct Batch {
+    const struct EventGraph *graph;
+    const struct CourtCalendar *cal;
+    FILE *input;
+    struct OutputSink *output;
+    enum SCHEDFORMAT format;
+    int maxevents; /* most events a schedule can have */
+    unsigned long line; /* lines read so far; reading stage only */
+    struct WorkQueue freeblocks; /* blocks waiting to be read into */
+    struct WorkQueue parsed; /* blocks waiting to be computed */
+    struct WorkQueue computed; /* blocks waiting to be written */
+    struct BatchStats stats; /* writing stage only */
+    int readerror; /* nonzero if the input could not be read */
+};
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
+
+/* Names of the service methods, in the order of enum SERVICEMETHOD. */
+static const char *servicenames[] = {"personal", "mail", "out-of-state",
+                                     "out-of-country", "express", "fax",
+                                     "electronic"};
+
+/* Names of the parties, in the order of enum PARTY. */
+static const char *partynames[] = {"plaintiff", "defendant"};
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static void * readstage (void *arg);
+    /* Reads blocks of records until the input ends */
+
+static void * computestage (void *arg);
+    /* Computes blocks of records until the reading stage is done */
+
+static int readblock (struct Batch *batch, struct BatchBlock *block);
+    /* Reads up to BATCH_RECORDS records into a block */
+
+static void computeblock (struct Batch *batch, struct BatchBlock *block);
+    /* Computes the schedule of every record of a block */
+
+static void computerange (void *arg, long first, long last);
+    /* Computes the schedules of some of the records of a block */
+
+static void writeblock (struct Batch *batch, struct BatchBlock *block);
+    /* Writes the schedules of a block and reports its bad records */
+
+static char * nextfield (char **cursor);
+    /* Splits the next field off a CSV line */
+
+static int findname (const char *name, const char **names, int numnames,
+                     int deft);
+    /* Looks a name up in a table */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description:  Computes and writes the schedule of every trigger record of
+ * the input.
+ *
+ * Parameters:  The graph and calendar, the input, the sink and format for
+ * the results, the number of blocks in the pipeline, and the stats to fill
+ * in.
+ *
+ * Returns:  BT_OK, or a negative BT_E code.
+ *
+ * Algorithm:  A reading thread fills free blocks with records, a computing
+ * thread computes them on the shared task pool, and the calling thread
+ * writes them and hands the blocks back to be filled again.  There are only
+ * depth blocks, so no stage can get more than that far ahead of the writer:
+ * a reader that has filled them all waits for the writer to hand one back,
+ * and the input is read no faster than the results are written.  If the
+ * threads cannot be started, the calling thread runs the stages itself, one
+ * block at a time.
+ */
+
+int runbatch (const struct EventGraph *graph, const struct CourtCalendar *cal,
+              FILE *input, struct OutputSink *output,
+              enum SCHEDFORMAT format, int depth, struct BatchStats *stats)
+{
+    struct Batch batch;
+    struct BatchBlock *blocks, *block;
+    pthread_t reader, computer;
+    int index, result, threaded;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.graph = graph;
+    batch.cal = cal;
+    batch.input = input;
+    batch.output = output;
+    batch.format = format;
+    batch.maxevents = (graph->listsize > 0) ? graph->listsize : 1;
+    if (depth < 1)
+        depth = BATCH_NUMBLOCKS;
+
+    blocks = calloc(depth, sizeof(struct BatchBlock));
+    if (blocks == NULL)
+        return BT_ENOMEM;
+    result = BT_ENOMEM;
+    for (index = 0; index < depth; index++) {
+        blocks[index].events = malloc((size_t) BATCH_RECORDS *
+                                      batch.maxevents *
+                                      sizeof(struct ScheduledEvent));
+        if (blocks[index].events == NULL)
+            goto cleanup;
+    }
+    if (wqinit(&batch.freeblocks, depth) != WQ_OK)
+        goto cleanup;
+    if (wqinit(&batch.parsed, depth) != WQ_OK) {
+        wqfree(&batch.freeblocks);
+        goto cleanup;
+    }
+    if (wqinit(&batch.computed, depth) != WQ_OK) {
+        wqfree(&batch.parsed);
+        wqfree(&batch.freeblocks);
+        goto cleanup;
+    }
+    for (index = 0; index < depth; index++)
+        wqput(&batch.freeblocks, &blocks[index]);
+
+    /* The computing thread is started first: until the reading thread
+     * starts, it has nothing to do, so it can be stopped without losing
+     * any input. */
+    threaded = (pthread_create(&computer, NULL, computestage, &batch) == 0);
+    if (threaded && pthread_create(&reader, NULL, readstage, &batch) != 0) {
+        wqclose(&batch.parsed);
+        pthread_join(computer, NULL);
+        threaded = 0;
+    }
+
+    if (threaded) {
+        while ((block = wqget(&batch.computed)) != NULL) {
+            setgauge(MG_PARSEDBLOCKS, wqcount(&batch.parsed));
+            setgauge(MG_COMPUTEDBLOCKS, wqcount(&batch.computed));
+            writeblock(&batch, block);
+            wqput(&batch.freeblocks, block);
+        }
+        setgauge(MG_PARSEDBLOCKS, 0);
+        setgauge(MG_COMPUTEDBLOCKS, 0);
+        pthread_join(reader, NULL);
+        pthread_join(computer, NULL);
+    } else {
+        while (readblock(&batch, &blocks[0]) > 0) {
+            computeblock(&batch, &blocks[0]);
+            writeblock(&batch, &blocks[0]);
+        }
+    }
+
+    wqfree(&batch.computed);
+    wqfree(&batch.parsed);
+    wqfree(&batch.freeblocks);
+    batch.stats.depth = depth;
+    batch.stats.stalls = batch.freeblocks.getwaits;
+    batch.stats.maxparsed = batch.parsed.highwater;
+    batch.stats.maxcomputed = batch.computed.highwater;
+    result = BT_OK;
+    if (batch.readerror)
+        result = BT_EFORMAT;
+    if (sinkflush(output) != OUT_OK)
+        result = BT_EWRITE;
+    if (stats != NULL)
+        *stats = batch.stats;
+
+cleanup:
+    for (index = 0; index < depth; index++)
+        free(blocks[index].events);
+    free(blocks);
+    return result;
+}		/* -----  end of function runbatch  ----- */
+
+/*
+ * Description:  Computes the schedule of a trigger record, or the deadline
+ * of its target event.
+ *
+ * Parameters:  The graph and calendar, the record, and the array to fill in
+ * and its size.
+ *
+ * Returns:  The number of events, or BT_ENOEVENT.
+ *
+ * Notes:  The target's deadline is moved to the front of the schedule.
+ */
+
+int computetrigger (const struct EventGraph *graph,
+                    const struct CourtCalendar *cal,
+                    const struct TriggerRecord *record,
+                    struct ScheduledEvent *schedule, int maxevents)
+{
+    struct CourtEventNode *node;
+    int count, index;
+
+    node = searchforevent((char *) record->trigger, graph->eventlist);
+    if (node == NULL)
+        return BT_ENOEVENT;
+    count = computeschedule(graph, cal, node->eventposn, record->jdn,
+                            record->service, record->party, schedule,
+                            maxevents);
+    if (count < 0)
+        return BT_ENOEVENT;
+    if (record->target[0] == '\0')
+        return count;
+
+    for (index = 0; index < count; index++)
+        if (eventcmp(record->target, schedule[index].event->shorttitle) == 0) {
+            schedule[0] = schedule[index];
+            return 1;
+        }
+    return BT_ENOEVENT;
+}		/* -----  end of function computetrigger  ----- */
+
+/*
+ * Description:  Reads a trigger record.
+ *
+ * Parameters:  The record's line, which is split into its fields in place,
+ * and the TriggerRecord to fill in.
+ *
+ * Returns:  BT_OK, or BT_EFORMAT.
+ */
+
+int parsetrigger (char *line, struct TriggerRecord *record)
+{
+    char *cursor, *caseid, *trigger, *datefield, *service, *party, *target;
+    int result;
+    METRIC_STAMP(start);
+
+    METRIC_START(MP_PARSETRIGGER, start);
+    cursor = line;
+    caseid = nextfield(&cursor);
+    trigger = nextfield(&cursor);
+    datefield = nextfield(&cursor);
+    service = nextfield(&cursor);
+    party = nextfield(&cursor);
+    target = nextfield(&cursor);
+    result = BT_EFORMAT;
+    if (datefield != NULL && cursor == NULL)
+        result = filltrigger(caseid, trigger, datefield, service, party,
+                             target, record);
+    if (result != BT_OK)
+        countmetric(MC_TRIGGERERRORS, 1);
+    METRIC_STOP(MP_PARSETRIGGER, start);
+    return result;
+}		/* -----  end of function parsetrigger  ----- */
+
+/*
+ * Description:  Fills in a trigger record from its fields.
+ *
+ * Parameters:  The case id, trigger event, and date, which are required; the
+ * service method, party, and target event, any of which may be NULL or
+ * empty; and the TriggerRecord to fill in.
+ *
+ * Returns:  BT_OK, or BT_EFORMAT.
+ */
+
+int filltrigger (const char *caseid, const char *trigger,
+                 const char *datefield, const char *service,
+                 const char *party, const char *target,
+                 struct TriggerRecord *record)
+{
+    struct DateTime date, check;
+    int used, index;
+
+    if (caseid == NULL || trigger == NULL || datefield == NULL ||
+            *caseid == '\0' || *trigger == '\0' ||
+            strlen(caseid) >= sizeof(record->caseid) ||
+            strlen(trigger) >= sizeof(record->trigger) ||
+            (target != NULL && strlen(target) >= sizeof(record->target)))
+        return BT_EFORMAT;
+
+    memset(&date, 0, sizeof(date));
+    used = 0;
+    if (sscanf(datefield, "%d/%d/%d%n", &date.month, &date.day, &date.year,
+               &used) != 3 || datefield[used] != '\0')
+        return BT_EFORMAT;
+    if (date.month < 1 || date.month > 12 || date.day < 1 || date.day > 31)
+        return BT_EFORMAT;
+    record->jdn = jdncnvrt(&date);
+    jdn2greg(record->jdn, &check);
+    if (check.day != date.day) /* e.g. February 30 */
+        return BT_EFORMAT;
+
+    index = findname(service, servicenames,
+                     sizeof(servicenames) / sizeof(servicenames[0]),
+                     SERVICE_PERSONAL);
+    if (index < 0)
+        return BT_EFORMAT;
+    record->service = (enum SERVICEMETHOD) index;
+    index = findname(party, partynames,
+                     sizeof(partynames) / sizeof(partynames[0]),
+                     PARTY_PLAINTIFF);
+    if (index < 0)
+        return BT_EFORMAT;
+    record->party = (enum PARTY) index;
+
+    strcpy(record->caseid, caseid);
+    strcpy(record->trigger, trigger);
+    strcpy(record->target, (target != NULL) ? target : "");
+    return BT_OK;
+}		/* -----  end of function filltrigger  ----- */
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description:  The reading stage: fills free blocks with records and
+ * passes them on until the input ends.
+ */
+
+static void * readstage (void *arg)
+{
+    struct Batch *batch = arg;
+    struct BatchBlock *block;
+
+    while ((block = wqget(&batch->freeblocks)) != NULL) {
+        if (readblock(batch, block) == 0)
+            break;
+        if (wqput(&batch->parsed, block) != WQ_OK)
+            break;
+    }
+    wqclose(&batch->parsed);
+    return NULL;
+}		/* -----  end of function readstage  ----- */
+
+/*
+ * Description:  The computing stage: computes each block the reading stage
+ * passes on.
+ */
+
+static void * computestage (void *arg)
+{
+    struct Batch *batch = arg;
+    struct BatchBlock *block;
+
+    while ((block = wqget(&batch->parsed)) != NULL) {
+        computeblock(batch, block);
+        wqput(&batch->computed, block);
+    }
+    wqclose(&batch->computed);
+    return NULL;
+}		/* -----  end of function computestage  ----- */
+
+/*
+ * Description:  Reads up to BATCH_RECORDS records into a block.
+ *
+ * Parameters:  The batch and the block.
+ *
+ * Returns:  The number of records read; zero once the input has ended.
+ *
+ * Notes:  A record that cannot be read still takes its place in the block,
+ * with BT_EFORMAT as its result, so it is reported in order.
+ */
+
+static int readblock (struct Batch *batch, struct BatchBlock *block)
+{
+    char line[BATCH_LINELEN];
+    char *start;
+    size_t len;
+    int index, c;
+
+    block->numrecords = 0;
+    while (block->numrecords < BATCH_RECORDS &&
+           fgets(line, sizeof(line), batch->input) != NULL) {
+        batch->line++;
+        index = block->numrecords;
+        len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n' &&
+                !feof(batch->input)) {
+            /* Too long: skip the rest of it. */
+            while ((c = getc(batch->input)) != EOF && c != '\n')
+                ;
+            block->lines[index] = batch->line;
+            block->results[index] = BT_EFORMAT;
+            block->numrecords++;
+            continue;
+        }
+        for (start = line; *start == ' ' || *start == '\t'; start++)
+            ;
+        if (*start == '#' || *start == '\n' || *start == '\r' ||
+                *start == '\0')
+            continue;
+        block->lines[index] = batch->line;
+        block->results[index] = parsetrigger(start, &block->records[index]);
+        block->numrecords++;
+    }
+    if (ferror(batch->input))
+        batch->readerror = 1;
+    return block->numrecords;
+}		/* -----  end of function readblock  ----- */
+
+/*
+ * Description:  Computes the schedule of every record of a block that was
+ * read successfully.
+ *
+ * Notes:  The records are shared out over the shared task pool, a few at a
+ * time, so a record with a long chain does not hold up the others.
+ */
+
+static void computeblock (struct Batch *batch, struct BatchBlock *block)
+{
+    struct BlockWork work;
+
+    work.batch = batch;
+    work.block = block;
+    tpparallelfor(tpshared(), 0, block->numrecords, BATCH_GRAIN,
+                  computerange, &work);
+    return;
+}		/* -----  end of function computeblock  ----- */
+
+/*
+ * Description:  Computes the schedules of records first through last - 1 of
+ * a block (a task of computeblock()).
+ */
+
+static void computerange (void *arg, long first, long last)
+{
+    struct BlockWork *work = arg;
+    struct Batch *batch = work->batch;
+    struct BatchBlock *block = work->block;
+    long index;
+
+    for (index = first; index < last; index++)
+        if (block->results[index] == BT_OK)
+            block->results[index] = computetrigger(batch->graph, batch->cal,
+                    &block->records[index],
+                    block->events + (size_t) index * batch->maxevents,
+                    batch->maxevents);
+    return;
+}		/* -----  end of function computerange  ----- */
+
+/*
+ * Description:  Writes the schedules of a block, and reports its records
+ * that were skipped on stderr.
+ */
+
+static void writeblock (struct Batch *batch, struct BatchBlock *block)
+{
+    int index, result;
+
+    for (index = 0; index < block->numrecords; index++) {
+        batch->stats.records++;
+        result = block->results[index];
+        if (result == BT_EFORMAT) {
+            fprintf(stderr, "ERROR: Line %lu: bad trigger record\n",
+                    block->lines[index]);
+        } else if (result == BT_ENOEVENT) {
+            fprintf(stderr, "ERROR: Line %lu: no event \"%s\"\n",
+                    block->lines[index],
+                    (block->records[index].target[0] != '\0') ?
+                    block->records[index].target :
+                    block->records[index].trigger);
+        } else {
+            writeschedule(batch->output, batch->format,
+                          block->records[index].caseid,
+                          block->events + (size_t) index * batch->maxevents,
+                          result);
+            batch->stats.events += result;
+            continue;
+        }
+        batch->stats.errors++;
+    }
+    return;
+}		/* -----  end of function writeblock  ----- */
+
+/*
+ * Description:  Splits the next field off a CSV line.
+ *
+ * Parameters:  Where the rest of the line starts, which is advanced past the
+ * field, or set to NULL after the last field.
+ *
+ * Returns:  The field, with its quotes removed and blanks trimmed, or NULL if
+ * there are no more fields.
+ */
+
+static char * nextfield (char **cursor)
+{
+    char *p, *field, *end;
+
+    if ((p = *cursor) == NULL)
+        return NULL;
+    while (*p == ' ' || *p == '\t')
+        p++;
+    if (*p == '"') {
+        field = end = ++p;
+        while (*p != '\0' && !(*p == '"' && p[1] != '"')) {
+            if (*p == '"')
+                p++;
+            *end++ = *p++;
+        }
+        if (*p == '"')
+            p++;
+        while (*p != '\0' && *p != ',' && *p != '\r' && *p != '\n')
+            p++;
+    } else {
+        field = p;
+        while (*p != '\0' && *p != ',' && *p != '\r' && *p != '\n')
+            p++;
+        for (end = p; end > field && (end[-1] == ' ' || end[-1] == '\t');
+                end--)
+            ;
+    }
+    *cursor = (*p == ',') ? p + 1 : NULL;
+    *end = '\0';
+    return field;
+}		/* -----  end of function nextfield  ----- */
+
+/*
+ * Description:  Looks a name up in a table, ignoring case.
+ *
+ * Parameters:  The name, which may be NULL or empty, the table, its size, and
+ * the index to return for a missing name.
+ *
+ * Returns:  The index of the name, deft if the name is missing, or -1 if it
+ * is not in the table.
+ */
+
+static int findname (const char *name, const char **names, int numnames,
+                     int deft)
+{
+    int index;
+
+    if (name == NULL || *name == '\0')
+        return deft;
+    for (index = 0; index < numnames; index++)
+        if (strcasecmp(name, names[index]) == 0)
+            return index;
+    return -1;
+}		/* -----  end of function findname  ----- */
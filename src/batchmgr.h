@@ -0,0 +1,157 @@
+/*
+ * Filename: batchmgr.h
+ * Project: DocketMaster
+ *
+ * Description: The batch manager computes the schedules of a stream of
+ * trigger records against the loaded event graph and writes them out as
+ * they are computed.  Reading, computing, and writing each run on their own
+ * thread, so a large batch takes about as long as its slowest stage.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 09:57:08 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: runbatch() with the graph and calendar, the input, and a sink and
+ * format for the results.
+ *
+ * File Format: One trigger record per line, in the CSV style of the rules
+ * files (fields may be quoted, with quotes in them doubled):
+ *     case id, trigger event, trigger date, service method, party, event
+ * The trigger event is its short title and the date is MM/DD/YYYY.  The
+ * service method is one of personal, mail, out-of-state, out-of-country,
+ * express, fax, or electronic, and the party plaintiff or defendant; either
+ * may be left empty for personal service or the plaintiff.  The last field
+ * is optional: if it names an event, only that event's deadline is written
+ * instead of the whole schedule.  Blank lines and lines starting with '#'
+ * are skipped.
+ *
+ * Restrictions: The graph and calendar must not change while a batch runs.
+ *
+ * Error Handling: A record that cannot be read or whose trigger is not in
+ * the graph is reported on stderr, by line number, and skipped.  runbatch()
+ * returns BT_OK or a negative BT_E code.
+ *
+ * References:
+ * Notes:
+ */
+
+#ifndef _BATCHMGR_H_INCLUDED_
+#define _BATCHMGR_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdio.h>
+#include "eprocessor.h"
+#include "outputmgr.h"
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define BATCH_CASEIDLEN 64 /* room for a case id and its null terminator */
+#define BATCH_LINELEN 512 /* longest trigger record */
+#define BATCH_RECORDS 128 /* records passed between the threads at a time */
+#define BATCH_NUMBLOCKS 8 /* default: blocks of records in the pipeline at
+                             once */
+
+/*------------------------------------------------------------------------------
+ *  Batch error codes
+ *----------------------------------------------------------------------------*/
+#define BT_OK 0
+#define BT_EFORMAT -1 /* a record could not be read */
+#define BT_ENOEVENT -2 /* a record's trigger is not in the graph */
+#define BT_ENOMEM -3 /* out of memory */
+#define BT_EWRITE -4 /* the results could not be written */
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+/* One trigger record, as read. */
+struct TriggerRecord {
+    char caseid[BATCH_CASEIDLEN];
+    char trigger[50]; /* short title of the trigger event */
+    char target[50]; /* short title of the only event wanted, or empty for
+                        the whole schedule */
+    int jdn; /* date of the trigger */
+    enum SERVICEMETHOD service;
+    enum PARTY party;
+};
+
+/* What a batch did. */
+struct BatchStats {
+    unsigned long records; /* trigger records read */
+    unsigned long errors; /* records skipped */
+    unsigned long events; /* scheduled events written */
+    int depth; /* blocks in the pipeline */
+    unsigned long stalls; /* times the reader waited for the writer to hand
+                             back a block */
+    int maxparsed; /* most blocks read and waiting to be computed */
+    int maxcomputed; /* most blocks computed and waiting to be written */
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Computes and writes the schedule of every trigger record of
+ * the input.
+ *
+ * Parameters: The event graph and court calendar, the input, the sink and
+ * format for the results, the number of blocks of BATCH_RECORDS in the
+ * pipeline (zero or less for BATCH_NUMBLOCKS), and the BatchStats to fill
+ * in (or NULL).
+ *
+ * Returns: BT_OK, or a negative BT_E code.  Skipped records are counted in
+ * the stats, not returned.
+ */
+
+int runbatch (const struct EventGraph *graph, const struct CourtCalendar *cal,
+              FILE *input, struct OutputSink *output,
+              enum SCHEDFORMAT format, int depth, struct BatchStats *stats);
+
+/*
+ * Description: Computes the schedule of a trigger record, or the deadline of
+ * its target event.
+ *
+ * Parameters: The event graph and court calendar, the record, and the array
+ * to fill in and its size (the graph's listsize is always enough).
+ *
+ * Returns: The number of events, or BT_ENOEVENT if the trigger is not in the
+ * graph or the target is not in the trigger's chain.
+ */
+
+int computetrigger (const struct EventGraph *graph,
+                    const struct CourtCalendar *cal,
+                    const struct TriggerRecord *record,
+                    struct ScheduledEvent *schedule, int maxevents);
+
+/*
+ * Description: Reads a trigger record.
+ *
+ * Parameters: The record's line, which is changed in place, and the
+ * TriggerRecord to fill in.
+ *
+ * Returns: BT_OK, or BT_EFORMAT.
+ */
+
+int parsetrigger (char *line, struct TriggerRecord *record);
+
+/*
+ * Description: Fills in a trigger record from fields already separated, as
+ * from a request that is not a line of CSV.
+ *
+ * Parameters: The case id, trigger event, and date (MM/DD/YYYY), which are
+ * required; the service method, party, and target event, any of which may be
+ * NULL or empty; and the TriggerRecord to fill in.
+ *
+ * Returns: BT_OK, or BT_EFORMAT.
+ */
+
+int filltrigger (const char *caseid, const char *trigger,
+                 const char *datefield, const char *service,
+                 const char *party, const char *target,
+                 struct TriggerRecord *record);
+
+#endif	/* _BATCHMGR_H_INCLUDED_ */
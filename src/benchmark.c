@@ -0,0 +1,433 @@
+/*
+ * Filename: benchmark.c
+ * Project: DocketMaster
+ *
+ * Description: Times the date engine's primitives and writes the results
+ * as JSON.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:13:23 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: See benchmark.h.
+ * File Format:
+ * Restrictions:
+ * Error Handling:
+ * References:
+ * Notes: The inputs are drawn once, before any benchmark runs, and every
+ * benchmark cycles through the same BN_INPUTS of them, so the times differ
+ * only by the work each function does.
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "benchmark.h"
+#include "datetools.h"
+#include "metrics.h"
+#include "outputmgr.h"
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* The arguments of one call. */
+struct BenchInput {
+    struct DateTime date; /* a day in the calendar */
+    struct DateTime later; /* BN_SPAN days after it */
+    int numdays; /* court days to count, 1 to BN_MAXDAYS */
+};
+
+/* Makes calls calls of one function, and adds up what they return. */
+typedef unsigned long long (*BenchFunction) (const struct CourtCalendar *cal,
+                                             struct BenchInput *inputs,
+                                             long calls);
+
+/* One benchmark. */
+struct Benchmark {
+    const char *name;
+    BenchFunction run;
+    long calls; /* calls in a round */
+};
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static uint64_t nextrandom (uint64_t *state);
+    /* SplitMix64 */
+
+static void drawinputs (const struct CourtCalendar *cal,
+                        struct BenchInput *inputs, unsigned long seed);
+    /* Draws the arguments of the calls */
+
+static int comparetimes (const void *a, const void *b);
+    /* Orders the times of the rounds */
+
+static unsigned long long benchjdncnvrt (const struct CourtCalendar *cal,
+                                         struct BenchInput *inputs,
+                                         long calls);
+static unsigned long long benchjdn2greg (const struct CourtCalendar *cal,
+                                         struct BenchInput *inputs,
+                                         long calls);
+static unsigned long long benchsakamoto (const struct CourtCalendar *cal,
+                                         struct BenchInput *inputs,
+                                         long calls);
+static unsigned long long benchisholiday (const struct CourtCalendar *cal,
+                                          struct BenchInput *inputs,
+                                          long calls);
+static unsigned long long benchcalholiday (const struct CourtCalendar *cal,
+                                           struct BenchInput *inputs,
+                                           long calls);
+static unsigned long long benchoffset (const struct CourtCalendar *cal,
+                                       struct BenchInput *inputs,
+                                       long calls);
+static unsigned long long benchcaloffset (const struct CourtCalendar *cal,
+                                          struct BenchInput *inputs,
+                                          long calls);
+static unsigned long long benchdifference (const struct CourtCalendar *cal,
+                                           struct BenchInput *inputs,
+                                           long calls);
+static unsigned long long benchcaldifference (const struct CourtCalendar *cal,
+                                              struct BenchInput *inputs,
+                                              long calls);
+    /* The benchmarks */
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
+
+/* The benchmarks, in the order they are run and reported.  The calls in a
+ * round are set so that each round takes some tens of milliseconds; the
+ * functions that walk the holiday rules a day at a time make fewer. */
+static const struct Benchmark benchmarks[] = {
+    {"jdncnvrt", benchjdncnvrt, 1L << 20},
+    {"jdn2greg", benchjdn2greg, 1L << 20},
+    {"wkday_sakamoto", benchsakamoto, 1L << 20},
+    {"isholiday", benchisholiday, 1L << 18},
+    {"calendar_isholiday", benchcalholiday, 1L << 20},
+    {"courtday_offset", benchoffset, 1L << 12},
+    {"calendar_offset", benchcaloffset, 1L << 18},
+    {"courtday_difference", benchdifference, 1L << 8},
+    {"calendar_difference", benchcaldifference, 1L << 18}};
+
+#define NUMBENCHMARKS ((int) (sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description:  Runs every benchmark and writes the results as JSON.
+ *
+ * Parameters:  The calendar, the file to write (NULL for the standard
+ * output), and the seed of the inputs.
+ *
+ * Returns:  BN_OK, or a negative BN_E code.
+ *
+ * Algorithm:  Each benchmark is run once untimed, to bring its code and the
+ * inputs into the caches, and then BN_ROUNDS times.  The time of a round is
+ * divided by its calls; the fastest and the median are reported.
+ */
+
+int runbenchmarks (const struct CourtCalendar *cal, const char *results,
+                   unsigned long seed)
+{
+    struct BenchInput *inputs;
+    struct OutputSink out;
+    const struct Benchmark *bench;
+    double times[BN_ROUNDS];
+    unsigned long long checksum;
+    uint64_t start;
+    int b, round, result;
+
+    if (cal->numdays <= BN_SPAN + 2 * BN_MAXDAYS)
+        return BN_ECALENDAR;
+    inputs = malloc(BN_INPUTS * sizeof(*inputs));
+    if (inputs == NULL)
+        return BN_ENOMEM;
+    drawinputs(cal, inputs, seed);
+
+    if (results != NULL && *results != '\0')
+        result = sinkopenfile(&out, results);
+    else
+        result = sinkopenstdout(&out);
+    if (result != OUT_OK) {
+        free(inputs);
+        return BN_EOPEN;
+    }
+
+#ifdef DM_METRICS
+    sinkprintf(&out, "{\"seed\":%lu,\"rounds\":%d,\"probes\":true,", seed,
+               BN_ROUNDS);
+#else
+    sinkprintf(&out, "{\"seed\":%lu,\"rounds\":%d,\"probes\":false,", seed,
+               BN_ROUNDS);
+#endif
+    sinkprintf(&out, "\"calendar\":{\"firstjdn\":%d,\"days\":%d},\n"
+               "\"benchmarks\":[\n", cal->firstjdn, cal->numdays);
+    for (b = 0; b < NUMBENCHMARKS; b++) {
+        bench = &benchmarks[b];
+        checksum = bench->run(cal, inputs, bench->calls);
+        for (round = 0; round < BN_ROUNDS; round++) {
+            start = metricclock();
+            checksum = bench->run(cal, inputs, bench->calls);
+            times[round] = (double) (metricclock() - start) / bench->calls;
+        }
+        qsort(times, BN_ROUNDS, sizeof(times[0]), comparetimes);
+        sinkprintf(&out, " {\"name\":\"%s\",\"calls\":%ld,\"min_ns\":%.2f,"
+                   "\"median_ns\":%.2f,\"checksum\":%llu}%s\n", bench->name,
+                   bench->calls, times[0], times[BN_ROUNDS / 2], checksum,
+                   (b < NUMBENCHMARKS - 1) ? "," : "");
+    }
+    sinkprintf(&out, "]}\n");
+
+    free(inputs);
+    return (sinkclose(&out) == OUT_OK) ? BN_OK : BN_EOPEN;
+}		/* -----  end of function runbenchmarks  ----- */
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Name:  nextrandom
+ * Description:  SplitMix64: the next of a sequence of 64-bit numbers that is
+ * the same for a seed on every machine, unlike rand()'s.
+ */
+
+static uint64_t nextrandom (uint64_t *state)
+{
+    uint64_t z;
+
+    z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}		/* -----  end of function nextrandom  ----- */
+
+
+/*
+ * Name:  drawinputs
+ * Description:  Draws BN_INPUTS days from the calendar, early enough that
+ * the day BN_SPAN later, and BN_MAXDAYS court days later, are in it too.
+ * Each is paired with the day BN_SPAN later and a count of court days.
+ */
+
+static void drawinputs (const struct CourtCalendar *cal,
+                        struct BenchInput *inputs, unsigned long seed)
+{
+    uint64_t state = seed;
+    int span = cal->numdays - BN_SPAN - 2 * BN_MAXDAYS;
+    int i, jdn;
+
+    for (i = 0; i < BN_INPUTS; i++) {
+        jdn = cal->firstjdn + (int) (nextrandom(&state) % span);
+        jdn2greg(jdn, &inputs[i].date);
+        inputs[i].date.jdn = jdn;
+        inputs[i].date.day_of_week = wkday_sakamoto(&inputs[i].date);
+        jdn2greg(jdn + BN_SPAN, &inputs[i].later);
+        inputs[i].later.jdn = jdn + BN_SPAN;
+        inputs[i].later.day_of_week = wkday_sakamoto(&inputs[i].later);
+        inputs[i].numdays = 1 + (int) (nextrandom(&state) % BN_MAXDAYS);
+    }
+    return;
+}		/* -----  end of function drawinputs  ----- */
+
+
+/*
+ * Name:  comparetimes
+ * Description:  Orders two times for qsort(), fastest first.
+ */
+
+static int comparetimes (const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}		/* -----  end of function comparetimes  ----- */
+
+
+/*
+ * Name:  benchjdncnvrt
+ * Description:  Converts dates to Julian Day Numbers.
+ */
+
+static unsigned long long benchjdncnvrt (const struct CourtCalendar *cal,
+                                         struct BenchInput *inputs,
+                                         long calls)
+{
+    unsigned long long sum = 0;
+    long i;
+
+    (void) cal;
+    for (i = 0; i < calls; i++)
+        sum += jdncnvrt(&inputs[i & (BN_INPUTS - 1)].date);
+    return sum;
+}		/* -----  end of function benchjdncnvrt  ----- */
+
+
+/*
+ * Name:  benchjdn2greg
+ * Description:  Converts Julian Day Numbers to dates.
+ */
+
+static unsigned long long benchjdn2greg (const struct CourtCalendar *cal,
+                                         struct BenchInput *inputs,
+                                         long calls)
+{
+    struct DateTime date;
+    unsigned long long sum = 0;
+    long i;
+
+    (void) cal;
+    for (i = 0; i < calls; i++) {
+        jdn2greg(inputs[i & (BN_INPUTS - 1)].date.jdn, &date);
+        sum += date.year * 10000 + date.month * 100 + date.day;
+    }
+    return sum;
+}		/* -----  end of function benchjdn2greg  ----- */
+
+
+/*
+ * Name:  benchsakamoto
+ * Description:  Finds the days of the week of dates.
+ */
+
+static unsigned long long benchsakamoto (const struct CourtCalendar *cal,
+                                         struct BenchInput *inputs,
+                                         long calls)
+{
+    unsigned long long sum = 0;
+    long i;
+
+    (void) cal;
+    for (i = 0; i < calls; i++)
+        sum += wkday_sakamoto(&inputs[i & (BN_INPUTS - 1)].date);
+    return sum;
+}		/* -----  end of function benchsakamoto  ----- */
+
+
+/*
+ * Name:  benchisholiday
+ * Description:  Tests days against the holiday rules.
+ */
+
+static unsigned long long benchisholiday (const struct CourtCalendar *cal,
+                                          struct BenchInput *inputs,
+                                          long calls)
+{
+    unsigned long long sum = 0;
+    long i;
+
+    (void) cal;
+    for (i = 0; i < calls; i++)
+        sum += isholiday(&inputs[i & (BN_INPUTS - 1)].date);
+    return sum;
+}		/* -----  end of function benchisholiday  ----- */
+
+
+/*
+ * Name:  benchcalholiday
+ * Description:  Tests days against the materialized calendar.
+ */
+
+static unsigned long long benchcalholiday (const struct CourtCalendar *cal,
+                                           struct BenchInput *inputs,
+                                           long calls)
+{
+    unsigned long long sum = 0;
+    long i;
+
+    for (i = 0; i < calls; i++)
+        sum += calendar_isholiday(cal, inputs[i & (BN_INPUTS - 1)].date.jdn);
+    return sum;
+}		/* -----  end of function benchcalholiday  ----- */
+
+
+/*
+ * Name:  benchoffset
+ * Description:  Counts 1 to BN_MAXDAYS court days by the holiday rules.
+ */
+
+static unsigned long long benchoffset (const struct CourtCalendar *cal,
+                                       struct BenchInput *inputs,
+                                       long calls)
+{
+    struct BenchInput *input;
+    struct DateTime date;
+    unsigned long long sum = 0;
+    long i;
+
+    (void) cal;
+    for (i = 0; i < calls; i++) {
+        input = &inputs[i & (BN_INPUTS - 1)];
+        courtday_offset(&input->date, &date, input->numdays);
+        sum += jdncnvrt(&date);
+    }
+    return sum;
+}		/* -----  end of function benchoffset  ----- */
+
+
+/*
+ * Name:  benchcaloffset
+ * Description:  Counts 1 to BN_MAXDAYS court days in the calendar.
+ */
+
+static unsigned long long benchcaloffset (const struct CourtCalendar *cal,
+                                          struct BenchInput *inputs,
+                                          long calls)
+{
+    struct BenchInput *input;
+    struct DateTime date;
+    unsigned long long sum = 0;
+    long i;
+
+    for (i = 0; i < calls; i++) {
+        input = &inputs[i & (BN_INPUTS - 1)];
+        calendar_offset(cal, &input->date, &date, input->numdays);
+        sum += jdncnvrt(&date);
+    }
+    return sum;
+}		/* -----  end of function benchcaloffset  ----- */
+
+
+/*
+ * Name:  benchdifference
+ * Description:  Counts the court days in ten years by the holiday rules.
+ */
+
+static unsigned long long benchdifference (const struct CourtCalendar *cal,
+                                           struct BenchInput *inputs,
+                                           long calls)
+{
+    struct BenchInput *input;
+    unsigned long long sum = 0;
+    long i;
+
+    (void) cal;
+    for (i = 0; i < calls; i++) {
+        input = &inputs[i & (BN_INPUTS - 1)];
+        sum += courtday_difference(&input->date, &input->later);
+    }
+    return sum;
+}		/* -----  end of function benchdifference  ----- */
+
+
+/*
+ * Name:  benchcaldifference
+ * Description:  Counts the court days in ten years in the calendar.
+ */
+
+static unsigned long long benchcaldifference (const struct CourtCalendar *cal,
+                                              struct BenchInput *inputs,
+                                              long calls)
+{
+    struct BenchInput *input;
+    unsigned long long sum = 0;
+    long i;
+
+    for (i = 0; i < calls; i++) {
+        input = &inputs[i & (BN_INPUTS - 1)];
+        sum += calendar_difference(cal, &input->date, &input->later);
+    }
+    return sum;
+}		/* -----  end of function benchcaldifference  ----- */
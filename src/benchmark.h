@@ -0,0 +1,81 @@
+/*
+ * Filename: benchmark.h
+ * Project: DocketMaster
+ *
+ * Description: The benchmark module times the date engine's primitives: the
+ * Julian Day conversions, the weekday formula, the holiday test, and court
+ * day counting, both by the holiday rules and by the materialized calendar.
+ * The inputs are drawn from a fixed seed and the results are written as
+ * JSON, so one run can be compared with the next.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:13:23 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Build or load the rules, then runbenchmarks() over the calendar.
+ *
+ * File Format: One JSON object.  Times are nanoseconds per call.
+ *     {"seed": 20261019, "rounds": 5, "probes": false,
+ *      "calendar": {"firstjdn": 2447893, "days": 29220},
+ *      "benchmarks": [
+ *       {"name": "jdncnvrt", "calls": 1048576, "min_ns": 9.1,
+ *        "median_ns": 9.4, "checksum": 2563042581437},
+ *       ...]}
+ * probes is true if the engine was built with DM_METRICS, whose probes
+ * slow the calendar functions down.  The checksum adds up the results of
+ * every call of a round; it changes only if the inputs or the answers do.
+ *
+ * Restrictions: The calendar must span more than BN_SPAN days.
+ *
+ * Error Handling: runbenchmarks() returns BN_OK or a negative BN_E code.
+ *
+ * References: Steele, Lea, and Flood, "Fast Splittable Pseudorandom Number
+ * Generators" (SplitMix64), for the inputs.
+ * Notes: Each benchmark is run once to warm up and then BN_ROUNDS times;
+ * the fastest round is the least disturbed by the rest of the machine.
+ */
+
+#ifndef _BENCHMARK_H_INCLUDED_
+#define _BENCHMARK_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include "courtcal.h"
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define BN_SEED 20261019UL /* default seed of the inputs */
+#define BN_ROUNDS 5 /* timed rounds of each benchmark */
+#define BN_INPUTS 4096 /* dates drawn, a power of two */
+#define BN_SPAN 3652 /* days in the ten years courtday_difference() spans */
+#define BN_MAXDAYS 365 /* most court days courtday_offset() counts */
+
+/*------------------------------------------------------------------------------
+ *  Benchmark error codes
+ *----------------------------------------------------------------------------*/
+#define BN_OK 0
+#define BN_EOPEN -1 /* the results could not be written */
+#define BN_ECALENDAR -2 /* the calendar is too short to draw dates from */
+#define BN_ENOMEM -3 /* out of memory */
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Runs every benchmark and writes the results as JSON.
+ *
+ * Parameters: The materialized calendar to count court days in, the file
+ * to write (NULL for the standard output), and the seed of the inputs.
+ *
+ * Returns: BN_OK, or a negative BN_E code.
+ */
+
+int runbenchmarks (const struct CourtCalendar *cal, const char *results,
+                   unsigned long seed);
+
+#endif	/* _BENCHMARK_H_INCLUDED_ */
@@ -0,0 +1,409 @@
+/*
+ * Filename: chainloader.c
+ * Project: DocketMaster
+ *
+ * Description: The chain loader indexes an events file by record offset and
+ * loads only the events reachable from a requested trigger.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 09:14:50 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Called by main() for the chain subcommand.
+ * File Format:
+ * Restrictions:
+ * Error Handling:
+ * References: The name hash is the 64-bit FNV-1a hash (Fowler, Noll, and
+ * Vo).
+ * Notes:
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdlib.h>
+#include <string.h>
+#include "chainloader.h"
+#include "rulebuilder.h"
+#include "eprocessor.h"
+#include "errorhandler.h"
+
+/* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ################ */
+
+#define FNV_OFFSET 14695981039346656037ULL /* FNV-1a 64-bit offset basis */
+#define FNV_PRIME 1099511628211ULL /* FNV-1a 64-bit prime */
+#define FIRSTENTRIES 64 /* number of index entries first allocated */
+
+/* Longest event name kept by the lexical analyzer */
+#define NAMELEN (sizeof(((struct CourtEvent *) 0)->shorttitle) - 1)
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* An event waiting to have the events it triggers loaded. */
+struct ChainLink {
+    char shorttitle[NAMELEN + 1];
+};
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static int addentry (struct ChainIndexEntry **entries, int *count,
+                     int *maxcount, const struct ChainIndexEntry *entry);
+    /* Appends an entry to an index, growing it as needed */
+
+static int readrecord (struct ChainIndex *index,
+                       const struct ChainIndexEntry *entry,
+                       struct CourtEvent *event);
+    /* Reads and parses the record an entry points to */
+
+static int addlink (struct ChainLink **queue, int *count, int *maxcount,
+                    const char *shorttitle);
+    /* Appends an event to the queue of events to follow */
+
+static int firstentry (const struct ChainIndexEntry *entries, int count,
+                       uint64_t key);
+    /* Position of the first entry whose key is not less than key */
+
+static int entrycmp (const void *entry1, const void *entry2);
+    /* qsort() comparison: by key, then by record */
+
+static uint64_t hashname (const char *name);
+    /* FNV-1a hash of an event name, as the lexical analyzer stores it */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description: Opens an events file and indexes its records.
+ *
+ * Parameters: Name of the events file and the index to fill in.
+ *
+ * Returns: The number of records indexed, or -1 if the file could not be
+ * opened, is not an events file, or memory could not be allocated.
+ *
+ * Algorithm: Each record is split into fields, but only the Event and
+ * Trigger fields are looked at, and only their hashes are kept.  No event is
+ * built and nothing is added to an event graph.
+ */
+
+int openchainindex(const char *filename, struct ChainIndex *index)
+{
+    char record[MAXRECORDLENGTH]; /* single record input buffer */
+    struct ChainIndexEntry entry;
+    uint64_t triggerkey;
+    char *token;
+    long offset;
+    int maxnames, maxtriggered, curfield, hasname, hastrigger, errors;
+
+    memset(index, 0, sizeof(*index));
+    index->filename = filename;
+    index->file = fopen(filename, "r");
+    if (index->file == NULL) {
+        seterrorcontext(index->filename, 0);
+        recorderror(NOFILE, 0);
+        return -1;
+    }
+
+    switch (checkfile(index->file, index->filename, index->fields,
+                      &index->numfields)) {
+        case E_FILE:
+            break;
+        case BAD_FILE:
+            closechainindex(index);
+            return -1;
+        default: /* a rules file, but not an events file */
+            recorderror(BADFILE, 1);
+            closechainindex(index);
+            return -1;
+    }
+
+    maxnames = maxtriggered = 0;
+    entry.line = 2;
+    entry.record = 0;
+    for (;;) {
+        offset = ftell(index->file);
+        if (fgets(record, sizeof(record), index->file) == NULL)
+            break;
+        entry.line++;
+        record[strcspn(record, "\r\n")] = NULCHAR;
+        if (*record == NULCHAR)
+            continue; /* skip blank lines */
+        seterrorcontext(index->filename, entry.line);
+
+        errors = threaderrorcount();
+        hasname = hastrigger = 0;
+        triggerkey = 0;
+        token = ftotok(record, FDELIMITER, TDELIMITER);
+        for (curfield = 0; token != NULL && curfield < index->numfields;
+                curfield++) {
+            if (strcmp(index->fields[curfield], EF_EVENT) == 0 &&
+                    *token != NULCHAR) {
+                entry.key = hashname(token);
+                hasname = 1;
+            } else if (strcmp(index->fields[curfield], EF_TRIGGER) == 0 &&
+                    *token != NULCHAR) {
+                triggerkey = hashname(token);
+                hastrigger = 1;
+            }
+            token = ftotok(NULL, FDELIMITER, TDELIMITER);
+        }
+        if (threaderrorcount() != errors)
+            continue; /* ftotok() recorded a formatting error */
+        if (!hasname) {
+            recorderror(BADRECORD, 0);
+            continue;
+        }
+
+        entry.offset = offset;
+        if (addentry(&index->byname, &index->numrecords, &maxnames,
+                     &entry) != 0)
+            goto nomemory;
+        if (hastrigger) {
+            entry.key = triggerkey;
+            if (addentry(&index->bytrigger, &index->numtriggered,
+                         &maxtriggered, &entry) != 0)
+                goto nomemory;
+        }
+        entry.record++;
+    }
+
+    if (index->numrecords > 0)
+        qsort(index->byname, index->numrecords,
+              sizeof(struct ChainIndexEntry), entrycmp);
+    if (index->numtriggered > 0)
+        qsort(index->bytrigger, index->numtriggered,
+              sizeof(struct ChainIndexEntry), entrycmp);
+    return index->numrecords;
+
+nomemory:
+    closechainindex(index);
+    return -1;
+}		/* -----  end of function openchainindex  ----- */
+
+/*
+ * Description: Loads an event and every event reachable from it.
+ *
+ * Parameters: The index, the short title of the event that starts the
+ * chain, and the EventGraph to load.
+ *
+ * Returns: The number of events loaded, zero if the event is not in the
+ * file, or -1 if memory could not be allocated.
+ *
+ * Algorithm: Breadth first from the starting event.  For each event loaded,
+ * the records whose Trigger hashes to its name are read, parsed, and kept if
+ * the trigger really is that event (two names can share a hash).  Each record
+ * is read at most once, so the work is proportional to the size of the chain
+ * rather than the size of the file.
+ */
+
+int loadchain(struct ChainIndex *index, const char *trigger,
+              struct EventGraph *graph)
+{
+    struct CourtEvent event;
+    struct ChainLink *queue = NULL; /* the events loaded, in BFS order */
+    unsigned char *loaded = NULL; /* nonzero for each record loaded */
+    const struct ChainIndexEntry *entry;
+    uint64_t key;
+    int head, count, maxcount, posn;
+
+    init_eventgraph(graph, 0);
+    loaded = calloc(index->numrecords + 1, 1);
+    if (loaded == NULL)
+        return -1;
+    count = maxcount = 0;
+
+    /* Find the starting event */
+    key = hashname(trigger);
+    for (posn = firstentry(index->byname, index->numrecords, key);
+            posn < index->numrecords && index->byname[posn].key == key;
+            posn++) {
+        entry = &index->byname[posn];
+        if (readrecord(index, entry, &event) == 0 &&
+                eventcmp(event.shorttitle, trigger) == 0) {
+            if (addlink(&queue, &count, &maxcount, event.shorttitle) != 0)
+                goto nomemory;
+            loaded[entry->record] = 1;
+            graph->eventlist = insertevent(&event, graph->eventlist);
+            graph->listsize++;
+            break;
+        }
+    }
+
+    /* Follow the chain */
+    for (head = 0; head < count; head++) {
+        key = hashname(queue[head].shorttitle);
+        for (posn = firstentry(index->bytrigger, index->numtriggered, key);
+                posn < index->numtriggered &&
+                index->bytrigger[posn].key == key; posn++) {
+            entry = &index->bytrigger[posn];
+            if (loaded[entry->record] ||
+                    readrecord(index, entry, &event) != 0 ||
+                    eventcmp(event.ntc_dependency1,
+                             queue[head].shorttitle) != 0)
+                continue;
+            if (addlink(&queue, &count, &maxcount, event.shorttitle) != 0)
+                goto nomemory;
+            loaded[entry->record] = 1;
+            graph->eventlist = insertevent(&event, graph->eventlist);
+            graph->listsize++;
+        }
+    }
+
+    free(queue);
+    free(loaded);
+    if (finalizeeventgraph(graph) < 0)
+        return -1;
+    return count;
+
+nomemory:
+    free(queue);
+    free(loaded);
+    return -1;
+}		/* -----  end of function loadchain  ----- */
+
+/*
+ * Description: Closes the events file and releases the index.
+ */
+
+void closechainindex(struct ChainIndex *index)
+{
+    if (index->file != NULL)
+        fclose(index->file);
+    free(index->byname);
+    free(index->bytrigger);
+    memset(index, 0, sizeof(*index));
+    return;
+}		/* -----  end of function closechainindex  ----- */
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description: Appends an entry to an index, growing it as needed.
+ *
+ * Returns: Zero if successful, -1 if memory could not be allocated.
+ */
+
+static int addentry (struct ChainIndexEntry **entries, int *count,
+                     int *maxcount, const struct ChainIndexEntry *entry)
+{
+    struct ChainIndexEntry *grown;
+    int newmax;
+
+    if (*count == *maxcount) {
+        newmax = (*maxcount > 0) ? *maxcount * 2 : FIRSTENTRIES;
+        grown = realloc(*entries, newmax * sizeof(struct ChainIndexEntry));
+        if (grown == NULL)
+            return -1;
+        *entries = grown;
+        *maxcount = newmax;
+    }
+    (*entries)[(*count)++] = *entry;
+    return 0;
+}		/* -----  end of function addentry  ----- */
+
+/*
+ * Description: Reads and parses the record an entry points to.
+ *
+ * Returns: Zero if successful, -1 if the record could not be read or
+ * parsed.
+ */
+
+static int readrecord (struct ChainIndex *index,
+                       const struct ChainIndexEntry *entry,
+                       struct CourtEvent *event)
+{
+    char record[MAXRECORDLENGTH]; /* single record input buffer */
+
+    if (fseek(index->file, entry->offset, SEEK_SET) != 0 ||
+            fgets(record, sizeof(record), index->file) == NULL)
+        return -1;
+    record[strcspn(record, "\r\n")] = NULCHAR;
+    seterrorcontext(index->filename, entry->line);
+    return parseeventrecord(record, index->fields, index->numfields, event);
+}		/* -----  end of function readrecord  ----- */
+
+/*
+ * Description: Appends an event to the queue of events to follow.
+ *
+ * Returns: Zero if successful, -1 if memory could not be allocated.
+ */
+
+static int addlink (struct ChainLink **queue, int *count, int *maxcount,
+                    const char *shorttitle)
+{
+    struct ChainLink *grown;
+    int newmax;
+
+    if (*count == *maxcount) {
+        newmax = (*maxcount > 0) ? *maxcount * 2 : FIRSTENTRIES;
+        grown = realloc(*queue, newmax * sizeof(struct ChainLink));
+        if (grown == NULL)
+            return -1;
+        *queue = grown;
+        *maxcount = newmax;
+    }
+    strncpy((*queue)[*count].shorttitle, shorttitle, NAMELEN);
+    (*queue)[*count].shorttitle[NAMELEN] = '\0';
+    (*count)++;
+    return 0;
+}		/* -----  end of function addlink  ----- */
+
+/*
+ * Description: Binary search for the first entry whose key is not less than
+ * key.
+ *
+ * Returns: Its position, or count if there is none.
+ */
+
+static int firstentry (const struct ChainIndexEntry *entries, int count,
+                       uint64_t key)
+{
+    int low, high, mid;
+
+    low = 0;
+    high = count;
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (entries[mid].key < key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}		/* -----  end of function firstentry  ----- */
+
+/*
+ * Description: qsort() comparison for index entries: by key, then by
+ * record, so records with the same key stay in file order.
+ */
+
+static int entrycmp (const void *entry1, const void *entry2)
+{
+    const struct ChainIndexEntry *e1 = entry1;
+    const struct ChainIndexEntry *e2 = entry2;
+
+    if (e1->key != e2->key)
+        return (e1->key < e2->key) ? -1 : 1;
+    return (e1->record > e2->record) - (e1->record < e2->record);
+}		/* -----  end of function entrycmp  ----- */
+
+/*
+ * Description: FNV-1a hash of an event name.  Only the characters the
+ * lexical analyzer keeps in a short title are hashed, so a long name in the
+ * Trigger field hashes the same as the event it names.
+ */
+
+static uint64_t hashname (const char *name)
+{
+    uint64_t hash = FNV_OFFSET;
+    size_t len;
+
+    for (len = 0; name[len] != '\0' && len < NAMELEN; len++) {
+        hash ^= (unsigned char) name[len];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}		/* -----  end of function hashname  ----- */
@@ -0,0 +1,113 @@
+/*
+ * Filename: chainloader.h
+ * Project: DocketMaster
+ *
+ * Description: The chain loader answers small queries without building the
+ * whole event graph.  Opening an events file only indexes where each record
+ * starts, by the event it names and the event that triggers it.  Loading a
+ * chain then reads and parses just the records reachable from the requested
+ * trigger, and builds an event graph of those events alone.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 09:14:50 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: "docketmaster chain -e[events] -c[trigger]" opens the events file
+ * with openchainindex() and loads one chain with loadchain().  The same
+ * query against a compiled rule pack uses rulepack_loadchain() (see
+ * rulepack.h).
+ *
+ * File Format: Same events file read by buildre().
+ *
+ * Restrictions: The file is kept open and read again by every loadchain(),
+ * so it must not be changed while the index is open.  The file name passed
+ * to openchainindex() is kept too (the error log refers to it), so it must
+ * outlive the index.
+ *
+ * Error Handling: Badly formatted records are recorded in the error log
+ * (see errorhandler.h).  A record that cannot be indexed is left out of the
+ * index, and one that cannot be parsed when its chain is loaded is skipped.
+ *
+ * References:
+ * Notes:
+ */
+
+#ifndef _CHAINLOADER_H_INCLUDED_
+#define _CHAINLOADER_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "graphmgr.h"
+#include "lexicalanalyzer.h"
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+/* Where a record of the events file starts.  The key is the hash of an event
+name: the event's own name in the byname index, its trigger's name in the
+bytrigger index. */
+struct ChainIndexEntry {
+    uint64_t key;
+    long offset; /* of the record in the file */
+    int line; /* line number of the record, for the error log */
+    int record; /* number of the record, counting from zero */
+};
+
+struct ChainIndex {
+    FILE *file; /* the events file, kept open */
+    const char *filename; /* as passed to openchainindex() */
+    char fields[MAXNUMFIELDS][MAXFIELDLEN]; /* the file's field names */
+    int numfields;
+    struct ChainIndexEntry *byname; /* every record, sorted by key */
+    int numrecords;
+    struct ChainIndexEntry *bytrigger; /* the records that have a trigger,
+                                          sorted by key */
+    int numtriggered;
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Opens an events file and indexes its records.
+ *
+ * Parameters: Name of the events file and the index to fill in.
+ *
+ * Returns: The number of records indexed, or -1 if the file could not be
+ * opened, is not an events file, or memory could not be allocated.
+ */
+
+int openchainindex(const char *filename, struct ChainIndex *index);
+
+/*
+ * Description: Loads an event and every event reachable from it.
+ *
+ * Parameters: The index, the short title of the event that starts the
+ * chain (normally a CHAINHEAD event), and the EventGraph to load, which is
+ * initialized first.
+ *
+ * Returns: The number of events loaded, zero if the event is not in the
+ * file, or -1 if memory could not be allocated.  The graph is finalized (see
+ * finalizeeventgraph()) and belongs to the caller.
+ */
+
+int loadchain(struct ChainIndex *index, const char *trigger,
+              struct EventGraph *graph);
+
+/*
+ * Description: Closes the events file and releases the index.
+ *
+ * Parameters: The index.
+ *
+ * Returns: Nothing.
+ */
+
+void closechainindex(struct ChainIndex *index);
+
+#endif	/* _CHAINLOADER_H_INCLUDED_ */
@@ -0,0 +1,433 @@
+/*
+ * Filename: courtcal.c
+ * Project: DocketMaster
+ *
+ * Description: The court calendar module materializes a jurisdiction's
+ * holiday rules into a bitmap of non-court days.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:35:03 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Used by the rule builder and the rule pack module.
+ * File Format:
+ * Restrictions:
+ * Error Handling:
+ * References:
+ * Notes:
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdlib.h>
+#include <string.h>
+#include "courtcal.h"
+#include "metrics.h"
+#include "arena.h"
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static int ruleholiday (struct HolidayNode *rules[], struct DateTime *dt);
+    /* Runs the holiday rules for a single date */
+
+static int stepcourtdays (const struct CourtCalendar *cal, int jdn,
+                          int numdays);
+    /* Counts court days one day at a time */
+
+static void setdate (int jdn, struct DateTime *dt);
+    /* Fills in a DateTime from a JDN */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description: Builds the holiday bitmap for every day from January 1 of
+ * firstyear through December 31 of lastyear.
+ *
+ * Parameters: The calendar to build, the holiday hash table to build it
+ * from, and the first and last years to materialize.
+ *
+ * Returns: Zero if successful, -1 if the span is invalid or memory could not
+ * be allocated.
+ *
+ * Algorithm: Every day in the span is converted from its JDN to a Gregorian
+ * date and run through the holiday rules once.  This is the only place the
+ * rules are evaluated for dates inside the span.
+ */
+
+int buildcalendar(struct CourtCalendar *cal, struct HolidayNode *rules[],
+                  int firstyear, int lastyear)
+{
+    struct DateTime dt; /* the date being materialized */
+    int lastjdn; /* JDN of December 31 of lastyear */
+    int day; /* offset of the current day into the span */
+
+    memset(cal, 0, sizeof(*cal));
+    if (lastyear < firstyear)
+        return -1;
+
+    dt.year = firstyear;
+    dt.month = 1;
+    dt.day = 1;
+    cal->firstjdn = jdncnvrt(&dt);
+    dt.year = lastyear;
+    dt.month = 12;
+    dt.day = 31;
+    lastjdn = jdncnvrt(&dt);
+
+    cal->firstyear = firstyear;
+    cal->lastyear = lastyear;
+    cal->numdays = lastjdn - cal->firstjdn + 1;
+    cal->rules = rules;
+    cal->holidaybits = countedcalloc(CALENDARWORDS(cal->numdays),
+                                     sizeof(uint32_t));
+    if (cal->holidaybits == NULL)
+        return -1;
+    cal->ownsbits = 1;
+
+    for (day = 0; day < cal->numdays; day++) {
+        jdn2greg(cal->firstjdn + day, &dt);
+        dt.jdn = cal->firstjdn + day;
+        dt.day_of_week = wkday_sakamoto(&dt);
+        if (ruleholiday(rules, &dt))
+            cal->holidaybits[day >> 5] |= (1u << (day & 31));
+    }
+
+    return 0;
+}		/* -----  end of function buildcalendar  ----- */
+
+
+/*
+ * Description: Determines whether the day with the given JDN is a holiday.
+ *
+ * Parameters: The calendar and a Julian Day Number.
+ *
+ * Returns: 1 if the day is a holiday or weekend, 0 if it is a court day.
+ *
+ * Notes: Dates outside the materialized span fall back on the holiday rules
+ * the calendar was built from.
+ */
+
+int calendar_isholiday(const struct CourtCalendar *cal, int jdn)
+{
+    struct DateTime dt;
+    unsigned int day; /* offset into the span; wraps if jdn < firstjdn */
+    int holiday;
+    METRIC_STAMP(start);
+
+    METRIC_START(MP_ISHOLIDAY, start);
+    day = (unsigned int) (jdn - cal->firstjdn);
+    if (day < (unsigned int) cal->numdays) {
+        holiday = (cal->holidaybits[day >> 5] >> (day & 31)) & 1u;
+    } else {
+        jdn2greg(jdn, &dt);
+        dt.jdn = jdn;
+        dt.day_of_week = wkday_sakamoto(&dt);
+        holiday = ruleholiday(cal->rules, &dt);
+        countmetric(MC_HOLIDAYMISSES, 1);
+    }
+    METRIC_STOP(MP_ISHOLIDAY, start);
+    return holiday;
+}		/* -----  end of function calendar_isholiday  ----- */
+
+
+/*
+ * Description: Builds the court-day offset tables from the holiday bitmap.
+ *
+ * Parameters: A calendar whose bitmap has been built.
+ *
+ * Returns: Zero if successful, -1 if memory could not be allocated.
+ *
+ * Algorithm: courtrank is a running count of the court days seen so far, so
+ * the number of court days in any range inside the span is the difference of
+ * two entries.  courtdays is the inverse: the n-th court day of the span.
+ * Together they answer calendar_offset() and calendar_difference() without
+ * walking the days in between.
+ */
+
+int materializecalendar(struct CourtCalendar *cal)
+{
+    int day, count;
+
+    cal->courtrank = countedmalloc((cal->numdays + 1) * sizeof(int32_t));
+    cal->courtdays = countedmalloc((cal->numdays + 1) * sizeof(int32_t));
+    if (cal->courtrank == NULL || cal->courtdays == NULL) {
+        countedfree(cal->courtrank);
+        countedfree(cal->courtdays);
+        cal->courtrank = NULL;
+        cal->courtdays = NULL;
+        return -1;
+    }
+    cal->ownstables = 1;
+
+    count = 0;
+    for (day = 0; day < cal->numdays; day++) {
+        cal->courtrank[day] = count;
+        if (((cal->holidaybits[day >> 5] >> (day & 31)) & 1u) == 0)
+            cal->courtdays[count++] = cal->firstjdn + day;
+    }
+    cal->courtrank[cal->numdays] = count;
+    cal->numcourtdays = count;
+
+    return 0;
+}		/* -----  end of function materializecalendar  ----- */
+
+
+/*
+ * Description: Calculates the date a number of court days before or after a
+ * date.
+ *
+ * Parameters: The calendar, the starting date, a pointer to the DateTime
+ * that receives the result, and the number of court days to count (negative
+ * to count backward).
+ *
+ * Returns: Nothing; the result is stored in calc_date.
+ *
+ * Algorithm: Counting forward, the first court day after day d is court day
+ * number courtrank[d+1], so the answer is courtdays[courtrank[d+1] + n - 1].
+ * Counting backward, the last court day before d is court day number
+ * courtrank[d] - 1, so the answer is courtdays[courtrank[d] + n].  If the
+ * calendar has no tables, or the answer falls outside the span, the days are
+ * counted one at a time.
+ */
+
+void calendar_offset(const struct CourtCalendar *cal,
+                     struct DateTime *orig_date, struct DateTime *calc_date,
+                     int numdays)
+{
+    int jdn, day, index;
+    METRIC_STAMP(start);
+
+    METRIC_START(MP_COURTOFFSET, start);
+    jdn = jdncnvrt(orig_date);
+    day = jdn - cal->firstjdn;
+
+    index = -1;
+    if (numdays != 0 && cal->courtrank != NULL && day >= 0 &&
+            day < cal->numdays) {
+        if (numdays > 0)
+            index = cal->courtrank[day+1] + numdays - 1;
+        else
+            index = cal->courtrank[day] + numdays;
+    }
+    if (index >= 0 && index < cal->numcourtdays) {
+        setdate(cal->courtdays[index], calc_date);
+        countmetric(MC_RANKHITS, 1);
+    } else {
+        setdate(stepcourtdays(cal, jdn, numdays), calc_date);
+        countmetric(MC_RANKMISSES, 1);
+    }
+    METRIC_STOP(MP_COURTOFFSET, start);
+    return;
+}		/* -----  end of function calendar_offset  ----- */
+
+
+/*
+ * Description: Counts court days between two dates.
+ *
+ * Parameters: The calendar, the starting date, and the ending date.
+ *
+ * Returns: The number of court days, positive if date1 is before date2 and
+ * negative otherwise.
+ *
+ * Algorithm: Counts the court days after the earlier date up to and
+ * including the later date, which is the inverse of calendar_offset().
+ */
+
+int calendar_difference(const struct CourtCalendar *cal,
+                        struct DateTime *date1, struct DateTime *date2)
+{
+    int jdn1, jdn2, low, high, count, sign;
+    METRIC_STAMP(start);
+
+    METRIC_START(MP_COURTDIFF, start);
+    jdn1 = jdncnvrt(date1);
+    jdn2 = jdncnvrt(date2);
+    if (jdn1 <= jdn2) {
+        low = jdn1 - cal->firstjdn;
+        high = jdn2 - cal->firstjdn;
+        sign = 1;
+    } else {
+        low = jdn2 - cal->firstjdn;
+        high = jdn1 - cal->firstjdn;
+        sign = -1;
+    }
+
+    if (cal->courtrank != NULL && low >= 0 && high < cal->numdays) {
+        count = cal->courtrank[high+1] - cal->courtrank[low+1];
+        countmetric(MC_RANKHITS, 1);
+    } else {
+        countmetric(MC_RANKMISSES, 1);
+        count = 0;
+        for (low++; low <= high; low++)
+            if (!calendar_isholiday(cal, cal->firstjdn + low))
+                count++;
+    }
+    METRIC_STOP(MP_COURTDIFF, start);
+    return sign * count;
+}		/* -----  end of function calendar_difference  ----- */
+
+
+/*
+ * Description: Re-runs the holiday rules for the days of the given months
+ * after the rules for those months have changed, and rebuilds the offset
+ * tables if the calendar has them.
+ *
+ * Parameters: The calendar and a mask with bit (month - 1) set for each
+ * month whose rules changed.  The ALLMONTHS bit means every month.
+ *
+ * Returns: Zero if successful, -1 if memory could not be allocated.
+ *
+ * Algorithm: Only the days of the changed months are converted and run
+ * through the rules; every other bit is left as it is.  A bitmap that lives
+ * in a rule pack is copied before it is changed.  The offset tables are
+ * running counts, so they are rebuilt in full, which is a single pass over
+ * the bitmap.
+ */
+
+int refreshcalendar(struct CourtCalendar *cal, unsigned int monthmask)
+{
+    struct DateTime dt;
+    uint32_t *bits;
+    int year, month, firstday, lastday, day;
+
+    if (monthmask == 0 || cal->holidaybits == NULL)
+        return 0;
+    if (monthmask & (1u << (ALLMONTHS-1)))
+        monthmask = (1u << (ALLMONTHS-1)) - 1; /* all twelve months */
+
+    if (!cal->ownsbits) {
+        bits = countedmalloc(CALENDARWORDS(cal->numdays) * sizeof(uint32_t));
+        if (bits == NULL)
+            return -1;
+        memcpy(bits, cal->holidaybits,
+               CALENDARWORDS(cal->numdays) * sizeof(uint32_t));
+        cal->holidaybits = bits;
+        cal->ownsbits = 1;
+    }
+
+    for (year = cal->firstyear; year <= cal->lastyear; year++) {
+        for (month = 1; month < ALLMONTHS; month++) {
+            if ((monthmask & (1u << (month-1))) == 0)
+                continue;
+            dt.year = year;
+            dt.month = month;
+            dt.day = 1;
+            firstday = jdncnvrt(&dt) - cal->firstjdn;
+            dt.year = (month == 12) ? year + 1 : year;
+            dt.month = (month == 12) ? 1 : month + 1;
+            lastday = jdncnvrt(&dt) - cal->firstjdn;
+            for (day = firstday; day < lastday; day++) {
+                setdate(cal->firstjdn + day, &dt);
+                if (ruleholiday(cal->rules, &dt))
+                    cal->holidaybits[day >> 5] |= (1u << (day & 31));
+                else
+                    cal->holidaybits[day >> 5] &= ~(1u << (day & 31));
+            }
+        }
+    }
+
+    if (cal->courtrank == NULL)
+        return 0;
+    if (cal->ownstables) {
+        countedfree(cal->courtrank);
+        countedfree(cal->courtdays);
+    }
+    cal->courtrank = NULL;
+    cal->courtdays = NULL;
+    cal->ownstables = 0;
+    return materializecalendar(cal);
+}		/* -----  end of function refreshcalendar  ----- */
+
+
+/*
+ * Description: Releases the memory held by a calendar.
+ * Parameters: The calendar.
+ * Returns: Nothing.
+ */
+
+void freecalendar(struct CourtCalendar *cal)
+{
+    if (cal->ownsbits)
+        countedfree(cal->holidaybits);
+    if (cal->ownstables) {
+        countedfree(cal->courtrank);
+        countedfree(cal->courtdays);
+    }
+    memset(cal, 0, sizeof(*cal));
+    return;
+}		/* -----  end of function freecalendar  ----- */
+
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description: Runs the holiday rules for a single date.
+ *
+ * Parameters: The holiday hash table and the date to check.
+ *
+ * Returns: 1 if any rule for the date's month, or any ALLMONTHS rule, makes
+ * the date a holiday.  Otherwise 0.
+ *
+ * Notes: This does the same job as isholiday(), but against the table passed
+ * in rather than THE global holidayhashtable, so a calendar can be built for
+ * rules that are not (or not yet) the live ones.
+ */
+
+static int ruleholiday (struct HolidayNode *rules[], struct DateTime *dt)
+{
+    struct HolidayNode *node;
+
+    if (rules == NULL)
+        return 0;
+
+    for (node = rules[dt->month-1]; node != NULL; node = node->nextrule)
+        if (processhrule(dt, node))
+            return 1;
+    for (node = rules[ALLMONTHS-1]; node != NULL; node = node->nextrule)
+        if (processhrule(dt, node))
+            return 1;
+
+    return 0;
+}		/* -----  end of function ruleholiday  ----- */
+
+
+/*
+ * Description: Counts court days one day at a time.
+ *
+ * Parameters: The calendar, the JDN to start from, and the number of court
+ * days to count (negative to count backward).
+ *
+ * Returns: The JDN of the resulting court day.
+ */
+
+static int stepcourtdays (const struct CourtCalendar *cal, int jdn,
+                          int numdays)
+{
+    int step = (numdays < 0) ? -1 : 1;
+
+    while (numdays != 0) {
+        jdn += step;
+        if (!calendar_isholiday(cal, jdn))
+            numdays -= step;
+    }
+    return jdn;
+}		/* -----  end of function stepcourtdays  ----- */
+
+
+/*
+ * Description: Fills in a DateTime from a JDN.
+ */
+
+static void setdate (int jdn, struct DateTime *dt)
+{
+    jdn2greg(jdn, dt);
+    dt->jdn = jdn;
+    dt->day_of_week = wkday_sakamoto(dt);
+    return;
+}		/* -----  end of function setdate  ----- */
@@ -0,0 +1,169 @@
+/*
+ * Filename: courtcal.h
+ * Project: DocketMaster
+ *
+ * Description: The court calendar module materializes a jurisdiction's
+ * holiday rules into a bitmap of non-court days.  Once the bitmap is built,
+ * asking whether a date is a holiday is a single bit test instead of a walk
+ * through the holiday hash table.  The calendar can also be materialized
+ * into offset tables, which turn court-day counting into table lookups.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 09:04:10 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: The rule builder builds THE calendar for the jurisdiction after the
+ * holiday rules are loaded.  The rule pack module saves the bitmap to disk
+ * and maps it back in.
+ *
+ * File Format:
+ * Restrictions: Only the years between firstyear and lastyear are
+ * materialized.  Dates outside that span are answered by running the holiday
+ * rules directly, which is correct but slow.
+ *
+ * Error Handling:
+ * References:
+ * Notes:
+ */
+
+#ifndef _COURTCAL_H_INCLUDED_
+#define _COURTCAL_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdint.h>
+#include "datetools.h"
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define CAL_FIRSTYEAR 1990 /* default first year materialized */
+#define CAL_LASTYEAR 2069  /* default last year materialized */
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+struct CourtCalendar {
+    int firstyear; /* first materialized year */
+    int lastyear; /* last materialized year */
+    int firstjdn; /* JDN of January 1 of firstyear */
+    int numdays; /* number of days in the materialized span */
+    uint32_t *holidaybits; /* one bit per day, set if the day is NOT a court
+                              day (weekend or holiday). */
+    struct HolidayNode **rules; /* the holiday hash table the calendar was
+                                   built from; used for dates outside the
+                                   span. */
+    int ownsbits; /* nonzero if holidaybits was allocated by buildcalendar(),
+                     zero if it points into a mapped rule pack. */
+
+    /* Offset tables, built by materializecalendar().  NULL until then. */
+    int32_t *courtrank; /* courtrank[i] = number of court days in the span
+                           before day i; numdays + 1 entries. */
+    int32_t *courtdays; /* JDN of every court day in the span, in order */
+    int numcourtdays;
+    int ownstables; /* nonzero if the tables were allocated by
+                       materializecalendar() */
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Builds the holiday bitmap for every day from January 1 of
+ * firstyear through December 31 of lastyear.
+ *
+ * Parameters: The calendar to build, the holiday hash table to build it
+ * from, and the first and last years to materialize.
+ *
+ * Returns: Zero if successful, -1 if the span is invalid or memory could not
+ * be allocated.
+ */
+
+int buildcalendar(struct CourtCalendar *cal, struct HolidayNode *rules[],
+                  int firstyear, int lastyear);
+
+/*
+ * Description: Determines whether the day with the given JDN is a holiday
+ * (i.e., is not a court day).
+ *
+ * Parameters: The calendar and a Julian Day Number.
+ *
+ * Returns: 1 if the day is a holiday or weekend, 0 if it is a court day.
+ */
+
+int calendar_isholiday(const struct CourtCalendar *cal, int jdn);
+
+/*
+ * Description: Builds the court-day offset tables from the holiday bitmap.
+ *
+ * Parameters: A calendar whose bitmap has been built.
+ *
+ * Returns: Zero if successful, -1 if memory could not be allocated.
+ */
+
+int materializecalendar(struct CourtCalendar *cal);
+
+/*
+ * Description: Calculates the date a number of court days before or after a
+ * date.  Same counting rules as courtday_offset(): the first date is
+ * excluded and the end date is counted.
+ *
+ * Parameters: The calendar, the starting date, a pointer to the DateTime
+ * that receives the result, and the number of court days to count (negative
+ * to count backward).
+ *
+ * Returns: Nothing; the result is stored in calc_date.
+ */
+
+void calendar_offset(const struct CourtCalendar *cal,
+                     struct DateTime *orig_date, struct DateTime *calc_date,
+                     int numdays);
+
+/*
+ * Description: Counts court days between two dates.  Same counting rules as
+ * courtday_difference().
+ *
+ * Parameters: The calendar, the starting date, and the ending date.
+ *
+ * Returns: The number of court days, positive if date1 is before date2 and
+ * negative otherwise.
+ */
+
+int calendar_difference(const struct CourtCalendar *cal,
+                        struct DateTime *date1, struct DateTime *date2);
+
+/*
+ * Description: Re-runs the holiday rules for the days of the given months
+ * after the rules for those months have changed, and rebuilds the offset
+ * tables if the calendar has them.
+ *
+ * Parameters: The calendar and a mask with bit (month - 1) set for each
+ * month whose rules changed.  The ALLMONTHS bit means every month.
+ *
+ * Returns: Zero if successful, -1 if memory could not be allocated.
+ */
+
+int refreshcalendar(struct CourtCalendar *cal, unsigned int monthmask);
+
+/*
+ * Description: Releases the memory held by a calendar.  A calendar whose
+ * bitmap lives in a rule pack is simply reset.
+ *
+ * Parameters: The calendar.
+ *
+ * Returns: Nothing.
+ */
+
+void freecalendar(struct CourtCalendar *cal);
+
+/*
+ * Description: Returns the number of 32-bit words needed to hold the holiday
+ * bits for a span of numdays days.
+ */
+
+#define CALENDARWORDS(numdays) (((numdays) + 31) / 32)
+
+#endif	/* _COURTCAL_H_INCLUDED_ */
@@ -10,7 +10,7 @@
  *
  * Version: 1.0.20
  * Created: 02/03/2012 07:26:12 AM
- * Last Modified: Wed Dec 16 16:56:07 2020
+ * Last Modified: Mon Oct 19 10:35:03 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -32,7 +32,54 @@
 
 
 /* #####   HEADER FILE INCLUDES   ########################################### */
+#include <stdlib.h>
+#include <string.h>
 #include "eprocessor.h"
+#include "metrics.h"
+#include "arena.h"
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static void setdependency (struct EventGraph* graph, int row,
+                           struct CourtEventNode* eventnode, int countperiod);
+    /* Stores the dependency of an event on its trigger in the matrix */
+
+static struct CourtEventNode* findvertex (const char *eventname,
+                                         struct CourtEventNode **vertices,
+                                         int numvertices);
+    /* Binary search of the vertex index for an event */
+
+static int vertexcmp (const void *key, const void *member);
+    /* bsearch() comparison for findvertex */
+
+static int scheduledate (const struct CourtCalendar* cal,
+                         const struct CourtEvent* event,
+                         const struct Dependency* edge, int triggerjdn,
+                         enum SERVICEMETHOD service, enum PARTY party);
+    /* Date of an event from the date of its trigger */
+
+static int countdays (const struct CourtCalendar* cal, int jdn, int count,
+                      int courtdays);
+    /* Counts days forward or back from a date */
+
+static int countmonths (int jdn, int months);
+    /* Counts calendar months forward or back from a date */
+
+static int extraservicedays (const struct CourtEvent* event,
+                             enum SERVICEMETHOD service, int* courtdays);
+    /* Extra days an event gets for the way its trigger was served */
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
+
+/* Extra days for service when an event has no custom rule (Cal. Code Civ.
+Proc. 1010.6, 1013): five calendar days for mail in the state, ten out of the
+state, twenty out of the country, and two court days for express mail, fax,
+and electronic service. */
+static const struct ExtraServiceDays defaultservicedays = {
+    (1<<3) | (1<<4) | (1<<5), /* EXPRESS_MAIL_COURT | FAX_SERVICE_COURT |
+                                 ELECTRONIC_SERVICE_COURT */
+    5, 10, 20, 2, 2, 2
+};
 
 /* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
 
@@ -136,32 +183,13 @@ struct CourtEventNode* searchforevent (char *eventname,
 {
 
     struct CourtEventNode *cur_pos; /* current position */
-    char *searchstring, *eventstring;
+    METRIC_STAMP(start);
 
-    cur_pos = list;
-    searchstring = eventname;
-    eventstring = list->eventdata.shorttitle;
-
-    while (cur_pos != NULL)
-    {
-        if (searchstring != NULL && eventstring != NULL &&
-               *searchstring == *eventstring)
-        {
-            searchstring++;
-            eventstring++;
-        }
-        else if (searchstring == NULL && eventstring == NULL)
-        {
-            return cur_pos; /* found a match */
-        }
-        else
-        {
-                cur_pos = cur_pos->nextevent;
-                searchstring = eventname;
-                eventstring = list->eventdata.shorttitle;
-                continue;
-        }
-    }
+    METRIC_START(MP_SEARCHEVENT, start);
+    for (cur_pos = list; cur_pos != NULL; cur_pos = cur_pos->nextevent)
+        if (eventcmp(eventname, cur_pos->eventdata.shorttitle) == 0)
+            break; /* found a match */
+    METRIC_STOP(MP_SEARCHEVENT, start);
 
     return cur_pos;
 }
@@ -240,4 +268,424 @@ void followchain (CourtEvent* startingvertex, struct EventGraph* graph)
 
 }
 
+/* 
+ * Description:  Resolves the triggers named in an event into dependencies
+ * in the adjacency matrix.
+ *
+ * Parameters:  Takes a pointer to the event's node, which must already be in
+ * the graph's event list with its eventposn set, and the EventGraph.
+ *
+ * Returns:  The number of triggers found.  A trigger that names an event not
+ * (yet) in the list is left unresolved.
+ *
+ * Algorithm:  The event's column is cleared first, so relinking an event
+ * whose triggers have changed drops the old dependencies.  Each trigger
+ * found sets the cell at [trigger's row][event's column].
+ */
+
+int linkevent (struct CourtEventNode* eventnode, struct EventGraph* graph)
+{
+    struct AdjacencyMatrix *matrix = &graph->dependencymatrix;
+    struct CourtEventNode *trigger;
+    int row, col, count;
+
+    col = eventnode->eventposn;
+    for (row = 0; row < matrix->trigger_rows; row++) {
+        if (matrix->rowptr[row][col].dependencyhandle != NULL) {
+            memset(&matrix->rowptr[row][col], 0, sizeof(struct Dependency));
+            graph->numedges--;
+        }
+    }
+
+    count = 0;
+    if (eventnode->eventdata.ntc_dependency1[0] != '\0') {
+        trigger = searchforevent(eventnode->eventdata.ntc_dependency1,
+                                 graph->eventlist);
+        if (trigger != NULL && trigger != eventnode) {
+            setdependency(graph, trigger->eventposn, eventnode,
+                          eventnode->eventdata.ntcpd1);
+            count++;
+        }
+    }
+    if (eventnode->eventdata.ntc_dependency2[0] != '\0') {
+        trigger = searchforevent(eventnode->eventdata.ntc_dependency2,
+                                 graph->eventlist);
+        if (trigger != NULL && trigger != eventnode) {
+            setdependency(graph, trigger->eventposn, eventnode,
+                          eventnode->eventdata.ntcpd2);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/* 
+ * Description:  Finishes building the EventGraph once the lexical analyzer
+ * has added every event to the list.
+ *
+ * Parameters:  Takes a pointer to the EventGraph.
+ *
+ * Returns:  The number of dependencies, or -1 if memory could not be
+ * allocated.
+ *
+ * Algorithm:  The events are numbered in list order, which is the order of
+ * their short titles, and the matrix is sized to match.  A temporary index
+ * of the nodes in that order lets each trigger be found by binary search,
+ * so resolving all the dependencies takes O(n log n) rather than a walk of
+ * the list for every trigger.
+ */
+
+int finalizeeventgraph (struct EventGraph* graph)
+{
+    struct CourtEventNode **vertices; /* the nodes in list order */
+    struct CourtEventNode *node, *trigger;
+    int posn, count;
+
+    count = numberofevents(graph->eventlist);
+    vertices = countedmalloc((count + 1) * sizeof(struct CourtEventNode *));
+    if (vertices == NULL)
+        return -1;
+
+    posn = 0;
+    for (node = graph->eventlist; node != NULL; node = node->nextevent) {
+        node->eventposn = posn;
+        vertices[posn++] = node;
+    }
+    graph->listsize = count;
+
+    if (resizeadjacencymatrix(graph, (count > 0) ? count : 1) != 0) {
+        countedfree(vertices);
+        return -1;
+    }
+
+    for (posn = 0; posn < count; posn++) {
+        node = vertices[posn];
+        trigger = findvertex(node->eventdata.ntc_dependency1, vertices,
+                             count);
+        if (trigger != NULL && trigger != node)
+            setdependency(graph, trigger->eventposn, node,
+                          node->eventdata.ntcpd1);
+        trigger = findvertex(node->eventdata.ntc_dependency2, vertices,
+                             count);
+        if (trigger != NULL && trigger != node)
+            setdependency(graph, trigger->eventposn, node,
+                          node->eventdata.ntcpd2);
+    }
+
+    countedfree(vertices);
+    return graph->numedges;
+}
+
+/* 
+ * Description:  Fills in the dependency of an event on its trigger.
+ *
+ * Parameters:  The Dependency to fill in, the triggered event, and the
+ * signed count from the events file (negative if the event comes before its
+ * trigger).
+ *
+ * Returns:  Nothing.
+ */
+
+void makedependency (struct Dependency* edge, struct CourtEvent* event,
+                     int countperiod)
+{
+    edge->dependencyhandle = event;
+    edge->dependencyhandle_deft = NULL;
+    edge->dependencyflag = TRIGGERS | DEADLINE;
+    if (countperiod < 0)
+        SET_FLAG(edge->dependencyflag, BEFOREDEPENDENCY);
+    edge->countperiod = (char) abs(countperiod); /* fits: see MAXCOUNTPERIOD */
+    edge->countperiod_deft = NOT_PARTY_SENSITIVE;
+    return;
+}
+
+/* 
+ * Description:  Computes the dates of every event in the chain that starts
+ * at a trigger.
+ *
+ * Parameters:  The finalized EventGraph, the materialized court calendar,
+ * the trigger's eventposn and date, how the trigger was served, whose
+ * deadlines to compute, the array to fill, and its size.
+ *
+ * Returns:  The number of events scheduled, or -1 if the trigger is not in
+ * the graph.
+ *
+ * Algorithm:  Breadth first from the trigger: the schedule array doubles as
+ * the queue.  Each event's row of the matrix gives the events it triggers,
+ * and each of those is dated from the event's date by scheduledate().  An
+ * event reached twice (it has two triggers in the chain) keeps the first
+ * date found, which is the one from the trigger nearest the start.
+ *
+ * Notes:  Whether an event is already scheduled is found by a scan of the
+ * schedule.  Chains are short, and the scan saves allocating a visited set,
+ * so the function allocates nothing.
+ */
+
+int computeschedule (const struct EventGraph* graph,
+                     const struct CourtCalendar* cal, int triggerposn,
+                     int triggerjdn, enum SERVICEMETHOD service,
+                     enum PARTY party, struct ScheduledEvent* schedule,
+                     int maxevents)
+{
+    const struct AdjacencyMatrix *matrix = &graph->dependencymatrix;
+    const struct Dependency *edge;
+    const struct CourtEventNode *node;
+    int head, count, col, index;
+    METRIC_STAMP(start);
+
+    if (triggerposn < 0 || triggerposn >= graph->listsize || maxevents < 1)
+        return -1;
+    METRIC_START(MP_CHAIN, start);
+    for (node = graph->eventlist; node != NULL &&
+            node->eventposn != triggerposn; node = node->nextevent)
+        ;
+    if (node == NULL) {
+        METRIC_STOP(MP_CHAIN, start);
+        return -1;
+    }
+
+    schedule[0].event = &node->eventdata;
+    schedule[0].eventid = triggerposn;
+    schedule[0].jdn = triggerjdn;
+    schedule[0].flags = node->eventdata.eventflags;
+    schedule[0].ruleid = -1;
+    count = 1;
+
+    for (head = 0; head < count; head++) {
+        if (schedule[head].eventid >= matrix->trigger_rows)
+            continue;
+        for (col = 0; col < matrix->triggeredby_cols; col++) {
+            edge = &matrix->rowptr[schedule[head].eventid][col];
+            if (edge->dependencyhandle == NULL ||
+                    !TEST_FLAG(edge->dependencyflag, TRIGGERS))
+                continue;
+            for (index = 0; index < count && schedule[index].eventid != col;
+                    index++)
+                ;
+            if (index < count || count == maxevents)
+                continue;
+
+            schedule[count].event = edge->dependencyhandle;
+            schedule[count].eventid = col;
+            schedule[count].jdn = scheduledate(cal, edge->dependencyhandle,
+                                               edge, schedule[head].jdn,
+                                               service, party);
+            schedule[count].flags = edge->dependencyhandle->eventflags |
+                (edge->dependencyflag << 8);
+            schedule[count].ruleid = schedule[head].eventid;
+            count++;
+        }
+    }
+    countmetric(MC_DEADLINES, count);
+    METRIC_STOP(MP_CHAIN, start);
+    return count;
+}
+
 /* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/* 
+ * Description:  Binary search of the vertex index for an event.
+ *
+ * Parameters:  The event's short title, and the index of the nodes sorted
+ * by short title.
+ *
+ * Returns:  The event's node, or NULL if the name is empty or not found.
+ */
+
+static struct CourtEventNode* findvertex (const char *eventname,
+                                         struct CourtEventNode **vertices,
+                                         int numvertices)
+{
+    struct CourtEventNode **found;
+
+    if (eventname[0] == '\0')
+        return NULL;
+    found = bsearch(eventname, vertices, numvertices,
+                    sizeof(struct CourtEventNode *), vertexcmp);
+    return (found != NULL) ? *found : NULL;
+}
+
+/* 
+ * Description:  bsearch() comparison for findvertex: an event name against
+ * a node in the index.
+ */
+
+static int vertexcmp (const void *key, const void *member)
+{
+    const struct CourtEventNode *node =
+        *(struct CourtEventNode * const *) member;
+
+    return eventcmp(key, node->eventdata.shorttitle);
+}
+
+/* 
+ * Description:  Stores the dependency of an event on its trigger in the
+ * matrix.
+ *
+ * Parameters:  The EventGraph, the trigger's row, the event's node, and the
+ * signed count from the events file (negative if the event comes before its
+ * trigger).
+ */
+
+static void setdependency (struct EventGraph* graph, int row,
+                           struct CourtEventNode* eventnode, int countperiod)
+{
+    struct Dependency *edge;
+
+    edge = &graph->dependencymatrix.rowptr[row][eventnode->eventposn];
+    if (edge->dependencyhandle == NULL)
+        graph->numedges++;
+    makedependency(edge, &eventnode->eventdata, countperiod);
+    return;
+}
+
+/* 
+ * Description:  Dates an event from the date of its trigger.
+ *
+ * Parameters:  The calendar, the event, its dependency on the trigger, the
+ * trigger's date, how the trigger was served, and whose deadline it is.
+ *
+ * Returns:  The event's date (JDN).
+ *
+ * Algorithm:  The count is taken in the event's count units, forward, or
+ * back if the event comes before its trigger.  An event that requires
+ * notice then gets the extra days for the way the trigger was served, in
+ * the same direction.  A count in calendar days that ends on a weekend or
+ * holiday moves to the next court day (Cal. Code Civ. Proc. 12a), or the
+ * court day before when counting back.
+ */
+
+static int scheduledate (const struct CourtCalendar* cal,
+                         const struct CourtEvent* event,
+                         const struct Dependency* edge, int triggerjdn,
+                         enum SERVICEMETHOD service, enum PARTY party)
+{
+    int count, direction, jdn, extra, extracourt;
+
+    count = edge->countperiod;
+    if (party == PARTY_DEFENDANT &&
+            TEST_FLAG(edge->dependencyflag, PARTYSENSITIVE) &&
+            edge->countperiod_deft != NOT_PARTY_SENSITIVE)
+        count = edge->countperiod_deft;
+    direction = TEST_FLAG(edge->dependencyflag, BEFOREDEPENDENCY) ? -1 : 1;
+
+    if (TEST_FLAG(event->countunits, COUNT_WEEKS))
+        jdn = countdays(cal, triggerjdn, direction * count * 7, 0);
+    else if (TEST_FLAG(event->countunits, COUNT_MONTHS))
+        jdn = countmonths(triggerjdn, direction * count);
+    else if (TEST_FLAG(event->countunits, COUNT_QUARTERS))
+        jdn = countmonths(triggerjdn, direction * count * 3);
+    else if (TEST_FLAG(event->countunits, COUNT_YEARS))
+        jdn = countmonths(triggerjdn, direction * count * 12);
+    else
+        jdn = countdays(cal, triggerjdn, direction * count,
+                        !TEST_FLAG(event->eventflags, CALENDARYDAYS));
+
+    if (TEST_FLAG(event->eventflags, NTCRQD)) {
+        extra = extraservicedays(event, service, &extracourt);
+        if (extra > 0)
+            jdn = countdays(cal, jdn, direction * extra, extracourt);
+    }
+
+    while (calendar_isholiday(cal, jdn))
+        jdn += direction;
+    return jdn;
+}
+
+/* 
+ * Description:  Counts days forward or back from a date.
+ * Parameters:  The calendar, the date, the signed count, and nonzero to count
+ * court days.
+ * Returns:  The resulting date (JDN).
+ */
+
+static int countdays (const struct CourtCalendar* cal, int jdn, int count,
+                      int courtdays)
+{
+    struct DateTime from, to;
+
+    if (!courtdays || count == 0)
+        return jdn + count;
+    jdn2greg(jdn, &from);
+    calendar_offset(cal, &from, &to, count);
+    return jdncnvrt(&to);
+}
+
+/* 
+ * Description:  Counts calendar months forward or back from a date.  A day
+ * past the end of the resulting month becomes its last day (January 31 plus
+ * one month is February 28 or 29).
+ * Returns:  The resulting date (JDN).
+ */
+
+static int countmonths (int jdn, int months)
+{
+    struct DateTime date, first;
+    int month, lastday;
+
+    jdn2greg(jdn, &date);
+    month = date.year * 12 + (date.month - 1) + months;
+    date.year = month / 12;
+    date.month = month % 12 + 1;
+
+    memset(&first, 0, sizeof(first));
+    first.year = (date.month == 12) ? date.year + 1 : date.year;
+    first.month = (date.month == 12) ? 1 : date.month + 1;
+    first.day = 1;
+    jdn2greg(jdncnvrt(&first) - 1, &first);
+    lastday = first.day;
+    if (date.day > lastday)
+        date.day = lastday;
+    return jdncnvrt(&date);
+}
+
+/* 
+ * Description:  Finds the extra days an event gets for the way its trigger
+ * was served.
+ *
+ * Parameters:  The event, the service method, and where to put whether the
+ * days are court days (nonzero) or calendar days.
+ *
+ * Returns:  The number of extra days.
+ *
+ * Notes:  The event's own rule applies if it has CUSTOMSERVICE, otherwise
+ * defaultservicedays.
+ */
+
+static int extraservicedays (const struct CourtEvent* event,
+                             enum SERVICEMETHOD service, int* courtdays)
+{
+    const struct ExtraServiceDays *rule = &defaultservicedays;
+
+    if (TEST_FLAG(event->eventflags, CUSTOMSERVICE))
+        rule = &event->customservicerule;
+
+    *courtdays = 0;
+    switch (service) {
+        case SERVICE_INSTATEMAIL:
+            *courtdays = TEST_FLAG(rule->counttypeflags, IN_STATE_MAIL_COURT);
+            return rule->in_state_maildays;
+        case SERVICE_OUTOFSTATEMAIL:
+            *courtdays = TEST_FLAG(rule->counttypeflags,
+                                   OUT_OF_STATE_MAIL_COURT);
+            return rule->out_of_state_maildays;
+        case SERVICE_OUTOFCOUNTRYMAIL:
+            *courtdays = TEST_FLAG(rule->counttypeflags,
+                                   OUT_OF_COUNTRY_MAIL_COURT);
+            return rule->out_of_country_maildays;
+        case SERVICE_EXPRESSMAIL:
+            *courtdays = TEST_FLAG(rule->counttypeflags, EXPRESS_MAIL_COURT);
+            return rule->express_mail_days;
+        case SERVICE_FAX:
+            *courtdays = TEST_FLAG(rule->counttypeflags, FAX_SERVICE_COURT);
+            return rule->fax_servicedays;
+        case SERVICE_ELECTRONIC:
+            *courtdays = TEST_FLAG(rule->counttypeflags,
+                                   ELECTRONIC_SERVICE_COURT);
+            return rule->electronic_servicedays;
+        case SERVICE_PERSONAL:
+            break;
+    }
+    return 0;
+}
@@ -10,7 +10,7 @@
  *
  * Version: 1.0.20
  * Created: 02/03/2012 07:05:40 AM
- * Last Modified: Sat Dec 19 00:17:27 2020
+ * Last Modified: Mon Oct 19 09:29:27 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -29,8 +29,33 @@
  * Notes: 
  */
 
+#ifndef _EPROCESSOR_H_INCLUDED_
+#define _EPROCESSOR_H_INCLUDED_
+
 /* #####   HEADER FILE INCLUDES   ########################################### */
 #include "graphmgr.h"
+#include "courtcal.h"
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+/* How the trigger was served, which decides the extra days for service. */
+enum SERVICEMETHOD {SERVICE_PERSONAL, SERVICE_INSTATEMAIL, SERVICE_OUTOFSTATEMAIL,
+                    SERVICE_OUTOFCOUNTRYMAIL, SERVICE_EXPRESSMAIL, SERVICE_FAX,
+                    SERVICE_ELECTRONIC};
+
+/* Whose deadlines are computed, for party-sensitive dependencies. */
+enum PARTY {PARTY_PLAINTIFF, PARTY_DEFENDANT};
+
+/* One event of a computed schedule. */
+struct ScheduledEvent {
+    const struct CourtEvent *event;
+    int eventid; /* the event's eventposn in the graph */
+    int jdn; /* Julian Day Number of the event's date */
+    unsigned int flags; /* the event's eventflags, and the dependencyflag of
+                           the rule that set its date in bits 8-15 */
+    int ruleid; /* eventid of the trigger whose rule set the date; -1 for
+                   the event the schedule starts from */
+};
 
 /* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
 
@@ -110,9 +135,65 @@ extern void followchain (struct CourtEvent* startingvertex,
                          struct EventGraph* graph);
 
 /* 
- * Description:  displays the scheduled chain of events
- * Parameters:  pointer to eventnode
- * Returns:  No return value
+ * Description:  Resolves the triggers named in an event into dependencies
+ * in the adjacency matrix, replacing any it had before.
+ *
+ * Parameters:  Takes a pointer to the event's node, which must already be in
+ * the graph's event list with its eventposn set, and the EventGraph.
+ *
+ * Returns:  The number of triggers found.
+ */
+
+extern int linkevent (struct CourtEventNode* eventnode,
+                      struct EventGraph* graph);
+
+/* 
+ * Description:  Finishes building the EventGraph once the lexical analyzer
+ * has added every event to the list: numbers the events, sizes the
+ * dependency matrix, and resolves each event's triggers into dependencies.
+ *
+ * Parameters:  Takes a pointer to the EventGraph.
+ *
+ * Returns:  The number of dependencies, or -1 if memory could not be
+ * allocated.
  */
 
-void displayschedule(struct CourtEventNode *eventnodenode);
+extern int finalizeeventgraph (struct EventGraph* graph);
+
+/* 
+ * Description:  Fills in the dependency of an event on its trigger.
+ *
+ * Parameters:  Takes a pointer to the Dependency to fill in, the triggered
+ * event, and the signed count from the events file (negative if the event
+ * comes before its trigger).  The count must be within MAXCOUNTPERIOD
+ * either way; the parser rejects records whose counts are not.
+ *
+ * Returns:  No return value.
+ */
+
+extern void makedependency (struct Dependency* edge, struct CourtEvent* event,
+                            int countperiod);
+
+/* 
+ * Description:  Computes the dates of every event in the chain that starts
+ * at a trigger.
+ *
+ * Parameters:  The finalized EventGraph, the materialized court calendar,
+ * the trigger's eventposn and date (JDN), how the trigger was served, whose
+ * deadlines to compute, the array to fill, and its size (listsize entries
+ * is always enough).
+ *
+ * Returns:  The number of events scheduled, the trigger first, or -1 if the
+ * trigger is not in the graph.
+ *
+ * Notes:  Nothing is allocated, so any number of threads may compute
+ * schedules from the same graph and calendar at once.
+ */
+
+extern int computeschedule (const struct EventGraph* graph,
+                            const struct CourtCalendar* cal, int triggerposn,
+                            int triggerjdn, enum SERVICEMETHOD service,
+                            enum PARTY party,
+                            struct ScheduledEvent* schedule, int maxevents);
+
+#endif	/* _EPROCESSOR_H_INCLUDED_ */
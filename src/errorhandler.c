@@ -6,7 +6,7 @@
  *
  * Version: 1.0.20
  * Created: 03/11/2012 12:49:17 PM
- * Last Modified: Wed Dec 16 14:28:14 2020
+ * Last Modified: Mon Oct 19 09:09:14 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -22,11 +22,13 @@
  * Notes: 
  */
 
-#include <stdlib.h>
-
-
 /* #####   HEADER FILE INCLUDES   ########################################### */
 
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "errorhandler.h"
+
 /* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ########################### */
 
 /* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ################ */
@@ -37,8 +39,23 @@
 
 /* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
 
+static struct ErrorRecord *errorlog; /* the errors recorded so far */
+static int numerrors; /* number of errors recorded */
+static int logsize; /* number of entries allocated in errorlog */
+static pthread_mutex_t loglock = PTHREAD_MUTEX_INITIALIZER; /* guards the
+                                                                log */
+
+/* Each thread reading a file has its own place in it. */
+static _Thread_local const char *curfilename; /* file errors are recorded
+                                                 against */
+static _Thread_local int curline; /* line errors are recorded against */
+static _Thread_local int threaderrors; /* errors recorded by this thread */
+
 /* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
 
+static const char *errormessage (int errcode);
+    /* Returns the text describing an error code */
+
 /* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
 
 /*
@@ -64,45 +81,183 @@ void usage(char *program_name)
 
 /*
  * Description: Receives an error code and processes it.
- * Arguments:
- * Returns:
- * Algorithm:
+ * Arguments: The error code.
+ * Returns: Nothing.
+ * Algorithm: A bad command line exits the program.  Every other error is
+ * added to the error log against the current file and line, and processing
+ * continues.
  * References:
- * Notes:
+ * Notes: Callers that know the column of the error should call
+ * recorderror() instead.
  */
 void errorprocessor(int errcode)
 {
     switch (errcode) {
-        case NULSTRING:
-            fprintf(stderr, "## Error No. %d", errcode);
-            exit(EXIT_FAILURE);
-            break;
         case BADCOMMANDLINE:
             fprintf(stderr, "## Error No. %d: Bad option.", errcode);
             usage(program_name);
             break;
-        case NOFDELIM:
-            fprintf(stderr, "## Error No. %d: No, or improper, field delimiters.\n"
-                    "## Input file expects fields separated by commas.\n\n",
-                    errcode);
-            exit(EXIT_FAILURE);
-            break;
-        case NOTDELIM:
-            fprintf(stderr, "## Error No. %d: No, or improper, text delimiters."
-                    "\n## Input file expects text fields enclosed with double "
-                    "quotes.\n\n", errcode);
-            exit(EXIT_FAILURE);
-            break;
-        case NOERROR: /*  fall through */
         default:
-            /* there is no error code or the error code is unknown. */
-            fprintf(stderr, "## Unknown Error.");
-            exit(EXIT_FAILURE);
+            recorderror(errcode, 0);
             break;
     }
     return;
 }		/* -----  end of function errorprocessor  ----- */
 
 
+/*
+ * Description: Sets the file and line that errors recorded from now on will
+ * be reported against.
+ * Arguments: The file name, which must stay valid until the errors are
+ * cleared, and the line number.
+ * Returns: Nothing.
+ */
+void seterrorcontext(const char *filename, int line)
+{
+    curfilename = filename;
+    curline = line;
+    return;
+}		/* -----  end of function seterrorcontext  ----- */
+
+
+/*
+ * Description: Adds an error to the error log.
+ * Arguments: The error code and the column where the error was found.
+ * Returns: Nothing.
+ * Notes: If the log cannot grow, the error is still counted, but it is
+ * reported without its location.  Safe to call from several threads.
+ */
+void recorderror(int errcode, int column)
+{
+    struct ErrorRecord *grown;
+    int newsize;
+
+    threaderrors++;
+    pthread_mutex_lock(&loglock);
+    if (numerrors == logsize) {
+        newsize = (logsize > 0) ? logsize * 2 : 32;
+        grown = realloc(errorlog, newsize * sizeof(struct ErrorRecord));
+        if (grown == NULL) {
+            numerrors++;
+            pthread_mutex_unlock(&loglock);
+            return;
+        }
+        errorlog = grown;
+        logsize = newsize;
+    }
+
+    errorlog[numerrors].filename = curfilename;
+    errorlog[numerrors].line = curline;
+    errorlog[numerrors].column = column;
+    errorlog[numerrors].errcode = errcode;
+    numerrors++;
+    pthread_mutex_unlock(&loglock);
+    return;
+}		/* -----  end of function recorderror  ----- */
+
+
+/*
+ * Description: Returns the number of errors recorded since the log was last
+ * cleared.
+ */
+int errorcount(void)
+{
+    int count;
+
+    pthread_mutex_lock(&loglock);
+    count = numerrors;
+    pthread_mutex_unlock(&loglock);
+    return count;
+}		/* -----  end of function errorcount  ----- */
+
+
+/*
+ * Description: Returns the number of errors recorded by the calling thread.
+ * Notes: A reader uses this to tell whether the record it just read had an
+ * error, without being confused by errors other threads record meanwhile.
+ */
+int threaderrorcount(void)
+{
+    return threaderrors;
+}		/* -----  end of function threaderrorcount  ----- */
+
+
+/*
+ * Description: Prints every recorded error, one per line.
+ * Arguments: The stream to print to.
+ * Returns: The number of errors printed.
+ * Notes: Call once the threads reading files have finished.
+ */
+int reporterrors(FILE *out)
+{
+    int index;
+    struct ErrorRecord *err;
+
+    for (index = 0; index < numerrors; index++) {
+        if (index >= logsize) {
+            fprintf(out, "## %d more errors could not be recorded.\n",
+                    numerrors - index);
+            break;
+        }
+        err = &errorlog[index];
+        fprintf(out, "%s:%d:%d: error %d: %s\n",
+                (err->filename != NULL) ? err->filename : "(no file)",
+                err->line, err->column, err->errcode,
+                errormessage(err->errcode));
+    }
+    return numerrors;
+}		/* -----  end of function reporterrors  ----- */
+
+
+/*
+ * Description: Empties the error log.
+ * Notes: Safe to call while other threads record errors, but not while
+ * reporterrors() runs.  The file names of the errors are not freed; they
+ * belong to the callers of seterrorcontext().
+ */
+void clearerrors(void)
+{
+    pthread_mutex_lock(&loglock);
+    free(errorlog);
+    errorlog = NULL;
+    numerrors = 0;
+    logsize = 0;
+    curfilename = NULL;
+    curline = 0;
+    pthread_mutex_unlock(&loglock);
+    return;
+}		/* -----  end of function clearerrors  ----- */
+
+
 /* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
 
+/*
+ * Description: Returns the text describing an error code.
+ */
+static const char *errormessage (int errcode)
+{
+    switch (errcode) {
+        case NULSTRING:
+            return "Empty record.";
+        case NOFDELIM:
+            return "No, or improper, field delimiters.  Input file expects "
+                "fields separated by commas.";
+        case NOTDELIM:
+            return "No, or improper, text delimiters.  Input file expects "
+                "text fields enclosed with double quotes.";
+        case BADFILE:
+            return "This is not a rules file.";
+        case BADVERSION:
+            return "This is not the correct version of the rules file.";
+        case EMPTYFILE:
+            return "The file is empty.";
+        case BADRECORD:
+            return "The record is missing a required field, or has a bad "
+                "one.";
+        case NOFILE:
+            return "The file does not exist or cannot be opened.";
+        case NOERROR: /*  fall through */
+        default:
+            return "Unknown Error.";
+    }
+}		/* -----  end of function errormessage  ----- */
@@ -7,7 +7,7 @@
  *
  * Version: 1.0.20
  * Created: 03/11/2012 12:33:51 PM
- * Last Modified: Wed Dec 16 14:27:58 2020
+ * Last Modified: Mon Oct 19 09:09:14 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -19,11 +19,13 @@
  * File Format: 
  * Restrictions: 
  *
- * Error Handling: Presently, most of the error conditions ungracefully exit the
- * application.  Currently, the module just collects all the errors.  At a
- * later point, a more robust exception handling mechanism will be implemented
- * with one goal: to recover from problems so that the program will continue
- * to run and produce accurate output.
+ * Error Handling: Errors found in the rules files do not stop the program.
+ * Each one is recorded, with the file, line, and column where it was found,
+ * in an error log that is reported once all the files have been read.  The
+ * bad record is skipped, so one pass over the files reports every error.
+ * Errors can be recorded from several threads at once; the file and line
+ * they are recorded against are kept per thread.
+ * Command-line errors still exit the application.
  *
  * References: 
  * Notes: 
@@ -35,6 +37,8 @@
 
 /* #####   HEADER FILE INCLUDES   ########################################### */
 
+#include <stdio.h>
+
 /* #####   EXPORTED MACROS   ################################################ */
 
 /* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
@@ -47,6 +51,11 @@
 #define NULSTRING 2
 #define NOFDELIM 3
 #define NOTDELIM 4
+#define BADFILE 5 /* not a rules file */
+#define BADVERSION 6 /* wrong version of the rules file */
+#define EMPTYFILE 7 /* file has no header line */
+#define BADRECORD 8 /* record is missing a required field, or has a bad one */
+#define NOFILE 9 /* file could not be opened */
 
 
 
@@ -54,6 +63,15 @@
 
 /* #####   EXPORTED DATA TYPES   ############################################ */
 
+/* One error found while reading a rules file. */
+struct ErrorRecord {
+    const char *filename; /* file the error was found in; NULL if none */
+    int line; /* line number in the file, counting from 1; 0 if none */
+    int column; /* column in the line, counting from 1; 0 if the error is
+                   with the record as a whole */
+    int errcode; /* one of the error codes above */
+};
+
 /* #####   EXPORTED VARIABLES   ############################################# */
 
 /* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
@@ -61,5 +79,60 @@
 void usage(char *);
 void errorprocessor(int errcode);
 
+/*
+ * Description: Sets the file and line that errors recorded from now on will
+ * be reported against.
+ *
+ * Parameters: The file name, which must stay valid until the errors are
+ * cleared, and the line number.
+ *
+ * Returns: Nothing.
+ */
+
+void seterrorcontext(const char *filename, int line);
+
+/*
+ * Description: Adds an error to the error log.
+ *
+ * Parameters: The error code and the column where the error was found (0 if
+ * the error is with the record as a whole).
+ *
+ * Returns: Nothing.
+ */
+
+void recorderror(int errcode, int column);
+
+/*
+ * Description: Returns the number of errors recorded since the log was last
+ * cleared.
+ */
+
+int errorcount(void);
+
+/*
+ * Description: Returns the number of errors recorded by the calling thread.
+ */
+
+int threaderrorcount(void);
+
+/*
+ * Description: Prints every recorded error, one per line, in the form
+ * "file:line:column: error N: message".
+ *
+ * Parameters: The stream to print to.
+ *
+ * Returns: The number of errors printed.
+ */
+
+int reporterrors(FILE *out);
+
+/*
+ * Description: Empties the error log.  buildre(), reloadre(), and
+ * loadruleset() empty it before they read the rules files, so each reports
+ * and counts only the errors of its own pass.
+ */
+
+void clearerrors(void);
+
 
 #endif	/* _ERRORHANDLER_H_INCLUDED_ */
@@ -7,214 +7,1236 @@
  *
  * Version: 1.0.20
  * Created: 01/14/2012 08:40:58 PM
- * Last Modified: Wed Dec 16 16:56:57 2020
+ * Last Modified: Mon Oct 19 10:37:38 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
- *  
- * Copyright: Copyright (c) 2011-2020, Thomas H. Vidal
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
  * SPDX-License-Identifier: GPL-2.0-only
  *
  * Usage: Used by DocketMaster Program
  *
  * File Format:   Saves calendar data in outlook iCalendar format.
  *
- * Restrictions:   
+ * Restrictions:
  *
- * Error Handling:   
+ * Error Handling:
  *
  * References: Refer to internet mail consortium website re materials re
  * personal data interchange: http://www.imc.org/pdi/pdiproddev.html,iCalendar
  * obj std: http://www.rfc-editor.org/info/rfc5545
- * iCalendar TIP: RFC # 5546: http://www.rfc-editor.org/info/rfc5546  
+ * iCalendar TIP: RFC # 5546: http://www.rfc-editor.org/info/rfc5546
  *
  * Notes:  This module will be expanded as necessary to cover other calendar
  * formats, if necessary.  At present, it appears most computer calendars and
  * smartphone (android, iPhone, and Blackberry) support iCalendar.
+ *
+ * Bulk exports run to hundreds of thousands of VEVENTs, so nothing here goes
+ * through printf.  Each content line is built directly in the export buffer:
+ * dates are formatted by hand, text is escaped and folded as it is copied,
+ * and the buffer is written out only when it is full.
  */
 
 /* #####   HEADER FILE INCLUDES   ########################################## */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "exportmgr.h"
+#include "datetools.h"
+#include "taskpool.h"
+#include "metrics.h"
 
 /* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ########################## */
 
+/* Appends a string constant to the buffer at p. */
+#define PUTCONST(p, s) (memcpy((p), (s), sizeof(s) - 1), (p) + sizeof(s) - 1)
+
 /* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ############### */
 
-/* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ################ */
+#define CRLF "\r\n"
+#define FNV_OFFSET 14695981039346656037ULL /* FNV-1a 64-bit offset basis */
+#define FNV_PRIME 1099511628211ULL /* FNV-1a 64-bit prime */
+#define UIDDOMAIN "@docketmaster" /* right-hand side of every UID */
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* A time zone we export for. */
+struct ZoneInfo {
+    const char *tzid;
+    const char *stdname; /* TZNAME in standard time */
+    const char *dstname; /* TZNAME in daylight time */
+    int stdoffset; /* standard time, in minutes east of UTC */
+};
 
-/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ###################### */
+/* A daylight saving rule.  A week of -1 is the last Sunday of the month. */
+struct DstRule {
+    int firstyear;
+    int lastyear; /* 0 if still in force */
+    int startmonth, startweek; /* when daylight time starts */
+    int endmonth, endweek; /* when it ends */
+};
+
+/* The work of a sharded export, shared by its tasks. */
+struct ShardWork {
+    const char *directory;
+    struct ExportShard *shards;
+};
+
+/* A deadline being compared with the manifest. */
+struct PendingItem {
+    struct ManifestEntry entry;
+    const struct ExportItem *item;
+};
 
 /* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ####################### */
 
+static const char calheader[] =
+    "BEGIN:VCALENDAR" CRLF
+    "VERSION:2.0" CRLF
+    "PRODID:" PRODID CRLF
+    "CALSCALE:GREGORIAN" CRLF
+    "METHOD:PUBLISH" CRLF;
+
+static const char calender[] =
+    "END:VCALENDAR" CRLF;
+
+/* The zones: TZID, standard and daylight names, and standard offset in
+minutes east of UTC. */
+static const struct ZoneInfo zones[ZONE_NUMZONES] = {
+    {"America/Los_Angeles", "PST", "PDT", -480},
+    {"America/Denver", "MST", "MDT", -420},
+    {"America/Chicago", "CST", "CDT", -360},
+    {"America/New_York", "EST", "EDT", -300}
+};
+
+/* US daylight saving rules since 1987 (15 U.S.C. 260a).  Daylight time
+starts and ends at 02:00 local time on the given Sunday of the month. */
+static const struct DstRule dstrules[] = {
+    {1987, 2006, 4, 1, 10, -1}, /* first Sunday in April to last in October */
+    {2007, 0, 3, 2, 11, 1} /* second Sunday in March to first in November */
+};
+
+#define NUMDSTRULES ((int) (sizeof(dstrules) / sizeof(dstrules[0])))
+
+static char tzblocks[ZONE_NUMZONES][TZBLOCKSIZE]; /* serialized VTIMEZONEs */
+static size_t tzlengths[ZONE_NUMZONES];
+static pthread_once_t tzonce = PTHREAD_ONCE_INIT; /* builds tzblocks */
+
 /* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ###################### */
 
-/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ################### */
-int write_cal_items (FILE exp_file);
-{
-	BEGIN:VEVENT
-       DTSTAMP:19980309T231000Z
-       UID:guid-1.example.com
-       ORGANIZER:mailto:mrbig@example.com
-       ATTENDEE;RSVP=TRUE;ROLE=REQ-PARTICIPANT;CUTYPE=GROUP:
-        mailto:employee-A@example.com
-       DESCRIPTION:Project XYZ Review Meeting
-       CATEGORIES:MEETING
-       CLASS:PUBLIC
-       CREATED:19980309T130000Z
-       SUMMARY:XYZ Project Review
-       DTSTART;TZID=America/New_York:19980312T083000
-       DTEND;TZID=America/New_York:19980312T093000
-       LOCATION:1CP Conference Room 4350
-}
+static char * reserve (struct ExportFile *exp, size_t len);
+    /* Makes room for len bytes in the sink */
 
+static int putraw (struct ExportFile *exp, const char *text, size_t len);
+    /* Copies text that is already in iCalendar form into the sink */
 
+static int sinkerror (const struct OutputSink *sink);
+    /* Translates the error of a sink into an EX_E code */
 
-/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############ */
+static char * foldtext (char *p, int *col, const char *text, int escape);
+    /* Copies text into a content line, escaping and folding it */
+
+static char * putdate (char *p, int jdn);
+    /* Formats a JDN as YYYYMMDD */
+
+static void shardrange (void *work, long first, long last);
+    /* Writes some of the shards (a task of exportshards()) */
+
+static int writeshard (const char *directory, struct ExportShard *shard);
+    /* Writes the file of one shard */
+
+static int writeshardindex (const char *directory,
+                            const struct ExportShard *shards, int numshards);
+    /* Writes the index of a sharded export */
 
+static void buildtzblocks (void);
+    /* Serializes the VTIMEZONE of every zone */
 
-/* 
+static size_t puttzrule (char *p, size_t room, const struct ZoneInfo *zone,
+                         const struct DstRule *rule, int daylight);
+    /* Serializes the STANDARD or DAYLIGHT component of one rule */
+
+static int sundayjdn (int year, int month, int week);
+    /* JDN of the nth (or last) Sunday of a month */
+
+static int putevent (struct ExportFile *exp, const struct ExportItem *item,
+                     uint32_t sequence);
+    /* Writes the VEVENT of a deadline */
+
+static int putcancel (struct ExportFile *exp, const struct ManifestEntry *entry);
+    /* Writes the VEVENT that cancels a deadline */
+
+static char * putuid (char *p, uint64_t key);
+    /* Formats the UID with the given hash */
+
+static char * putnumber (char *p, unsigned long number);
+    /* Formats a number in decimal */
+
+static uint64_t uidkey (const char *caseid, const char *shorttitle,
+                        const char *ruleversion);
+    /* Hash of what identifies a deadline */
+
+static uint64_t contenthash (const struct ExportItem *item);
+    /* Hash of what is exported for a deadline */
+
+static uint64_t hashtext (uint64_t hash, const char *text);
+    /* Adds text and its terminator to an FNV-1a hash */
+
+static int pendingcmp (const void *item1, const void *item2);
+    /* qsort() comparison: deadlines by key */
+
+static size_t linesize (size_t textlen);
+    /* Most bytes a content line with textlen bytes of text can take */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ################### */
+
+/*
  *   Description:  opens a new text file to store and save the exported
  *   		   calendar entries.
- *     Parameters:  None at present (perhaps update the function to save the file
- *     		   with a customized name and/or path)
- *       Returns:  FILE pointer
- *    References:   
- *  	   Notes:   
+ *     Parameters:  The ExportFile to set up, and the name of the file to
+ *                  create, or NULL to name it for today's date.
+ *       Returns:  EX_OK, or a negative EX_E code.
+ *    References:
+ *  	   Notes:  The file is written through a batched sink (see
+ *  	           outputmgr.h).
  */
-FILE * newexportfile (void)
-{
-    time_t curtimesec; /* current time in seconds */;
-    struct tim *curtime; /* pointer to struct tm defined in time.h */
-    char exportfilename[25]; /* file name for the export file */
-    char tempstring[10]; /* string for holding intermediate values */
-    FILE *out_file; /* temporary file pointer */
 
+int newexportfile (struct ExportFile *exp, const char *filename)
+{
+    time_t curtimesec; /* current time in seconds */
+    struct tm curtime; /* broken-down current time */
+    char exportfilename[sizeof(EXPORTFILENAME) + 16]; /* file name for the
+                                                         export file */
 
     /*  create the file name */
-    curtimesec = time (NULL);
-    *curtime = localtime (&curtimesec);
-    sprintf(exportfilename, "%d", tm_year);
-    sprintf(tempstring, "%d", tm_month);
-    strcat(exportfilename, tempstring);
-    sprintf(tempstring, "%d", tm_mday);
-    strcat(exportfilename, tempstring);
-    strcat(exportfilename, _EXPORTFILENAME);
+    if (filename == NULL) {
+        curtimesec = time(NULL);
+        localtime_r(&curtimesec, &curtime);
+        strftime(exportfilename, sizeof(exportfilename), "%Y%m%d", &curtime);
+        strcat(exportfilename, EXPORTFILENAME);
+        filename = exportfilename;
+    }
 
     /* Open the new file */
-    out_file = fopen(exportfilename, w); /*  opens the file for writing */
+    newexportsink(exp, &exp->filesink);
+    if (sinkopenbatched(&exp->filesink, filename) != OUT_OK)
+        return exp->error = sinkerror(&exp->filesink);
+    return EX_OK;
+}		/* -----  end of function newexportfile  ----- */
 
-    /* Error Handling */
-    if (out_file == NULL)
-    {
-	 /* :TODO:01/18/2012 11:40:49 PM:THV: Add more robust error handling */
-	printf("## ERROR ## Cannot open exportfile!");
-	printf("## ERROR ## Error Number: %s\n", strerror(errno));
-	return out_file;
+/*
+ * Description:  Starts an export to a sink that is already open.
+ *
+ * Parameters:  The ExportFile to set up and the sink.
+ *
+ * Returns:  EX_OK.
+ *
+ * Notes:  The DTSTAMP of every event in the export is the time the export
+ * started, so it is formatted once, here.
+ */
+
+int newexportsink (struct ExportFile *exp, struct OutputSink *sink)
+{
+    time_t curtimesec; /* current time in seconds */
+    struct tm curtime; /* broken-down current time */
+
+    memset(exp, 0, sizeof(*exp));
+    exp->sink = sink;
+    exp->ruleversion = EXPORTRULEVERSION;
+    curtimesec = time(NULL);
+    gmtime_r(&curtimesec, &curtime);
+    strftime(exp->dtstamp, sizeof(exp->dtstamp), "%Y%m%dT%H%M%SZ", &curtime);
+    return EX_OK;
+}		/* -----  end of function newexportsink  ----- */
+
+/*
+ * Description:  Starts the VCALENDAR object.
+ * Parameters:  The export file.
+ * Returns:  EX_OK, or a negative EX_E code.
+ */
+
+int writeheaders (struct ExportFile *exp)
+{
+    return putraw(exp, calheader, sizeof(calheader) - 1);
+}		/* -----  end of function writeheaders  ----- */
+
+/*
+ * Description:  Add timezone to vcalendar file.
+ * Parameters:  The export file and the court's zone.
+ * Returns:  EX_OK, or a negative EX_E code.
+ * Notes:  All-day deadlines are floating dates and need no time zone; this
+ * is for events with a time of day.  The components are serialized once, by
+ * whichever export asks first, and then copied in whole (or, by a batched
+ * sink, written from the cache).
+ */
+
+int addtz (struct ExportFile *exp, enum EXPORTZONE zone)
+{
+    if ((unsigned) zone >= ZONE_NUMZONES)
+        return EX_OK;
+    pthread_once(&tzonce, buildtzblocks);
+    if (exp->error == EX_OK &&
+            sinkref(exp->sink, tzblocks[zone], tzlengths[zone]) != OUT_OK)
+        exp->error = sinkerror(exp->sink);
+    return exp->error;
+}		/* -----  end of function addtz  ----- */
+
+/*
+ * Description:  Writes a VEVENT for each deadline.
+ *
+ * Parameters:  The export file, the deadlines, and the number of them.
+ *
+ * Returns:  EX_OK, or a negative EX_E code.
+ *
+ * Notes:  The UIDs come from makeuid(), so the same deadline has the same UID
+ * in every export.
+ */
+
+int write_cal_items (struct ExportFile *exp, const struct ExportItem *items,
+                     int numitems)
+{
+    int index, result;
+    METRIC_STAMP(start);
+
+    METRIC_START(MP_EXPORT, start);
+    result = EX_OK;
+    for (index = 0; index < numitems; index++)
+        if (putevent(exp, &items[index], 0) != EX_OK) {
+            result = exp->error;
+            break;
+        }
+    METRIC_STOP(MP_EXPORT, start);
+    return result;
+}		/* -----  end of function write_cal_items  ----- */
+
+/*
+ * Description:  Writes only the deadlines of a case that changed since its
+ * last export.
+ *
+ * Parameters:  The export file, the case's manifest from its last export
+ * (updated to match this one), and ALL of the case's current deadlines.
+ *
+ * Returns:  The number of VEVENTs written, or a negative EX_E code.  On an
+ * error the manifest is left as it was.
+ *
+ * Algorithm:  The deadlines are keyed and hashed like the manifest entries
+ * and sorted by key, and one merge of the two lists sorts them out:
+ *     in the manifest only     a VEVENT with STATUS:CANCELLED, unless the
+ *                              entry says it was cancelled already
+ *     new                      a VEVENT with SEQUENCE:0
+ *     content hash changed     a VEVENT with the SEQUENCE bumped
+ *     unchanged                nothing
+ * The manifest is then replaced by the current deadlines and the cancelled
+ * ones, which keep the SEQUENCE of their cancellation (RFC 5545 3.8.7.4: a
+ * deadline that comes back must carry a higher one).
+ *
+ * Notes:  If the same deadline is passed twice, the first one counts.
+ */
+
+int write_changed_items (struct ExportFile *exp, struct ExportManifest *man,
+                         const struct ExportItem *items, int numitems)
+{
+    struct PendingItem *pending = NULL; /* the deadlines, by key */
+    struct ManifestEntry *entries = NULL; /* the new manifest */
+    struct ManifestEntry *old;
+    int numpending, numentries, index, oldindex, written, changed;
+
+    pending = malloc((numitems + 1) * sizeof(struct PendingItem));
+    entries = malloc((numitems + man->numentries + 1) *
+                     sizeof(struct ManifestEntry));
+    if (pending == NULL || entries == NULL) {
+        free(pending);
+        free(entries);
+        return exp->error = EX_ENOMEM;
+    }
+
+    for (index = 0; index < numitems; index++) {
+        pending[index].item = &items[index];
+        pending[index].entry.uidkey = uidkey(items[index].caseid,
+                                             items[index].event->shorttitle,
+                                             exp->ruleversion);
+        pending[index].entry.contenthash = contenthash(&items[index]);
+        pending[index].entry.jdn = items[index].jdn;
+        pending[index].entry.sequence = 0;
     }
-    else
-    {
-	return out_file; /*  return the FILE* to the new file */
+    if (numitems > 0)
+        qsort(pending, numitems, sizeof(struct PendingItem), pendingcmp);
+    numpending = 0;
+    for (index = 0; index < numitems; index++)
+        if (numpending == 0 || pending[numpending - 1].entry.uidkey !=
+                pending[index].entry.uidkey)
+            pending[numpending++] = pending[index];
+
+    numentries = written = 0;
+    index = oldindex = 0;
+    while (index < numpending || oldindex < man->numentries) {
+        old = (oldindex < man->numentries) ? &man->entries[oldindex] : NULL;
+        if (index == numpending ||
+                (old != NULL && old->uidkey < pending[index].entry.uidkey)) {
+            entries[numentries] = *old;
+            if (old->contenthash != MANIFEST_CANCELLED) {
+                if (putcancel(exp, old) != EX_OK)
+                    goto writefailed;
+                written++;
+                entries[numentries].contenthash = MANIFEST_CANCELLED;
+                entries[numentries].sequence++;
+            }
+            numentries++;
+            oldindex++;
+            continue;
+        }
+
+        entries[numentries] = pending[index].entry;
+        changed = 1;
+        if (old != NULL && old->uidkey == pending[index].entry.uidkey) {
+            entries[numentries].sequence = old->sequence;
+            if (old->contenthash == pending[index].entry.contenthash)
+                changed = 0;
+            else
+                entries[numentries].sequence++;
+            oldindex++;
+        }
+        if (changed) {
+            if (putevent(exp, pending[index].item,
+                         entries[numentries].sequence) != EX_OK)
+                goto writefailed;
+            written++;
+        }
+        numentries++;
+        index++;
     }
-}
 
+    free(pending);
+    free(man->entries);
+    man->entries = entries;
+    man->numentries = numentries;
+    return written;
 
-/* 
- * Description:  
- * Parameters:   
- * Returns:   
- * Algorithm:   
- * References:   
- * Notes:   
+writefailed:
+    free(pending);
+    free(entries);
+    return exp->error;
+}		/* -----  end of function write_changed_items  ----- */
+
+/*
+ * Description:  Writes a sharded export: one file for each shard, in
+ * parallel, followed by an index of the files.
+ *
+ * Parameters:  The directory to write to, the shards, the number of them,
+ * and the number of threads to use (0 for one per processor).
+ *
+ * Returns:  The number of shards that could not be written, or a negative
+ * EX_E code if the index could not be written.
+ *
+ * Algorithm:  The shards are shared out over a task pool one at a time;
+ * shards vary a great deal in size, and an idle worker steals whatever
+ * shards are left.  Each is written with its own ExportFile, so the tasks
+ * share nothing.  Once they are done, the index is written.
+ *
+ * Notes:  0 threads uses the shared pool; any other number gets a pool of
+ * its own for this export.
  */
 
-int writeheaders (FILE exp_file)
+int exportshards (const char *directory, struct ExportShard *shards,
+                  int numshards, int numthreads)
 {
+    struct ShardWork work;
+    struct TaskPool *pool;
+    int index, failed;
 
-       BEGIN:VCALENDAR
-       PRODID:-//RDU Software//NONSGML HandCal//EN
-       VERSION:2.0
- 
+    work.directory = directory;
+    work.shards = shards;
+    pool = (numthreads > 0) ? tpnew(numthreads) : tpshared();
+    tpparallelfor(pool, 0, numshards, 1, shardrange, &work);
+    if (numthreads > 0)
+        tpfree(pool);
 
-}
+    failed = 0;
+    for (index = 0; index < numshards; index++)
+        if (shards[index].result != EX_OK)
+            failed++;
+    index = writeshardindex(directory, shards, numshards);
+    return (index != EX_OK) ? index : failed;
+}		/* -----  end of function exportshards  ----- */
 
+/*
+ * Description:  Makes the file name of a shard.
+ *
+ * Parameters:  Where to put the name, its size, the directory, and the
+ * shard's name.
+ *
+ * Returns:  The file name, or NULL if it does not fit.
+ *
+ * Notes:  Case ids and attorney names may hold '/' or spaces, so anything
+ * but a letter, digit, '-', or '.' becomes '_'.  A leading '.' does too, so
+ * a name cannot make a hidden file or refer to a parent directory.
+ */
 
-/* 
- * Description:  Add timezone to vcalendar file.
- * Parameters:   
- * Returns:   
- * Algorithm:   
- * References:   
- * Notes:   
+char *shardfilename (char *filename, size_t size, const char *directory,
+                     const char *name)
+{
+    size_t dirlen, namelen, index;
+    char *p;
+
+    dirlen = strlen(directory);
+    namelen = strlen(name);
+    if (dirlen + namelen + sizeof(SHARDSUFFIX) + 1 > size)
+        return NULL;
+
+    memcpy(filename, directory, dirlen);
+    p = filename + dirlen;
+    if (dirlen > 0 && directory[dirlen - 1] != '/')
+        *p++ = '/';
+    for (index = 0; index < namelen; index++)
+        *p++ = (isalnum((unsigned char) name[index]) || name[index] == '-' ||
+                (name[index] == '.' && index > 0)) ? name[index] : '_';
+    memcpy(p, SHARDSUFFIX, sizeof(SHARDSUFFIX));
+    return filename;
+}		/* -----  end of function shardfilename  ----- */
+
+/*
+ * Description:  Reads the manifest of a case.
+ *
+ * Parameters:  Name of the manifest file and the manifest to fill in.
+ *
+ * Returns:  EX_OK, or a negative EX_E code.  A file that does not exist gives
+ * an empty manifest and EX_OK.  A file whose entries are not in strictly
+ * increasing uidkey order gives EX_EFORMAT.
+ */
+
+int loadmanifest (const char *filename, struct ExportManifest *man)
+{
+    struct ManifestHeader hdr;
+    FILE *in;
+    uint32_t index;
+    int result = EX_EFORMAT;
+
+    memset(man, 0, sizeof(*man));
+    if ((in = fopen(filename, "rb")) == NULL)
+        return (errno == ENOENT) ? EX_OK : EX_EOPEN;
+
+    if (fread(&hdr, sizeof(hdr), 1, in) != 1 ||
+            memcmp(hdr.magic, MANIFEST_MAGIC, sizeof(hdr.magic)) != 0 ||
+            hdr.version != MANIFEST_VERSION || hdr.numentries > INT32_MAX /
+            sizeof(struct ManifestEntry))
+        goto cleanup;
+
+    man->entries = malloc((hdr.numentries + 1) * sizeof(struct ManifestEntry));
+    if (man->entries == NULL) {
+        result = EX_ENOMEM;
+        goto cleanup;
+    }
+    if (fread(man->entries, sizeof(struct ManifestEntry), hdr.numentries, in)
+            != hdr.numentries) {
+        freemanifest(man);
+        goto cleanup;
+    }
+    /* write_changed_items() merges against the entries in uidkey order. */
+    for (index = 1; index < hdr.numentries; index++) {
+        if (man->entries[index - 1].uidkey >= man->entries[index].uidkey) {
+            freemanifest(man);
+            goto cleanup;
+        }
+    }
+    man->numentries = (int) hdr.numentries;
+    result = EX_OK;
+
+cleanup:
+    fclose(in);
+    return result;
+}		/* -----  end of function loadmanifest  ----- */
+
+/*
+ * Description:  Writes the manifest of a case.
+ *
+ * Parameters:  Name of the manifest file and the manifest.
+ *
+ * Returns:  EX_OK, or a negative EX_E code.
+ *
+ * Algorithm:  The manifest is written to a temporary file which is renamed
+ * when complete, so a failed save leaves the old manifest in place.
+ */
+
+int savemanifest (const char *filename, const struct ExportManifest *man)
+{
+    struct ManifestHeader hdr;
+    char tmpname[FILENAME_MAX];
+    FILE *out;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MANIFEST_MAGIC, sizeof(hdr.magic));
+    hdr.version = MANIFEST_VERSION;
+    hdr.numentries = (uint32_t) man->numentries;
+
+    snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+    if ((out = fopen(tmpname, "wb")) == NULL) {
+        fprintf(stderr, "## ERROR ## Cannot create manifest %s: %s\n",
+                tmpname, strerror(errno));
+        return EX_EOPEN;
+    }
+    if (fwrite(&hdr, sizeof(hdr), 1, out) != 1 ||
+            (man->numentries > 0 &&
+             fwrite(man->entries, sizeof(struct ManifestEntry),
+                    man->numentries, out) != (size_t) man->numentries)) {
+        fclose(out);
+        remove(tmpname);
+        return EX_EWRITE;
+    }
+    if (fclose(out) != 0 || rename(tmpname, filename) != 0) {
+        remove(tmpname);
+        return EX_EWRITE;
+    }
+    return EX_OK;
+}		/* -----  end of function savemanifest  ----- */
+
+/*
+ * Description:  Releases the memory held by a manifest and empties it.
+ */
+
+void freemanifest (struct ExportManifest *man)
+{
+    free(man->entries);
+    memset(man, 0, sizeof(*man));
+    return;
+}		/* -----  end of function freemanifest  ----- */
+
+/*
+ * Description:  Makes the UID of a deadline.
+ *
+ * Parameters:  Where to put the UID (at least UIDSIZE chars), the case id,
+ * the short title of the event, and the version of the rules.
+ *
+ * Returns:  The UID.
+ *
+ * Algorithm:  The UID is the 64-bit FNV-1a hash of the case id, short title,
+ * and rule version, each with its null terminator so that ("ab", "c") and
+ * ("a", "bc") differ, written as 16 hex digits and followed by UIDDOMAIN.
+ * A short title is unique within the rules, so two deadlines of a case share
+ * a UID only if the hash collides.
+ */
+
+char *makeuid (char *uid, const char *caseid, const char *shorttitle,
+               const char *ruleversion)
+{
+    *putuid(uid, uidkey(caseid, shorttitle, ruleversion)) = '\0';
+    return uid;
+}		/* -----  end of function makeuid  ----- */
+
+/*
+ * Description:  Ends the VCALENDAR object.
+ * Parameters:  The export file.
+ * Returns:  EX_OK, or a negative EX_E code.
+ */
+
+int writeenders (struct ExportFile *exp)
+{
+    return putraw(exp, calender, sizeof(calender) - 1);
+}		/* -----  end of function writeenders  ----- */
+
+/*
+ * Description:  Writes whatever is still buffered and, if the export opened
+ * its own file, closes it.
+ * Parameters:  The export file.
+ * Returns:  EX_OK, or the first error of the export.
+ */
+
+int closexportfile (struct ExportFile *exp)
+{
+    if (exp->sink == NULL)
+        return exp->error;
+    if (exp->sink == &exp->filesink) {
+        if (sinkclose(exp->sink) != OUT_OK && exp->error == EX_OK)
+            exp->error = sinkerror(exp->sink);
+    } else if (sinkflush(exp->sink) != OUT_OK && exp->error == EX_OK) {
+        exp->error = sinkerror(exp->sink);
+    }
+    exp->sink = NULL;
+    return exp->error;
+}		/* -----  end of function closexportfile  ----- */
+
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############ */
+
+/*
+ * Description:  Serializes the VTIMEZONE component of every zone into
+ * tzblocks.
+ *
+ * Algorithm:  Each daylight saving rule becomes a DAYLIGHT and a STANDARD
+ * component: DTSTART is the rule's first transition, and an RRULE gives the
+ * rest, ending (UNTIL) with the last transition if the rule has been
+ * replaced.
  */
 
-int addtz(FILE exp_file)
+static void buildtzblocks (void)
 {
+    const struct ZoneInfo *zone;
+    char *p;
+    size_t room, len;
+    int z, r;
 
-      BEGIN:VTIMEZONE
-       TZID:America/New_York
-       BEGIN:STANDARD
-       DTSTART:19981025T020000
-       TZOFFSETFROM:-0400
-       TZOFFSETTO:-0500
-       TZNAME:EST
-       END:STANDARD
-       BEGIN:DAYLIGHT
-       DTSTART:19990404T020000
-       TZOFFSETFROM:-0500
-       TZOFFSETTO:-0400
-       TZNAME:EDT
-       END:DAYLIGHT
-       END:VTIMEZONE
- 
+    for (z = 0; z < ZONE_NUMZONES; z++) {
+        zone = &zones[z];
+        p = tzblocks[z];
+        room = TZBLOCKSIZE;
+        len = snprintf(p, room, "BEGIN:VTIMEZONE" CRLF "TZID:%s" CRLF,
+                       zone->tzid);
+        for (r = 0; r < NUMDSTRULES; r++) {
+            len += puttzrule(p + len, room - len, zone, &dstrules[r], 1);
+            len += puttzrule(p + len, room - len, zone, &dstrules[r], 0);
+        }
+        len += snprintf(p + len, room - len, "END:VTIMEZONE" CRLF);
+        tzlengths[z] = (len < room) ? len : 0; /* never truncated: a block
+                                                  is about 800 bytes */
+    }
+    return;
+}		/* -----  end of function buildtzblocks  ----- */
 
-}
+/*
+ * Description:  Serializes the DAYLIGHT or STANDARD component of a rule.
+ *
+ * Parameters:  Where to write, the room there, the zone, the rule, and
+ * nonzero for the DAYLIGHT component.
+ *
+ * Returns:  The number of chars written.
+ *
+ * Notes:  UNTIL must be in UTC (RFC 5545 3.3.10), so it is the local 02:00
+ * of the last transition less the offset in force before it.
+ */
+
+static size_t puttzrule (char *p, size_t room, const struct ZoneInfo *zone,
+                         const struct DstRule *rule, int daylight)
+{
+    const char *kind = daylight ? "DAYLIGHT" : "STANDARD";
+    char date[9];
+    char until[32];
+    int month, week, from, to;
 
+    month = daylight ? rule->startmonth : rule->endmonth;
+    week = daylight ? rule->startweek : rule->endweek;
+    from = daylight ? zone->stdoffset : zone->stdoffset + 60;
+    to = daylight ? zone->stdoffset + 60 : zone->stdoffset;
+
+    until[0] = '\0';
+    if (rule->lastyear != 0) {
+        *putdate(date, sundayjdn(rule->lastyear, month, week)) = '\0';
+        snprintf(until, sizeof(until), ";UNTIL=%sT%02d0000Z", date,
+                 2 - from / 60);
+    }
+    *putdate(date, sundayjdn(rule->firstyear, month, week)) = '\0';
 
-/* 
- * Description:  Create a unique UID
- * Parameters:   
- * Returns:   
- * Algorithm:   
- * References:   
- * Notes:   
+    return snprintf(p, room,
+                    "BEGIN:%s" CRLF
+                    "DTSTART:%sT020000" CRLF
+                    "RRULE:FREQ=YEARLY;BYMONTH=%d;BYDAY=%dSU%s" CRLF
+                    "TZOFFSETFROM:-%02d%02d" CRLF
+                    "TZOFFSETTO:-%02d%02d" CRLF
+                    "TZNAME:%s" CRLF
+                    "END:%s" CRLF,
+                    kind, date, month, week, until,
+                    -from / 60, -from % 60, -to / 60, -to % 60,
+                    daylight ? zone->dstname : zone->stdname, kind);
+}		/* -----  end of function puttzrule  ----- */
+
+/*
+ * Description:  Finds the nth Sunday of a month, or the last if week is -1.
+ * Returns:  The JDN of the Sunday.
+ * Notes:  The day of the week of a JDN is (jdn + 1) % 7, with Sunday 0.
  */
 
-int getuid(void)
+static int sundayjdn (int year, int month, int week)
 {
+    struct DateTime dt;
+    int jdn;
 
-}
+    memset(&dt, 0, sizeof(dt));
+    dt.day = 1;
+    if (week > 0) {
+        dt.year = year;
+        dt.month = month;
+        jdn = jdncnvrt(&dt);
+        return jdn + (7 - (jdn + 1) % 7) % 7 + 7 * (week - 1);
+    }
+    dt.year = (month == 12) ? year + 1 : year;
+    dt.month = (month == 12) ? 1 : month + 1;
+    jdn = jdncnvrt(&dt) - 1; /* last day of the month */
+    return jdn - (jdn + 1) % 7;
+}		/* -----  end of function sundayjdn  ----- */
 
-/* 
- * Description:  
- * Parameters:   
- * Returns:   
- * Algorithm:   
- * References:   
- * Notes:   
+/*
+ * Description:  Writes shards first through last - 1.
+ * Parameters:  The ShardWork and the shards to write.
+ * Returns:  Nothing.
  */
 
-int writeenders (FILE exp_file)
+static void shardrange (void *work, long first, long last)
 {
+    struct ShardWork *sw = work;
+    long index;
 
-       END:VEVENT
-       END:VCALENDAR
+    for (index = first; index < last; index++)
+        writeshard(sw->directory, &sw->shards[index]);
+    return;
+}		/* -----  end of function shardrange  ----- */
 
+/*
+ * Description:  Writes the file of one shard.
+ * Parameters:  The directory and the shard, whose result and numevents are
+ * set.
+ * Returns:  The shard's result.
+ */
+
+static int writeshard (const char *directory, struct ExportShard *shard)
+{
+    struct ExportFile exp;
+    char filename[FILENAME_MAX];
+
+    shard->numevents = 0;
+    if (shardfilename(filename, sizeof(filename), directory,
+                      shard->name) == NULL)
+        return shard->result = EX_EOPEN;
+    if ((shard->result = newexportfile(&exp, filename)) != EX_OK)
+        return shard->result;
 
-}
+    writeheaders(&exp);
+    write_cal_items(&exp, shard->items, shard->numitems);
+    writeenders(&exp);
+    shard->numevents = exp.numevents;
+    return shard->result = closexportfile(&exp);
+}		/* -----  end of function writeshard  ----- */
 
-/* 
- * Description:  
- * Parameters:   
- * Returns:   
- * Algorithm:   
- * References:   
- * Notes:   
+/*
+ * Description:  Writes the index of a sharded export.
+ *
+ * Parameters:  The directory and the shards.
+ *
+ * Returns:  EX_OK, or a negative EX_E code.
+ *
+ * Notes:  The index is a CSV file in the same form as the rules files: a
+ * name and version line, field names, then one quoted record per shard.  It
+ * is written to a temporary file which is renamed when complete.
  */
 
-int closexportfile (FILE exp_file)
+static int writeshardindex (const char *directory,
+                            const struct ExportShard *shards, int numshards)
 {
+    char indexname[FILENAME_MAX], tmpname[FILENAME_MAX];
+    char filename[FILENAME_MAX];
+    FILE *out;
+    int index;
+
+    if (snprintf(indexname, sizeof(indexname), "%s/%s", directory,
+                 SHARDINDEXNAME) >= (int) sizeof(indexname) ||
+            snprintf(tmpname, sizeof(tmpname), "%s.tmp", indexname) >=
+            (int) sizeof(tmpname))
+        return EX_EOPEN;
+    if ((out = fopen(tmpname, "w")) == NULL) {
+        fprintf(stderr, "## ERROR ## Cannot create export index %s: %s\n",
+                tmpname, strerror(errno));
+        return EX_EOPEN;
+    }
+
+    fprintf(out, "Export Index File,V1.0\n");
+    fprintf(out, "\"Name\",\"File\",\"Events\",\"Result\"\n");
+    for (index = 0; index < numshards; index++) {
+        if (shardfilename(filename, sizeof(filename), "",
+                          shards[index].name) == NULL)
+            filename[0] = '\0';
+        fprintf(out, "\"%s\",\"%s\",\"%lu\",\"%d\"\n", shards[index].name,
+                filename, shards[index].numevents, shards[index].result);
+    }
+
+    if (ferror(out)) {
+        fclose(out);
+        remove(tmpname);
+        return EX_EWRITE;
+    }
+    if (fclose(out) != 0 || rename(tmpname, indexname) != 0) {
+        remove(tmpname);
+        return EX_EWRITE;
+    }
+    return EX_OK;
+}		/* -----  end of function writeshardindex  ----- */
+
+/*
+ * Description:  Writes the VEVENT of a deadline.
+ *
+ * Parameters:  The export file, the deadline, and its SEQUENCE (the line is
+ * left out for zero, the default).
+ *
+ * Returns:  EX_OK, or a negative EX_E code.
+ *
+ * Algorithm:  The most space the VEVENT can take is worked out from the
+ * lengths of its text, and that much room is reserved in the buffer up
+ * front.  The VEVENT is then written straight into the buffer with no
+ * further checks.
+ */
+
+static int putevent (struct ExportFile *exp, const struct ExportItem *item,
+                     uint32_t sequence)
+{
+    const struct CourtEvent *event = item->event;
+    const char *title;
+    size_t caselen, titlelen, desclen, authlen, catlen, need;
+    char *p;
+    int col;
+
+    title = (event->eventitle[0] != '\0') ? event->eventitle :
+        event->shorttitle;
+    caselen = strlen(item->caseid);
+    titlelen = strlen(title);
+    desclen = strlen(event->description);
+    authlen = strlen(event->authority);
+    catlen = strlen(event->eventcategory);
+
+    need = sizeof("BEGIN:VEVENT" CRLF "END:VEVENT" CRLF
+                  "TRANSP:TRANSPARENT" CRLF) +
+        linesize(sizeof("UID:") + UIDSIZE) +
+        linesize(sizeof("SEQUENCE:") + 10) +
+        linesize(sizeof("DTSTAMP:") + sizeof(exp->dtstamp)) +
+        linesize(sizeof("DTSTART;VALUE=DATE:YYYYMMDD")) +
+        linesize(sizeof("SUMMARY:: ") + 2 * (caselen + titlelen)) +
+        linesize(sizeof("DESCRIPTION: ()") + 2 * (desclen + authlen)) +
+        linesize(sizeof("CATEGORIES:") + 2 * catlen);
+    p = reserve(exp, need);
+    if (p == NULL)
+        return exp->error;
+
+    p = PUTCONST(p, "BEGIN:VEVENT" CRLF);
+
+    p = PUTCONST(p, "UID:");
+    p = putuid(p, uidkey(item->caseid, event->shorttitle, exp->ruleversion));
+    p = PUTCONST(p, CRLF);
+
+    p = PUTCONST(p, "DTSTAMP:");
+    memcpy(p, exp->dtstamp, sizeof(exp->dtstamp) - 1);
+    p += sizeof(exp->dtstamp) - 1;
+    p = PUTCONST(p, CRLF);
+
+    p = PUTCONST(p, "DTSTART;VALUE=DATE:");
+    p = putdate(p, item->jdn);
+    p = PUTCONST(p, CRLF);
+
+    if (sequence > 0) {
+        p = PUTCONST(p, "SEQUENCE:");
+        p = putnumber(p, sequence);
+        p = PUTCONST(p, CRLF);
+    }
+
+    col = 0;
+    p = foldtext(p, &col, "SUMMARY:", 0);
+    if (caselen > 0) {
+        p = foldtext(p, &col, item->caseid, 1);
+        p = foldtext(p, &col, ": ", 0);
+    }
+    p = foldtext(p, &col, title, 1);
+    p = PUTCONST(p, CRLF);
+
+    if (desclen > 0 || authlen > 0) {
+        col = 0;
+        p = foldtext(p, &col, "DESCRIPTION:", 0);
+        p = foldtext(p, &col, event->description, 1);
+        if (authlen > 0) {
+            p = foldtext(p, &col, (desclen > 0) ? " (" : "(", 0);
+            p = foldtext(p, &col, event->authority, 1);
+            p = foldtext(p, &col, ")", 0);
+        }
+        p = PUTCONST(p, CRLF);
+    }
+
+    if (catlen > 0) {
+        col = 0;
+        p = foldtext(p, &col, "CATEGORIES:", 0);
+        p = foldtext(p, &col, event->eventcategory, 1);
+        p = PUTCONST(p, CRLF);
+    }
+
+    p = PUTCONST(p, "TRANSP:TRANSPARENT" CRLF);
+    p = PUTCONST(p, "END:VEVENT" CRLF);
+
+    sinkcommit(exp->sink, p);
+    exp->numevents++;
+    return EX_OK;
+}		/* -----  end of function putevent  ----- */
+
+/*
+ * Description:  Writes the VEVENT that cancels a deadline exported before.
+ *
+ * Parameters:  The export file and the deadline's manifest entry.
+ *
+ * Returns:  EX_OK, or a negative EX_E code.
+ *
+ * Notes:  RFC 5546 3.2.5: the cancellation carries the UID and a SEQUENCE
+ * higher than the last one sent.
+ */
+
+static int putcancel (struct ExportFile *exp, const struct ManifestEntry *entry)
+{
+    char *p;
+
+    p = reserve(exp, 256);
+    if (p == NULL)
+        return exp->error;
+
+    p = PUTCONST(p, "BEGIN:VEVENT" CRLF "UID:");
+    p = putuid(p, entry->uidkey);
+    p = PUTCONST(p, CRLF "DTSTAMP:");
+    memcpy(p, exp->dtstamp, sizeof(exp->dtstamp) - 1);
+    p += sizeof(exp->dtstamp) - 1;
+    p = PUTCONST(p, CRLF "DTSTART;VALUE=DATE:");
+    p = putdate(p, entry->jdn);
+    p = PUTCONST(p, CRLF "SEQUENCE:");
+    p = putnumber(p, entry->sequence + 1);
+    p = PUTCONST(p, CRLF "STATUS:CANCELLED" CRLF "END:VEVENT" CRLF);
+
+    sinkcommit(exp->sink, p);
+    exp->numevents++;
+    return EX_OK;
+}		/* -----  end of function putcancel  ----- */
+
+/*
+ * Description:  Formats a UID: the hash as 16 hex digits, then UIDDOMAIN.
+ * Returns:  The end of what was written (not null terminated).
+ */
 
-}
+static char * putuid (char *p, uint64_t key)
+{
+    static const char hexdigits[] = "0123456789abcdef";
+    int digit;
+
+    for (digit = 15; digit >= 0; digit--) {
+        p[digit] = hexdigits[key & 0xF];
+        key >>= 4;
+    }
+    memcpy(p + 16, UIDDOMAIN, sizeof(UIDDOMAIN) - 1);
+    return p + 16 + sizeof(UIDDOMAIN) - 1;
+}		/* -----  end of function putuid  ----- */
+
+/*
+ * Description:  Formats a number in decimal.
+ * Returns:  The end of what was written.
+ */
+
+static char * putnumber (char *p, unsigned long number)
+{
+    char digits[20];
+    int count = 0;
+
+    do {
+        digits[count++] = (char) ('0' + number % 10);
+        number /= 10;
+    } while (number > 0);
+    while (count > 0)
+        *p++ = digits[--count];
+    return p;
+}		/* -----  end of function putnumber  ----- */
+
+/*
+ * Description:  Hashes what identifies a deadline: the case id, short title,
+ * and rule version, each with its null terminator so that ("ab", "c") and
+ * ("a", "bc") differ.
+ * Returns:  The 64-bit FNV-1a hash.
+ */
+
+static uint64_t uidkey (const char *caseid, const char *shorttitle,
+                        const char *ruleversion)
+{
+    uint64_t hash = FNV_OFFSET;
+
+    hash = hashtext(hash, caseid);
+    hash = hashtext(hash, shorttitle);
+    return hashtext(hash, ruleversion);
+}		/* -----  end of function uidkey  ----- */
+
+/*
+ * Description:  Hashes what is exported for a deadline apart from its UID:
+ * the date and the event's text.
+ * Returns:  The 64-bit FNV-1a hash, moved off MANIFEST_CANCELLED.
+ */
+
+static uint64_t contenthash (const struct ExportItem *item)
+{
+    const struct CourtEvent *event = item->event;
+    uint64_t hash = FNV_OFFSET;
+    char date[9];
+
+    *putdate(date, item->jdn) = '\0';
+    hash = hashtext(hash, date);
+    hash = hashtext(hash, event->eventitle);
+    hash = hashtext(hash, event->description);
+    hash = hashtext(hash, event->authority);
+    hash = hashtext(hash, event->eventcategory);
+    return (hash == MANIFEST_CANCELLED) ? hash + 1 : hash;
+}		/* -----  end of function contenthash  ----- */
+
+/*
+ * Description:  Makes room for len bytes in the sink.
+ * Returns:  Where to write the bytes, or NULL if the export has failed.
+ */
+
+static char * reserve (struct ExportFile *exp, size_t len)
+{
+    char *p;
+
+    if (exp->error != EX_OK)
+        return NULL;
+    if ((p = sinkreserve(exp->sink, len)) == NULL)
+        exp->error = sinkerror(exp->sink);
+    return p;
+}		/* -----  end of function reserve  ----- */
+
+/*
+ * Description:  Copies text that is already in iCalendar form (folded, with
+ * CRLF line endings) into the sink.
+ * Returns:  EX_OK, or a negative EX_E code.
+ */
+
+static int putraw (struct ExportFile *exp, const char *text, size_t len)
+{
+    if (exp->error == EX_OK && sinkwrite(exp->sink, text, len) != OUT_OK)
+        exp->error = sinkerror(exp->sink);
+    return exp->error;
+}		/* -----  end of function putraw  ----- */
+
+/*
+ * Description:  Translates the error of a sink into an EX_E code.
+ */
+
+static int sinkerror (const struct OutputSink *sink)
+{
+    switch (sink->error) {
+        case OUT_OK:
+            return EX_OK;
+        case OUT_EOPEN:
+            return EX_EOPEN;
+        case OUT_ENOMEM:
+        case OUT_ETOOBIG: /* never happens: a VEVENT is a few KB */
+            return EX_ENOMEM;
+        default:
+            return EX_EWRITE;
+    }
+}		/* -----  end of function sinkerror  ----- */
+
+/*
+ * Description:  Copies text into a content line, escaping it if it is a
+ * TEXT value and folding the line as it reaches ICAL_LINELEN octets.
+ *
+ * Parameters:  Where to write, the number of octets already on the current
+ * line (updated), the text, and nonzero to escape it.
+ *
+ * Returns:  The end of what was written.
+ *
+ * Algorithm:  RFC 5545 3.1 and 3.3.11: a line is folded by inserting CRLF
+ * and a single space, which counts as the first octet of the next line.
+ * Backslash, semicolon, and comma are escaped with a backslash, and a
+ * newline becomes \n.  A multi-octet UTF-8 character is never split across a
+ * fold.
+ */
+
+static char * foldtext (char *p, int *col, const char *text, int escape)
+{
+    const unsigned char *s = (const unsigned char *) text;
+    char seq[4]; /* the octets to write for the current character */
+    int len, used, i; /* octets written, and octets of text consumed */
+
+    while (*s != '\0') {
+        len = used = 1;
+        seq[0] = (char) *s;
+        if (escape && (*s == '\\' || *s == ';' || *s == ',')) {
+            seq[0] = '\\';
+            seq[1] = (char) *s;
+            len = 2;
+        } else if (escape && *s == '\n') {
+            seq[0] = '\\';
+            seq[1] = 'n';
+            len = 2;
+        } else if (escape && *s == '\r') { /* the \n stands for it */
+            s++;
+            continue;
+        } else if (*s >= 0xC0) {
+            len = (*s >= 0xF0) ? 4 : (*s >= 0xE0) ? 3 : 2;
+            for (i = 1; i < len && s[i] >= 0x80 && s[i] < 0xC0; i++)
+                seq[i] = (char) s[i];
+            len = used = i;
+        }
+
+        if (*col + len > ICAL_LINELEN) {
+            p = PUTCONST(p, CRLF " ");
+            *col = 1;
+        }
+        for (i = 0; i < len; i++)
+            *p++ = seq[i];
+        *col += len;
+        s += used;
+    }
+    return p;
+}		/* -----  end of function foldtext  ----- */
+
+/*
+ * Description:  Formats a Julian Day Number as an iCalendar DATE, YYYYMMDD.
+ * Returns:  The end of what was written.
+ */
+
+static char * putdate (char *p, int jdn)
+{
+    struct DateTime dt;
+
+    jdn2greg(jdn, &dt);
+    p[0] = (char) ('0' + dt.year / 1000 % 10);
+    p[1] = (char) ('0' + dt.year / 100 % 10);
+    p[2] = (char) ('0' + dt.year / 10 % 10);
+    p[3] = (char) ('0' + dt.year % 10);
+    p[4] = (char) ('0' + dt.month / 10);
+    p[5] = (char) ('0' + dt.month % 10);
+    p[6] = (char) ('0' + dt.day / 10);
+    p[7] = (char) ('0' + dt.day % 10);
+    return p + 8;
+}		/* -----  end of function putdate  ----- */
+
+/*
+ * Description:  Adds text, and its null terminator, to a 64-bit FNV-1a hash.
+ * Returns:  The new hash.
+ * References:  FNV-1a is by Fowler, Noll, and Vo.
+ */
+
+static uint64_t hashtext (uint64_t hash, const char *text)
+{
+    const unsigned char *s = (const unsigned char *) text;
+
+    do {
+        hash ^= *s;
+        hash *= FNV_PRIME;
+    } while (*s++ != '\0');
+    return hash;
+}		/* -----  end of function hashtext  ----- */
+
+/*
+ * Description:  qsort() comparison for deadlines: by key, then by the order
+ * they were passed, so the first of two duplicates sorts first.
+ */
+
+static int pendingcmp (const void *item1, const void *item2)
+{
+    const struct PendingItem *p1 = item1;
+    const struct PendingItem *p2 = item2;
+
+    if (p1->entry.uidkey != p2->entry.uidkey)
+        return (p1->entry.uidkey < p2->entry.uidkey) ? -1 : 1;
+    return (p1->item < p2->item) ? -1 : (p1->item > p2->item);
+}		/* -----  end of function pendingcmp  ----- */
+
+/*
+ * Description:  Works out the most bytes a content line holding textlen
+ * bytes can take once folded, including its CRLF.
+ */
+
+static size_t linesize (size_t textlen)
+{
+    return textlen + (textlen / (ICAL_LINELEN - 4) + 1) * 3 + 2;
+}		/* -----  end of function linesize  ----- */
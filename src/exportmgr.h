@@ -1,5 +1,5 @@
 /*
- * Filename: exportmgr.c
+ * Filename: exportmgr.h
  * Project: DocketMaster
  *
  * Description:  This module contains the functions that control exporting
@@ -7,85 +7,314 @@
  *
  * Version: 1.0.20
  * Created: 01/16/2012 07:16:53 PM
- * Last Modified: Wed Dec 16 14:27:59 2020
+ * Last Modified: Mon Oct 19 10:37:38 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
- *  
- * Copyright: Copyright (c) 2012-2020, Thomas H. Vidal
+ *
+ * Copyright: Copyright (c) 2012-2026, Thomas H. Vidal
  * SPDX-License-Identifier: GPL-2.0-only
  *
- * Usage:   Used by DocketMaster Program
+ * Usage:   Used by DocketMaster Program.  An export is written in order:
+ * newexportfile() (or newexportsink() to write to an OutputSink that is
+ * already open), writeheaders(), addtz() if the events carry times,
+ * write_cal_items() as many times as needed, writeenders(), and
+ * closexportfile().  An incremental export of a case writes its deadlines
+ * with write_changed_items() instead, between loadmanifest() and
+ * savemanifest().
  *
- * File Format:   Saves calendar data in outlook iCalendar format.
+ * File Format:   Saves calendar data in outlook iCalendar format.  Every
+ * deadline is an all-day VEVENT (DTSTART;VALUE=DATE).  The VTIMEZONE
+ * components are generated from a table of US daylight saving rules built
+ * into this module, so no system time zone data is needed.  Lines end in CRLF and
+ * are folded at 75 octets, as RFC 5545 requires.
  *
- * Restrictions:   
+ * Restrictions:   An ExportFile belongs to one thread at a time.  Nothing
+ * else is shared, so separate exports may run on separate threads.
  *
- * Error Handling:   
+ * Error Handling:   The functions return EX_OK or a negative EX_E code.  A
+ * write error is sticky: once one occurs, the rest of the export is
+ * discarded and closexportfile() reports it.
  *
  * References: Refer to internet mail consortium website re materials re
  * personal data interchange: http://www.imc.org/pdi/pdiproddev.html,iCalendar
  * obj std: http://www.rfc-editor.org/info/rfc5545
- * iCalendar TIP: RFC # 5546: http://www.rfc-editor.org/info/rfc5546  
+ * iCalendar TIP: RFC # 5546: http://www.rfc-editor.org/info/rfc5546
  *
  * Notes:  This module will be expanded as necessary to cover other calendar
  * formats, if necessary.  At present, it appears most computer calendars and
  * smartphone (android, iPhone, and Blackberry) support iCalendar.
  */
 
+#ifndef _EXPORTMGR_H_INCLUDED_
+#define _EXPORTMGR_H_INCLUDED_
+
 /* #####   HEADER FILE INCLUDES   ########################################### */
 #include <stdio.h>
-
-/* #####   EXPORTED MACROS   ################################################ */
+#include <stddef.h>
+#include <stdint.h>
+#include "graphmgr.h"
+#include "outputmgr.h"
 
 /* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
-const _EXPORTFILENAME[]="_dktmstr_events";
-const _PRODID[]="DocketMaster/v.1.0";
+#define EXPORTFILENAME "_dktmstr_events.ics" /* suffix of the default
+                                                export file name */
+#define PRODID "-//Dark Matter Computing//DocketMaster 1.0//EN"
+
+#define ICAL_LINELEN 75 /* longest content line, in octets, before folding */
+#define EXPORTRULEVERSION "V1.0" /* version of the rules files, part of every
+                                    UID (see makeuid()) */
+#define UIDSIZE 32 /* room for a UID and its null terminator */
+
+#define TZBLOCKSIZE 1024 /* room for one serialized VTIMEZONE */
+
+#define SHARDSUFFIX ".ics" /* a shard's file is its name plus this */
+#define SHARDINDEXNAME "_dktmstr_index.csv" /* index of a sharded export */
+
+#define MANIFEST_MAGIC "DKTMMANI" /* first eight bytes of every manifest */
+#define MANIFEST_VERSION 1
+#define MANIFEST_CANCELLED 0 /* content hash of an entry whose deadline has
+                                been cancelled; no deadline hashes to it */
 
-/* #####   EXPORTED TYPE DEFINITIONS   ###################################### */
+/*------------------------------------------------------------------------------
+ *  Export error codes
+ *----------------------------------------------------------------------------*/
+#define EX_OK 0
+#define EX_EOPEN -1 /* export file could not be created */
+#define EX_EWRITE -2 /* export file could not be written */
+#define EX_ENOMEM -3 /* out of memory */
+#define EX_EFORMAT -4 /* manifest is not one, is truncated, is from
+                         another version, or is out of order */
 
 /* #####   EXPORTED DATA TYPES   ############################################ */
 
-typedef struct VCAL {
-
-       	char PRODID[25];
-	char VERSION[] = "2.0";
-	char TZID[25];
-	char DTSTART[18];
-	char TZOFFSETFROM[10];
-       	char TZOFFSETTO[10];
-       	char TZNAME[5];
-       END:STANDARD
-       BEGIN:DAYLIGHT
-       DTSTART:19990404T020000
-       TZOFFSETFROM:-0500
-       TZOFFSETTO:-0400
-       TZNAME:EDT
-       END:DAYLIGHT
-       END:VTIMEZONE
-       BEGIN:VEVENT
-       DTSTAMP:19980309T231000Z
-       UID:guid-1.example.com
-       ORGANIZER:mailto:mrbig@example.com
-       ATTENDEE;RSVP=TRUE;ROLE=REQ-PARTICIPANT;CUTYPE=GROUP:
-        mailto:employee-A@example.com
-       DESCRIPTION:Project XYZ Review Meeting
-       CATEGORIES:MEETING
-       CLASS:PUBLIC
-       CREATED:19980309T130000Z
-       SUMMARY:XYZ Project Review
-       DTSTART;TZID=America/New_York:19980312T083000
-       DTEND;TZID=America/New_York:19980312T093000
-       LOCATION:1CP Conference Room 4350
-       END:VEVENT
-       END:VCALENDAR
+/* The time zones of the courts we export for. */
+enum EXPORTZONE {ZONE_PACIFIC, ZONE_MOUNTAIN, ZONE_CENTRAL, ZONE_EASTERN,
+                 ZONE_NUMZONES};
+
+/* An export being written.  The VEVENTs are built in place in the sink's
+buffer.  An ExportFile must not be copied while it is open, since it may
+point to its own filesink. */
+struct ExportFile {
+    struct OutputSink *sink; /* where the export goes */
+    struct OutputSink filesink; /* the file opened by newexportfile() */
+    char dtstamp[17]; /* when the export started: YYYYMMDDTHHMMSSZ */
+    unsigned long numevents; /* VEVENTs written so far */
+    const char *ruleversion; /* of the rules the deadlines were computed
+                                from; EXPORTRULEVERSION unless set */
+    int error; /* EX_OK, or the first error */
+};
+
+/* One deadline to export. */
+struct ExportItem {
+    const char *caseid; /* the case (matter) the deadline belongs to */
+    const struct CourtEvent *event; /* the event that sets the deadline */
+    int jdn; /* Julian Day Number of the deadline */
 };
 
-/* #####   EXPORTED VARIABLES   ############################################# */
+/* One file of a sharded export: the deadlines of one case, or of all of one
+attorney's cases. */
+struct ExportShard {
+    const char *name; /* case id or attorney; names the file */
+    const struct ExportItem *items;
+    int numitems;
+    int result; /* set by exportshards(): EX_OK or a negative EX_E code */
+    unsigned long numevents; /* set by exportshards(): VEVENTs written */
+};
+
+/* What the last export of a case said about one deadline.  Entries are kept
+sorted by uidkey and are stored in the manifest file as they are in memory.
+A deadline that has been cancelled keeps its entry, with the content hash
+MANIFEST_CANCELLED and the SEQUENCE of the cancellation, so that it is not
+cancelled again and, if it comes back, is exported with a higher SEQUENCE. */
+struct ManifestEntry {
+    uint64_t uidkey; /* the hash in the deadline's UID */
+    uint64_t contenthash; /* hash of the date and text exported */
+    int32_t jdn; /* date exported */
+    uint32_t sequence; /* SEQUENCE of the last VEVENT exported */
+};
+
+struct ManifestHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numentries;
+};
+
+/* The deadlines of one case as last exported. */
+struct ExportManifest {
+    struct ManifestEntry *entries;
+    int numentries;
+};
 
 /* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
-FILE * newexportfile (void);
-int writeheaders (FILE exp_file);
-int write_cal_items (FILE exp_file);
-int writeenders (FILE exp_file);
-int closexportfile (FILE exp_file);
+
+/*
+ * Description: Creates an export file.
+ *
+ * Parameters: The ExportFile to set up, and the name of the file to create.
+ * If the name is NULL, the file is named for today's date followed by
+ * EXPORTFILENAME.
+ *
+ * Returns: EX_OK, or a negative EX_E code.
+ */
+
+int newexportfile (struct ExportFile *exp, const char *filename);
+
+/*
+ * Description: Starts an export to a sink that is already open, such as a
+ * memory sink.
+ *
+ * Parameters: The ExportFile to set up and the sink.
+ *
+ * Returns: EX_OK.  closexportfile() flushes the sink but does not close it.
+ */
+
+int newexportsink (struct ExportFile *exp, struct OutputSink *sink);
+
+/*
+ * Description: Starts the VCALENDAR object.
+ * Parameters: The export file.
+ * Returns: EX_OK, or a negative EX_E code.
+ */
+
+int writeheaders (struct ExportFile *exp);
+
+/*
+ * Description: Adds the VTIMEZONE component of a court's time zone.
+ * Parameters: The export file and the zone.
+ * Returns: EX_OK, or a negative EX_E code.
+ * Notes: Each zone's component is built once, the first time any export
+ * asks for a zone, and copied into every export after that.
+ */
+
+int addtz (struct ExportFile *exp, enum EXPORTZONE zone);
+
+/*
+ * Description: Writes a VEVENT for each deadline.
+ *
+ * Parameters: The export file, the deadlines, and the number of them.
+ *
+ * Returns: EX_OK, or a negative EX_E code.
+ */
+
+int write_cal_items (struct ExportFile *exp, const struct ExportItem *items,
+                     int numitems);
+
+/*
+ * Description: Writes only the deadlines of a case that are new, changed, or
+ * no longer due since the case was last exported.
+ *
+ * Parameters: The export file, the case's manifest (see loadmanifest()),
+ * which is updated to match this export, and all of the case's current
+ * deadlines.
+ *
+ * Returns: The number of VEVENTs written, or a negative EX_E code.
+ *
+ * Notes: A changed deadline is written with its SEQUENCE bumped, and one that
+ * is no longer due is written with STATUS:CANCELLED, once.  A cancelled
+ * deadline that comes back is written with the SEQUENCE after the one its
+ * cancellation carried.  Save the manifest with
+ * savemanifest() once the export has been closed successfully.
+ */
+
+int write_changed_items (struct ExportFile *exp, struct ExportManifest *man,
+                         const struct ExportItem *items, int numitems);
+
+/*
+ * Description: Reads the manifest of a case.
+ *
+ * Parameters: Name of the manifest file and the manifest to fill in.
+ *
+ * Returns: EX_OK, or a negative EX_E code.  A file that does not exist gives
+ * an empty manifest (the case has not been exported) and EX_OK.  A file
+ * whose entries are not sorted by uidkey gives EX_EFORMAT.
+ */
+
+int loadmanifest (const char *filename, struct ExportManifest *man);
+
+/*
+ * Description: Writes the manifest of a case.
+ *
+ * Parameters: Name of the manifest file and the manifest.
+ *
+ * Returns: EX_OK, or a negative EX_E code.  The file is replaced only once
+ * the new one has been written in full.
+ */
+
+int savemanifest (const char *filename, const struct ExportManifest *man);
+
+/*
+ * Description: Releases the memory held by a manifest and empties it.
+ */
+
+void freemanifest (struct ExportManifest *man);
+
+/*
+ * Description: Writes a sharded export: one file for each shard, in
+ * parallel, followed by an index of the files.
+ *
+ * Parameters: The directory to write to, the shards, the number of them, and
+ * the number of threads to use (0 to use the shared task pool, which has one
+ * per processor).
+ *
+ * Returns: The number of shards that could not be written (each shard's
+ * result says why), or a negative EX_E code if the index could not be
+ * written.
+ *
+ * Notes: The index, SHARDINDEXNAME, is a CSV file listing each shard's
+ * name, file, number of events, and result.
+ */
+
+int exportshards (const char *directory, struct ExportShard *shards,
+                  int numshards, int numthreads);
+
+/*
+ * Description: Makes the file name of a shard: the directory, then the
+ * shard's name with any character that is not a letter, digit, '-', or '.'
+ * replaced by '_', then SHARDSUFFIX.
+ *
+ * Parameters: Where to put the name, its size, the directory, and the
+ * shard's name.
+ *
+ * Returns: The file name, or NULL if it does not fit.
+ */
+
+char *shardfilename (char *filename, size_t size, const char *directory,
+                     const char *name);
+
+/*
+ * Description: Makes the UID of a deadline.
+ *
+ * Parameters: Where to put the UID (at least UIDSIZE chars), the case id, the
+ * short title of the event, and the version of the rules.
+ *
+ * Returns: The UID.
+ *
+ * Notes: The UID depends only on its arguments, so an event exported again
+ * keeps its UID and calendar programs treat it as an update.  No state is
+ * shared, so any number of threads may call this at once.
+ */
+
+char *makeuid (char *uid, const char *caseid, const char *shorttitle,
+               const char *ruleversion);
+
+/*
+ * Description: Ends the VCALENDAR object.
+ * Parameters: The export file.
+ * Returns: EX_OK, or a negative EX_E code.
+ */
+
+int writeenders (struct ExportFile *exp);
+
+/*
+ * Description: Writes whatever is still buffered and, if newexportfile()
+ * opened the file, closes it.
+ *
+ * Parameters: The export file.
+ *
+ * Returns: EX_OK, or the first error of the export.
+ */
+
+int closexportfile (struct ExportFile *exp);
+
+#endif	/* _EXPORTMGR_H_INCLUDED_ */
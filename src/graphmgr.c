@@ -11,7 +11,7 @@
  *
  * Version: 1.0.20
  * Created: 10/24/2011
- * Last Modified: Wed Dec 16 16:37:03 2020
+ * Last Modified: Mon Oct 19 10:35:03 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -30,6 +30,7 @@
  */
 
 #include "graphmgr.h"
+#include "arena.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -123,7 +124,9 @@ struct CourtEventNode* insertevent (struct CourtEvent* eventinfo,
         eventcmp(eventinfo->shorttitle, temphead->eventdata.shorttitle) <= 0)
     {
          /* create a new node */
-        new_event = malloc(sizeof(struct CourtEvent));
+        new_event = countedmalloc(sizeof(struct CourtEventNode));
+        if (new_event == NULL)
+            return eventlist;
 
         /* copy the data into the new node */
         new_event->eventdata.eventflags = eventinfo->eventflags;
@@ -162,8 +165,8 @@ struct CourtEventNode* insertevent (struct CourtEvent* eventinfo,
     }
     else
     {
-        temphead = temphead->nextevent;
-        temphead = insertevent (eventinfo, temphead);
+        /* insert further down the list; this node stays the head */
+        temphead->nextevent = insertevent (eventinfo, temphead->nextevent);
     }
 
     return temphead;
@@ -197,7 +200,71 @@ int insertdependency (struct Dependency newdep, struct EventGraph* graph)
 
 int deleteevent  (struct CourtEvent* delevent, struct EventGraph* graph)
 {
-    return 0;
+    struct CourtEventNode **link; /* the pointer that points to the node */
+    struct CourtEventNode *node;
+    struct AdjacencyMatrix *matrix;
+    int index;
+
+    for (link = &graph->eventlist; *link != NULL; link = &(*link)->nextevent)
+        if (&(*link)->eventdata == delevent)
+            break;
+    if (*link == NULL)
+        return 0; /* the event is not in this graph */
+
+    node = *link;
+    matrix = &graph->dependencymatrix;
+
+    /* Remove the edges from the events this event triggers (its row) and to
+    the events that trigger it (its column). */
+    if (node->eventposn >= 0 && node->eventposn < matrix->trigger_rows) {
+        for (index = 0; index < matrix->triggeredby_cols; index++) {
+            if (matrix->rowptr[node->eventposn][index].dependencyhandle
+                    != NULL) {
+                memset(&matrix->rowptr[node->eventposn][index], 0,
+                       sizeof(struct Dependency));
+                graph->numedges--;
+            }
+            if (matrix->rowptr[index][node->eventposn].dependencyhandle
+                    != NULL) {
+                memset(&matrix->rowptr[index][node->eventposn], 0,
+                       sizeof(struct Dependency));
+                graph->numedges--;
+            }
+        }
+    }
+
+    *link = node->nextevent;
+    countedfree(node);
+    graph->listsize--;
+    return 1;
+}
+
+/*
+ * Description: Releases every event in the graph and its dependency matrix,
+ * leaving the graph empty.
+ *
+ * Parameters: Takes a pointer to the EventGraph.
+ *
+ * Returns: No return value.
+ */
+
+void freeeventgraph (struct EventGraph* graph)
+{
+    struct CourtEventNode *node;
+
+    while ((node = graph->eventlist) != NULL) {
+        graph->eventlist = node->nextevent;
+        countedfree(node);
+    }
+    countedfree(graph->dependencymatrix.matrixptr);
+    countedfree(graph->dependencymatrix.rowptr);
+    graph->dependencymatrix.matrixptr = NULL;
+    graph->dependencymatrix.rowptr = NULL;
+    graph->dependencymatrix.trigger_rows = 0;
+    graph->dependencymatrix.triggeredby_cols = 0;
+    graph->listsize = 0;
+    graph->numedges = 0;
+    return;
 }
 
 /*
@@ -230,7 +297,14 @@ int deletedependency (struct Dependency* deldep, struct EventGraph* graph)
 
 int replaceevent (struct CourtEvent* newvertex, struct CourtEvent* oldvertex)
 {
-    return 0;
+    /* The event is replaced in place, so the node keeps its position in the
+    list and in the matrix, and the dependencyhandles that point to it stay
+    valid.  The caller must relink its dependencies if they changed. */
+    if (newvertex == NULL || oldvertex == NULL)
+        return 0;
+
+    *oldvertex = *newvertex;
+    return 1;
 }
 
 /*
@@ -276,15 +350,16 @@ memory.  This is the actual block of memory where the adjacency matrix data will
 be stored.  It's the simulated array. */
 
     graph->dependencymatrix.matrixptr =
-        malloc(graph->dependencymatrix.trigger_rows *
-               graph->dependencymatrix.triggeredby_cols *
-               sizeof(struct Dependency));
+        countedcalloc(graph->dependencymatrix.trigger_rows *
+                      graph->dependencymatrix.triggeredby_cols,
+                      sizeof(struct Dependency));
 
 /* Step 2. Allocate room for the pointers to the rows.  This sets the pointers
 to the rows of Dependency events. */
 
-    graph->dependencymatrix.rowptr = malloc(graph->dependencymatrix.trigger_rows
-                                            * sizeof(struct Dependency *));
+    graph->dependencymatrix.rowptr =
+        countedmalloc(graph->dependencymatrix.trigger_rows *
+                      sizeof(struct Dependency *));
 
 /* Step 3. 'Point' the pointers.  This points each row pointer to the beginning
 of each row. Note the simple pointer arithmetic. */
@@ -299,6 +374,56 @@ of each row. Note the simple pointer arithmetic. */
     return 0;
 }
 
+/*
+ * Description: Grows (or shrinks) the adjacency matrix to hold newsize
+ * events, keeping the dependencies already in it.
+ *
+ * Parameters: Takes a pointer to the EventGraph and the new number of rows
+ * and columns.
+ *
+ * Returns: Zero if successful, -1 if memory could not be allocated, in
+ * which case the old matrix is left untouched.
+ *
+ * Notes: Dependencies in rows or columns past newsize are dropped.
+ */
+
+int resizeadjacencymatrix (struct EventGraph* graph, int newsize)
+{
+    struct AdjacencyMatrix *matrix = &graph->dependencymatrix;
+    struct Dependency *newblock; /* the new simulated array */
+    struct Dependency **newrows; /* the new row pointers */
+    int row, keeprows, keepcols;
+
+    newblock = countedcalloc((size_t) newsize * newsize,
+                             sizeof(struct Dependency));
+    newrows = countedmalloc(newsize * sizeof(struct Dependency *));
+    if (newblock == NULL || newrows == NULL) {
+        countedfree(newblock);
+        countedfree(newrows);
+        return -1;
+    }
+
+    keeprows = (matrix->trigger_rows < newsize) ?
+        matrix->trigger_rows : newsize;
+    keepcols = (matrix->triggeredby_cols < newsize) ?
+        matrix->triggeredby_cols : newsize;
+
+    for (row = 0; row < newsize; row++) {
+        newrows[row] = newblock + (row * newsize);
+        if (row < keeprows && matrix->rowptr != NULL)
+            memcpy(newrows[row], matrix->rowptr[row],
+                   keepcols * sizeof(struct Dependency));
+    }
+
+    countedfree(matrix->matrixptr);
+    countedfree(matrix->rowptr);
+    matrix->matrixptr = newblock;
+    matrix->rowptr = newrows;
+    matrix->trigger_rows = newsize;
+    matrix->triggeredby_cols = newsize;
+    return 0;
+}
+
 /*-----------------------------------------------------------------------------
  * Function Definitions -- utility functions
  *----------------------------------------------------------------------------*/
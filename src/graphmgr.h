@@ -10,7 +10,7 @@
  *
  * Version: 1.0.20
  * Created: 10/24/2011
- * Last Modified: Wed Dec 16 17:24:47 2020
+ * Last Modified: Mon Oct 19 09:48:06 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -51,6 +51,12 @@ a legitimate countperiod.  */
 
 const char NOT_PARTY_SENSITIVE = -126;
 
+/* The largest count, before or after, that an event's ntcpd1 and ntcpd2 and
+a dependency's countperiod can hold.  They are chars, and the count is stored
+negated when the event comes before its trigger.  */
+
+#define MAXCOUNTPERIOD 127
+
 /* Event Flags */
 
 /* True if the event is the beginning of a chain of events. */
@@ -321,14 +327,15 @@ struct EventGraph {
 /*
  * Description: Initializes the vertex list (court events).
  *
- * Parameters: Takes a pointer to EventGraph.
+ * Parameters: Takes a pointer to EventGraph and the number of events the
+ * dependency matrix should be sized for (zero if it is not yet known).
  *
  * Returns: No return value.  This function initializes the court events
  * list only.  It does not need to initialize the matrix because entries are 
  * irrelevant until vertices have been inserted into the graph.
  */
 
-void init_eventgraph(struct EventGraph* graph);
+void init_eventgraph(struct EventGraph* graph, int numofevents);
 
 /*
  * Description: Determines whether the vertex list contains values or is
@@ -392,6 +399,17 @@ int insertdependency (struct Dependency newdep, struct EventGraph* graph);
 
 int deleteevent  (struct CourtEvent* delevent, struct EventGraph* graph);
 
+/*
+ * Description: Releases every event in the graph and its dependency matrix,
+ * leaving the graph empty.
+ *
+ * Parameters: Takes a pointer to the EventGraph.
+ *
+ * Returns: None.
+ */
+
+void freeeventgraph (struct EventGraph* graph);
+
 /*
  * Description: Removes a Dependency (edge) from the list of events.
  *
@@ -439,6 +457,18 @@ void traverse (struct EventGraph* graph); /* breadth first */
  * Function prototypes -- matrix manager 
  *----------------------------------------------------------------------------*/
 int initializeadjacencymatrix (struct EventGraph* graph);
+
+/*
+ * Description: Grows (or shrinks) the adjacency matrix to hold newsize
+ * events, keeping the dependencies already in it.
+ *
+ * Parameters: Takes a pointer to the EventGraph and the new number of rows
+ * and columns.
+ *
+ * Returns: Zero if successful, -1 if memory could not be allocated.
+ */
+
+int resizeadjacencymatrix (struct EventGraph* graph, int newsize);
 void closeadjacencymatrix (void);
 
 
@@ -0,0 +1,1172 @@
+/*
+ * Filename: httpmgr.c
+ * Project: DocketMaster
+ *
+ * Description: The HTTP manager answers schedule requests as JSON over
+ * HTTP/1.1 on the loopback interface.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:06:33 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Called by main() for the serve command.
+ * File Format: See httpmgr.h.
+ * Restrictions:
+ * Error Handling: A connection that cannot be read or written is closed;
+ * nothing a client sends stops the listener.
+ * References:
+ * Notes: Each event loop is one thread serving many connections, none of
+ * which it ever waits on.  As with the server manager's clients, a
+ * connection's requests are read as they arrive, answered into one buffer,
+ * and sent with as few writes as possible, and each connection has a
+ * ServerSession, so once its arena and buffer have grown to fit, answering
+ * a request allocates nothing.  A connection whose responses are not being
+ * read is not read from either, so it cannot make the buffer grow without
+ * end.
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "httpmgr.h"
+#include "servermgr.h"
+#include "batchmgr.h"
+#include "outputmgr.h"
+#include "arena.h"
+#include "ruleset.h"
+#include "metrics.h"
+#include "promexport.h"
+
+/* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ################ */
+
+#define MAXEVENTS 64 /* epoll events handled per wait */
+#define MAXPENDING (256 * 1024) /* responses held for a connection before
+                                   its requests are answered no further */
+#define HEADERLEN 256 /* room for the header of a response */
+#define NUMFIELDS 6 /* fields of a trigger record */
+
+/* Results of parserequest(), besides a complete request */
+#define REQ_PARTIAL 0 /* more of the request is still to come */
+#define REQ_BAD -1 /* the request cannot be read */
+#define REQ_TOOLARGE -2 /* the request is longer than HT_BUFSIZE */
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* One connection. */
+struct HttpConn {
+    int fd;
+    int slot; /* index in its loop's conns */
+    unsigned int want; /* events epoll is watching for */
+    int closing; /* nonzero to close once the responses are sent */
+    int eof; /* nonzero once the client has stopped sending */
+    int continued; /* nonzero once 100 Continue is sent for the request
+                      being read */
+    int maxpipeline; /* requests answered before their responses are
+                        sent */
+    size_t have; /* bytes in input */
+    size_t sent; /* bytes of the output already sent */
+    struct ServerSession session;
+    char input[HT_BUFSIZE]; /* requests read but not yet answered */
+};
+
+/* One event loop and the connections it serves. */
+struct HttpLoop {
+    pthread_t thread;
+    int listenfd;
+    int epollfd;
+    int numconns;
+    struct HttpConn *conns[HT_MAXCONNS];
+};
+
+/* A request, as read.  The pointers are into the connection's input. */
+struct HttpRequest {
+    const char *method;
+    size_t methodlen;
+    const char *path; /* the target, less any query */
+    size_t pathlen;
+    const char *body;
+    size_t bodylen;
+    size_t length; /* of the whole request */
+    int keepalive; /* nonzero unless the connection is to be closed */
+    int expect; /* nonzero if the client waits for 100 Continue */
+    int chunked; /* nonzero if the body is in chunks */
+};
+
+/* One trigger record of a request's body. */
+struct HttpItem {
+    struct TriggerRecord record;
+    int result; /* BT_OK, or BT_EFORMAT if the record is bad */
+    struct HttpItem *next;
+};
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
+
+static struct HttpLoop *loops;
+static int numloops; /* loops running */
+static int stoploops; /* set by stophttp(); read atomically */
+
+/* Names of the fields of a trigger record, in the order filltrigger() takes
+them. */
+static const char *fieldnames[NUMFIELDS] = {"caseid", "trigger", "date",
+                                            "service", "party", "event"};
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static void * runloop (void *arg);
+    /* An event loop's thread */
+
+static void acceptconns (struct HttpLoop *loop);
+    /* Accepts the connections waiting */
+
+static void serveconn (struct HttpLoop *loop, struct HttpConn *conn,
+                       unsigned int events);
+    /* Reads, answers, and writes what a connection is ready for */
+
+static void dropconn (struct HttpLoop *loop, struct HttpConn *conn);
+    /* Closes a connection */
+
+static void turnaway (int fd);
+    /* Tells a client it is being turned away */
+
+static int readconn (struct HttpConn *conn);
+    /* Reads what a connection has sent */
+
+static int flushconn (struct HttpConn *conn);
+    /* Sends as much of a connection's responses as it will take */
+
+static int answerall (struct HttpConn *conn);
+    /* Answers the complete requests a connection has sent */
+
+static int parserequest (const char *data, size_t len,
+                         struct HttpRequest *request);
+    /* Reads a request's line and headers */
+
+static void answerhttp (struct HttpConn *conn,
+                        const struct HttpRequest *request);
+    /* Answers one request */
+
+static void answermetrics (struct HttpConn *conn,
+                           const struct HttpRequest *request);
+    /* Answers GET /metrics */
+
+static void answererror (struct HttpConn *conn, int status,
+                         const char *extra, const char *message);
+    /* Answers a request with an error */
+
+static void writeheader (struct HttpConn *conn, int status,
+                         const char *type, const char *extra,
+                         size_t bodystart);
+    /* Puts a response's header before its body */
+
+static int answerjson (struct ServerSession *session,
+                       const struct RuleSet *rules, const char *body,
+                       size_t len);
+    /* Computes the schedules a request's body asks for */
+
+static int answeritem (struct OutputSink *out, const struct RuleSet *rules,
+                       const struct HttpItem *item,
+                       struct ScheduledEvent *schedule, int maxevents);
+    /* Computes and writes the schedule of one trigger record */
+
+static const char * parseobject (const char *p, const char *end,
+                                 char **scratch, struct HttpItem *item);
+    /* Reads a trigger record as a JSON object */
+
+static const char * parsestring (const char *p, const char *end,
+                                 char **scratch);
+    /* Reads a JSON string */
+
+static const char * skipscalar (const char *p, const char *end);
+    /* Skips a JSON number, true, false, or null */
+
+static const char * skipspace (const char *p, const char *end);
+    /* Skips JSON white space */
+
+static int sameword (const char *text, size_t len, const char *word);
+    /* Compares a word, ignoring case */
+
+static const char * reasonphrase (int status);
+    /* The reason phrase of a status code */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description:  Starts answering HTTP requests on the loopback interface.
+ *
+ * Parameters:  The port and the number of event loops.
+ *
+ * Returns:  HT_OK, or a negative HT_E code.
+ *
+ * Algorithm:  Each loop has its own listening socket, bound with
+ * SO_REUSEPORT, and its own epoll instance, so the loops share nothing and
+ * never wait on each other.
+ */
+
+int starthttp (int port, int count)
+{
+    struct sockaddr_in addr;
+    struct epoll_event event;
+    struct HttpLoop *loop;
+    int one = 1;
+
+    if (count < 1)
+        count = 1;
+    if (count > HT_MAXLOOPS)
+        count = HT_MAXLOOPS;
+    loops = countedmalloc(count * sizeof(struct HttpLoop));
+    if (loops == NULL)
+        return HT_ENOMEM;
+    memset(loops, 0, count * sizeof(struct HttpLoop));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short) port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    __atomic_store_n(&stoploops, 0, __ATOMIC_RELAXED);
+
+    for (numloops = 0; numloops < count; numloops++) {
+        loop = &loops[numloops];
+        loop->epollfd = -1;
+        loop->listenfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (loop->listenfd < 0)
+            break;
+        setsockopt(loop->listenfd, SOL_SOCKET, SO_REUSEADDR, &one,
+                   sizeof(one));
+        setsockopt(loop->listenfd, SOL_SOCKET, SO_REUSEPORT, &one,
+                   sizeof(one));
+        fcntl(loop->listenfd, F_SETFL, O_NONBLOCK);
+        if (bind(loop->listenfd, (struct sockaddr *) &addr,
+                 sizeof(addr)) != 0 ||
+                listen(loop->listenfd, SOMAXCONN) != 0 ||
+                (loop->epollfd = epoll_create1(0)) < 0)
+            break;
+        event.events = EPOLLIN;
+        event.data.ptr = NULL; /* the listener */
+        if (epoll_ctl(loop->epollfd, EPOLL_CTL_ADD, loop->listenfd,
+                      &event) != 0 ||
+                pthread_create(&loop->thread, NULL, runloop, loop) != 0)
+            break;
+    }
+
+    if (numloops < count) {
+        close(loop->listenfd);
+        if (loop->epollfd >= 0)
+            close(loop->epollfd);
+        stophttp();
+        return HT_ESOCKET;
+    }
+    return HT_OK;
+}		/* -----  end of function starthttp  ----- */
+
+/*
+ * Description:  Stops answering HTTP requests.
+ * Parameters:  None.
+ * Returns:  Nothing.
+ */
+
+void stophttp (void)
+{
+    int index;
+
+    __atomic_store_n(&stoploops, 1, __ATOMIC_RELAXED);
+    for (index = 0; index < numloops; index++) {
+        pthread_join(loops[index].thread, NULL);
+        close(loops[index].epollfd);
+        close(loops[index].listenfd);
+    }
+    countedfree(loops);
+    loops = NULL;
+    numloops = 0;
+    return;
+}		/* -----  end of function stophttp  ----- */
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description:  An event loop's thread: serves its connections until
+ * stophttp(), then closes them.  It wakes twice a second to see whether it
+ * has been asked to stop.
+ */
+
+static void * runloop (void *arg)
+{
+    struct HttpLoop *loop = arg;
+    struct epoll_event events[MAXEVENTS];
+    int count, index;
+
+    while (!__atomic_load_n(&stoploops, __ATOMIC_RELAXED)) {
+        count = epoll_wait(loop->epollfd, events, MAXEVENTS, 500);
+        for (index = 0; index < count; index++) {
+            if (events[index].data.ptr == NULL)
+                acceptconns(loop);
+            else
+                serveconn(loop, events[index].data.ptr,
+                          events[index].events);
+        }
+    }
+    while (loop->numconns > 0)
+        dropconn(loop, loop->conns[0]);
+    return NULL;
+}		/* -----  end of function runloop  ----- */
+
+/*
+ * Description:  Accepts the connections waiting on a loop's listener.  One
+ * that would be more than HT_MAXCONNS is answered 503 and closed at once.
+ */
+
+static void acceptconns (struct HttpLoop *loop)
+{
+    struct epoll_event event;
+    struct ServerLimits limits;
+    struct HttpConn *conn;
+    int fd, one = 1;
+
+    getserverlimits(&limits);
+    while ((fd = accept(loop->listenfd, NULL, NULL)) >= 0) {
+        if (loop->numconns == HT_MAXCONNS) {
+            refuseclient();
+            turnaway(fd);
+            close(fd);
+            continue;
+        }
+        conn = NULL;
+        if ((conn = countedmalloc(sizeof(struct HttpConn))) == NULL ||
+                opensession(&conn->session) != SV_OK) {
+            countedfree(conn);
+            close(fd);
+            continue;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        conn->fd = fd;
+        conn->want = EPOLLIN;
+        conn->closing = conn->eof = conn->continued = 0;
+        conn->maxpipeline = limits.maxpipeline;
+        conn->have = conn->sent = 0;
+        event.events = conn->want;
+        event.data.ptr = conn;
+        if (epoll_ctl(loop->epollfd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            closesession(&conn->session);
+            countedfree(conn);
+            close(fd);
+            continue;
+        }
+        conn->slot = loop->numconns;
+        loop->conns[loop->numconns++] = conn;
+    }
+    return;
+}		/* -----  end of function acceptconns  ----- */
+
+/*
+ * Description:  Reads, answers, and writes what a connection is ready for,
+ * then tells epoll what to wait for next.
+ *
+ * Parameters:  The loop, the connection, and the events epoll reported.
+ *
+ * Algorithm:  The requests are answered until the responses waiting to be
+ * sent pass MAXPENDING or the connection's maxpipeline.  If the client then
+ * takes them all, the rest are answered; if it does not, the connection
+ * waits for it to, and is not read from meanwhile.
+ */
+
+static void serveconn (struct HttpLoop *loop, struct HttpConn *conn,
+                       unsigned int events)
+{
+    struct OutputSink *out = &conn->session.output;
+    struct epoll_event event;
+    int more;
+
+    if ((events & EPOLLIN) && readconn(conn) != 0) {
+        dropconn(loop, conn);
+        return;
+    }
+    if ((events & EPOLLERR) && !(events & EPOLLIN)) {
+        dropconn(loop, conn);
+        return;
+    }
+    do {
+        more = answerall(conn);
+        if (flushconn(conn) != 0) {
+            dropconn(loop, conn);
+            return;
+        }
+    } while (more && out->used == 0);
+    if (out->used == 0 && (conn->closing || (conn->eof && !more))) {
+        dropconn(loop, conn);
+        return;
+    }
+
+    event.events = 0;
+    if (out->used > 0)
+        event.events |= EPOLLOUT;
+    if (!conn->closing && !conn->eof && out->used <= MAXPENDING)
+        event.events |= EPOLLIN;
+    if (event.events != conn->want) {
+        conn->want = event.events;
+        event.data.ptr = conn;
+        epoll_ctl(loop->epollfd, EPOLL_CTL_MOD, conn->fd, &event);
+    }
+    return;
+}		/* -----  end of function serveconn  ----- */
+
+/*
+ * Description:  Closes a connection and releases its memory.
+ */
+
+static void dropconn (struct HttpLoop *loop, struct HttpConn *conn)
+{
+    close(conn->fd);
+    closesession(&conn->session);
+    loop->conns[conn->slot] = loop->conns[--loop->numconns];
+    loop->conns[conn->slot]->slot = conn->slot;
+    countedfree(conn);
+    return;
+}		/* -----  end of function dropconn  ----- */
+
+/*
+ * Description:  Tells a client that is being turned away that the server
+ * is busy.  As with the socket, the connection is not waited on.
+ */
+
+static void turnaway (int fd)
+{
+    static const char response[] = "HTTP/1.1 503 Service Unavailable\r\n"
+        "Content-Type: application/json\r\nContent-Length: 40\r\n"
+        "Retry-After: 1\r\nConnection: close\r\n\r\n"
+        "{\"status\":\"error\",\"error\":\"server busy\"}";
+
+    send(fd, response, sizeof(response) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+    return;
+}		/* -----  end of function turnaway  ----- */
+
+/*
+ * Description:  Reads what a connection has sent, as far as its input has
+ * room.  A short read means the socket is drained, so it is not read again
+ * only to find it empty.
+ *
+ * Returns:  Zero, or -1 if the connection failed.
+ */
+
+static int readconn (struct HttpConn *conn)
+{
+    size_t room;
+    ssize_t got;
+
+    while ((room = HT_BUFSIZE - conn->have) > 0) {
+        got = read(conn->fd, conn->input + conn->have, room);
+        if (got > 0) {
+            conn->have += got;
+            if ((size_t) got < room)
+                return 0;
+        } else if (got == 0) {
+            conn->eof = 1;
+            return 0;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        } else if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return 0;
+}		/* -----  end of function readconn  ----- */
+
+/*
+ * Description:  Sends as much of a connection's responses as it will take.
+ *
+ * Returns:  Zero, or -1 if the connection failed or the responses could not
+ * be built.
+ */
+
+static int flushconn (struct HttpConn *conn)
+{
+    struct OutputSink *out = &conn->session.output;
+    ssize_t sent;
+
+    if (out->error != OUT_OK)
+        return -1;
+    while (conn->sent < out->used) {
+        sent = send(conn->fd, out->buffer + conn->sent,
+                    out->used - conn->sent, MSG_NOSIGNAL);
+        if (sent > 0)
+            conn->sent += sent;
+        else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0;
+        else if (sent == 0 || errno != EINTR)
+            return -1;
+    }
+    sinkrewind(out);
+    conn->sent = 0;
+    return 0;
+}		/* -----  end of function flushconn  ----- */
+
+/*
+ * Description:  Answers the complete requests a connection has sent, and
+ * keeps the rest of its input for when more arrives.
+ *
+ * Returns:  Nonzero if requests were left unanswered because the responses
+ * waiting to be sent passed MAXPENDING, or the connection's maxpipeline.
+ */
+
+static int answerall (struct HttpConn *conn)
+{
+    struct HttpRequest request;
+    size_t start;
+    int result, more, answered;
+
+    start = 0;
+    more = 0;
+    answered = 0;
+    while (!conn->closing) {
+        if (conn->session.output.used > MAXPENDING ||
+                answered == conn->maxpipeline) {
+            more = 1;
+            break;
+        }
+        result = parserequest(conn->input + start, conn->have - start,
+                              &request);
+        if (result == REQ_PARTIAL) {
+            if (request.expect && !conn->continued) {
+                sinkputs(&conn->session.output,
+                         "HTTP/1.1 100 Continue\r\n\r\n");
+                conn->continued = 1;
+            }
+            break;
+        }
+        if (result < 0) {
+            conn->closing = 1;
+            if (result == REQ_TOOLARGE)
+                answererror(conn, 413, "", "request too large");
+            else
+                answererror(conn, 400, "", "bad request");
+            break;
+        }
+        answerhttp(conn, &request);
+        answered++;
+        conn->continued = 0;
+        start += request.length;
+    }
+    memmove(conn->input, conn->input + start, conn->have - start);
+    conn->have -= start;
+    return more;
+}		/* -----  end of function answerall  ----- */
+
+/*
+ * Description:  Reads a request's line and headers.
+ *
+ * Parameters:  The data read and its length, and the HttpRequest to fill
+ * in.
+ *
+ * Returns:  1 if the whole request has been read, or a REQ_ code.  A
+ * REQ_PARTIAL request's expect is set if its headers have been read.
+ *
+ * Notes:  Only the headers that change how the request is read or answered
+ * are looked at: Content-Length, Connection, Transfer-Encoding, and Expect.
+ */
+
+static int parserequest (const char *data, size_t len,
+                         struct HttpRequest *request)
+{
+    const char *p, *end, *line, *eol, *colon, *value, *valueend;
+    size_t headerlen, namelen;
+    unsigned long contentlength;
+
+    memset(request, 0, sizeof(struct HttpRequest));
+    end = NULL;
+    for (p = data; p + 4 <= data + len; p++)
+        if (p[0] == '\r' && p[1] == '\n' && p[2] == '\r' && p[3] == '\n') {
+            end = p;
+            break;
+        }
+    if (end == NULL)
+        return (len >= HT_BUFSIZE) ? REQ_TOOLARGE : REQ_PARTIAL;
+    headerlen = end + 4 - data;
+
+    /* The request line: method, target, and version */
+    request->method = data;
+    for (p = data; p < end && *p != ' '; p++)
+        ;
+    request->methodlen = p - data;
+    if (p == end || request->methodlen == 0)
+        return REQ_BAD;
+    request->path = ++p;
+    for (; p < end && *p != ' ' && *p != '?'; p++)
+        ;
+    request->pathlen = p - request->path;
+    for (; p < end && *p != ' '; p++)
+        ;
+    if (end - p < 9 || memcmp(p, " HTTP/1.", 8) != 0)
+        return REQ_BAD;
+    if (p[8] == '1')
+        request->keepalive = 1;
+    else if (p[8] != '0')
+        return REQ_BAD;
+    p += 9;
+
+    contentlength = 0;
+    while (p < end) {
+        if (p[0] != '\r' || p[1] != '\n')
+            return REQ_BAD;
+        line = p + 2;
+        for (eol = line; eol < end && *eol != '\r'; eol++)
+            ;
+        p = eol;
+        for (colon = line; colon < eol && *colon != ':'; colon++)
+            ;
+        if (colon == eol)
+            return REQ_BAD;
+        namelen = colon - line;
+        for (value = colon + 1; value < eol && (*value == ' ' ||
+                                                *value == '\t'); value++)
+            ;
+        for (valueend = eol; valueend > value && (valueend[-1] == ' ' ||
+                                                  valueend[-1] == '\t');
+             valueend--)
+            ;
+
+        if (sameword(line, namelen, "Content-Length")) {
+            if (value == valueend)
+                return REQ_BAD;
+            for (contentlength = 0; value < valueend; value++) {
+                if (*value < '0' || *value > '9')
+                    return REQ_BAD;
+                contentlength = contentlength * 10 + (*value - '0');
+                if (contentlength > HT_BUFSIZE)
+                    return REQ_TOOLARGE;
+            }
+        } else if (sameword(line, namelen, "Connection")) {
+            if (sameword(value, valueend - value, "close"))
+                request->keepalive = 0;
+            else if (sameword(value, valueend - value, "keep-alive"))
+                request->keepalive = 1;
+        } else if (sameword(line, namelen, "Transfer-Encoding")) {
+            request->chunked = 1;
+        } else if (sameword(line, namelen, "Expect")) {
+            request->expect = sameword(value, valueend - value,
+                                       "100-continue");
+        }
+    }
+
+    if (headerlen + contentlength > HT_BUFSIZE)
+        return REQ_TOOLARGE;
+    if (request->chunked) { /* answered with an error before the body */
+        request->length = headerlen;
+        return 1;
+    }
+    if (len < headerlen + contentlength)
+        return REQ_PARTIAL;
+    request->body = data + headerlen;
+    request->bodylen = contentlength;
+    request->length = headerlen + contentlength;
+    return 1;
+}		/* -----  end of function parserequest  ----- */
+
+/*
+ * Description:  Answers one request, adding the response to the
+ * connection's output.
+ *
+ * Algorithm:  As with the server manager's requests, a schedule is computed
+ * from the rule set current when the request began, pinned until it is
+ * answered, and is answered 503 at once if the server is over its
+ * maxinflight limit.  A batch is computed from one rule set throughout,
+ * and counts as one request.
+ */
+
+static void answerhttp (struct HttpConn *conn,
+                        const struct HttpRequest *request)
+{
+    struct RuleSet *rules;
+    size_t bodystart;
+    int status;
+
+    if (!request->keepalive)
+        conn->closing = 1;
+    if (request->chunked) {
+        conn->closing = 1;
+        answererror(conn, 501, "", "chunked requests are not supported");
+        return;
+    }
+    if (request->pathlen == strlen("/metrics") &&
+            memcmp(request->path, "/metrics", request->pathlen) == 0) {
+        answermetrics(conn, request);
+        return;
+    }
+    if (request->pathlen != strlen("/schedule") ||
+            memcmp(request->path, "/schedule", request->pathlen) != 0) {
+        answererror(conn, 404, "", "not found");
+        return;
+    }
+    if (request->methodlen != strlen("POST") ||
+            memcmp(request->method, "POST", request->methodlen) != 0) {
+        answererror(conn, 405, "Allow: POST\r\n", "method not allowed");
+        return;
+    }
+    if (!admitrequest()) {
+        answererror(conn, 503, "Retry-After: 1\r\n", "server busy");
+        return;
+    }
+    if ((rules = pinruleset()) == NULL) {
+        finishrequest();
+        answererror(conn, 503, "", "no rules loaded");
+        return;
+    }
+
+    bodystart = conn->session.output.used;
+    status = answerjson(&conn->session, rules, request->body,
+                        request->bodylen);
+    unpinruleset(rules);
+    finishrequest();
+    arenareset(&conn->session.arena);
+    writeheader(conn, status, "application/json", "", bodystart);
+    return;
+}		/* -----  end of function answerhttp  ----- */
+
+/*
+ * Description:  Answers GET /metrics with every metric in the Prometheus
+ * text format.  It is answered even when the server is busy, which is when
+ * it is wanted most.
+ */
+
+static void answermetrics (struct HttpConn *conn,
+                           const struct HttpRequest *request)
+{
+    size_t bodystart;
+
+    if (request->methodlen != strlen("GET") ||
+            memcmp(request->method, "GET", request->methodlen) != 0) {
+        answererror(conn, 405, "Allow: GET\r\n", "method not allowed");
+        return;
+    }
+    bodystart = conn->session.output.used;
+    writeprometheus(&conn->session.output);
+    writeheader(conn, 200, PX_CONTENTTYPE, "", bodystart);
+    return;
+}		/* -----  end of function answermetrics  ----- */
+
+/*
+ * Description:  Answers a request with an error.
+ *
+ * Parameters:  The connection, the status, any headers to add (each ending
+ * in CRLF), and the reason for the error, which needs no escaping in JSON.
+ */
+
+static void answererror (struct HttpConn *conn, int status,
+                         const char *extra, const char *message)
+{
+    struct OutputSink *out = &conn->session.output;
+    size_t bodystart;
+
+    bodystart = out->used;
+    sinkputs(out, "{\"status\":\"error\",\"error\":\"");
+    sinkputs(out, message);
+    sinkputs(out, "\"}");
+    writeheader(conn, status, "application/json", extra, bodystart);
+    return;
+}		/* -----  end of function answererror  ----- */
+
+/*
+ * Description:  Puts a response's status line and headers before its body.
+ *
+ * Parameters:  The connection, the status, the type of the body, any
+ * headers to add, and where in the output the body starts.
+ *
+ * Algorithm:  The length of the body is not known until it is written, so
+ * it is written first and moved along to make room for the header.  The
+ * move is of one response, a few hundred bytes for most.
+ */
+
+static void writeheader (struct HttpConn *conn, int status,
+                         const char *type, const char *extra,
+                         size_t bodystart)
+{
+    struct OutputSink *out = &conn->session.output;
+    char header[HEADERLEN], *p;
+    size_t bodylen;
+    int headerlen;
+
+    bodylen = out->used - bodystart;
+    headerlen = snprintf(header, sizeof(header),
+                         "HTTP/1.1 %d %s\r\n"
+                         "Content-Type: %s\r\n"
+                         "Content-Length: %lu\r\n%s%s\r\n",
+                         status, reasonphrase(status), type,
+                         (unsigned long) bodylen, extra,
+                         conn->closing ? "Connection: close\r\n" : "");
+    if ((p = sinkreserve(out, headerlen)) == NULL)
+        return;
+    memmove(out->buffer + bodystart + headerlen, out->buffer + bodystart,
+            bodylen);
+    memcpy(out->buffer + bodystart, header, headerlen);
+    sinkcommit(out, p + headerlen);
+    return;
+}		/* -----  end of function writeheader  ----- */
+
+/*
+ * Description:  Computes the schedules a request's body asks for, and
+ * writes the response's body.
+ *
+ * Parameters:  The session, the rule set pinned for the request, and the
+ * body and its length.
+ *
+ * Returns:  The status of the response.
+ *
+ * Algorithm:  The whole body is read before anything is computed, so a
+ * body that is not JSON is answered with 400 alone rather than part of a
+ * batch and then an error.  The strings of the body, its trigger records,
+ * and the schedule come from the arena.
+ */
+
+static int answerjson (struct ServerSession *session,
+                       const struct RuleSet *rules, const char *body,
+                       size_t len)
+{
+    struct OutputSink *out = &session->output;
+    struct HttpItem *items, *item, **tail;
+    struct ScheduledEvent *schedule;
+    const char *p, *end;
+    char *scratch;
+    int maxevents, batch;
+    METRIC_STAMP(start);
+
+    maxevents = (rules->graph->listsize > 0) ? rules->graph->listsize : 1;
+    scratch = arenaalloc(&session->arena, len + 1);
+    schedule = arenaalloc(&session->arena,
+                          maxevents * sizeof(struct ScheduledEvent));
+    if (scratch == NULL || schedule == NULL) {
+        sinkputs(out, "{\"status\":\"error\",\"error\":\"out of memory\"}");
+        return 500;
+    }
+
+    items = NULL;
+    tail = &items;
+    end = body + len;
+    p = skipspace(body, end);
+    batch = (p < end && *p == '[');
+    if (batch)
+        p = skipspace(p + 1, end);
+    if (batch && p < end && *p == ']') {
+        p++;
+    } else {
+        while (p != NULL) {
+            item = arenaalloc(&session->arena, sizeof(struct HttpItem));
+            if (item == NULL) {
+                sinkputs(out, "{\"status\":\"error\","
+                         "\"error\":\"out of memory\"}");
+                return 500;
+            }
+            METRIC_START(MP_PARSETRIGGER, start);
+            p = parseobject(p, end, &scratch, item);
+            METRIC_STOP(MP_PARSETRIGGER, start);
+            if (p == NULL)
+                break;
+            item->next = NULL;
+            *tail = item;
+            tail = &item->next;
+            if (!batch)
+                break;
+            p = skipspace(p, end);
+            if (p < end && *p == ',') {
+                p = skipspace(p + 1, end);
+            } else if (p < end && *p == ']') {
+                p++;
+                break;
+            } else {
+                p = NULL;
+            }
+        }
+    }
+    if (p == NULL || skipspace(p, end) != end) {
+        countmetric(MC_TRIGGERERRORS, 1);
+        sinkputs(out, "{\"status\":\"error\",\"error\":\"bad JSON\"}");
+        return 400;
+    }
+
+    if (!batch)
+        return answeritem(out, rules, items, schedule, maxevents);
+    sinkwrite(out, "[", 1);
+    for (item = items; item != NULL; item = item->next) {
+        if (item != items)
+            sinkwrite(out, ",", 1);
+        answeritem(out, rules, item, schedule, maxevents);
+    }
+    sinkwrite(out, "]", 1);
+    return 200;
+}		/* -----  end of function answerjson  ----- */
+
+/*
+ * Description:  Computes the schedule of one trigger record, and writes it
+ * or the reason it could not be computed as a JSON object.
+ *
+ * Returns:  The status the object would have as a response of its own.
+ */
+
+static int answeritem (struct OutputSink *out, const struct RuleSet *rules,
+                       const struct HttpItem *item,
+                       struct ScheduledEvent *schedule, int maxevents)
+{
+    int count;
+
+    if (item->result != BT_OK) {
+        countmetric(MC_TRIGGERERRORS, 1);
+        sinkputs(out, "{\"status\":\"error\","
+                 "\"error\":\"bad trigger record\"}");
+        return 400;
+    }
+    count = computetrigger(rules->graph, rules->cal, &item->record, schedule,
+                           maxevents);
+    if (count < 0) {
+        sinkputs(out, "{\"status\":\"error\",\"error\":\"no such event\"}");
+        return 404;
+    }
+    sinkputs(out, "{\"status\":\"ok\",\"events\":");
+    writeschedule(out, SCHED_JSON, item->record.caseid, schedule, count);
+    sinkwrite(out, "}", 1);
+    return 200;
+}		/* -----  end of function answeritem  ----- */
+
+/*
+ * Description:  Reads a trigger record as a JSON object.
+ *
+ * Parameters:  The text and its end, the scratch space its strings are
+ * copied into (moved past them), and the HttpItem to fill in.
+ *
+ * Returns:  Where the object ends, or NULL if it is not a JSON object of
+ * plain values.
+ *
+ * Notes:  A field that is not a string or null makes the record bad, not
+ * the JSON.  Fields that are not part of a trigger record are ignored.
+ */
+
+static const char * parseobject (const char *p, const char *end,
+                                 char **scratch, struct HttpItem *item)
+{
+    const char *fields[NUMFIELDS];
+    char *key;
+    int field, badfield;
+
+    memset(fields, 0, sizeof(fields));
+    badfield = 0;
+    if (p >= end || *p != '{')
+        return NULL;
+    p = skipspace(p + 1, end);
+    if (p < end && *p == '}') {
+        p++;
+    } else {
+        for (;;) {
+            if (p >= end || *p != '"')
+                return NULL;
+            key = *scratch;
+            if ((p = parsestring(p, end, scratch)) == NULL)
+                return NULL;
+            p = skipspace(p, end);
+            if (p >= end || *p != ':')
+                return NULL;
+            p = skipspace(p + 1, end);
+
+            for (field = 0; field < NUMFIELDS; field++)
+                if (strcmp(key, fieldnames[field]) == 0)
+                    break;
+            if (p < end && *p == '"') {
+                if (field < NUMFIELDS)
+                    fields[field] = *scratch;
+                if ((p = parsestring(p, end, scratch)) == NULL)
+                    return NULL;
+            } else {
+                if (field < NUMFIELDS && (end - p < 4 ||
+                                          memcmp(p, "null", 4) != 0))
+                    badfield = 1;
+                if ((p = skipscalar(p, end)) == NULL)
+                    return NULL;
+            }
+
+            p = skipspace(p, end);
+            if (p < end && *p == ',') {
+                p = skipspace(p + 1, end);
+            } else if (p < end && *p == '}') {
+                p++;
+                break;
+            } else {
+                return NULL;
+            }
+        }
+    }
+
+    if (badfield)
+        item->result = BT_EFORMAT;
+    else
+        item->result = filltrigger(fields[0], fields[1], fields[2],
+                                   fields[3], fields[4], fields[5],
+                                   &item->record);
+    return p;
+}		/* -----  end of function parseobject  ----- */
+
+/*
+ * Description:  Reads a JSON string, copying it, unescaped and null
+ * terminated, to the scratch space.
+ *
+ * Parameters:  The string's opening quote and the end of the text, and the
+ * scratch space, which is moved past the copy.
+ *
+ * Returns:  Where the string ends, or NULL if it is not a JSON string.
+ *
+ * Notes:  A copy is never longer than the string it is copied from, quotes
+ * included, so scratch space as long as the text always has room.  A \u
+ * escape is copied as UTF-8; one of a surrogate pair, or of a null, is
+ * copied as '?'.
+ */
+
+static const char * parsestring (const char *p, const char *end,
+                                 char **scratch)
+{
+    char *q = *scratch;
+    unsigned int code;
+    int digit;
+    char c;
+
+    for (p++; p < end && *p != '"'; ) {
+        c = *p++;
+        if ((unsigned char) c < 0x20)
+            return NULL;
+        if (c != '\\') {
+            *q++ = c;
+            continue;
+        }
+        if (p >= end)
+            return NULL;
+        switch (c = *p++) {
+            case '"': case '\\': case '/':
+                *q++ = c;
+                break;
+            case 'b':
+                *q++ = '\b';
+                break;
+            case 'f':
+                *q++ = '\f';
+                break;
+            case 'n':
+                *q++ = '\n';
+                break;
+            case 'r':
+                *q++ = '\r';
+                break;
+            case 't':
+                *q++ = '\t';
+                break;
+            case 'u':
+                if (end - p < 4)
+                    return NULL;
+                for (code = 0, digit = 0; digit < 4; digit++, p++) {
+                    code <<= 4;
+                    if (*p >= '0' && *p <= '9')
+                        code |= *p - '0';
+                    else if (*p >= 'a' && *p <= 'f')
+                        code |= *p - 'a' + 10;
+                    else if (*p >= 'A' && *p <= 'F')
+                        code |= *p - 'A' + 10;
+                    else
+                        return NULL;
+                }
+                if (code == 0 || (code >= 0xd800 && code <= 0xdfff)) {
+                    *q++ = '?';
+                } else if (code < 0x80) {
+                    *q++ = (char) code;
+                } else if (code < 0x800) {
+                    *q++ = (char) (0xc0 | (code >> 6));
+                    *q++ = (char) (0x80 | (code & 0x3f));
+                } else {
+                    *q++ = (char) (0xe0 | (code >> 12));
+                    *q++ = (char) (0x80 | ((code >> 6) & 0x3f));
+                    *q++ = (char) (0x80 | (code & 0x3f));
+                }
+                break;
+            default:
+                return NULL;
+        }
+    }
+    if (p >= end)
+        return NULL;
+    *q++ = '\0';
+    *scratch = q;
+    return p + 1;
+}		/* -----  end of function parsestring  ----- */
+
+/*
+ * Description:  Skips a JSON number, true, false, or null.
+ * Returns:  Where the value ends, or NULL if there is none.
+ */
+
+static const char * skipscalar (const char *p, const char *end)
+{
+    static const char *words[] = {"true", "false", "null"};
+    const char *start = p;
+    size_t len;
+    int index;
+
+    for (index = 0; index < 3; index++) {
+        len = strlen(words[index]);
+        if ((size_t) (end - p) >= len && memcmp(p, words[index], len) == 0)
+            return p + len;
+    }
+    while (p < end && ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' ||
+                       *p == '.' || *p == 'e' || *p == 'E'))
+        p++;
+    return (p > start) ? p : NULL;
+}		/* -----  end of function skipscalar  ----- */
+
+/*
+ * Description:  Skips JSON white space.
+ * Returns:  The first character that is not white space, or end.
+ */
+
+static const char * skipspace (const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        p++;
+    return p;
+}		/* -----  end of function skipspace  ----- */
+
+/*
+ * Description:  Compares a word, ignoring case.
+ * Returns:  Nonzero if the text is the word.
+ */
+
+static int sameword (const char *text, size_t len, const char *word)
+{
+    return strlen(word) == len && strncasecmp(text, word, len) == 0;
+}		/* -----  end of function sameword  ----- */
+
+/*
+ * Description:  The reason phrase of a status code.
+ */
+
+static const char * reasonphrase (int status)
+{
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Content Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "Error";
+    }
+}		/* -----  end of function reasonphrase  ----- */
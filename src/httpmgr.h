@@ -0,0 +1,99 @@
+/*
+ * Filename: httpmgr.h
+ * Project: DocketMaster
+ *
+ * Description: The HTTP manager answers schedule requests as JSON over
+ * HTTP/1.1 on the loopback interface, for clients that would rather speak
+ * HTTP than the framed protocol of the server manager's socket.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:06:33 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Publish a rule set (see ruleset.h), starthttp(), and stophttp()
+ * when done.  The listener runs on threads of its own, so it may run beside
+ * runserver().
+ *
+ * File Format: POST /schedule with a JSON object, or an array of them, as
+ * the body.  An object is a trigger record (see batchmgr.h) with the fields
+ * as strings:
+ *     {"caseid": "CV-1", "trigger": "Trial", "date": "03/02/2026",
+ *      "service": "mail", "party": "defendant", "event": "..."}
+ * The last three may be left out.  For one object the response is
+ *     {"status": "ok", "events": [...]}
+ * with the events as SCHED_JSONL writes them, or
+ *     {"status": "error", "error": "..."}
+ * with status 400 for a bad trigger record or 404 for a trigger or event not
+ * in the rules.  For an array the response is an array of those objects, in
+ * order, with status 200.
+ *
+ * GET /metrics is answered with every metric in the Prometheus text format
+ * (see promexport.h), for scraping.
+ *
+ * Connections are kept alive unless the client asks otherwise, and a client
+ * may send any number of requests without waiting; they are answered in
+ * order.  The server's limits (see servermgr.h) apply as they do to the
+ * socket: a request over maxinflight, or a connection over HT_MAXCONNS, is
+ * answered 503 with Retry-After, and a client is not answered further while
+ * it owes reading maxpipeline responses.
+ *
+ * Restrictions: Only the loopback interface is listened on; there is no
+ * authentication.  A request, headers and body, is at most HT_BUFSIZE
+ * bytes, and chunked request bodies are not accepted.
+ *
+ * Error Handling: starthttp() returns HT_OK or a negative HT_E code.  A
+ * request that cannot be read is answered with a 4xx status and the
+ * connection closed.
+ * References: RFC 9112 (HTTP/1.1).
+ * Notes:
+ */
+
+#ifndef _HTTPMGR_H_INCLUDED_
+#define _HTTPMGR_H_INCLUDED_
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define HT_PORT 8470 /* default port */
+#define HT_BUFSIZE (64 * 1024) /* longest request, headers and body */
+#define HT_MAXCONNS 1024 /* connections at once, per event loop */
+#define HT_MAXLOOPS 16 /* event loops, each with a thread */
+
+/*------------------------------------------------------------------------------
+ *  HTTP manager error codes
+ *----------------------------------------------------------------------------*/
+#define HT_OK 0
+#define HT_ESOCKET -1 /* the port could not be listened on */
+#define HT_ENOMEM -2 /* out of memory */
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Starts answering HTTP requests on the loopback interface.
+ *
+ * Parameters: The port, and the number of event loops to run, each on its
+ * own thread (at most HT_MAXLOOPS).
+ *
+ * Returns: HT_OK, or a negative HT_E code.
+ *
+ * Notes: Schedules are computed from the current rule set (see ruleset.h).
+ * Each loop has its own listening socket on the same port, and the kernel
+ * spreads new connections among them.
+ */
+
+int starthttp (int port, int numloops);
+
+/*
+ * Description: Stops answering HTTP requests, closing every connection.
+ * Parameters: None.
+ * Returns: Nothing.
+ */
+
+void stophttp (void);
+
+#endif	/* _HTTPMGR_H_INCLUDED_ */
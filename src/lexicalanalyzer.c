@@ -8,7 +8,7 @@
  *
  * Version: 1.0.20
  * Created: 0x/xx/2011 09:56:56 PM
- * Last Modified: Wed Dec 16 14:48:18 2020
+ * Last Modified: Mon Oct 19 10:11:19 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -26,9 +26,13 @@
 
 /* #####   HEADER FILE INCLUDES   ########################################### */
 
+#include <ctype.h>
 #include <string.h>
+#include <errno.h>
 #include "lexicalanalyzer.h"
+#include "rulebuilder.h"
 #include "ruleprocessor.h"
+#include "metrics.h"
 
 
 /* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ################ */
@@ -42,11 +46,11 @@ void gettokens (char *record, (*tokenize)(void *, void *, void *));
 void gethtokens (char *r, char *f, struct HolidayRule *hstruct);
     /* Populates holiday rule structure with fields extracted from the record */
 
-void getevtokens (char *r, char *f, struct courtevent *estruct);
+void getevtokens (char *r, char *f, struct CourtEvent *estruct);
     /* Populates court event structure with fields extracted from the record */
 
-char * ftotok (char *string, char fdelim, char tdelim);
-    /* Convert fields in record to tokens */
+static void addphases (const struct PhaseStats *phases);
+    /* Adds the phases of one file to buildtimings */
 
 
 /* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
@@ -58,18 +62,24 @@ char * ftotok (char *string, char fdelim, char tdelim);
  * of a particular month.  The holidays are "attached" to the
  * array via a linked list. 
  *
- * Parameters:  File handle to the holidays file.
+ * Parameters:  File handle to the rules file, the name of the file, and the
+ * data structure to load: the holiday hash table for a holiday file, or a
+ * pointer to the EventGraph for an events file.
  *
- * Returns:  Zero if successful.  Function will return a non-zero error
- * code on specified errors, but this functionality has not been
- * coded as yet.
+ * Returns:  The number of records that were skipped because of errors, or -1
+ * if the file could not be read or is not a rules file.  Every error is
+ * recorded in the error log, with its line and column.
  *
- * Algorithm:  Function reads the file character by character, inputting the
+ * Algorithm:  Function reads the file a record at a time, inputting the
  * parsed data into the appropriate fields of a temporary holiday rule, which
  * is of type holiday rule. The temporary variable is then passed to the
  * addholiday function, which stores the new rule in the appropriate index
- * of the holidayhashtable array. The temp rule is then zeroed out and
- * the loop iterates again until it reaches EOF.
+ * of the holidayhashtable array.  A record that cannot be parsed is skipped
+ * and the loop continues with the next one, so a single pass reports every
+ * bad record in the file.
+ *
+ * Events are added to the event list only.  Their positions and their
+ * dependencies are assigned once the whole file has been read.
  *
  * File format: Version 1.0 of the Court Holiday Rules File is an ASCII text
  * file in a CSV format. The first line contains the file name and version
@@ -102,41 +112,137 @@ char * ftotok (char *string, char fdelim, char tdelim);
  */
 
 
-int parsefile (FILE *infile, const char *filename,
-        const char *fields[MAXNUMFIELDS][], void *datastruct)
+int parsefile (FILE *infile, const char *filename, void *datastruct)
 {
     char currecord[MAXRECORDLENGTH]; /* single record input buffer */
-    int curfield = 0; /* index to current field name */
+    char fields[MAXNUMFIELDS][MAXFIELDLEN]; /* the list of field names */
+    enum FILETYPE ftype; /* the type of file being read */
+    struct HolidayRule temprule; /* store data for the rule until it is
+                                    inserted into the hash table */
+    struct CourtEvent tempevent; /* store data for the event until it is
+                                    inserted into the event list */
+    struct HolidayNode **holidays; /* the holiday hash table */
+    struct EventGraph *graph; /* the event graph */
+    enum LOCALACTION action; /* what a local rule does */
+    int numfields; /* number of field names */
+    int line; /* the line number of the current record */
+    int skipped = 0; /* number of bad records */
+    int result; /* what parsing the record gave */
+    int timed; /* nonzero if buildre() is timing its phases */
+    struct PhaseStats phases[BP_NUMPHASES]; /* the time in each, if so */
+    struct PhaseClock clock; /* the start of the current phase */
+    METRIC_STAMP(start);
+
+    if (infile == NULL) {
+        seterrorcontext(filename, 0);
+        recorderror(NOFILE, 0);
+        return -1;
+    }
+
+    timed = timingbuildphases();
+    if (timed) {
+        memset(phases, 0, sizeof(phases));
+        readphaseclock(&clock);
+    }
 
     /* check filetype, version, and row headers */
-    ftype = checkfile(infile, filename, fields);
- 
-   if (ftype == H_FILE) {
-       
-    /* lexically analyze the rules and build the array of linked lists.
-        After running the checkfile function, the file should be
-        on the line with the first rule.  */
+    ftype = checkfile(infile, filename, fields, &numfields);
+    if (timed) {
+        phases[BP_CHECKFILE].bytes = ftell(infile);
+        endphase(&phases[BP_CHECKFILE], &clock);
+    }
+    if (ftype == BAD_FILE) {
+        if (timed)
+            addphases(phases);
+        return -1;
+    }
 
-        while ((fgets(currecord, sizeof(currecord), infile)) != EOF) {
-	    
-            /* The while-loop starts by reading in a record */
+    METRIC_START(MP_PARSERULES, start);
 
-  	        /* Send the record to the Tokenizer: */
-            *c = ftotok (*string, char fdelim, char tdelim);
-            tokenize (*currecord, fields[curfield], htokens,
-                (*holidayhashtable[]) datastruct);
-            curfield++;
-        }
-    } else if (ftype == E_FILE) {
-        while ((fgets(currecord, sizeof(currecord), infile)) != EOF) {
+    /* lexically analyze the records.  After running the checkfile function,
+        the file should be on the line with the first record.  Reading,
+        tokenizing, and inserting each record are timed as separate phases
+        when buildre() asks. */
 
-            gettokens (*currecord, fields[curfield], htokens,
-                    (struct *eventnode) datastruct);
+    line = 2;
+    while (fgets(currecord, sizeof(currecord), infile) != NULL) {
+        line++;
+        if (timed) {
+            phases[BP_GETFILE].bytes += strlen(currecord);
+            phases[BP_GETFILE].records++;
+            endphase(&phases[BP_GETFILE], &clock);
+        }
+        currecord[strcspn(currecord, "\r\n")] = NULCHAR;
+        if (*currecord == NULCHAR)
+            continue; /* skip blank lines */
+        seterrorcontext(filename, line);
+
+        if (ftype == H_FILE)
+            result = parseholidayrecord(currecord, fields, numfields,
+                                        &temprule);
+        else if (ftype == E_FILE)
+            result = parseeventrecord(currecord, fields, numfields,
+                                      &tempevent);
+        else
+            result = parselocalrecord(currecord, fields, numfields,
+                                      &tempevent, &action);
+        if (timed) {
+            phases[BP_TOKENIZE].records++;
+            endphase(&phases[BP_TOKENIZE], &clock);
+        }
+        if (result != 0) {
+            skipped++;
+            continue;
+        }
 
-            curfield++;
+        if (ftype == H_FILE) {
+            holidays = datastruct;
+
+            /* add the rule to the array of linked lists note month has to
+                be subtracted by one.  because the array counts from 0-12,
+                but the rule file uses number 1 to 13 for human
+                readability. */
+
+            holidays[temprule.month-1] =
+                addholidayrule(holidays[temprule.month-1], &temprule);
+        } else if (ftype == E_FILE) {
+            graph = datastruct;
+            graph->eventlist = insertevent(&tempevent, graph->eventlist);
+            graph->listsize++;
+        } else if (addlocalrule(datastruct, &tempevent, action) != 0) {
+            METRIC_STOP(MP_PARSERULES, start);
+            if (timed)
+                addphases(phases);
+            return -1;
+        }
+        if (timed) {
+            phases[BP_INSERT].records++;
+            endphase(&phases[BP_INSERT], &clock);
         }
     }
-    return 0;
+    if (timed) {
+        endphase(&phases[BP_GETFILE], &clock); /* the read that hit EOF */
+        addphases(phases);
+    }
+    countmetric(MC_RULEERRORS, skipped);
+    METRIC_STOP(MP_PARSERULES, start);
+    return skipped;
+}
+
+
+/*
+ * Description:  Adds the phases of one file to buildtimings.
+ * Parameters:  The time spent in each phase.
+ * Returns:  Nothing.
+ */
+
+static void addphases (const struct PhaseStats *phases)
+{
+    int phase;
+
+    for (phase = 0; phase < BP_NUMPHASES; phase++)
+        addphase(phase, &phases[phase]);
+    return;
 }
 
 
@@ -214,7 +320,13 @@ void gettokens (char *record, char* fieldn, (*tokenize)(void *, void *, void *))
  * Notes: On the first call of the function on a particular record the user
  * must pass the string containing the record to tokenize.  On subsequent
  * calls, only a null string should be passed.  The function sets up a static
- * pointer to the next token in the record.
+ * pointer to the next token in the record.  The pointer is kept per thread,
+ * so several files can be tokenized at once.
+ *
+ * The function returns NULL both at the end of the record and when the record
+ * is badly formatted.  A formatting error is recorded in the error log, with
+ * the column where it was found, so callers tell the two apart by checking
+ * threaderrorcount().
  */
 
 char * ftotok (char *string, char fdelim, char tdelim)
@@ -224,13 +336,19 @@ char * ftotok (char *string, char fdelim, char tdelim)
         char *tokenptr; /* Pointer to current token in the record
                            string */
 
-    static char *prevpsn; /* Previous position in the string from the last
-                             call to this function. */
+    static _Thread_local char *prevpsn; /* Previous position in the string
+                                           from the last call to this
+                                           function. */
+    static _Thread_local char *recordstart; /* Beginning of the record, for
+                                               reporting the column of an
+                                               error. */
+    static char emptyfield[1] = {EMPTYFIELD}; /* token for an empty field */
 
     CLEAR_ALLFLAGS(flags); /* clear the flags. */
 
-    if (string != '\0') { /* If this is the first time the string is processed */
-        cur_char = prevpsn = string; /* point to the beginning of the string */
+    if (string != NULL) { /* If this is the first time the string is processed */
+        cur_char = prevpsn = recordstart = string; /* point to the beginning
+                                                      of the string */
 
         SET_FLAG(flags, BEGIN_FIELD); /* Set the BEGIN_FIELD flag because the
                                           first field does not lead off with a
@@ -261,17 +379,21 @@ char * ftotok (char *string, char fdelim, char tdelim)
                      * field delimiter. */
 
                     cur_char++;
-                } else
+                } else {
                     /* There are two field delimiters back-to-back, which
-                     * indicates and empty field. */
+                     * indicates and empty field.  The second delimiter
+                     * starts the next field. */
 
-                    return EMPTYFIELD; /* the field does not contain data */
+                    prevpsn = cur_char;
+                    return emptyfield; /* the field does not contain data */
+                }
                 break;
             case TDELIMITER:
                 if (TEST_FLAG(flags, BEGIN_FIELD) == 0) {
                     /* If we are not inside a field, but we have reached a
                      * text delimiter, the file is not properly formatted. */
-                    errorprocessor(NOFDELIM);
+                    recorderror(NOFDELIM, (int) (cur_char - recordstart) + 1);
+                    return NULL;
                 }
                 if (TEST_FLAG(flags, BEGIN_TSTRING) == 0) {
                     *cur_char = '\0'; /* terminate the string */
@@ -279,8 +401,9 @@ char * ftotok (char *string, char fdelim, char tdelim)
                                    token. */
                     SET_FLAG(flags, BEGIN_TSTRING);
                     tokenptr = cur_char; /* Set the tokenpointer to the begin of
-                                            the token. */
-                    cur_char++;
+                                            the token.  If the token is empty,
+                                            cur_char is already on the closing
+                                            delimiter. */
                 } else { /* we are at the end of the token */
                     *cur_char = '\0'; /* terminate the token string */
                     SET_FLAG(flags, TOKEN_FOUND);
@@ -289,31 +412,26 @@ char * ftotok (char *string, char fdelim, char tdelim)
                                       field delimter. */
                 }
                 break;
-            case NEWLINE:
-                if (string == NULL) {
-                    if (TEST_FLAG(flags, BEGIN_FIELD) != 0)
-                        errorprocessor(NOTDELIM);
-                    else if (TEST_FLAG(flags, BEGIN_TSTRING))
-                        errorprocessor(NOTDELIM);
-                    else
-                        return NULL;
-                } else {
-                    errorprocessor(NULSTRING);
-                }
-                break;
+            case NEWLINE: /* fall through */
             case NULCHAR:
-                if (string == NULL) {
-                    if (TEST_FLAG(flags, BEGIN_FIELD) != 0)
-                        errorprocessor(NOTDELIM);
-                    else if (TEST_FLAG(flags, BEGIN_TSTRING))
-                        errorprocessor(NOTDELIM);
-                } else {
-                    errorprocessor(NULSTRING);
+                /* The end of the record.  (The last record of a file may not
+                 * end with a newline.) */
+                if (TEST_FLAG(flags, BEGIN_TSTRING) != 0) {
+                    /* the text string was never closed */
+                    recorderror(NOTDELIM, (int) (cur_char - recordstart) + 1);
+                } else if (string != NULL) {
+                    /* the record is empty */
+                    recorderror(NULSTRING, 1);
+                } else if (TEST_FLAG(flags, BEGIN_FIELD) != 0) {
+                    /* a field delimiter with no field after it */
+                    recorderror(NOTDELIM, (int) (cur_char - recordstart) + 1);
                 }
-                break;
+                prevpsn = cur_char;
+                return NULL;
             default:
                 if(TEST_FLAG(flags, BEGIN_TSTRING) == 0) {
-                    errorprocessor(NOTDELIM);
+                    recorderror(NOTDELIM, (int) (cur_char - recordstart) + 1);
+                    return NULL;
                 } else {
                     cur_char++;
                 }
@@ -345,89 +463,134 @@ void gethtokens (char *field, char *fieldname, struct HolidayRule *hstruct) {
 
     posn = field;
     
-    if (strcmp(fieldname, HF_MONTH)) {
-        /*  Analyze the field to determine the month */
-        if (*posn== '0') {
-            /* if posn = '0' then the month is september or earlier */
-            posn++; /* read next character */
-
-            /* TODO (Thomas#1#): Add error processing in case the month
-            is not listed as a number betweeen 1 and 12. */
-
-            *hstruct->month = (ASCII2DECIMAL(*posn));
-        } else {
-            posn++; /* read next character of filed */
-            *hstruct->month = 10 + (ASCII2DECIMAL(*posn));
-			/* add ten reflecting the first character read and
-			 * convert the second ASCII character to a number
-			 * between 0 and 9.
-			 * */
-
-            /* TODO (Thomas#1#): Add error processing in case the first
-            digit of the month month is != '1'. */
-        }
-    } else if (strcmp(fieldname, HF_RTYPE)) {
-        *hstruct->ruletype = *posn; /* ruletype is a single character */
-    } else if (strcmp(fieldname, HF_RULE)) {
-        switch (temprule.ruletype) {
+    if (strcmp(fieldname, HF_MONTH) == 0) {
+        /*  Analyze the field to determine the month.  The month is one or
+         *  two digits: "1" through "13", with or without a leading zero. */
+        hstruct->month = ASCII2DECIMAL(*posn);
+        posn++; /* read next character */
+        if (isdigit((unsigned char) *posn))
+            hstruct->month = (hstruct->month * 10) + ASCII2DECIMAL(*posn);
+
+        /* TODO (Thomas#1#): Add error processing in case the month
+        is not listed as a number betweeen 1 and 13. */
+    } else if (strcmp(fieldname, HF_RTYPE) == 0) {
+        hstruct->ruletype = *posn; /* ruletype is a single character */
+    } else if (strcmp(fieldname, HF_RULE) == 0) {
+        switch (hstruct->ruletype) {
             case 'w':   /* Weekend Rules */
                          /* fall through */
             case 'W':
-                 *hstruct->wkday = ASCII2DECIMAL(*posn);
-                 posn++; /* get rid of the dash */
-                 *hstruct->wknum = ASCII2DECIMAL(*posn);
-                 break;
+                         /* fall through */
+            case 'r':   /* Relative Rules */
+                        /* fall through */
+            case 'R':
+                hstruct->wkday = ASCII2DECIMAL(*posn);
+                posn += 2; /* get rid of the dash */
+                hstruct->wknum = ASCII2DECIMAL(*posn);
+                break;
             case 'a':   /* Absolute Rules */
                         /* fall through */
             case 'A':
-                *hstruct->wkday = 999; /* temprule.wkday = '\0'; */
-                *hstruct->wknum = 999; /* temprule.wknum = '\0'; */
+                hstruct->wkday = 999; /* temprule.wkday = '\0'; */
+                hstruct->wknum = 999; /* temprule.wknum = '\0'; */
+                hstruct->day = ASCII2DECIMAL(*posn);
                 posn++;
-                if (posn == '0') { /* the day is less than 10 */
-                    posn++;
-                    *hstruct->.day = ASCII2DECIMAL(*++posn);
-                } else { /* day is greater than 10 */
-                   *hstruct->day = ASCII2DECIMAL(*posn);
-                   *hstruct->day = (*hstruct->day * 10) + 
-                       ASCII2DECIMAL(*++posn);
-               }
-               break;
-            case 'r':   /* Relative Rules */
-                        /* fall through */
-            case 'R':
-                        *hstruct->wkday = ASCII2DECIMAL(*posn);
-                        posn++; /* get rid of the dash */
-                        *hstruct->wknum = ASCII2DECIMAL(*++posn);
-                        break;
-           default:
-                        /* TODO (Thomas#1#): Add error processing in case the
-                            rule is not in the proper format. */
-                        break;
-                }
-    } else if (strcmp(fieldname, HF_HOLIDAY)) {
-        while(*posn) {
-            *hstruct->holidayname = *posn;
-            posn++;
-            hstruct->holidayname++;
-        }
-        *hstruct->holidayname = '\0';    
-    }  else if (strcmp(fieldname, HF_AUTHORITY)) {
-        while(*posn) {
-            *hstruct->authority = *posn;
-            posn++;
-            hstruct->authority++;
+                if (isdigit((unsigned char) *posn)) /* day is two digits */
+                    hstruct->day = (hstruct->day * 10) +
+                        ASCII2DECIMAL(*posn);
+                break;
+            default:
+                /* TODO (Thomas#1#): Add error processing in case the
+                    rule is not in the proper format. */
+                break;
         }
-        *hstruct->authority = '\0';    
+    } else if (strcmp(fieldname, HF_HOLIDAY) == 0) {
+        strncpy(hstruct->holidayname, posn, sizeof(hstruct->holidayname) - 1);
+        hstruct->holidayname[sizeof(hstruct->holidayname) - 1] = '\0';
+    }  else if (strcmp(fieldname, HF_AUTHORITY) == 0) {
+        strncpy(hstruct->authority, posn, sizeof(hstruct->authority) - 1);
+        hstruct->authority[sizeof(hstruct->authority) - 1] = '\0';
     }  else {
 	    /* Error field name not defined */
     } 
 
 }
 
-void getevtokens (char *r, struct HolidayRule *hstruct); 
+/* 
+ * Description:  Extract court-event tokens from a record and populate a court
+ * event with the parsed fields.
+ *
+ * Parameters:  A string containing one field of the record, the name of the
+ * field, and a pointer to the court event. 
+ *
+ * Returns:  Nothing.
+ *
+ * Algorithm:  The Count field is signed: a positive count means the event
+ * comes AFTER its trigger, a negative count means it comes BEFORE (and the
+ * COUNTBACK flag is set).  A count that is not a number, or that is more
+ * than MAXCOUNTPERIOD either way, is recorded as a BADRECORD error, so the
+ * record is skipped rather than counted in the wrong direction.  The Ct Pd
+ * field is a letter code: C = court days; D = calendar days; W = weeks;
+ * M = months; Q = quarters; Y = years.
+ */
+
+void getevtokens (char *field, char *fieldname, struct CourtEvent *estruct)
 {
-    return 0;
-}
+    char *end; /* the first character after the count */
+    long count;
+
+    if (strcmp(fieldname, EF_EVENT) == 0) {
+        strncpy(estruct->shorttitle, field, sizeof(estruct->shorttitle) - 1);
+        strncpy(estruct->eventitle, field, sizeof(estruct->eventitle) - 1);
+    } else if (strcmp(fieldname, EF_TRIGGER) == 0) {
+        strncpy(estruct->ntc_dependency1, field,
+                sizeof(estruct->ntc_dependency1) - 1);
+    } else if (strcmp(fieldname, EF_COUNT) == 0) {
+        errno = 0;
+        count = strtol(field, &end, 10); /* an empty count is zero */
+        while (isspace((unsigned char) *end))
+            end++;
+        if (*end != NULCHAR || errno == ERANGE ||
+                count > MAXCOUNTPERIOD || count < -MAXCOUNTPERIOD) {
+            recorderror(BADRECORD, 0);
+            return;
+        }
+        estruct->ntcpd1 = (char) count;
+        if (count < 0)
+            SET_FLAG(estruct->eventflags, COUNTBACK);
+    } else if (strcmp(fieldname, EF_CT_PD) == 0) {
+        switch (toupper((unsigned char) *field)) {
+            case 'D':
+                SET_FLAG(estruct->eventflags, CALENDARYDAYS);
+                /* fall through */
+            case 'C':
+                estruct->countunits = COUNT_DAYS;
+                break;
+            case 'W':
+                estruct->countunits = COUNT_WEEKS;
+                break;
+            case 'M':
+                estruct->countunits = COUNT_MONTHS;
+                break;
+            case 'Q':
+                estruct->countunits = COUNT_QUARTERS;
+                break;
+            case 'Y':
+                estruct->countunits = COUNT_YEARS;
+                break;
+            default:
+                /* TODO (Thomas#1#): Add error processing in case the
+                    count period is not in the proper format. */
+                break;
+        }
+    } else if (strcmp(fieldname, EF_AUTHORITY) == 0) {
+        strncpy(estruct->authority, field, sizeof(estruct->authority) - 1);
+    } else {
+	    /* Error field name not defined */
+    }
+
+    return;
+}		/* -----  end of function getevtokens  ----- */
 
 /* 
  * Description:  This function parses the holiday file and creates a linked
@@ -560,6 +723,186 @@ int parseevents(FILE *events)
     }
     return 0;
 }
+/*
+ * Description:  Splits the field-name record (the second line of a rules
+ * file) into the list of field names.
+ *
+ * Parameters:  The record, which is modified, and the array that receives
+ * the field names.
+ *
+ * Returns:  The number of field names found.
+ */
+
+int parsefieldnames(char *record, char fields[][MAXFIELDLEN])
+{
+    char *token;
+    int numfields = 0;
+
+    token = ftotok(record, FDELIMITER, TDELIMITER);
+    while (token != NULL && numfields < MAXNUMFIELDS) {
+        strncpy(fields[numfields], token, MAXFIELDLEN - 1);
+        fields[numfields][MAXFIELDLEN - 1] = '\0';
+        numfields++;
+        token = ftotok(NULL, FDELIMITER, TDELIMITER);
+    }
+
+    return numfields;
+}		/* -----  end of function parsefieldnames  ----- */
+
+
+/*
+ * Description:  Parses a single record of the holiday file into a holiday
+ * rule.
+ *
+ * Parameters:  The record, which is modified; the field names of the file
+ * and the number of them; and the rule to fill in.
+ *
+ * Returns:  Zero if successful, -1 if the record is empty, badly formatted,
+ * or has no valid month.  The error is recorded in the error log.
+ *
+ * Notes:  The rule is not added to the holiday hash table; that is up to
+ * the caller.
+ */
+
+int parseholidayrecord(char *record, char fields[][MAXFIELDLEN],
+                       int numfields, struct HolidayRule *rule)
+{
+    char *token;
+    int curfield;
+    int errors; /* number of errors in the log before this record */
+
+    memset(rule, 0, sizeof(*rule));
+    if (record == NULL || *record == NULCHAR || *record == NEWLINE)
+        return -1;
+
+    errors = threaderrorcount();
+    token = ftotok(record, FDELIMITER, TDELIMITER);
+    for (curfield = 0; token != NULL && curfield < numfields; curfield++) {
+        gethtokens(token, fields[curfield], rule);
+        token = ftotok(NULL, FDELIMITER, TDELIMITER);
+    }
+
+    if (threaderrorcount() != errors)
+        return -1; /* ftotok() recorded a formatting error */
+    if (rule->month < 1 || rule->month > ALLMONTHS) {
+        recorderror(BADRECORD, 0);
+        return -1;
+    }
+    return 0;
+}		/* -----  end of function parseholidayrecord  ----- */
+
+
+/*
+ * Description:  Parses a single record of the events file into a court
+ * event.
+ *
+ * Parameters:  The record, which is modified; the field names of the file
+ * and the number of them; and the event to fill in.
+ *
+ * Returns:  Zero if successful, -1 if the record is empty, badly formatted,
+ * or has no event name.  The error is recorded in the error log.
+ *
+ * Notes:  An event with no trigger is the head of a chain of events.  The
+ * event is not added to the event graph; that is up to the caller.
+ */
+
+int parseeventrecord(char *record, char fields[][MAXFIELDLEN],
+                     int numfields, struct CourtEvent *event)
+{
+    char *token;
+    int curfield;
+    int errors; /* number of errors in the log before this record */
+
+    memset(event, 0, sizeof(*event));
+    if (record == NULL || *record == NULCHAR || *record == NEWLINE)
+        return -1;
+
+    errors = threaderrorcount();
+    token = ftotok(record, FDELIMITER, TDELIMITER);
+    for (curfield = 0; token != NULL && curfield < numfields; curfield++) {
+        getevtokens(token, fields[curfield], event);
+        token = ftotok(NULL, FDELIMITER, TDELIMITER);
+    }
+
+    if (threaderrorcount() != errors)
+        return -1; /* ftotok() recorded a formatting error */
+    if (event->shorttitle[0] == '\0') {
+        recorderror(BADRECORD, 0);
+        return -1;
+    }
+    if (event->ntc_dependency1[0] == '\0')
+        SET_FLAG(event->eventflags, CHAINHEAD);
+    return 0;
+}		/* -----  end of function parseeventrecord  ----- */
+
+
+/*
+ * Description:  Parses a single record of a local rules file into a court
+ * event and the action to take with it.
+ *
+ * Parameters:  The record, which is modified; the field names of the file
+ * and the number of them; the event to fill in; and the action to set.
+ *
+ * Returns:  Zero if successful, -1 if the record is empty, badly formatted,
+ * has no event name, or has an unknown action.  The error is recorded in the
+ * error log.
+ *
+ * Algorithm:  The Action field is a word, but only its first letter is
+ * checked: A = add; O = override; M = mask.  An empty Action field (or none
+ * at all) is LOCAL_DEFAULT.  The other fields are those of the events file.
+ */
+
+int parselocalrecord(char *record, char fields[][MAXFIELDLEN],
+                     int numfields, struct CourtEvent *event,
+                     enum LOCALACTION *action)
+{
+    char *token;
+    int curfield;
+    int errors; /* number of errors in the log before this record */
+
+    memset(event, 0, sizeof(*event));
+    *action = LOCAL_DEFAULT;
+    if (record == NULL || *record == NULCHAR || *record == NEWLINE)
+        return -1;
+
+    errors = threaderrorcount();
+    token = ftotok(record, FDELIMITER, TDELIMITER);
+    for (curfield = 0; token != NULL && curfield < numfields; curfield++) {
+        if (strcmp(fields[curfield], LF_ACTION) != 0) {
+            getevtokens(token, fields[curfield], event);
+        } else {
+            switch (toupper((unsigned char) *token)) {
+                case NULCHAR:
+                    *action = LOCAL_DEFAULT;
+                    break;
+                case 'A':
+                    *action = LOCAL_ADD;
+                    break;
+                case 'O':
+                    *action = LOCAL_OVERRIDE;
+                    break;
+                case 'M':
+                    *action = LOCAL_MASK;
+                    break;
+                default:
+                    recorderror(BADRECORD, (int) (token - record) + 1);
+                    break;
+            }
+        }
+        token = ftotok(NULL, FDELIMITER, TDELIMITER);
+    }
+
+    if (threaderrorcount() != errors)
+        return -1; /* a formatting error or a bad action */
+    if (event->shorttitle[0] == '\0') {
+        recorderror(BADRECORD, 0);
+        return -1;
+    }
+    if (event->ntc_dependency1[0] == '\0')
+        SET_FLAG(event->eventflags, CHAINHEAD);
+    return 0;
+}		/* -----  end of function parselocalrecord  ----- */
+
 /* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
 
 
@@ -8,7 +8,7 @@
  *
  * Version: 1.0.20
  * Created: 10/24/2011
- * Last Modified: Wed Dec 16 14:28:02 2020
+ * Last Modified: Mon Oct 19 09:14:50 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -27,7 +27,8 @@
  * expects to receive a proper file type, with proper fields, and the
  * appropriate data structure to store the tokens in.
  *
- * Error Handling: 
+ * Error Handling: A badly formatted record is recorded in the error log
+ * (see errorhandler.h) and skipped.
  *
  * Notes: TODO Instead of passing one data structure type, pass a
  *                 a void pointer to the data type??? 
@@ -43,7 +44,9 @@
 #include <stdlib.h>
 #include "utilities.h"
 #include "errorhandler.h"
-/* todo: include ruleprocessor.h and graphmgr.h ??? */
+#include "datetools.h"
+#include "graphmgr.h"
+#include "overlay.h"
 
 /* #####   EXPORTED MACROS   ################################################ */
 
@@ -77,14 +80,18 @@ checking (of course!), but anticipates an ascii character between '0'
 #define EF_CT_PD "Ct Pd"
 #define EF_AUTHORITY "Authority"
 
+/* The local rules CSV file has the events fields, plus */
+
+#define LF_ACTION "Action"
+
 /*------------------------------------------------------------------------------
  *  Sizes and numbers of records and fields 
  *----------------------------------------------------------------------------*/
 
-#define MAXRECORDLENGTH = 500 /* Maximum Length (in characters of CSV File line,
+#define MAXRECORDLENGTH 500 /* Maximum Length (in characters of CSV File line,
 				 each line consists of one record. */
-#define MAXNUMFIELDS = 25 /* Maxinum number of fields in CSV File */
-#define MAXFIELDLEN = 25 /* Maximum length (in chars) of name of field */
+#define MAXNUMFIELDS 25 /* Maxinum number of fields in CSV File */
+#define MAXFIELDLEN 25 /* Maximum length (in chars) of name of field */
 
 /*------------------------------------------------------------------------------
  *  Field and Text delimiters
@@ -118,7 +125,6 @@ const unsigned char TOKEN_FOUND = (1<<7);
 extern FILE *HOLIDAY_FILE;
 extern FILE *EVENT_FILE;
 extern FILE *EXTRAS_FILE;
-extern EventNode eventlist; 
 
 
 /* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
@@ -126,24 +132,22 @@ extern EventNode eventlist;
 /*
  * Description: This function parses the holiday file and creates the array of
  * linked lists. Each array element represents the holidays of a a particular
- * month.  The holidays are "attached" to the array via a linked list.
+ * month.  The holidays are "attached" to the array via a linked list.  Given
+ * an events file, it builds the list of court events instead, and given a
+ * local rules file, it loads a local-rules layer.
  *
- * Parameters: File handle to the holidays file.
+ * Parameters: File handle to the rules file, the name of the file, and the
+ * holiday hash table, EventGraph, or LocalRules to load.
  *
- * Returns: Zero if successful.  Function will return a non-zero error code on
- * specified errors, but this functionality has not been coded as yet.
+ * Returns: The number of records skipped because of errors, or -1 if the file
+ * could not be read or is not a rules file.  The errors themselves are in the
+ * error log.
  *
  * Notes The holiday field contains the holiday name.  The authority field
  * identifies the statutory (or other) legal authority for the rule.
  */
 
-int parsefile (FILE *infile, const char *filename, FILETYPE ftype, const
-               char *fields[], void *datastruct);
-/* 
- * ELIMINATE void *datastruct, lexical analyzer has no need to access
- * this variable.
- *
- */
+int parsefile (FILE *infile, const char *filename, void *datastruct);
 
 /* 
  * Description: This function parses the holiday file and creates a linked
@@ -159,6 +163,76 @@ int parsefile (FILE *infile, const char *filename, FILETYPE ftype, const
 
 int parseevents(FILE *events);
 
+/*
+ * Description: Splits a record into its fields, one field per call, in the
+ * manner of strtok().
+ *
+ * Parameters: The record on the first call for a record, NULL after that;
+ * the field delimiter; and the text delimiter.
+ *
+ * Returns: The next field, an empty string for an empty field, or NULL at
+ * the end of the record or if the record is badly formatted.  A formatting
+ * error is recorded in the error log; check threaderrorcount() to tell the
+ * two apart.
+ */
+
+char * ftotok (char *string, char fdelim, char tdelim);
+
+/*
+ * Description: Splits the field-name record (the second line of a rules file)
+ * into the list of field names.
+ *
+ * Parameters: The record, which is modified, and the array that receives the
+ * field names.
+ *
+ * Returns: The number of field names found.
+ */
+
+int parsefieldnames(char *record, char fields[][MAXFIELDLEN]);
+
+/*
+ * Description: Parses a single record of the holiday file into a holiday
+ * rule.
+ *
+ * Parameters: The record, which is modified; the field names of the file and
+ * the number of them; and the rule to fill in.
+ *
+ * Returns: Zero if successful, -1 if the record is empty, badly formatted, or
+ * has no month.  The error is recorded in the error log.
+ */
+
+int parseholidayrecord(char *record, char fields[][MAXFIELDLEN],
+                       int numfields, struct HolidayRule *rule);
+
+/*
+ * Description: Parses a single record of the events file into a court event.
+ *
+ * Parameters: The record, which is modified; the field names of the file and
+ * the number of them; and the event to fill in.
+ *
+ * Returns: Zero if successful, -1 if the record is empty, badly formatted, or
+ * has no event name.  The error is recorded in the error log.
+ */
+
+int parseeventrecord(char *record, char fields[][MAXFIELDLEN],
+                     int numfields, struct CourtEvent *event);
+
+/*
+ * Description: Parses a single record of a local rules file into a court
+ * event and the action to take with it.
+ *
+ * Parameters: The record, which is modified; the field names of the file and
+ * the number of them; the event to fill in; and the action to set.
+ *
+ * Returns: Zero if successful, -1 if the record is empty, badly formatted,
+ * has no event name, or has an unknown action.  The error is recorded in the
+ * error log.
+ */
+
+int parselocalrecord(char *record, char fields[][MAXFIELDLEN],
+                     int numfields, struct CourtEvent *event,
+                     enum LOCALACTION *action);
+
 /*-----------------------------------------------------------------------------
  * WARNING: UNDEVELOPED "DRAFT" FUNCTIONS 
  *----------------------------------------------------------------------------*/
@@ -4,7 +4,7 @@
  *
  * Version: 1.0.20
  * Created: 8/18/2011
- * Last Modified: Wed Dec 16 14:28:20 2020
+ * Last Modified: Mon Oct 19 10:39:07 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -25,21 +25,60 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "builder.h"
+#include "rulepack.h"
+#include "snapshot.h"
+#include "rulereload.h"
+#include "chainloader.h"
+#include "outputmgr.h"
+#include "batchmgr.h"
+#include "servermgr.h"
+#include "httpmgr.h"
+#include "ruleset.h"
+#include "metrics.h"
+#include "promexport.h"
+#include "benchmark.h"
 #include "datetools.h"
 #include "lexicalanalyzer.h"
 #include "ruleprocessor.h"
 #include "datetools.h"
+#include "testsuite.h"
 
 
 /* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ########################### */
 
 /* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ################ */
 
+#define WATCHINTERVAL 5 /* seconds between checks of the rules files */
+
 /* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ################# */
 
+/* Whether and how to print how long the rules took to build */
+enum TIMINGS {NOTIMINGS, TEXTTIMINGS, JSONTIMINGS};
+
 /* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
 
+/* The rules files the serve command keeps its rules up to date with. */
+struct ServedRules {
+    char *holiday;
+    char *events;
+    char *extras; /* NULL if there are no local rules */
+};
+
+/* What a rules file looked like when it was last loaded.  The inode and size
+ * catch a file replaced, or rewritten within the same second, by one with the
+ * same modification time. */
+struct FileStamp {
+    struct timespec modified;
+    off_t size;
+    ino_t inode;
+    dev_t device;
+};
+
 /* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
 
 FILE *HOLIDAY_FILE;
@@ -57,6 +96,31 @@ EventNode eventlist; /* !VARIABLE DEFINITION! This is THE instance ofthe Event
 
 void usage(char *);
 
+static void reporttimings(enum TIMINGS how);
+    /* Prints how long the rules took to build, if asked */
+
+static void watchrules(char *holiday, char *events, char *extras);
+    /* Reloads the rules files whenever they change */
+
+static int showchain(char *events, char *packname, char *trigger);
+    /* Loads and prints the chain of events that starts at trigger */
+
+static int batch(char *input, char *results, char *format, int depth);
+    /* Computes the schedules of a file of trigger records */
+
+static int serve(char *socketpath, char *holiday, char *events,
+                 char *extras, char *httpport, int maxinflight);
+    /* Answers requests on a local socket until stopped */
+
+static void * reloadserved(void *arg);
+    /* Publishes new rules whenever the rules files change */
+
+static int getstamp(const char *filename, struct FileStamp *stamp);
+    /* Records what a rules file looks like now */
+
+static int samestamp(const struct FileStamp *a, const struct FileStamp *b);
+    /* Whether two stamps are of the same file contents */
+
 /* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
 
 
@@ -73,12 +137,70 @@ int main(int argc, char *argv[])
     char *holidays_filename;
     char *events_filename;
     char *extras_filename;
+    char *pack_filename; /* compiled rule pack or snapshot to load or to
+                            create */
+    char *snapshot_filename; /* engine snapshot to restore */
+    char *chain_trigger; /* event that starts the chain to load */
+    char *input_filename; /* trigger records for the batch command */
+    char *results_filename; /* where the batch command writes */
+    char *results_format; /* how the batch command writes */
+    char *socket_path; /* where the serve command listens */
+    char *http_port; /* where the serve command listens for HTTP, if it
+                        does */
+    char *metrics_filename; /* where batch and serve dump their metrics, if
+                               they do */
+    int queue_depth; /* blocks in the batch pipeline, or requests the
+                        serve command computes at once; 0 for the default */
+    unsigned long bench_seed; /* the seed of the bench command's inputs */
+    enum {RUN, COMPILE, SNAPSHOT, WATCH, CHAIN, BATCH, SERVE,
+          BENCH, TEST} command; /* the subcommand, if any */
+    struct RulePack pack; /* the mapped rule pack, if one was given */
+    struct Snapshot snap; /* the restored snapshot, if one was given */
+    enum TIMINGS showtimings; /* whether and how to print how long the
+                                 rules took to build */
+    int failures; /* checks the test command failed */
+    int result;
 
     /* initialize file names */
     program_name = argv[0];
     holidays_filename = NULL;
     events_filename = NULL;
     extras_filename = NULL;
+    pack_filename = NULL;
+    snapshot_filename = NULL;
+    chain_trigger = NULL;
+    input_filename = NULL;
+    results_filename = NULL;
+    results_format = NULL;
+    socket_path = NULL;
+    http_port = NULL;
+    metrics_filename = NULL;
+    queue_depth = 0;
+    bench_seed = BN_SEED;
+    showtimings = NOTIMINGS;
+    command = RUN;
+
+    /* Check for a subcommand */
+    if ((argc > 1) && (strcmp(argv[1], "compile") == 0))
+        command = COMPILE;
+    else if ((argc > 1) && (strcmp(argv[1], "snapshot") == 0))
+        command = SNAPSHOT;
+    else if ((argc > 1) && (strcmp(argv[1], "watch") == 0))
+        command = WATCH;
+    else if ((argc > 1) && (strcmp(argv[1], "chain") == 0))
+        command = CHAIN;
+    else if ((argc > 1) && (strcmp(argv[1], "batch") == 0))
+        command = BATCH;
+    else if ((argc > 1) && (strcmp(argv[1], "serve") == 0))
+        command = SERVE;
+    else if ((argc > 1) && (strcmp(argv[1], "bench") == 0))
+        command = BENCH;
+    else if ((argc > 1) && (strcmp(argv[1], "test") == 0))
+        command = TEST;
+    if (command != RUN) {
+        ++argv;
+        --argc;
+    }
 
     /* Process the commandline arguments */
     while ((argc > 1) && (argv[1][0] == '-'))
@@ -97,6 +219,68 @@ int main(int argc, char *argv[])
             case 'x':
                 extras_filename = &argv[1][2];
                 break;
+            case 'O': /* fall through */
+            case 'o': /* fall through */
+            case 'P': /* fall through */
+            case 'p':
+                pack_filename = &argv[1][2];
+                break;
+            case 'S': /* fall through */
+            case 's':
+                snapshot_filename = &argv[1][2];
+                break;
+            case 'T': /* fall through */
+            case 't':
+                showtimings = (strcmp(&argv[1][2], "json") == 0) ?
+                    JSONTIMINGS : TEXTTIMINGS;
+                break;
+            case '-': /* the long forms of the options */
+                if (strcmp(&argv[1][2], "timings") == 0) {
+                    showtimings = TEXTTIMINGS;
+                    break;
+                } else if (strcmp(&argv[1][2], "timings=json") == 0) {
+                    showtimings = JSONTIMINGS;
+                    break;
+                }
+                fprintf(stderr, "Bad option %s\n", argv[1]);
+                usage(program_name);
+                break;
+            case 'C': /* fall through */
+            case 'c':
+                chain_trigger = &argv[1][2];
+                break;
+            case 'I': /* fall through */
+            case 'i':
+                input_filename = &argv[1][2];
+                break;
+            case 'R': /* fall through */
+            case 'r':
+                results_filename = &argv[1][2];
+                break;
+            case 'F': /* fall through */
+            case 'f':
+                results_format = &argv[1][2];
+                break;
+            case 'U': /* fall through */
+            case 'u':
+                socket_path = &argv[1][2];
+                break;
+            case 'L': /* fall through */
+            case 'l':
+                http_port = &argv[1][2];
+                break;
+            case 'Q': /* fall through */
+            case 'q':
+                queue_depth = atoi(&argv[1][2]);
+                break;
+            case 'M': /* fall through */
+            case 'm':
+                metrics_filename = &argv[1][2];
+                break;
+            case 'N': /* fall through */
+            case 'n':
+                bench_seed = strtoul(&argv[1][2], NULL, 10);
+                break;
             default:
                 fprintf(stderr, "Bad option %s\n", argv[1]);
                 usage(program_name);
@@ -104,7 +288,126 @@ int main(int argc, char *argv[])
         ++argv;
         --argc;
     }
-    buildre(holidays_filename, events_filename, extras_filename);
+    timebuildphases(showtimings != NOTIMINGS);
+
+    if (command == COMPILE) {
+        /* Build the rules from the CSV files and save them as a rule pack. */
+        if (pack_filename == NULL || *pack_filename == '\0')
+            usage(program_name);
+        buildre(holidays_filename, events_filename, extras_filename);
+        reporttimings(showtimings);
+        result = compilerulepack(pack_filename, eventsinforce(),
+                                 holidayhashtable, &jurisdcalendar);
+        if (result != RP_OK) {
+            fprintf(stderr, "ERROR: Could not compile rule pack %s (%d)\n",
+                    pack_filename, result);
+            return 8;
+        }
+        return 0;
+    } else if (command == SNAPSHOT) {
+        /* Build the whole engine and save its state. */
+        if (pack_filename == NULL || *pack_filename == '\0')
+            usage(program_name);
+        buildre(holidays_filename, events_filename, extras_filename);
+        reporttimings(showtimings);
+        result = savesnapshot(pack_filename, holidayhashtable,
+                              eventsinforce(), &jurisdcalendar);
+        if (result != SN_OK) {
+            fprintf(stderr, "ERROR: Could not save snapshot %s (%d)\n",
+                    pack_filename, result);
+            return 8;
+        }
+        return 0;
+    } else if (command == WATCH) {
+        /* Build the rules, then keep them up to date as the files change. */
+        buildre(holidays_filename, events_filename, extras_filename);
+        reporttimings(showtimings);
+        watchrules(holidays_filename, events_filename, extras_filename);
+        return 0;
+    } else if (command == CHAIN) {
+        /* Load only the events the trigger reaches; nothing else is built. */
+        if (chain_trigger == NULL || *chain_trigger == '\0' ||
+                (events_filename == NULL && pack_filename == NULL))
+            usage(program_name);
+        return (showchain(events_filename, pack_filename,
+                          chain_trigger) < 0) ? 8 : 0;
+    } else if ((command == BATCH || command == SERVE || command == TEST) &&
+               events_filename == NULL && snapshot_filename == NULL &&
+               pack_filename == NULL) {
+        /* There would be no events to compute from. */
+        usage(program_name);
+    }
+
+    if (snapshot_filename != NULL) {
+        /* Restore the engine exactly as it was saved; nothing is rebuilt. */
+        result = loadsnapshot(snapshot_filename, &snap);
+        if (result != SN_OK) {
+            fprintf(stderr, "ERROR: Could not load snapshot %s (%d)\n",
+                    snapshot_filename, result);
+            return 8;
+        }
+        memcpy(holidayhashtable, snap.root->holidays,
+               sizeof(snap.root->holidays));
+        jurisdevents = snap.root->graph;
+        jurisdcalendar = snap.root->calendar;
+    } else if (pack_filename != NULL) {
+        /* Map the compiled rules in place of parsing the CSV files. */
+        result = openrulepack(pack_filename, &pack);
+        if (result != RP_OK) {
+            fprintf(stderr, "ERROR: Could not load rule pack %s (%d)\n",
+                    pack_filename, result);
+            return 8;
+        }
+        memcpy(holidayhashtable, pack.holidaytable, sizeof(pack.holidaytable));
+        jurisdcalendar = pack.calendar;
+        if (rulepack_loadgraph(&pack, &jurisdevents) < 0) {
+            fprintf(stderr, "ERROR: Could not load the events of rule pack "
+                    "%s (%d)\n", pack_filename, RP_ENOMEM);
+            return 8;
+        }
+    } else {
+        buildre(holidays_filename, events_filename, extras_filename);
+        reporttimings(showtimings);
+    }
+    if (command == BATCH || command == SERVE) {
+        /* Dump the metrics for Prometheus while the work goes on. */
+        if (metrics_filename != NULL && *metrics_filename != '\0' &&
+                startmetricsdump(metrics_filename, PX_INTERVAL) != PX_OK)
+            fprintf(stderr, "ERROR: Could not dump metrics to %s\n",
+                    metrics_filename);
+        if (command == BATCH)
+            result = batch(input_filename, results_filename, results_format,
+                           queue_depth);
+        else
+            result = serve(socket_path, (snapshot_filename == NULL) ?
+                           holidays_filename : NULL, events_filename,
+                           extras_filename, http_port, queue_depth);
+        stopmetricsdump();
+        return (result < 0) ? 8 : 0;
+    } else if (command == BENCH) {
+        /* Time the date engine over the rules just built or loaded. */
+        result = runbenchmarks(&jurisdcalendar, results_filename, bench_seed);
+        if (result != BN_OK) {
+            fprintf(stderr, "ERROR: Could not run the benchmarks (%d)\n",
+                    result);
+            return 8;
+        }
+        return 0;
+    } else if (command == TEST) {
+        /* The checks too slow to run every time; any failure is an error. */
+        failures = 0;
+        failures += testsuite_export();
+        failures += testsuite_shardexport();
+        failures += testsuite_taskpool();
+        failures += testsuite_serverallocs();
+        failures += testsuite_ruleswap((snapshot_filename == NULL &&
+                                        pack_filename == NULL) ?
+                                       holidays_filename : NULL,
+                                       events_filename, extras_filename);
+        failures += testsuite_metrics();
+        failures += testsuite_localrules();
+        return (failures > 0) ? 8 : 0;
+    }
     testsuite_dates();
     testsuite_checkholidays();
     testsuite_courtdays();
@@ -125,7 +428,437 @@ int main(int argc, char *argv[])
 
 void usage(char *program_name)
 {
-    fprintf(stderr, "Uasge is %s -f[filename 1] -f[filename...]\n",
+    fprintf(stderr, "Uasge is %s -h[holiday file] -e[events file] "
+            "-x[extras file] [-t[json]]\n", program_name);
+    fprintf(stderr, "      or %s -p[rule pack]\n", program_name);
+    fprintf(stderr, "      or %s -s[snapshot]\n", program_name);
+    fprintf(stderr, "      or %s compile -h[holiday file] -e[events file] "
+            "-x[extras file] -o[rule pack] [-t[json]]\n", program_name);
+    fprintf(stderr, "      or %s snapshot -h[holiday file] -e[events file] "
+            "-x[extras file] -o[snapshot] [-t[json]]\n", program_name);
+    fprintf(stderr, "      or %s watch -h[holiday file] -e[events file] "
+            "-x[extras file] [-t[json]]\n", program_name);
+    fprintf(stderr, "      or %s chain -e[events file] -c[trigger]\n",
+            program_name);
+    fprintf(stderr, "      or %s chain -p[rule pack] -c[trigger]\n",
+            program_name);
+    fprintf(stderr, "      or %s batch -h[holiday file] -e[events file] "
+            "-x[extras file] [-i[input]] [-r[results]] "
+            "[-f{text|jsonl|csv|binary}] [-q[depth]] [-m[metrics]]\n",
+            program_name);
+    fprintf(stderr, "      or %s batch {-s[snapshot]|-p[rule pack]} "
+            "[-i[input]] [-r[results]] [-f{text|jsonl|csv|binary}] "
+            "[-q[depth]] [-m[metrics]]\n", program_name);
+    fprintf(stderr, "      or %s serve -h[holiday file] -e[events file] "
+            "-x[extras file] [-u[socket]] [-l[port]] [-q[requests]] "
+            "[-m[metrics]]\n", program_name);
+    fprintf(stderr, "      or %s serve {-s[snapshot]|-p[rule pack]} "
+            "[-u[socket]] [-l[port]] [-q[requests]] [-m[metrics]]\n",
+            program_name);
+    fprintf(stderr, "      or %s bench -h[holiday file] -e[events file] "
+            "-x[extras file] [-r[results]] [-n[seed]]\n", program_name);
+    fprintf(stderr, "      or %s bench -p[rule pack] [-r[results]] "
+            "[-n[seed]]\n", program_name);
+    fprintf(stderr, "      or %s test -h[holiday file] -e[events file] "
+            "-x[extras file]\n", program_name);
+    fprintf(stderr, "      or %s test {-s[snapshot]|-p[rule pack]}\n",
             program_name);
+    fprintf(stderr, "  -t, --timings prints how long each phase of the "
+            "build took; -tjson, --timings=json\n"
+            "  prints it as JSON\n");
     exit(8);
 }
+
+
+/* 
+ * Description:  Prints how long the rules took to build, if asked.
+ * Parameters:  NOTIMINGS, TEXTTIMINGS, or JSONTIMINGS.
+ * Returns:  Nothing.
+ */
+
+static void reporttimings(enum TIMINGS how)
+{
+    if (how == TEXTTIMINGS)
+        printbuildtimings(stderr);
+    else if (how == JSONTIMINGS)
+        printbuildtimingsjson(stderr);
+    return;
+}
+
+
+/* 
+ * Description:  Reloads the rules files whenever they change.
+ *
+ * Parameters:  Names of the holiday, events, and extras files.
+ *
+ * Returns:  Does not return.
+ *
+ * Algorithm:  The stamps of the files (modification time to the nanosecond,
+ * size, and inode) are checked every WATCHINTERVAL seconds.  When the
+ * holiday or events file changes, only the records that changed are applied
+ * with reloadre().  If the files can no longer be compared with the ones
+ * loaded (e.g., their field names changed), or the extras file changed, the
+ * rules are rebuilt.
+ */
+
+static void watchrules(char *holiday, char *events, char *extras)
+{
+    struct FileStamp hstamp, estamp, xstamp; /* the files last loaded */
+    struct FileStamp hnow, enow, xnow;
+    struct RuleDelta delta;
+    int result;
+
+    getstamp(holiday, &hstamp);
+    getstamp(events, &estamp);
+    getstamp(extras, &xstamp);
+
+    for (;;) {
+        sleep(WATCHINTERVAL);
+        if (getstamp(holiday, &hnow) != 0 || getstamp(events, &enow) != 0 ||
+                getstamp(extras, &xnow) != 0)
+            continue; /* a file is being replaced; try again later */
+        if (samestamp(&hnow, &hstamp) && samestamp(&enow, &estamp) &&
+                samestamp(&xnow, &xstamp))
+            continue;
+        hstamp = hnow;
+        estamp = enow;
+        if (!samestamp(&xnow, &xstamp)) {
+            xstamp = xnow;
+            printf("Local rules changed; rebuilding.\n");
+            buildre(holiday, events, extras);
+            continue;
+        }
+
+        result = reloadre(holiday, events, &delta);
+        if (result == RL_OK) {
+            printf("Reloaded: %d holiday rules added, %d removed; "
+                   "%d events added, %d removed, %d changed; "
+                   "%d events stale.\n", delta.holidaysadded,
+                   delta.holidaysremoved, delta.eventsadded,
+                   delta.eventsremoved, delta.eventschanged,
+                   delta.numstale);
+            freeruledelta(&delta);
+            if (applylocalrules() < 0)
+                fprintf(stderr, "ERROR: Out of memory applying the local "
+                        "rules.\n");
+        } else if (result == RL_EOPEN) {
+            fprintf(stderr, "ERROR: Could not reopen the rules files.\n");
+        } else {
+            printf("Rules files changed format; rebuilding.\n");
+            buildre(holiday, events, extras);
+        }
+    }
+}		/* -----  end of function watchrules  ----- */
+
+
+/* 
+ * Description:  Loads the chain of events that starts at a trigger, from a
+ * rule pack if one was given or else from the events file, and prints it.
+ *
+ * Parameters:  The events file, the rule pack (or NULL), and the short
+ * title of the trigger.
+ *
+ * Returns:  The number of events in the chain, or -1 if the file or pack
+ * could not be read.
+ *
+ * Notes:  Only the records the chain reaches are parsed, so this is the
+ * quick way to answer a single question about a single trigger.
+ */
+
+static int showchain(char *events, char *packname, char *trigger)
+{
+    struct ChainIndex index;
+    struct RulePack pack;
+    struct EventGraph chain;
+    struct CourtEventNode *node;
+    struct OutputSink out;
+    int result;
+
+    if (packname != NULL && *packname != '\0') {
+        result = openrulepack(packname, &pack);
+        if (result != RP_OK) {
+            fprintf(stderr, "ERROR: Could not load rule pack %s (%d)\n",
+                    packname, result);
+            return -1;
+        }
+        result = rulepack_loadchain(&pack, trigger, &chain);
+        closerulepack(&pack);
+    } else {
+        if (openchainindex(events, &index) < 0) {
+            reporterrors(stderr);
+            return -1;
+        }
+        result = loadchain(&index, trigger, &chain);
+        closechainindex(&index);
+    }
+    if (errorcount() > 0)
+        reporterrors(stderr);
+
+    if (result < 0) {
+        fprintf(stderr, "ERROR: Out of memory loading %s\n", trigger);
+        return -1;
+    } else if (result == 0) {
+        fprintf(stderr, "No event named %s\n", trigger);
+        return 0;
+    }
+
+    if (sinkopenstdout(&out) != OUT_OK)
+        return -1;
+    sinkprintf(&out, "%d events, %d dependencies in the chain of %s:\n",
+               chain.listsize, chain.numedges, trigger);
+    for (node = chain.eventlist; node != NULL; node = node->nextevent) {
+        if (node->eventdata.ntc_dependency1[0] == '\0')
+            sinkprintf(&out, "  %-40s (starts the chain)\n",
+                       node->eventdata.shorttitle);
+        else
+            sinkprintf(&out, "  %-40s %4d from %s\n",
+                       node->eventdata.shorttitle, node->eventdata.ntcpd1,
+                       node->eventdata.ntc_dependency1);
+    }
+    return (sinkclose(&out) == OUT_OK) ? result : -1;
+}		/* -----  end of function showchain  ----- */
+
+/*
+ * Description:  Computes the schedule of every trigger record of a file
+ * against THE events in force and calendar, and writes them as they are
+ * computed.
+ *
+ * Parameters:  The file of trigger records and the file to write, either of
+ * which may be NULL (or empty) for standard input or output, the format to
+ * write (text if NULL), and the number of blocks of records in the pipeline
+ * (0 for BATCH_NUMBLOCKS).
+ *
+ * Returns:  The number of records skipped, or -1 if the batch could not be
+ * run.
+ */
+
+static int batch(char *input, char *results, char *format, int depth)
+{
+    static const char *formats[] = {"text", "jsonl", "csv", "binary"};
+    struct OutputSink out;
+    struct BatchStats stats;
+    FILE *in;
+    int sched, result;
+
+    sched = SCHED_TEXT;
+    if (format != NULL && *format != '\0') {
+        for (sched = SCHED_BINARY; sched >= SCHED_TEXT; sched--)
+            if (strcmp(format, formats[sched]) == 0)
+                break;
+        if (sched < SCHED_TEXT) {
+            fprintf(stderr, "ERROR: Unknown format %s\n", format);
+            return -1;
+        }
+    }
+
+    in = stdin;
+    if (input != NULL && *input != '\0' &&
+            (in = fopen(input, "r")) == NULL) {
+        fprintf(stderr, "ERROR: Could not open %s\n", input);
+        return -1;
+    }
+    if (results != NULL && *results == '\0')
+        results = NULL;
+    if (sinkopenbatched(&out, results) != OUT_OK) {
+        fprintf(stderr, "ERROR: Could not create %s\n", results);
+        if (in != stdin)
+            fclose(in);
+        return -1;
+    }
+    if (sched == SCHED_CSV)
+        sinkputs(&out, SCHED_CSVHEADER);
+
+    result = runbatch(eventsinforce(), &jurisdcalendar, in, &out,
+                      (enum SCHEDFORMAT) sched, depth, &stats);
+    if (sinkclose(&out) != OUT_OK && result == BT_OK)
+        result = BT_EWRITE;
+    if (in != stdin)
+        fclose(in);
+    if (result != BT_OK) {
+        fprintf(stderr, "ERROR: Batch failed (%d)\n", result);
+        return -1;
+    }
+    fprintf(stderr, "%lu records, %lu skipped, %lu events\n",
+            stats.records, stats.errors, stats.events);
+    fprintf(stderr, "Pipeline of %d blocks: reader waited %lu times; at "
+            "most %d blocks waiting to be computed, %d to be written\n",
+            stats.depth, stats.stalls, stats.maxparsed, stats.maxcomputed);
+    printmetrics(stderr);
+    return (int) stats.errors;
+}		/* -----  end of function batch  ----- */
+
+/*
+ * Description:  Answers deadline and schedule requests against THE events
+ * in force and calendar on a local socket until interrupted, then reports
+ * how quickly they were answered.
+ *
+ * Parameters:  The path of the socket, or NULL (or empty) for
+ * SV_SOCKETPATH, the names of the holiday, events, and extras files the
+ * rules were built from (NULL if they were restored from a snapshot; the
+ * extras file is NULL or empty if there are no local rules), and the
+ * port to answer HTTP requests on as well (empty for HT_PORT), or NULL,
+ * and the most schedules to compute at once (0 for SV_MAXINFLIGHT).
+ *
+ * Returns:  Zero, or -1 if the socket or port could not be listened on.
+ *
+ * Notes:  If the rules were built from files, a thread watches the files
+ * and publishes a new rule set whenever they change, while the server goes
+ * on answering.
+ */
+
+static int serve(char *socketpath, char *holiday, char *events,
+                 char *extras, char *httpport, int maxinflight)
+{
+    static struct ServedRules files; /* read by the reload thread */
+    struct LatencyReport report;
+    struct AdmissionReport admission;
+    struct ServerLimits limits;
+    struct RuleSet *rules;
+    pthread_t thread;
+    long numcpus;
+    int result, port;
+
+    if (socketpath == NULL || *socketpath == '\0')
+        socketpath = SV_SOCKETPATH;
+    memset(&limits, 0, sizeof(limits));
+    limits.maxinflight = maxinflight;
+    setserverlimits(&limits);
+    if ((rules = wrapruleset(eventsinforce(), &jurisdcalendar)) == NULL) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return -1;
+    }
+    publishruleset(rules);
+    if (holiday != NULL && events != NULL) {
+        files.holiday = holiday;
+        files.events = events;
+        files.extras = extras;
+        if (pthread_create(&thread, NULL, reloadserved, &files) == 0)
+            pthread_detach(thread);
+    }
+
+    if (httpport != NULL) {
+        /* One event loop per processor answers HTTP beside the socket. */
+        port = (*httpport != '\0') ? atoi(httpport) : HT_PORT;
+        numcpus = sysconf(_SC_NPROCESSORS_ONLN);
+        result = starthttp(port, (numcpus > 0) ? (int) numcpus : 1);
+        if (result != HT_OK) {
+            fprintf(stderr, "ERROR: Could not listen on port %d (%d)\n",
+                    port, result);
+            return -1;
+        }
+        fprintf(stderr, "Listening on http://127.0.0.1:%d/schedule\n",
+                port);
+    }
+
+    fprintf(stderr, "Listening on %s\n", socketpath);
+    result = runserver(socketpath);
+    if (httpport != NULL)
+        stophttp();
+    if (result != SV_OK) {
+        fprintf(stderr, "ERROR: Could not listen on %s (%d)\n", socketpath,
+                result);
+        return -1;
+    }
+    serverlatency(&report);
+    serveradmission(&admission);
+    fprintf(stderr, "%lu requests, p50 %.1f us, p99 %.1f us\n",
+            report.requests, report.p50, report.p99);
+    fprintf(stderr, "%lu requests turned away busy, %lu clients refused\n",
+            admission.busy, admission.refused);
+    printmetrics(stderr);
+    return 0;
+}		/* -----  end of function serve  ----- */
+
+/*
+ * Description:  The serve command's reload thread: publishes a new rule set
+ * whenever the rules files change.
+ *
+ * Parameters:  The ServedRules naming the files.
+ *
+ * Returns:  Does not return.
+ *
+ * Algorithm:  As watchrules(), the stamps of the files, the extras file
+ * included, are checked every WATCHINTERVAL seconds.  The new set is built in full beside the one being
+ * served, so requests are never answered from rules part way through being
+ * changed.  If the new files cannot be read, the server keeps the rules it
+ * has.
+ */
+
+static void * reloadserved(void *arg)
+{
+    struct ServedRules *files = arg;
+    struct FileStamp hstamp, estamp, xstamp; /* the files last loaded */
+    struct FileStamp hnow, enow, xnow;
+    struct RuleSet *rules;
+    int result;
+
+    getstamp(files->holiday, &hstamp);
+    getstamp(files->events, &estamp);
+    getstamp(files->extras, &xstamp);
+
+    for (;;) {
+        sleep(WATCHINTERVAL);
+        if (getstamp(files->holiday, &hnow) != 0 ||
+                getstamp(files->events, &enow) != 0 ||
+                getstamp(files->extras, &xnow) != 0)
+            continue; /* a file is being replaced; try again later */
+        if (samestamp(&hnow, &hstamp) && samestamp(&enow, &estamp) &&
+                samestamp(&xnow, &xstamp))
+            continue;
+        hstamp = hnow;
+        estamp = enow;
+        xstamp = xnow;
+
+        result = loadruleset(files->holiday, files->events, files->extras,
+                             &rules);
+        if (result == RS_OK)
+            fprintf(stderr, "Reloaded: serving rules generation %lu.\n",
+                    publishruleset(rules));
+        else
+            fprintf(stderr, "ERROR: Could not reload the rules files (%d); "
+                    "keeping the rules in use.\n", result);
+    }
+    return NULL;
+}		/* -----  end of function reloadserved  ----- */
+
+/*
+ * Description:  Records what a rules file looks like now.
+ *
+ * Parameters:  Name of the file (NULL or empty if there is none) and the
+ * stamp to fill in.
+ *
+ * Returns:  0, or -1 if the file cannot be stat'ed.  A file that is not
+ * given gets an empty stamp.
+ */
+
+static int getstamp(const char *filename, struct FileStamp *stamp)
+{
+    struct stat sb;
+
+    memset(stamp, 0, sizeof(*stamp));
+    if (filename == NULL || *filename == '\0')
+        return 0;
+    if (stat(filename, &sb) != 0)
+        return -1;
+    stamp->modified = sb.st_mtim;
+    stamp->size = sb.st_size;
+    stamp->inode = sb.st_ino;
+    stamp->device = sb.st_dev;
+    return 0;
+}		/* -----  end of function getstamp  ----- */
+
+/*
+ * Description:  Compares two stamps of a rules file.
+ *
+ * Parameters:  The stamps.
+ *
+ * Returns:  Nonzero if the stamps match, i.e., the file has not changed.
+ */
+
+static int samestamp(const struct FileStamp *a, const struct FileStamp *b)
+{
+    return a->modified.tv_sec == b->modified.tv_sec &&
+           a->modified.tv_nsec == b->modified.tv_nsec &&
+           a->size == b->size && a->inode == b->inode &&
+           a->device == b->device;
+}		/* -----  end of function samestamp  ----- */
@@ -0,0 +1,419 @@
+/*
+ * Filename: metrics.c
+ * Project: DocketMaster
+ *
+ * Description: Per-thread hot path counters and latency histograms, and the
+ * engine's counters and gauges.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:06:33 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Called through the macros of metrics.h, and by the server manager.
+ * File Format:
+ * Restrictions:
+ * Error Handling:
+ * References:
+ * Notes: A thread's counters are written only by that thread, with relaxed
+ * atomic stores rather than read-modify-write instructions, so counting a
+ * call costs about as much as an ordinary increment.  A report reads them
+ * with relaxed loads while they may still be changing; each count is
+ * whole, but the counts of a report are not all from the same instant.
+ *
+ * When a thread exits its counts are added to those of the threads that
+ * have exited before it, and its counters are freed.
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "metrics.h"
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* One thread's counters. */
+struct ThreadMetrics {
+    struct ThreadMetrics *next; /* in the list of threads */
+    uint64_t calls[MP_NUMPROBES];
+    uint64_t totalns[MP_NUMPROBES];
+    uint64_t counts[MP_NUMPROBES][LAT_BUCKETS];
+    uint64_t counters[MC_NUMCOUNTERS];
+};
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
+
+/* Names of the probes, in the order of enum METRICPROBE. */
+static const char *probenames[MP_NUMPROBES] = {
+    "isholiday", "courtday_offset", "courtday_difference", "searchforevent",
+    "chain", "parse_rules", "parse_trigger", "write_schedule", "export"};
+
+/* A call is timed if its count and the probe's mask are zero: every call
+of the slow paths, one in 256 lookups of a day.  The masks keep the cost of
+reading the clock to a small part of the cost of the calls counted. */
+static const uint64_t probemasks[MP_NUMPROBES] = {255, 63, 63, 7, 7, 0, 15,
+                                                  15, 0};
+
+static __thread struct ThreadMetrics *mine; /* this thread's counters */
+
+static struct ThreadMetrics *threads; /* every thread's counters */
+static struct ThreadMetrics retired; /* the counts of threads that have
+                                        exited */
+static pthread_mutex_t threadslock = PTHREAD_MUTEX_INITIALIZER;
+    /* guards threads and retired */
+static long gauges[MG_NUMGAUGES];
+
+static pthread_key_t threadkey; /* frees a thread's counters as it exits */
+static pthread_once_t keyonce = PTHREAD_ONCE_INIT;
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static struct ThreadMetrics * joinmetrics (void);
+    /* Sets up the calling thread's counters */
+
+static void leavemetrics (void *arg);
+    /* Retires a thread's counters as it exits */
+
+static void makekey (void);
+    /* Creates threadkey */
+
+static void bump (uint64_t *counter, uint64_t amount);
+    /* Adds to a counter only this thread writes */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description:  Counts a call to a hot path, and starts timing it if it is
+ * one of the calls to be timed.
+ * Parameters:  The probe.
+ * Returns:  The time the call started, or zero if it is not timed.
+ */
+
+uint64_t probestart (int probe)
+{
+    struct ThreadMetrics *metrics = mine;
+
+    if (metrics == NULL && (metrics = joinmetrics()) == NULL)
+        return 0;
+    bump(&metrics->calls[probe], 1);
+    if ((metrics->calls[probe] & probemasks[probe]) != 0)
+        return 0;
+    return metricclock();
+}		/* -----  end of function probestart  ----- */
+
+/*
+ * Description:  Finishes timing a call to a hot path.
+ * Parameters:  The probe and what probestart() returned.
+ * Returns:  Nothing.
+ */
+
+void probestop (int probe, uint64_t start)
+{
+    struct ThreadMetrics *metrics = mine;
+    uint64_t ns;
+
+    if (start == 0 || metrics == NULL)
+        return;
+    ns = metricclock() - start;
+    bump(&metrics->totalns[probe], ns);
+    bump(&metrics->counts[probe][latencybucket(ns)], 1);
+    return;
+}		/* -----  end of function probestop  ----- */
+
+/*
+ * Description:  Adds to a counter.
+ * Parameters:  The counter and the amount.
+ * Returns:  Nothing.
+ */
+
+void countmetric (int counter, uint64_t amount)
+{
+    struct ThreadMetrics *metrics = mine;
+
+    if (metrics == NULL && (metrics = joinmetrics()) == NULL)
+        return;
+    bump(&metrics->counters[counter], amount);
+    return;
+}		/* -----  end of function countmetric  ----- */
+
+/*
+ * Description:  Adds up a counter over every thread.
+ * Parameters:  The counter.
+ * Returns:  The count.
+ */
+
+unsigned long long metriccount (int counter)
+{
+    struct ThreadMetrics *metrics;
+    unsigned long long count;
+
+    pthread_mutex_lock(&threadslock);
+    count = retired.counters[counter];
+    for (metrics = threads; metrics != NULL; metrics = metrics->next)
+        count += __atomic_load_n(&metrics->counters[counter],
+                                 __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&threadslock);
+    return count;
+}		/* -----  end of function metriccount  ----- */
+
+/*
+ * Description:  Sets a gauge.
+ * Parameters:  The gauge and its value.
+ * Returns:  Nothing.
+ */
+
+void setgauge (int gauge, long value)
+{
+    __atomic_store_n(&gauges[gauge], value, __ATOMIC_RELAXED);
+    return;
+}		/* -----  end of function setgauge  ----- */
+
+/*
+ * Description:  Reads a gauge.
+ * Parameters:  The gauge.
+ * Returns:  Its value.
+ */
+
+long readgauge (int gauge)
+{
+    return __atomic_load_n(&gauges[gauge], __ATOMIC_RELAXED);
+}		/* -----  end of function readgauge  ----- */
+
+/*
+ * Description:  Adds up a probe's counts over every thread.
+ * Parameters:  The probe and the ProbeStats to fill in.
+ * Returns:  Nothing.
+ */
+
+void probestats (int probe, struct ProbeStats *stats)
+{
+    struct ThreadMetrics *metrics;
+    int bucket;
+
+    memset(stats, 0, sizeof(struct ProbeStats));
+    pthread_mutex_lock(&threadslock);
+    stats->calls = retired.calls[probe];
+    stats->totalns = retired.totalns[probe];
+    memcpy(stats->counts, retired.counts[probe], sizeof(stats->counts));
+    for (metrics = threads; metrics != NULL; metrics = metrics->next) {
+        stats->calls += __atomic_load_n(&metrics->calls[probe],
+                                        __ATOMIC_RELAXED);
+        stats->totalns += __atomic_load_n(&metrics->totalns[probe],
+                                          __ATOMIC_RELAXED);
+        for (bucket = 0; bucket < LAT_BUCKETS; bucket++)
+            stats->counts[bucket] +=
+                __atomic_load_n(&metrics->counts[probe][bucket],
+                                __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&threadslock);
+    for (bucket = 0; bucket < LAT_BUCKETS; bucket++)
+        stats->timed += stats->counts[bucket];
+    return;
+}		/* -----  end of function probestats  ----- */
+
+/*
+ * Description:  The name of a probe.
+ */
+
+const char *probename (int probe)
+{
+    return (probe >= 0 && probe < MP_NUMPROBES) ? probenames[probe] : "";
+}		/* -----  end of function probename  ----- */
+
+/*
+ * Description:  Writes the calls, mean, and percentile times of each probe
+ * that has been called.
+ * Parameters:  The file to write.
+ * Returns:  Nothing.
+ */
+
+void printmetrics (FILE *out)
+{
+    struct ProbeStats stats;
+    int probe;
+
+    for (probe = 0; probe < MP_NUMPROBES; probe++) {
+        probestats(probe, &stats);
+        if (stats.calls == 0)
+            continue;
+        fprintf(out, "%-20s %12llu calls", probenames[probe], stats.calls);
+        if (stats.timed > 0)
+            fprintf(out, ", mean %.0f ns, p50 %.0f ns, p99 %.0f ns "
+                    "(%llu timed)", (double) stats.totalns / stats.timed,
+                    histpercentile(stats.counts, stats.timed, 0.50),
+                    histpercentile(stats.counts, stats.timed, 0.99),
+                    stats.timed);
+        fprintf(out, "\n");
+    }
+    return;
+}		/* -----  end of function printmetrics  ----- */
+
+/*
+ * Description:  Finds the histogram bucket a time falls in.
+ *
+ * Parameters:  The time, in nanoseconds.
+ *
+ * Returns:  The bucket.
+ *
+ * Algorithm:  Times under 2^LAT_SUBBITS ns have a bucket each.  Above that,
+ * the bucket is found from the position of the highest bit set and the
+ * LAT_SUBBITS bits after it.
+ */
+
+int latencybucket (uint64_t ns)
+{
+    int bit;
+
+    if (ns >= ((uint64_t) 1 << LAT_MAXBITS))
+        ns = ((uint64_t) 1 << LAT_MAXBITS) - 1;
+    if (ns < LAT_SUBBUCKETS)
+        return (int) ns;
+    bit = 63 - __builtin_clzll(ns);
+    return (bit - LAT_SUBBITS) * LAT_SUBBUCKETS +
+        (int) (ns >> (bit - LAT_SUBBITS));
+}		/* -----  end of function latencybucket  ----- */
+
+/*
+ * Description:  Finds the largest time in a histogram bucket.
+ * Parameters:  The bucket.
+ * Returns:  The time, in nanoseconds.
+ */
+
+double bucketlimit (int bucket)
+{
+    int shift;
+
+    if (bucket < LAT_SUBBUCKETS)
+        return (double) bucket;
+    shift = bucket / LAT_SUBBUCKETS - 1;
+    return (double) ((((uint64_t) (bucket % LAT_SUBBUCKETS +
+                                   LAT_SUBBUCKETS) + 1) << shift) - 1);
+}		/* -----  end of function bucketlimit  ----- */
+
+/*
+ * Description:  Finds a percentile of a histogram.
+ *
+ * Parameters:  The bucket counts, their total, and the fraction of the
+ * values that are no larger than the value wanted.
+ *
+ * Returns:  The largest time in the bucket the percentile falls in, or zero
+ * if the histogram is empty.
+ */
+
+double histpercentile (const uint64_t *counts, uint64_t total,
+                       double fraction)
+{
+    uint64_t wanted, seen;
+    int bucket;
+
+    if (total == 0)
+        return 0.0;
+    wanted = (uint64_t) (fraction * total + 0.5);
+    if (wanted < 1)
+        wanted = 1;
+    seen = 0;
+    for (bucket = 0; bucket < LAT_BUCKETS - 1; bucket++) {
+        seen += counts[bucket];
+        if (seen >= wanted)
+            break;
+    }
+    return bucketlimit(bucket);
+}		/* -----  end of function histpercentile  ----- */
+
+/*
+ * Description:  Reads the monotonic clock.
+ * Returns:  The time, in nanoseconds.
+ */
+
+uint64_t metricclock (void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + now.tv_nsec;
+}		/* -----  end of function metricclock  ----- */
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description:  Sets up the calling thread's counters and adds them to the
+ * list.
+ *
+ * Returns:  The counters, or NULL if out of memory.
+ */
+
+static struct ThreadMetrics * joinmetrics (void)
+{
+    struct ThreadMetrics *metrics;
+
+    pthread_once(&keyonce, makekey);
+    metrics = calloc(1, sizeof(struct ThreadMetrics));
+    if (metrics == NULL)
+        return NULL;
+    pthread_mutex_lock(&threadslock);
+    metrics->next = threads;
+    threads = metrics;
+    pthread_mutex_unlock(&threadslock);
+    pthread_setspecific(threadkey, metrics);
+    mine = metrics;
+    return metrics;
+}		/* -----  end of function joinmetrics  ----- */
+
+/*
+ * Description:  Destructor of threadkey: adds a thread's counts to those of
+ * the threads that have exited, and frees its counters.
+ */
+
+static void leavemetrics (void *arg)
+{
+    struct ThreadMetrics *metrics = arg, **link;
+    int probe, bucket, counter;
+
+    pthread_mutex_lock(&threadslock);
+    for (link = &threads; *link != NULL; link = &(*link)->next)
+        if (*link == metrics) {
+            *link = metrics->next;
+            break;
+        }
+    for (probe = 0; probe < MP_NUMPROBES; probe++) {
+        retired.calls[probe] += metrics->calls[probe];
+        retired.totalns[probe] += metrics->totalns[probe];
+        for (bucket = 0; bucket < LAT_BUCKETS; bucket++)
+            retired.counts[probe][bucket] += metrics->counts[probe][bucket];
+    }
+    for (counter = 0; counter < MC_NUMCOUNTERS; counter++)
+        retired.counters[counter] += metrics->counters[counter];
+    pthread_mutex_unlock(&threadslock);
+    mine = NULL;
+    free(metrics);
+    return;
+}		/* -----  end of function leavemetrics  ----- */
+
+/*
+ * Description:  Creates threadkey, once.
+ */
+
+static void makekey (void)
+{
+    pthread_key_create(&threadkey, leavemetrics);
+    return;
+}		/* -----  end of function makekey  ----- */
+
+/*
+ * Description:  Adds to a counter that only the calling thread writes.  The
+ * store is atomic so a report never reads half of it.
+ */
+
+static void bump (uint64_t *counter, uint64_t amount)
+{
+    __atomic_store_n(counter, *counter + amount, __ATOMIC_RELAXED);
+    return;
+}		/* -----  end of function bump  ----- */
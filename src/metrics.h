@@ -0,0 +1,244 @@
+/*
+ * Filename: metrics.h
+ * Project: DocketMaster
+ *
+ * Description: The metrics module counts the calls to the engine's hot
+ * paths and keeps histograms of the time they take, so a slow batch or
+ * server can be traced to the work that made it slow.  Each thread keeps
+ * its own counts, which are added up only when a report is asked for, so
+ * the threads never contend over them.
+ *
+ * It also keeps counters of what the engine has done, such as deadlines
+ * computed and records rejected, and gauges of how full the batch queues
+ * are; these are always kept, being cheap, and are exported by promexport.
+ *
+ * The histograms are also used by the server manager for the time taken to
+ * answer requests.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:06:33 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: A function on a hot path declares METRIC_STAMP(name) after its
+ * other variables, and brackets its work with METRIC_START(probe, name) and
+ * METRIC_STOP(probe, name).  probestats() and printmetrics() report.
+ *
+ * The probes are compiled in only if DM_METRICS is defined; otherwise the
+ * macros are empty and the reports show no calls.  countmetric() and
+ * setgauge() are called directly, and always count.
+ *
+ * File Format:
+ * Restrictions:
+ * Error Handling: A thread whose counters cannot be allocated is not
+ * counted.
+ * References: The histograms are after HdrHistogram: each power of two is
+ * split into the same number of buckets, so every bucket is within the
+ * same fraction of the values in it, from nanoseconds to minutes.
+ * Notes: Every call is counted, but only one call in every few is timed on
+ * the fastest paths (see probemasks in metrics.c): reading the clock takes
+ * longer than looking a day up in the calendar.
+ */
+
+#ifndef _METRICS_H_INCLUDED_
+#define _METRICS_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define LAT_SUBBITS 4 /* each power of two is split into 2^LAT_SUBBITS
+                         buckets, so a bucket is within 6% of its values */
+#define LAT_SUBBUCKETS (1 << LAT_SUBBITS)
+#define LAT_MAXBITS 40 /* longest time recorded: 2^40 ns, about 18 min */
+#define LAT_BUCKETS ((LAT_MAXBITS - LAT_SUBBITS + 1) * LAT_SUBBUCKETS)
+
+/* #####   EXPORTED MACROS   ################################################ */
+
+#ifdef DM_METRICS
+#define METRIC_STAMP(stamp) uint64_t stamp
+#define METRIC_START(probe, stamp) ((stamp) = probestart(probe))
+#define METRIC_STOP(probe, stamp) probestop((probe), (stamp))
+#else
+#define METRIC_STAMP(stamp)
+#define METRIC_START(probe, stamp) ((void) 0)
+#define METRIC_STOP(probe, stamp) ((void) 0)
+#endif
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+/* The hot paths. */
+enum METRICPROBE {
+    MP_ISHOLIDAY, /* calendar_isholiday() */
+    MP_COURTOFFSET, /* calendar_offset() */
+    MP_COURTDIFF, /* calendar_difference() */
+    MP_SEARCHEVENT, /* searchforevent() */
+    MP_CHAIN, /* computeschedule(): evaluating a trigger's chain */
+    MP_PARSERULES, /* parsefile(): reading a rules file */
+    MP_PARSETRIGGER, /* reading a trigger record */
+    MP_WRITESCHEDULE, /* writeschedule() */
+    MP_EXPORT, /* write_cal_items(): exporting calendar items */
+    MP_NUMPROBES
+};
+
+/* The counters, each added up over every thread. */
+enum METRICCOUNTER {
+    MC_RANKHITS, /* court day offsets and differences read from the ranks of
+                    the materialized calendar */
+    MC_RANKMISSES, /* those counted day by day, outside it */
+    MC_HOLIDAYMISSES, /* holiday lookups outside the materialized calendar,
+                         answered from the rules */
+    MC_DEADLINES, /* events scheduled, triggers included */
+    MC_TRIGGERERRORS, /* trigger records that could not be read */
+    MC_RULEERRORS, /* records skipped in rules files */
+    MC_NUMCOUNTERS
+};
+
+/* The gauges: values that go up and down. */
+enum METRICGAUGE {
+    MG_PARSEDBLOCKS, /* batch blocks waiting to be computed */
+    MG_COMPUTEDBLOCKS, /* batch blocks waiting to be written */
+    MG_NUMGAUGES
+};
+
+/* A probe's counts, added up over every thread. */
+struct ProbeStats {
+    unsigned long long calls;
+    unsigned long long timed; /* calls timed; the sum of counts */
+    unsigned long long totalns; /* time taken by the calls timed */
+    uint64_t counts[LAT_BUCKETS]; /* calls timed, by the time taken */
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Counts a call to a hot path, and starts timing it if it is
+ * one of the calls to be timed.
+ *
+ * Parameters: The probe.
+ *
+ * Returns: The time the call started, in nanoseconds, or zero if it is not
+ * to be timed.  Pass it to probestop().
+ */
+
+uint64_t probestart (int probe);
+
+/*
+ * Description: Finishes timing a call to a hot path.
+ * Parameters: The probe and what probestart() returned.
+ * Returns: Nothing.
+ */
+
+void probestop (int probe, uint64_t start);
+
+/*
+ * Description: Adds to a counter.
+ * Parameters: The counter and the amount.
+ * Returns: Nothing.
+ */
+
+void countmetric (int counter, uint64_t amount);
+
+/*
+ * Description: Adds up a counter over every thread, including those that
+ * have exited.
+ *
+ * Parameters: The counter.
+ *
+ * Returns: The count.
+ */
+
+unsigned long long metriccount (int counter);
+
+/*
+ * Description: Sets a gauge.
+ * Parameters: The gauge and its value.
+ * Returns: Nothing.
+ */
+
+void setgauge (int gauge, long value);
+
+/*
+ * Description: Reads a gauge.
+ * Parameters: The gauge.
+ * Returns: Its value.
+ */
+
+long readgauge (int gauge);
+
+/*
+ * Description: Adds up a probe's counts over every thread, including those
+ * that have exited.
+ *
+ * Parameters: The probe and the ProbeStats to fill in.
+ *
+ * Returns: Nothing.
+ */
+
+void probestats (int probe, struct ProbeStats *stats);
+
+/*
+ * Description: The name of a probe, as used in reports.
+ * Parameters: The probe.
+ * Returns: The name.
+ */
+
+const char *probename (int probe);
+
+/*
+ * Description: Writes the calls, mean, and percentile times of each probe
+ * that has been called.
+ *
+ * Parameters: The file to write.
+ *
+ * Returns: Nothing.
+ */
+
+void printmetrics (FILE *out);
+
+/*
+ * Description: Finds the histogram bucket a time falls in.
+ * Parameters: The time, in nanoseconds.
+ * Returns: The bucket, less than LAT_BUCKETS.
+ */
+
+int latencybucket (uint64_t ns);
+
+/*
+ * Description: Finds the largest time in a histogram bucket.
+ * Parameters: The bucket.
+ * Returns: The time, in nanoseconds.
+ */
+
+double bucketlimit (int bucket);
+
+/*
+ * Description: Finds a percentile of a histogram.
+ *
+ * Parameters: The bucket counts, their total, and the fraction of the
+ * values that are no larger than the value wanted.
+ *
+ * Returns: The largest time in the bucket the percentile falls in, in
+ * nanoseconds, or zero if the histogram is empty.
+ */
+
+double histpercentile (const uint64_t *counts, uint64_t total,
+                       double fraction);
+
+/*
+ * Description: Reads the monotonic clock.
+ * Parameters: None.
+ * Returns: The time, in nanoseconds.
+ */
+
+uint64_t metricclock (void);
+
+#endif	/* _METRICS_H_INCLUDED_ */
@@ -3,35 +3,53 @@
  * Project: DocketMaster
  *
  * Description:  This module contains the functions that control output of data
- * to data files or the printer.
+ * to data files or the printer.  Every kind of output goes through an
+ * OutputSink (see outputmgr.h).
  *
  * Version: 1.0.20
  * Created:  01/14/2012 08:40:58 PM
- * Last Modified: Wed Dec 16 14:28:22 2020
+ * Last Modified: Mon Oct 19 10:01:23 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
  *  
- * Copyright: Copyright (c) 2011-2020, Thomas H. Vidal
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
  * SPDX-License-Identifier: GPL-2.0-only
  *
  * Usage: Used by DocketMaster Program
  *
- * File Format: Saves calendar data in outlook ical format.
+ * File Format: Saves calendar data in outlook ical format.  Schedules are
+ * written as text, JSON Lines, CSV, or binary records (see outputmgr.h).
  *
- * File Format: 
  * Restrictions: 
- * Error Handling: 
+ * Error Handling: A failed write is reported on stderr once, when it
+ * happens, and then kept in the sink.
  * References: 
- * Notes: [no notes as of 10/24/2011]. 
+ * Notes: Output goes straight to write(2) and writev(2); stdio is not used,
+ * so there is only one layer of buffering.
  */
 
 /* #####   HEADER FILE INCLUDES   ################################################### */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "outputmgr.h"
+#include "datetools.h"
+#include "arena.h"
+#include "metrics.h"
+
 /* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ################################### */
 
 /* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ######################## */
 
+#define SCHED_RECORDLEN 128 /* room for a schedule record, less its case id
+                               and title */
+
 /* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ######################### */
 
 /* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
@@ -40,7 +58,734 @@
 
 /* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ############################### */
 
+static int opensink (struct OutputSink *sink, enum SINKTYPE type, int fd,
+                     int ownsfd);
+    /* Sets up a sink and its buffer */
+
+static char * makeroom (struct OutputSink *sink, size_t len);
+    /* Flushes or grows the buffer so len bytes fit */
+
+static void endsegment (struct OutputSink *sink);
+    /* Adds the bytes filled since the last piece as a piece of a batch */
+
+static int writeall (struct OutputSink *sink, const char *data, size_t len);
+    /* Writes all of the bytes, however many write(2) calls it takes */
+
+static int writebatch (struct OutputSink *sink);
+    /* Writes the pieces of a batch, however many writev(2) calls it takes */
+
+static int writefailed (struct OutputSink *sink);
+    /* Records and reports a failed write */
+
+static char * putint (char *p, long value);
+    /* Writes a number in decimal */
+
+static char * putjson (char *p, const char *text);
+    /* Writes a string as the contents of a JSON string */
+
+static char * putcsv (char *p, const char *text);
+    /* Writes a string as a quoted CSV field */
+
 /* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
 
+/*
+ * Description:  Opens a sink that writes to a file, creating or emptying it.
+ * Parameters:  The sink and the file name.
+ * Returns:  OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkopenfile (struct OutputSink *sink, const char *filename)
+{
+    int fd;
+
+    fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        memset(sink, 0, sizeof(*sink));
+        fprintf(stderr, "## ERROR ## Cannot open %s: %s\n", filename,
+                strerror(errno));
+        sink->fd = -1;
+        return sink->error = OUT_EOPEN;
+    }
+    if (opensink(sink, SINK_FILE, fd, 1) != OUT_OK)
+        close(fd);
+    return sink->error;
+}		/* -----  end of function sinkopenfile  ----- */
+
+/*
+ * Description:  Opens a sink that writes to standard output.
+ * Parameters:  The sink.
+ * Returns:  OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkopenstdout (struct OutputSink *sink)
+{
+    fflush(stdout); /* so what was printed comes first */
+    return opensink(sink, SINK_STDOUT, STDOUT_FILENO, 0);
+}		/* -----  end of function sinkopenstdout  ----- */
+
+/*
+ * Description:  Opens a sink that collects its output in memory.
+ * Parameters:  The sink.
+ * Returns:  OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkopenmemory (struct OutputSink *sink)
+{
+    return opensink(sink, SINK_MEMORY, -1, 0);
+}		/* -----  end of function sinkopenmemory  ----- */
+
+/*
+ * Description:  Opens a batched sink.
+ * Parameters:  The sink and the file name, or NULL for standard output.
+ * Returns:  OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkopenbatched (struct OutputSink *sink, const char *filename)
+{
+    int fd = STDOUT_FILENO;
+
+    if (filename != NULL) {
+        fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            memset(sink, 0, sizeof(*sink));
+            fprintf(stderr, "## ERROR ## Cannot open %s: %s\n", filename,
+                    strerror(errno));
+            sink->fd = -1;
+            return sink->error = OUT_EOPEN;
+        }
+    } else {
+        fflush(stdout);
+    }
+    if (opensink(sink, SINK_BATCHED, fd, filename != NULL) != OUT_OK &&
+            filename != NULL)
+        close(fd);
+    return sink->error;
+}		/* -----  end of function sinkopenbatched  ----- */
+
+/*
+ * Description:  Writes bytes to a sink.
+ *
+ * Parameters:  The sink, the bytes, and how many.
+ *
+ * Returns:  OUT_OK, or a negative OUT_E code.
+ *
+ * Algorithm:  The bytes are copied into the buffer a buffer-full at a time,
+ * except that a file or standard output sink writes bytes that would fill a
+ * whole buffer straight from where they are.
+ */
+
+int sinkwrite (struct OutputSink *sink, const void *data, size_t len)
+{
+    const char *bytes = data;
+    size_t chunk;
+    char *p;
+
+    if (sink->error != OUT_OK)
+        return sink->error;
+    if (len >= sink->size && (sink->type == SINK_FILE ||
+                              sink->type == SINK_STDOUT)) {
+        if (sinkflush(sink) == OUT_OK && writeall(sink, bytes, len) == OUT_OK)
+            sink->total += len;
+        return sink->error;
+    }
+
+    while (len > 0) {
+        chunk = len;
+        if (sink->type != SINK_MEMORY) {
+            if (sink->used == sink->size)
+                makeroom(sink, 1);
+            if (chunk > sink->size - sink->used)
+                chunk = sink->size - sink->used;
+        }
+        if ((p = sinkreserve(sink, chunk)) == NULL)
+            return sink->error;
+        memcpy(p, bytes, chunk);
+        sinkcommit(sink, p + chunk);
+        bytes += chunk;
+        len -= chunk;
+    }
+    return OUT_OK;
+}		/* -----  end of function sinkwrite  ----- */
+
+/*
+ * Description:  Writes a string to a sink.
+ * Parameters:  The sink and the string.
+ * Returns:  OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkputs (struct OutputSink *sink, const char *text)
+{
+    return sinkwrite(sink, text, strlen(text));
+}		/* -----  end of function sinkputs  ----- */
+
+/*
+ * Description:  Writes formatted text to a sink, as printf() does.
+ *
+ * Parameters:  The sink, the format, and its arguments.
+ *
+ * Returns:  OUT_OK, or a negative OUT_E code.
+ *
+ * Algorithm:  The text is formatted straight into the buffer.  Only if it
+ * does not fit in what is left of the buffer is it formatted again, after
+ * room is made, or into a temporary buffer if it is bigger than a block.
+ */
+
+int sinkprintf (struct OutputSink *sink, const char *format, ...)
+{
+    va_list args;
+    char *p, *temp;
+    size_t room;
+    int len;
+
+    if (sink->error != OUT_OK)
+        return sink->error;
+
+    room = sink->size - sink->used;
+    va_start(args, format);
+    len = vsnprintf(sink->buffer + sink->used, room, format, args);
+    va_end(args);
+    if (len < 0)
+        return OUT_OK; /* nothing that can be formatted */
+    if ((size_t) len < room) {
+        sinkcommit(sink, sink->buffer + sink->used + len);
+        return OUT_OK;
+    }
+
+    if ((size_t) len < sink->size || sink->type == SINK_MEMORY) {
+        if ((p = sinkreserve(sink, len + 1)) == NULL)
+            return sink->error;
+        va_start(args, format);
+        vsnprintf(p, len + 1, format, args);
+        va_end(args);
+        sinkcommit(sink, p + len);
+        return OUT_OK;
+    }
+
+    if ((temp = countedmalloc(len + 1)) == NULL)
+        return sink->error = OUT_ENOMEM;
+    va_start(args, format);
+    vsnprintf(temp, len + 1, format, args);
+    va_end(args);
+    sinkwrite(sink, temp, len);
+    countedfree(temp);
+    return sink->error;
+}		/* -----  end of function sinkprintf  ----- */
+
+/*
+ * Description:  Writes bytes that will not change or go away before the
+ * sink is closed.
+ *
+ * Parameters:  The sink, the bytes, and how many.
+ *
+ * Returns:  OUT_OK, or a negative OUT_E code.
+ *
+ * Notes:  A batched sink adds the bytes to its batch as a piece of their
+ * own; the other sinks copy them.
+ */
+
+int sinkref (struct OutputSink *sink, const void *data, size_t len)
+{
+    if (sink->type != SINK_BATCHED)
+        return sinkwrite(sink, data, len);
+    if (sink->error != OUT_OK)
+        return sink->error;
+    if (len == 0)
+        return OUT_OK;
+
+    endsegment(sink);
+    if (sink->error != OUT_OK)
+        return sink->error;
+    sink->iov[sink->numiov].iov_base = (void *) data;
+    sink->iov[sink->numiov].iov_len = len;
+    sink->numiov++;
+    sink->total += len;
+    if (sink->numiov == OUT_MAXIOV)
+        writebatch(sink);
+    return sink->error;
+}		/* -----  end of function sinkref  ----- */
+
+/*
+ * Description:  Makes room to build output in place.
+ * Parameters:  The sink and the most bytes that will be built.
+ * Returns:  Where to build the output, or NULL if the sink has failed.
+ */
+
+char *sinkreserve (struct OutputSink *sink, size_t len)
+{
+    if (sink->error != OUT_OK)
+        return NULL;
+    if (sink->size - sink->used >= len)
+        return sink->buffer + sink->used;
+    return makeroom(sink, len);
+}		/* -----  end of function sinkreserve  ----- */
+
+/*
+ * Description:  Adds output built in place to the sink.
+ * Parameters:  The sink and the end of the output built.
+ * Returns:  Nothing.
+ */
+
+void sinkcommit (struct OutputSink *sink, char *end)
+{
+    sink->total += end - (sink->buffer + sink->used);
+    sink->used = end - sink->buffer;
+    return;
+}		/* -----  end of function sinkcommit  ----- */
+
+/*
+ * Description:  Writes everything buffered in a sink.
+ * Parameters:  The sink.
+ * Returns:  OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkflush (struct OutputSink *sink)
+{
+    if (sink->error != OUT_OK)
+        return sink->error;
+
+    switch (sink->type) {
+        case SINK_FILE:
+        case SINK_STDOUT:
+            writeall(sink, sink->buffer, sink->used);
+            sink->used = 0;
+            break;
+        case SINK_BATCHED:
+            endsegment(sink);
+            writebatch(sink);
+            break;
+        case SINK_MEMORY:
+            break;
+    }
+    return sink->error;
+}		/* -----  end of function sinkflush  ----- */
+
+/*
+ * Description:  Takes the output of a memory sink.
+ *
+ * Parameters:  The sink and where to put the number of bytes.
+ *
+ * Returns:  The output, which the caller must free(), or NULL if the sink
+ * is not a memory sink.
+ */
+
+char *sinktakememory (struct OutputSink *sink, size_t *len)
+{
+    char *output;
+
+    if (sink->type != SINK_MEMORY)
+        return NULL;
+    output = sink->buffer;
+    *len = sink->used;
+    sink->buffer = NULL;
+    sink->used = sink->size = 0;
+    return output;
+}		/* -----  end of function sinktakememory  ----- */
+
+/*
+ * Description:  Writes everything buffered, closes the file (not standard
+ * output), and releases the buffers.
+ * Parameters:  The sink.
+ * Returns:  OUT_OK, or the first error of the sink.
+ */
+
+int sinkclose (struct OutputSink *sink)
+{
+    sinkflush(sink);
+    if (sink->ownsfd && sink->fd >= 0 && close(sink->fd) != 0 &&
+            sink->error == OUT_OK)
+        sink->error = OUT_EWRITE;
+    if (sink->type == SINK_BATCHED)
+        countedfree(sink->blocks);
+    else
+        countedfree(sink->buffer);
+    sink->blocks = sink->buffer = NULL;
+    sink->used = sink->size = 0;
+    sink->fd = -1;
+    sink->ownsfd = 0;
+    return sink->error;
+}		/* -----  end of function sinkclose  ----- */
+
+/*
+ * Description:  Empties a memory sink so it can be filled again, keeping its
+ * buffer.
+ * Parameters:  The sink.
+ * Returns:  Nothing.
+ */
+
+void sinkrewind (struct OutputSink *sink)
+{
+    if (sink->type == SINK_MEMORY)
+        sink->used = 0;
+    return;
+}		/* -----  end of function sinkrewind  ----- */
+
+/*
+ * Description:  Writes a computed schedule of one case.
+ *
+ * Parameters:  The sink, the format, the case id, and the schedule.
+ *
+ * Returns:  OUT_OK, or a negative OUT_E code.
+ *
+ * Algorithm:  Room for the longest record the case id could make is
+ * reserved once per event, the record is built there, and the part used is
+ * committed.  Escaping a character of JSON takes at most six bytes ("\u001f")
+ * and of CSV two, which sizes the reservation.
+ */
+
+int writeschedule (struct OutputSink *sink, enum SCHEDFORMAT format,
+                   const char *caseid, const struct ScheduledEvent *schedule,
+                   int numevents)
+{
+    const struct ScheduledEvent *item;
+    struct ScheduleRecord record;
+    struct DateTime date;
+    size_t caseidlen, room, len;
+    char *p;
+    int index;
+    METRIC_STAMP(start);
+
+    METRIC_START(MP_WRITESCHEDULE, start);
+    caseidlen = strlen(caseid);
+    room = SCHED_RECORDLEN + 6 * caseidlen;
+    if (format == SCHED_TEXT)
+        room += sizeof(schedule->event->eventitle);
+    if (format == SCHED_JSON)
+        sinkwrite(sink, "[", 1);
+
+    for (index = 0; index < numevents; index++) {
+        item = &schedule[index];
+        if (format == SCHED_BINARY) {
+            memset(&record, 0, sizeof(record));
+            memcpy(record.caseid, caseid, (caseidlen < SCHED_CASEIDLEN) ?
+                   caseidlen : SCHED_CASEIDLEN);
+            record.eventid = item->eventid;
+            record.jdn = item->jdn;
+            record.flags = item->flags;
+            record.ruleid = item->ruleid;
+            sinkwrite(sink, &record, sizeof(record));
+            continue;
+        }
+
+        if ((p = sinkreserve(sink, room)) == NULL)
+            break;
+        switch (format) {
+            case SCHED_JSONL:
+            case SCHED_JSON:
+                memcpy(p, "{\"caseid\":\"", 11);
+                p = putjson(p + 11, caseid);
+                memcpy(p, "\",\"eventid\":", 12);
+                p = putint(p + 12, item->eventid);
+                memcpy(p, ",\"jdn\":", 7);
+                p = putint(p + 7, item->jdn);
+                memcpy(p, ",\"flags\":", 9);
+                p = putint(p + 9, item->flags);
+                memcpy(p, ",\"ruleid\":", 10);
+                p = putint(p + 10, item->ruleid);
+                *p++ = '}';
+                break;
+            case SCHED_CSV:
+                p = putcsv(p, caseid);
+                *p++ = ',';
+                *p++ = '"';
+                p = putint(p, item->eventid);
+                memcpy(p, "\",\"", 3);
+                p = putint(p + 3, item->jdn);
+                memcpy(p, "\",\"", 3);
+                p = putint(p + 3, item->flags);
+                memcpy(p, "\",\"", 3);
+                p = putint(p + 3, item->ruleid);
+                *p++ = '"';
+                break;
+            default: /* SCHED_TEXT */
+                jdn2greg(item->jdn, &date);
+                memcpy(p, caseid, caseidlen);
+                p += caseidlen;
+                *p++ = ' ';
+                *p++ = ' ';
+                *p++ = '0' + date.month / 10;
+                *p++ = '0' + date.month % 10;
+                *p++ = '/';
+                *p++ = '0' + date.day / 10;
+                *p++ = '0' + date.day % 10;
+                *p++ = '/';
+                p = putint(p, date.year);
+                *p++ = ' ';
+                *p++ = ' ';
+                len = strnlen(item->event->eventitle,
+                              sizeof(item->event->eventitle));
+                memcpy(p, item->event->eventitle, len);
+                p += len;
+                break;
+        }
+        if (format != SCHED_JSON)
+            *p++ = '\n';
+        else if (index < numevents - 1)
+            *p++ = ',';
+        sinkcommit(sink, p);
+    }
+    if (format == SCHED_JSON)
+        sinkwrite(sink, "]", 1);
+    METRIC_STOP(MP_WRITESCHEDULE, start);
+    return sink->error;
+}		/* -----  end of function writeschedule  ----- */
+
 /* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
 
+/*
+ * Description:  Sets up a sink and its buffer.
+ * Parameters:  The sink, its type, where it writes, and whether it closes
+ * the file when it is closed.
+ * Returns:  OUT_OK, or OUT_ENOMEM.
+ */
+
+static int opensink (struct OutputSink *sink, enum SINKTYPE type, int fd,
+                     int ownsfd)
+{
+    memset(sink, 0, sizeof(*sink));
+    sink->type = type;
+    sink->fd = fd;
+    if (type == SINK_BATCHED) {
+        sink->blocks = countedmalloc(OUT_NUMBLOCKS * OUT_BLOCKSIZE);
+        sink->buffer = sink->blocks;
+        sink->size = OUT_BLOCKSIZE;
+    } else {
+        sink->buffer = countedmalloc(OUTBUFSIZE);
+        sink->size = OUTBUFSIZE;
+    }
+    if (sink->buffer == NULL) {
+        sink->size = 0;
+        sink->fd = -1;
+        return sink->error = OUT_ENOMEM;
+    }
+    sink->ownsfd = ownsfd;
+    return OUT_OK;
+}		/* -----  end of function opensink  ----- */
+
+/*
+ * Description:  Makes room for len bytes at the end of the buffer.
+ *
+ * Parameters:  The sink and the number of bytes.
+ *
+ * Returns:  Where to put the bytes, or NULL if the sink has failed.
+ *
+ * Algorithm:  A file or standard output sink writes its buffer out.  A
+ * memory sink doubles its buffer until the bytes fit.  A batched sink moves
+ * on to its next block, and writes the whole batch only when it runs out of
+ * blocks.
+ */
+
+static char * makeroom (struct OutputSink *sink, size_t len)
+{
+    size_t newsize;
+    char *newbuffer;
+
+    if (sink->type == SINK_MEMORY) {
+        newsize = (sink->size > 0) ? sink->size : OUTBUFSIZE;
+        while (newsize - sink->used < len)
+            newsize *= 2;
+        newbuffer = countedrealloc(sink->buffer, newsize);
+        if (newbuffer == NULL) {
+            sink->error = OUT_ENOMEM;
+            return NULL;
+        }
+        sink->buffer = newbuffer;
+        sink->size = newsize;
+        return sink->buffer + sink->used;
+    }
+
+    if (len > sink->size) {
+        sink->error = OUT_ETOOBIG;
+        return NULL;
+    }
+    if (sink->type != SINK_BATCHED) {
+        if (sinkflush(sink) != OUT_OK)
+            return NULL;
+        return sink->buffer;
+    }
+
+    endsegment(sink);
+    if (sink->error == OUT_OK && sink->size - sink->used < len) {
+        if (sink->block + 1 < OUT_NUMBLOCKS) {
+            sink->block++;
+            sink->buffer = sink->blocks + sink->block * OUT_BLOCKSIZE;
+            sink->used = sink->segment = 0;
+        } else {
+            writebatch(sink);
+        }
+    }
+    return (sink->error == OUT_OK) ? sink->buffer + sink->used : NULL;
+}		/* -----  end of function makeroom  ----- */
+
+/*
+ * Description:  Adds the bytes filled in the current block since the last
+ * piece of the batch as a new piece, and writes the batch if that fills it.
+ *
+ * Notes:  A batch is written as soon as it is full, so there is always room
+ * for one more piece.
+ */
+
+static void endsegment (struct OutputSink *sink)
+{
+    if (sink->used == sink->segment)
+        return;
+    sink->iov[sink->numiov].iov_base = sink->buffer + sink->segment;
+    sink->iov[sink->numiov].iov_len = sink->used - sink->segment;
+    sink->numiov++;
+    sink->segment = sink->used;
+    if (sink->numiov == OUT_MAXIOV)
+        writebatch(sink);
+    return;
+}		/* -----  end of function endsegment  ----- */
+
+/*
+ * Description:  Writes all of the bytes, however many write(2) calls it
+ * takes.
+ * Returns:  OUT_OK, or OUT_EWRITE.
+ */
+
+static int writeall (struct OutputSink *sink, const char *data, size_t len)
+{
+    ssize_t written;
+
+    while (len > 0) {
+        written = write(sink->fd, data, len);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return writefailed(sink);
+        data += written;
+        len -= written;
+    }
+    return OUT_OK;
+}		/* -----  end of function writeall  ----- */
+
+/*
+ * Description:  Writes the pieces of a batch, however many writev(2) calls
+ * it takes, and starts the batch over in the first block.
+ *
+ * Returns:  OUT_OK, or OUT_EWRITE.
+ *
+ * Notes:  The bytes filled in the current block are written too, even if
+ * they are not a piece yet, since the block is about to be reused.  There
+ * is always room for them (see endsegment()).
+ */
+
+static int writebatch (struct OutputSink *sink)
+{
+    struct iovec *iov = sink->iov;
+    int numiov;
+    ssize_t written;
+
+    if (sink->used > sink->segment) {
+        iov[sink->numiov].iov_base = sink->buffer + sink->segment;
+        iov[sink->numiov].iov_len = sink->used - sink->segment;
+        sink->numiov++;
+    }
+
+    numiov = sink->numiov;
+    while (numiov > 0) {
+        written = writev(sink->fd, iov, numiov);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return writefailed(sink);
+        while (numiov > 0 && (size_t) written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            numiov--;
+        }
+        if (numiov > 0) {
+            iov->iov_base = (char *) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    sink->numiov = 0;
+    sink->block = 0;
+    sink->buffer = sink->blocks;
+    sink->used = sink->segment = 0;
+    return OUT_OK;
+}		/* -----  end of function writebatch  ----- */
+
+/*
+ * Description:  Records and reports a failed write.
+ * Returns:  OUT_EWRITE.
+ */
+
+static int writefailed (struct OutputSink *sink)
+{
+    fprintf(stderr, "## ERROR ## Cannot write output: %s\n",
+            strerror(errno));
+    return sink->error = OUT_EWRITE;
+}		/* -----  end of function writefailed  ----- */
+
+/*
+ * Description:  Writes a number in decimal.
+ * Parameters:  Where to write it and the number.
+ * Returns:  The end of the number.
+ */
+
+static char * putint (char *p, long value)
+{
+    char digits[24];
+    unsigned long magnitude;
+    int count = 0;
+
+    magnitude = (value < 0) ? -(unsigned long)value : (unsigned long)value;
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0)
+        *p++ = '-';
+    while (count > 0)
+        *p++ = digits[--count];
+    return p;
+}		/* -----  end of function putint  ----- */
+
+/*
+ * Description:  Writes a string as the contents of a JSON string: quotes and
+ * backslashes are escaped, and control characters written as \u00XX.
+ * Parameters:  Where to write it and the string.
+ * Returns:  The end of what was written.
+ */
+
+static char * putjson (char *p, const char *text)
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned char c;
+
+    for (; (c = *text) != '\0'; text++) {
+        if (c == '"' || c == '\\') {
+            *p++ = '\\';
+            *p++ = c;
+        } else if (c < 0x20) {
+            memcpy(p, "\\u00", 4);
+            p[4] = hex[c >> 4];
+            p[5] = hex[c & 0xf];
+            p += 6;
+        } else {
+            *p++ = c;
+        }
+    }
+    return p;
+}		/* -----  end of function putjson  ----- */
+
+/*
+ * Description:  Writes a string as a quoted CSV field, with each quote in it
+ * doubled.
+ * Parameters:  Where to write it and the string.
+ * Returns:  The end of the field.
+ */
+
+static char * putcsv (char *p, const char *text)
+{
+    *p++ = '"';
+    for (; *text != '\0'; text++) {
+        if (*text == '"')
+            *p++ = '"';
+        *p++ = *text;
+    }
+    *p++ = '"';
+    return p;
+}		/* -----  end of function putcsv  ----- */
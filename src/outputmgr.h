@@ -0,0 +1,271 @@
+/*
+ * Filename: outputmgr.h
+ * Project: DocketMaster
+ *
+ * Description:  This module contains the functions that control output of
+ * data to data files, the terminal, or memory.  Every kind of output goes
+ * through an OutputSink, which collects it in a large buffer and hands it to
+ * the system a block at a time.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 09:54:05 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Open a sink with one of the sinkopen functions, write to it, and
+ * close it with sinkclose().  The backends are:
+ *     SINK_FILE     a file, written with write(2) when the buffer fills
+ *     SINK_STDOUT   standard output, the same way
+ *     SINK_MEMORY   a buffer that grows as needed and is never written out
+ *     SINK_BATCHED  a file or standard output, written with one writev(2)
+ *                   for up to OUT_NUMBLOCKS blocks, and able to send
+ *                   constant data (sinkref()) without copying it
+ *
+ * File Format: Computed schedules are written by writeschedule() in one of
+ * these formats, one record per event, with the fields case id, event id,
+ * date (JDN), flags, and rule id (see struct ScheduledEvent):
+ *     SCHED_TEXT    a line for a person: case, date, and event title
+ *     SCHED_JSONL   one JSON object per line
+ *     SCHED_CSV     one line of quoted fields, as in the rules files; the
+ *                   column names are SCHED_CSVHEADER
+ *     SCHED_BINARY  a struct ScheduleRecord, in the byte order of the host
+ *     SCHED_JSON    the objects of SCHED_JSONL as one JSON array, with no
+ *                   newline, to be part of a larger JSON document
+ *
+ * Restrictions: A sink belongs to one thread at a time.  Text written with
+ * printf() is not ordered with a sink on standard output until the sink is
+ * flushed.
+ *
+ * Error Handling: The functions return OUT_OK or a negative OUT_E code.  An
+ * error is sticky: once one occurs, later output is discarded and
+ * sinkclose() reports it.
+ *
+ * References:
+ * Notes:
+ */
+
+#ifndef _OUTPUTMGR_H_INCLUDED_
+#define _OUTPUTMGR_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include "eprocessor.h"
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define OUTBUFSIZE (256 * 1024) /* bytes buffered before a write */
+#define OUT_BLOCKSIZE (64 * 1024) /* size of each block of a batched sink */
+#define OUT_NUMBLOCKS 16 /* blocks a batched sink fills before writing */
+#define OUT_MAXIOV 64 /* most pieces a batched sink writes at once */
+
+#define SCHED_CASEIDLEN 32 /* width of the case id of a binary record */
+#define SCHED_CSVHEADER "\"caseid\",\"eventid\",\"jdn\",\"flags\",\"ruleid\"\n"
+
+/*------------------------------------------------------------------------------
+ *  Output error codes
+ *----------------------------------------------------------------------------*/
+#define OUT_OK 0
+#define OUT_EOPEN -1 /* file could not be created */
+#define OUT_EWRITE -2 /* output could not be written */
+#define OUT_ENOMEM -3 /* out of memory */
+#define OUT_ETOOBIG -4 /* more room asked of sinkreserve() than a block */
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+enum SINKTYPE {SINK_FILE, SINK_STDOUT, SINK_MEMORY, SINK_BATCHED};
+
+struct OutputSink {
+    enum SINKTYPE type;
+    int fd; /* where the output goes; -1 for SINK_MEMORY */
+    int ownsfd; /* nonzero if sinkclose() closes fd */
+    char *buffer; /* the block being filled */
+    size_t used; /* bytes in buffer */
+    size_t size; /* size of buffer */
+    size_t total; /* bytes written to the sink so far */
+    int error; /* OUT_OK, or the first error */
+
+    /* SINK_BATCHED only */
+    char *blocks; /* OUT_NUMBLOCKS blocks of OUT_BLOCKSIZE */
+    int block; /* number of the block being filled */
+    size_t segment; /* start of the bytes in buffer not yet in iov */
+    struct iovec iov[OUT_MAXIOV]; /* pieces waiting to be written */
+    int numiov;
+};
+
+enum SCHEDFORMAT {SCHED_TEXT, SCHED_JSONL, SCHED_CSV, SCHED_BINARY,
+                  SCHED_JSON};
+
+/* One event of a schedule as SCHED_BINARY writes it: 48 bytes, no padding.
+The case id is padded with nulls, and is not null terminated if it fills the
+field; a longer one is cut off. */
+struct ScheduleRecord {
+    char caseid[SCHED_CASEIDLEN];
+    int32_t eventid;
+    int32_t jdn;
+    uint32_t flags;
+    int32_t ruleid;
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Opens a sink that writes to a file, creating or emptying it.
+ * Parameters: The sink and the file name.
+ * Returns: OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkopenfile (struct OutputSink *sink, const char *filename);
+
+/*
+ * Description: Opens a sink that writes to standard output.
+ * Parameters: The sink.
+ * Returns: OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkopenstdout (struct OutputSink *sink);
+
+/*
+ * Description: Opens a sink that collects its output in memory.
+ *
+ * Parameters: The sink.
+ *
+ * Returns: OUT_OK, or a negative OUT_E code.
+ *
+ * Notes: The output is in sink->buffer (sink->used bytes) until
+ * sinkclose() or sinktakememory().
+ */
+
+int sinkopenmemory (struct OutputSink *sink);
+
+/*
+ * Description: Opens a batched sink.
+ * Parameters: The sink and the file name, or NULL for standard output.
+ * Returns: OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkopenbatched (struct OutputSink *sink, const char *filename);
+
+/*
+ * Description: Writes bytes to a sink.
+ * Parameters: The sink, the bytes, and how many.
+ * Returns: OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkwrite (struct OutputSink *sink, const void *data, size_t len);
+
+/*
+ * Description: Writes a string to a sink.
+ * Parameters: The sink and the string.
+ * Returns: OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkputs (struct OutputSink *sink, const char *text);
+
+/*
+ * Description: Writes formatted text to a sink, as printf() does.
+ * Parameters: The sink, the format, and its arguments.
+ * Returns: OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkprintf (struct OutputSink *sink, const char *format, ...);
+
+/*
+ * Description: Writes bytes that will not change or go away before the sink
+ * is closed, such as string constants or cached text.
+ *
+ * Parameters: The sink, the bytes, and how many.
+ *
+ * Returns: OUT_OK, or a negative OUT_E code.
+ *
+ * Notes: A batched sink sends the bytes from where they are; the other
+ * sinks copy them.
+ */
+
+int sinkref (struct OutputSink *sink, const void *data, size_t len);
+
+/*
+ * Description: Makes room to build output in place.
+ *
+ * Parameters: The sink and the most bytes that will be built.
+ *
+ * Returns: Where to build the output, or NULL if the sink has failed.
+ *
+ * Notes: Build the output at the pointer returned, then pass the end of it
+ * to sinkcommit().  Nothing else may be written to the sink in between.
+ */
+
+char *sinkreserve (struct OutputSink *sink, size_t len);
+
+/*
+ * Description: Adds output built in place to the sink.
+ * Parameters: The sink and the end of the output built.
+ * Returns: Nothing.
+ */
+
+void sinkcommit (struct OutputSink *sink, char *end);
+
+/*
+ * Description: Writes everything buffered in a sink.
+ * Parameters: The sink.
+ * Returns: OUT_OK, or a negative OUT_E code.
+ */
+
+int sinkflush (struct OutputSink *sink);
+
+/*
+ * Description: Takes the output of a memory sink.
+ *
+ * Parameters: The sink and where to put the number of bytes.
+ *
+ * Returns: The output, which the caller must free(), or NULL if the sink is
+ * not a memory sink.  The sink is left empty.
+ */
+
+char *sinktakememory (struct OutputSink *sink, size_t *len);
+
+/*
+ * Description: Empties a memory sink so it can be filled again, keeping its
+ * buffer.
+ * Parameters: The sink.
+ * Returns: Nothing.
+ */
+
+void sinkrewind (struct OutputSink *sink);
+
+/*
+ * Description: Writes a computed schedule of one case.
+ *
+ * Parameters: The sink, the format, the case id, and the schedule and number
+ * of events from computeschedule().
+ *
+ * Returns: OUT_OK, or a negative OUT_E code.
+ *
+ * Notes: Each record is built in place in the sink's buffer, so nothing is
+ * allocated.  A record must fit in a block of the sink, which limits the
+ * case id to a few thousand characters.
+ */
+
+int writeschedule (struct OutputSink *sink, enum SCHEDFORMAT format,
+                   const char *caseid, const struct ScheduledEvent *schedule,
+                   int numevents);
+
+/*
+ * Description: Writes everything buffered, closes the file (not standard
+ * output), and releases the buffers.
+ *
+ * Parameters: The sink.
+ *
+ * Returns: OUT_OK, or the first error of the sink.
+ */
+
+int sinkclose (struct OutputSink *sink);
+
+#endif	/* _OUTPUTMGR_H_INCLUDED_ */
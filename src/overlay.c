@@ -0,0 +1,371 @@
+/*
+ * Filename: overlay.c
+ * Project: DocketMaster
+ *
+ * Description: The overlay module layers a court's local rules over the
+ * court events of the base jurisdiction, resolving them into a compact view
+ * without copying the base graph.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:35:03 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Called by the lexical analyzer, which loads the layers, and by the
+ * rule builder, which builds THE view for the jurisdiction.
+ * File Format:
+ * Restrictions:
+ * Error Handling:
+ * References:
+ * Notes:
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdlib.h>
+#include <string.h>
+#include "overlay.h"
+#include "eprocessor.h"
+#include "arena.h"
+
+/* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ################ */
+
+#define FIRSTRULES 16 /* number of rules first allocated for a layer */
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static int addviewedges (struct RuleView *view, int *fill);
+    /* Resolves the triggers of the events in force into the view's edges */
+
+static int rulecmp (const void *rule1, const void *rule2);
+    /* qsort() comparison: by short title, then by order read */
+
+static int viewcmp (const void *key, const void *member);
+    /* bsearch() comparison: an event name against an event in the view */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description: Adds a rule to a local-rules layer.
+ *
+ * Parameters: The layer, the event the rule applies, and what to do with it.
+ *
+ * Returns: Zero if successful, -1 if memory could not be allocated.
+ */
+
+int addlocalrule(struct LocalRules *layer, const struct CourtEvent *event,
+                 enum LOCALACTION action)
+{
+    struct LocalRule *rules;
+    int newmax;
+
+    if (layer->numrules == layer->maxrules) {
+        newmax = (layer->maxrules > 0) ? layer->maxrules * 2 : FIRSTRULES;
+        rules = countedrealloc(layer->rules,
+                               newmax * sizeof(struct LocalRule));
+        if (rules == NULL)
+            return -1;
+        layer->rules = rules;
+        layer->maxrules = newmax;
+    }
+
+    layer->rules[layer->numrules].action = action;
+    layer->rules[layer->numrules].event = *event;
+    layer->numrules++;
+    return 0;
+}		/* -----  end of function addlocalrule  ----- */
+
+/*
+ * Description: Releases the memory held by a local-rules layer and empties
+ * it.
+ */
+
+void freelocalrules(struct LocalRules *layer)
+{
+    countedfree(layer->rules);
+    memset(layer, 0, sizeof(*layer));
+    return;
+}		/* -----  end of function freelocalrules  ----- */
+
+/*
+ * Description: Resolves a local-rules layer against a base event graph.
+ *
+ * Parameters: The view to build, the finalized base graph, and the layer.
+ *
+ * Returns: The number of rules skipped because they did not fit the base,
+ * or -1 if memory could not be allocated.
+ *
+ * Algorithm: The base event list is already sorted by short title.  The
+ * rules are sorted the same way, so one merge of the two gives the events in
+ * force, in order: an unchanged base event is kept by pointer, an added or
+ * overriding event is copied into the view, and a masked event is dropped.
+ * The triggers of the events in force are then resolved by binary search of
+ * the view, and the edges are stored grouped by trigger.  Building a view
+ * takes O(n + r log r + e log n) for n base events, r rules, and e
+ * dependencies, and the base is only read.
+ */
+
+int buildview(struct RuleView *view, const struct EventGraph *base,
+              const struct LocalRules *layer)
+{
+    const struct LocalRule **sorted = NULL; /* the rules by short title */
+    const struct LocalRule *rule;
+    struct CourtEventNode *node;
+    int numrules, numsorted, index, cmp;
+    int *fill = NULL; /* next free edge of each trigger */
+
+    memset(view, 0, sizeof(*view));
+    view->base = base;
+    numrules = (layer != NULL) ? layer->numrules : 0;
+
+    view->events = countedmalloc((base->listsize + numrules + 1) *
+                                 sizeof(struct CourtEvent *));
+    view->localevents = countedmalloc((numrules + 1) *
+                                      sizeof(struct CourtEvent));
+    sorted = countedmalloc((numrules + 1) * sizeof(struct LocalRule *));
+    if (view->events == NULL || view->localevents == NULL || sorted == NULL)
+        goto nomemory;
+
+    /* Sort the rules, keeping only the last rule for each event */
+    for (index = 0; index < numrules; index++)
+        sorted[index] = &layer->rules[index];
+    qsort(sorted, numrules, sizeof(struct LocalRule *), rulecmp);
+    numsorted = 0;
+    for (index = 0; index < numrules; index++) {
+        if (numsorted > 0 &&
+                eventcmp(sorted[numsorted - 1]->event.shorttitle,
+                         sorted[index]->event.shorttitle) == 0)
+            numsorted--;
+        sorted[numsorted++] = sorted[index];
+    }
+
+    /* Merge the base events with the rules */
+    node = base->eventlist;
+    index = 0;
+    while (node != NULL || index < numsorted) {
+        if (node == NULL)
+            cmp = 1;
+        else if (index == numsorted)
+            cmp = -1;
+        else
+            cmp = eventcmp(node->eventdata.shorttitle,
+                           sorted[index]->event.shorttitle);
+
+        if (cmp < 0) { /* no rule for this base event */
+            view->events[view->numevents++] = &node->eventdata;
+            node = node->nextevent;
+            continue;
+        }
+
+        rule = sorted[index++];
+        if (cmp > 0) { /* no base event for this rule */
+            if (rule->action == LOCAL_ADD || rule->action == LOCAL_DEFAULT) {
+                view->localevents[view->numlocal] = rule->event;
+                view->events[view->numevents++] =
+                    &view->localevents[view->numlocal++];
+            } else {
+                view->skipped++;
+            }
+            continue;
+        }
+
+        if (rule->action == LOCAL_ADD) {
+            view->skipped++;
+            view->events[view->numevents++] = &node->eventdata;
+        } else if (rule->action != LOCAL_MASK) {
+            view->localevents[view->numlocal] = rule->event;
+            view->events[view->numevents++] =
+                &view->localevents[view->numlocal++];
+        }
+        node = node->nextevent;
+    }
+    countedfree(sorted);
+    sorted = NULL;
+
+    view->firstedge = countedcalloc(view->numevents + 1, sizeof(int));
+    fill = countedmalloc((view->numevents + 1) * sizeof(int));
+    if (view->firstedge == NULL || fill == NULL)
+        goto nomemory;
+    if (addviewedges(view, fill) != 0)
+        goto nomemory;
+
+    countedfree(fill);
+    return view->skipped;
+
+nomemory:
+    countedfree(sorted);
+    countedfree(fill);
+    freeview(view);
+    return -1;
+}		/* -----  end of function buildview  ----- */
+
+/*
+ * Description: Finds an event in a view.
+ *
+ * Parameters: The view and the event's short title.
+ *
+ * Returns: The event's position in the view, or -1 if the event is not in
+ * force.
+ */
+
+int viewposition(const struct RuleView *view, const char *eventname)
+{
+    struct CourtEvent **found;
+
+    if (eventname == NULL || eventname[0] == '\0' || view->numevents == 0)
+        return -1;
+    found = bsearch(eventname, view->events, view->numevents,
+                    sizeof(struct CourtEvent *), viewcmp);
+    return (found != NULL) ? (int) (found - view->events) : -1;
+}		/* -----  end of function viewposition  ----- */
+
+/*
+ * Description: Releases the memory held by a view.  The base graph is not
+ * touched.
+ */
+
+void freeview(struct RuleView *view)
+{
+    countedfree(view->events);
+    countedfree(view->localevents);
+    countedfree(view->firstedge);
+    countedfree(view->edges);
+    memset(view, 0, sizeof(*view));
+    return;
+}		/* -----  end of function freeview  ----- */
+
+/*
+ * Description: Copies the events in force in a view into an EventGraph of
+ * their own.
+ *
+ * Parameters: The view, and the empty graph to build.
+ *
+ * Returns: The number of events, or -1 if memory could not be allocated.
+ *
+ * Algorithm: The view's events are already sorted by short title, so each
+ * node is appended to the list rather than inserted in order.
+ * finalizeeventgraph() then resolves the triggers by the same names
+ * buildview() resolved them by, so the graph has the view's edges.
+ */
+
+int viewgraph(const struct RuleView *view, struct EventGraph *graph)
+{
+    struct CourtEventNode **tail; /* where the next node goes */
+    struct CourtEventNode *node;
+    int posn;
+
+    init_eventgraph(graph, 0);
+    tail = &graph->eventlist;
+    for (posn = 0; posn < view->numevents; posn++) {
+        node = countedmalloc(sizeof(struct CourtEventNode));
+        if (node == NULL)
+            goto nomemory;
+        node->eventdata = *view->events[posn];
+        node->nextevent = NULL;
+        *tail = node;
+        tail = &node->nextevent;
+    }
+    if (finalizeeventgraph(graph) < 0)
+        goto nomemory;
+    return graph->listsize;
+
+nomemory:
+    freeeventgraph(graph);
+    return -1;
+}		/* -----  end of function viewgraph  ----- */
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description: Resolves the triggers of the events in force into the view's
+ * edges, grouped by trigger.
+ *
+ * Parameters: The view, whose events and zeroed firstedge array are set, and
+ * a scratch array of numevents + 1 ints.
+ *
+ * Returns: Zero if successful, -1 if memory could not be allocated.
+ *
+ * Algorithm: The first pass counts the edges of each trigger, which gives
+ * firstedge; the second pass fills them in.  A trigger that is masked, or
+ * not in force at all, leaves the event at the head of its own chain.
+ */
+
+static int addviewedges (struct RuleView *view, int *fill)
+{
+    struct CourtEvent *event;
+    int posn, trigger, pass, edge;
+
+    for (pass = 0; pass < 2; pass++) {
+        for (posn = 0; posn < view->numevents; posn++) {
+            event = view->events[posn];
+            trigger = viewposition(view, event->ntc_dependency1);
+            if (trigger >= 0 && trigger != posn) {
+                if (pass == 0) {
+                    view->firstedge[trigger + 1]++;
+                } else {
+                    edge = fill[trigger]++;
+                    view->edges[edge].triggered = posn;
+                    makedependency(&view->edges[edge].dependency, event,
+                                   event->ntcpd1);
+                }
+            }
+            trigger = viewposition(view, event->ntc_dependency2);
+            if (trigger >= 0 && trigger != posn) {
+                if (pass == 0) {
+                    view->firstedge[trigger + 1]++;
+                } else {
+                    edge = fill[trigger]++;
+                    view->edges[edge].triggered = posn;
+                    makedependency(&view->edges[edge].dependency, event,
+                                   event->ntcpd2);
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (posn = 0; posn < view->numevents; posn++)
+                view->firstedge[posn + 1] += view->firstedge[posn];
+            view->numedges = view->firstedge[view->numevents];
+            view->edges = countedmalloc((view->numedges + 1) *
+                                        sizeof(struct ViewEdge));
+            if (view->edges == NULL)
+                return -1;
+            memcpy(fill, view->firstedge, view->numevents * sizeof(int));
+        }
+    }
+    return 0;
+}		/* -----  end of function addviewedges  ----- */
+
+/*
+ * Description: qsort() comparison for the rules of a layer: by short title,
+ * then by the order they were read, so the last rule for an event sorts last.
+ */
+
+static int rulecmp (const void *rule1, const void *rule2)
+{
+    const struct LocalRule *r1 = *(const struct LocalRule * const *) rule1;
+    const struct LocalRule *r2 = *(const struct LocalRule * const *) rule2;
+    int cmp;
+
+    cmp = eventcmp(r1->event.shorttitle, r2->event.shorttitle);
+    if (cmp != 0)
+        return cmp;
+    return (r1 < r2) ? -1 : (r1 > r2);
+}		/* -----  end of function rulecmp  ----- */
+
+/*
+ * Description: bsearch() comparison for viewposition: an event name against
+ * an event in the view.
+ */
+
+static int viewcmp (const void *key, const void *member)
+{
+    const struct CourtEvent *event = *(struct CourtEvent * const *) member;
+
+    return eventcmp(key, event->shorttitle);
+}		/* -----  end of function viewcmp  ----- */
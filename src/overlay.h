@@ -0,0 +1,178 @@
+/*
+ * Filename: overlay.h
+ * Project: DocketMaster
+ *
+ * Description: The overlay module layers a court's local rules over the
+ * court events of the base jurisdiction.  A local-rules layer adds events,
+ * overrides base events, or masks them, each by short title.  The layer is
+ * resolved against the base EventGraph into a RuleView: a compact, sorted
+ * list of the events in force and the dependencies between them.  The base
+ * graph itself is never copied or changed, so any number of local courts
+ * can share one base graph.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:33:29 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: The lexical analyzer loads a local rules file into a LocalRules
+ * layer.  buildview() then resolves the layer against a finalized base
+ * EventGraph.  Building a view for each county only takes that county's
+ * layer; the base is read once.
+ *
+ * File Format: A local rules file has the same header lines and fields as
+ * the events file, except that the first line is "Court Local Rules File"
+ * and it may have an "Action" field: Add, Override, or Mask (only the first
+ * letter is checked).  A record with no action overrides the base event of
+ * the same name or, if there is none, adds a new event.
+ *
+ * Restrictions: A view points into its base graph.  It must be rebuilt
+ * whenever the base graph changes, and freed before the base is freed.
+ * Schedules are computed from an EventGraph, so a view that is to be
+ * computed from is copied into one with viewgraph().
+ *
+ * Error Handling: Records are checked by the lexical analyzer as they are
+ * read.  Rules that do not fit the base (adding an event that already exists,
+ * or overriding or masking one that does not) are skipped and counted by
+ * buildview().
+ *
+ * References:
+ * Notes:
+ */
+
+#ifndef _OVERLAY_H_INCLUDED_
+#define _OVERLAY_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include "graphmgr.h"
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+/* What a local rule does to the base event with the same short title. */
+enum LOCALACTION {
+    LOCAL_DEFAULT, /* override the base event, or add it if there is none */
+    LOCAL_ADD, /* add a new event */
+    LOCAL_OVERRIDE, /* replace the base event */
+    LOCAL_MASK /* remove the base event, and the dependencies on it */
+};
+
+struct LocalRule {
+    enum LOCALACTION action;
+    struct CourtEvent event; /* only the short title is used by LOCAL_MASK */
+};
+
+/* A local-rules layer, as read from a local rules file.  An all-zero
+LocalRules is an empty layer. */
+struct LocalRules {
+    struct LocalRule *rules; /* in the order they were read */
+    int numrules;
+    int maxrules; /* number of rules allocated */
+};
+
+/* A dependency in a view: the view position of the triggered event, and the
+dependency itself. */
+struct ViewEdge {
+    int triggered;
+    struct Dependency dependency;
+};
+
+/* The events in force once a layer is applied to a base graph. */
+struct RuleView {
+    const struct EventGraph *base; /* the graph the view was built over */
+    int numevents; /* number of events in force */
+    struct CourtEvent **events; /* the events in force, sorted by short
+                                   title; base events that are unchanged point
+                                   into the base graph */
+    struct CourtEvent *localevents; /* the view's own copies of the added and
+                                       overriding events */
+    int numlocal;
+    int *firstedge; /* the edges triggered by event i are edges[firstedge[i]]
+                       through edges[firstedge[i + 1] - 1]; numevents + 1
+                       entries */
+    struct ViewEdge *edges;
+    int numedges;
+    int skipped; /* number of rules that did not fit the base */
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Adds a rule to a local-rules layer.
+ *
+ * Parameters: The layer, the event the rule applies, and what to do with it.
+ *
+ * Returns: Zero if successful, -1 if memory could not be allocated.
+ */
+
+int addlocalrule(struct LocalRules *layer, const struct CourtEvent *event,
+                 enum LOCALACTION action);
+
+/*
+ * Description: Releases the memory held by a local-rules layer and empties
+ * it.
+ *
+ * Parameters: The layer.
+ *
+ * Returns: Nothing.
+ */
+
+void freelocalrules(struct LocalRules *layer);
+
+/*
+ * Description: Resolves a local-rules layer against a base event graph.
+ *
+ * Parameters: The view to build, the base graph, which must have been
+ * finalized, and the layer.  A NULL or empty layer gives a view of the base
+ * as it is.
+ *
+ * Returns: The number of rules skipped because they did not fit the base,
+ * or -1 if memory could not be allocated.
+ *
+ * Notes: If two rules name the same event, the later one wins.
+ */
+
+int buildview(struct RuleView *view, const struct EventGraph *base,
+              const struct LocalRules *layer);
+
+/*
+ * Description: Finds an event in a view.
+ *
+ * Parameters: The view and the event's short title.
+ *
+ * Returns: The event's position in the view, or -1 if the event is not in
+ * force.
+ */
+
+int viewposition(const struct RuleView *view, const char *eventname);
+
+/*
+ * Description: Releases the memory held by a view.  The base graph is not
+ * touched.
+ *
+ * Parameters: The view.
+ *
+ * Returns: Nothing.
+ */
+
+void freeview(struct RuleView *view);
+
+/*
+ * Description: Copies the events in force in a view into an EventGraph of
+ * their own, for the code that computes schedules from a graph.
+ *
+ * Parameters: The view, and the graph to build, which must be empty.
+ *
+ * Returns: The number of events, or -1 if memory could not be allocated.
+ * The graph does not point into the view or its base, so either may be
+ * freed once it is built.
+ */
+
+int viewgraph(const struct RuleView *view, struct EventGraph *graph);
+
+#endif	/* _OVERLAY_H_INCLUDED_ */
@@ -0,0 +1,360 @@
+/*
+ * Filename: promexport.c
+ * Project: DocketMaster
+ *
+ * Description: Writes the engine's metrics in the Prometheus text format.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:06:33 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: See promexport.h.
+ * File Format:
+ * Restrictions:
+ * Error Handling:
+ * References:
+ * Notes: The histograms of metrics.h have 16 buckets to each power of two;
+ * the exported ones are cut to one, which is plenty for alerting and keeps
+ * a scrape to a few hundred lines.
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "promexport.h"
+#include "metrics.h"
+#include "servermgr.h"
+#include "ruleset.h"
+#include "rulebuilder.h"
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* The thread writing the metrics to a file. */
+struct MetricsDump {
+    pthread_mutex_t lock; /* guards stop */
+    pthread_cond_t wake; /* signaled to stop */
+    pthread_t thread;
+    int running; /* nonzero while the thread runs */
+    int stop; /* set to ask the thread to finish */
+    char *filename; /* the file, and the temporary file beside it */
+    char *tempname;
+    int seconds; /* between dumps */
+};
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
+
+static struct MetricsDump dump = {.lock = PTHREAD_MUTEX_INITIALIZER,
+                                  .wake = PTHREAD_COND_INITIALIZER};
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static void putfamily (struct OutputSink *out, const char *name,
+                       const char *type, const char *help);
+    /* Writes the HELP and TYPE lines of a metric */
+
+static void puthistogram (struct OutputSink *out, const char *name,
+                          const char *labels, const struct ProbeStats *stats);
+    /* Writes the samples of a histogram */
+
+static void * dumpmetrics (void *arg);
+    /* The dump thread */
+
+static int writedump (void);
+    /* Writes the metrics to the dump file */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description:  Writes every metric in the Prometheus text format.
+ * Parameters:  The sink to write.
+ * Returns:  OUT_OK or a negative OUT_E code.
+ */
+
+int writeprometheus (struct OutputSink *out)
+{
+    struct ProbeStats stats;
+    struct AdmissionReport admission;
+    struct ServerLimits limits;
+    struct AllocStats allocs;
+    struct RuleSet *rules;
+    char labels[64];
+    int probe, called;
+
+    serverhistogram(&stats);
+    putfamily(out, "dm_requests_total", "counter",
+              "Requests answered on the server's socket.");
+    sinkprintf(out, "dm_requests_total %llu\n", stats.calls);
+    putfamily(out, "dm_request_duration_seconds", "histogram",
+              "Time taken to answer requests on the server's socket.");
+    puthistogram(out, "dm_request_duration_seconds", "", &stats);
+
+    serveradmission(&admission);
+    getserverlimits(&limits);
+    putfamily(out, "dm_requests_admitted_total", "counter",
+              "Schedule requests admitted under the inflight limit.");
+    sinkprintf(out, "dm_requests_admitted_total %lu\n", admission.admitted);
+    putfamily(out, "dm_requests_busy_total", "counter",
+              "Schedule requests turned away busy.");
+    sinkprintf(out, "dm_requests_busy_total %lu\n", admission.busy);
+    putfamily(out, "dm_clients_refused_total", "counter",
+              "Connections turned away over the client limit.");
+    sinkprintf(out, "dm_clients_refused_total %lu\n", admission.refused);
+    putfamily(out, "dm_clients", "gauge", "Clients connected to the socket.");
+    sinkprintf(out, "dm_clients %d\n", admission.clients);
+    putfamily(out, "dm_requests_inflight", "gauge",
+              "Schedules being computed.");
+    sinkprintf(out, "dm_requests_inflight %ld\n", admission.inflight);
+    putfamily(out, "dm_requests_inflight_limit", "gauge",
+              "Most schedules computed at once.");
+    sinkprintf(out, "dm_requests_inflight_limit %d\n", limits.maxinflight);
+
+    putfamily(out, "dm_deadlines_computed_total", "counter",
+              "Events scheduled, triggers included.");
+    sinkprintf(out, "dm_deadlines_computed_total %llu\n",
+               metriccount(MC_DEADLINES));
+    putfamily(out, "dm_parse_errors_total", "counter",
+              "Records that could not be read.");
+    sinkprintf(out, "dm_parse_errors_total{source=\"trigger\"} %llu\n"
+               "dm_parse_errors_total{source=\"rules\"} %llu\n",
+               metriccount(MC_TRIGGERERRORS), metriccount(MC_RULEERRORS));
+    putfamily(out, "dm_calendar_lookups_total", "counter",
+              "Court day counts answered from the materialized calendar "
+              "(hit) or day by day (miss).");
+    sinkprintf(out, "dm_calendar_lookups_total{result=\"hit\"} %llu\n"
+               "dm_calendar_lookups_total{result=\"miss\"} %llu\n",
+               metriccount(MC_RANKHITS), metriccount(MC_RANKMISSES));
+    putfamily(out, "dm_holiday_rule_lookups_total", "counter",
+              "Days outside the materialized calendar looked up in the "
+              "holiday rules.");
+    sinkprintf(out, "dm_holiday_rule_lookups_total %llu\n",
+               metriccount(MC_HOLIDAYMISSES));
+    putfamily(out, "dm_batch_queue_blocks", "gauge",
+              "Batch blocks waiting between pipeline stages.");
+    sinkprintf(out, "dm_batch_queue_blocks{queue=\"parsed\"} %ld\n"
+               "dm_batch_queue_blocks{queue=\"computed\"} %ld\n",
+               readgauge(MG_PARSEDBLOCKS), readgauge(MG_COMPUTEDBLOCKS));
+
+    allocstats(&allocs);
+    putfamily(out, "dm_heap_allocations_total", "counter",
+              "Counted heap allocations.");
+    sinkprintf(out, "dm_heap_allocations_total %lu\n", allocs.allocations);
+    putfamily(out, "dm_heap_bytes_total", "counter",
+              "Bytes asked for by counted heap allocations.");
+    sinkprintf(out, "dm_heap_bytes_total %llu\n", allocs.bytes);
+    putfamily(out, "dm_arena_bytes", "gauge",
+              "Bytes held by the arenas of live sessions.");
+    sinkprintf(out, "dm_arena_bytes %llu\n", allocs.arenabytes);
+
+    putfamily(out, "dm_build_phase_seconds", "gauge",
+              "Wall time of each phase of the last rules build.");
+    sinkprintf(out, "dm_build_phase_seconds{phase=\"holiday_file\"} %.6f\n"
+               "dm_build_phase_seconds{phase=\"calendar\"} %.6f\n"
+               "dm_build_phase_seconds{phase=\"events_file\"} %.6f\n"
+               "dm_build_phase_seconds{phase=\"event_graph\"} %.6f\n"
+               "dm_build_phase_seconds{phase=\"local_rules\"} %.6f\n"
+               "dm_build_phase_seconds{phase=\"total\"} %.6f\n",
+               buildtimings.holidayparse, buildtimings.calendarbuild,
+               buildtimings.eventparse, buildtimings.finalize,
+               buildtimings.localrules, buildtimings.total);
+    rules = pinruleset();
+    putfamily(out, "dm_rules_generation", "gauge",
+              "Generation of the rule set in use.");
+    sinkprintf(out, "dm_rules_generation %lu\n",
+               (rules != NULL) ? rules->generation : 0UL);
+    unpinruleset(rules);
+
+    /* A metric's samples must all follow its TYPE line, so the probes are
+     * gone over twice. */
+    called = 0;
+    for (probe = 0; probe < MP_NUMPROBES; probe++) {
+        probestats(probe, &stats);
+        if (stats.calls == 0)
+            continue;
+        if (!called++)
+            putfamily(out, "dm_probe_calls_total", "counter",
+                      "Calls to the engine's hot paths.");
+        sinkprintf(out, "dm_probe_calls_total{probe=\"%s\"} %llu\n",
+                   probename(probe), stats.calls);
+    }
+    if (called)
+        putfamily(out, "dm_probe_duration_seconds", "histogram",
+                  "Time taken by the calls timed.");
+    for (probe = 0; called && probe < MP_NUMPROBES; probe++) {
+        probestats(probe, &stats);
+        if (stats.calls == 0)
+            continue;
+        snprintf(labels, sizeof(labels), "probe=\"%s\"", probename(probe));
+        puthistogram(out, "dm_probe_duration_seconds", labels, &stats);
+    }
+    return out->error;
+}		/* -----  end of function writeprometheus  ----- */
+
+/*
+ * Description:  Starts a thread writing the metrics to a file every few
+ * seconds.
+ *
+ * Parameters:  The file, and the seconds between dumps.
+ *
+ * Returns:  PX_OK, or a negative PX_E code.
+ */
+
+int startmetricsdump (const char *filename, int seconds)
+{
+    size_t len;
+
+    if (dump.running)
+        return PX_ERUNNING;
+    len = strlen(filename);
+    dump.filename = malloc(2 * len + 6);
+    if (dump.filename == NULL)
+        return PX_ETHREAD;
+    dump.tempname = dump.filename + len + 1;
+    memcpy(dump.filename, filename, len + 1);
+    memcpy(dump.tempname, filename, len);
+    memcpy(dump.tempname + len, ".tmp", 5);
+    dump.seconds = (seconds > 0) ? seconds : PX_INTERVAL;
+    dump.stop = 0;
+    if (pthread_create(&dump.thread, NULL, dumpmetrics, NULL) != 0) {
+        free(dump.filename);
+        return PX_ETHREAD;
+    }
+    dump.running = 1;
+    return PX_OK;
+}		/* -----  end of function startmetricsdump  ----- */
+
+/*
+ * Description:  Asks the dump thread to write the metrics a last time and
+ * waits for it to finish.
+ */
+
+void stopmetricsdump (void)
+{
+    if (!dump.running)
+        return;
+    pthread_mutex_lock(&dump.lock);
+    dump.stop = 1;
+    pthread_cond_signal(&dump.wake);
+    pthread_mutex_unlock(&dump.lock);
+    pthread_join(dump.thread, NULL);
+    free(dump.filename);
+    dump.running = 0;
+    return;
+}		/* -----  end of function stopmetricsdump  ----- */
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description:  Writes the HELP and TYPE lines that come before a metric's
+ * samples.
+ */
+
+static void putfamily (struct OutputSink *out, const char *name,
+                       const char *type, const char *help)
+{
+    sinkprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    return;
+}		/* -----  end of function putfamily  ----- */
+
+/*
+ * Description:  Writes the bucket, sum, and count samples of a histogram.
+ *
+ * Parameters:  The sink, the name of the histogram, its labels (empty for
+ * none), and the counts to write.
+ *
+ * Algorithm:  The bucket for 2^bit ns counts every time of a histogram
+ * bucket below the one that 2^bit falls in, since those all hold shorter
+ * times.  Prometheus buckets are cumulative, so the count carries on from
+ * one to the next.
+ */
+
+static void puthistogram (struct OutputSink *out, const char *name,
+                          const char *labels, const struct ProbeStats *stats)
+{
+    const char *comma = (*labels != '\0') ? "," : "";
+    unsigned long long seen;
+    int bit, bucket, limit;
+
+    seen = 0;
+    bucket = 0;
+    for (bit = PX_FIRSTBIT; bit <= PX_LASTBIT; bit++) {
+        limit = latencybucket((uint64_t) 1 << bit);
+        for (; bucket < limit; bucket++)
+            seen += stats->counts[bucket];
+        sinkprintf(out, "%s_bucket{%s%sle=\"%.9g\"} %llu\n", name, labels,
+                   comma, (double) ((uint64_t) 1 << bit) / 1e9, seen);
+    }
+    sinkprintf(out, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels,
+               comma, stats->timed);
+    if (*labels != '\0') {
+        sinkprintf(out, "%s_sum{%s} %.9f\n%s_count{%s} %llu\n", name, labels,
+                   stats->totalns / 1e9, name, labels, stats->timed);
+    } else {
+        sinkprintf(out, "%s_sum %.9f\n%s_count %llu\n", name,
+                   stats->totalns / 1e9, name, stats->timed);
+    }
+    return;
+}		/* -----  end of function puthistogram  ----- */
+
+/*
+ * Description:  The dump thread: writes the metrics every dump.seconds
+ * until asked to stop, and once more as it stops.
+ */
+
+static void * dumpmetrics (void *arg)
+{
+    struct timespec until;
+    int stop;
+
+    (void) arg;
+    do {
+        writedump();
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += dump.seconds;
+        pthread_mutex_lock(&dump.lock);
+        while (!dump.stop &&
+               pthread_cond_timedwait(&dump.wake, &dump.lock, &until) !=
+               ETIMEDOUT)
+            ;
+        stop = dump.stop;
+        pthread_mutex_unlock(&dump.lock);
+    } while (!stop);
+    writedump();
+    return NULL;
+}		/* -----  end of function dumpmetrics  ----- */
+
+/*
+ * Description:  Writes the metrics to the temporary file and renames it
+ * over the dump file.
+ *
+ * Returns:  OUT_OK, or a negative OUT_E code if the file could not be
+ * written.
+ */
+
+static int writedump (void)
+{
+    struct OutputSink out;
+    int result;
+
+    if (sinkopenfile(&out, dump.tempname) != OUT_OK)
+        return out.error;
+    writeprometheus(&out);
+    result = sinkclose(&out);
+    if (result != OUT_OK || rename(dump.tempname, dump.filename) != 0) {
+        fprintf(stderr, "## ERROR ## Cannot write metrics to %s\n",
+                dump.filename);
+        remove(dump.tempname);
+        return (result != OUT_OK) ? result : OUT_EWRITE;
+    }
+    return OUT_OK;
+}		/* -----  end of function writedump  ----- */
@@ -0,0 +1,104 @@
+/*
+ * Filename: promexport.h
+ * Project: DocketMaster
+ *
+ * Description: The Prometheus exporter writes the engine's counters,
+ * gauges, and latency histograms in the Prometheus text exposition format,
+ * so they can be scraped without a client library.  The same text is
+ * answered to the server's 'P' request, to GET /metrics on the HTTP port,
+ * and written to a file every few seconds for the node exporter's textfile
+ * collector.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:06:33 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: writeprometheus() to a sink, or startmetricsdump() a file and
+ * stopmetricsdump() when done.
+ *
+ * File Format: Prometheus text exposition format 0.0.4.  Every metric is
+ * named dm_something; times are in seconds.  The histograms have a bucket
+ * for each power of two nanoseconds from 2^PX_FIRSTBIT to 2^PX_LASTBIT.
+ *     dm_requests_total, dm_request_duration_seconds  socket requests
+ *     dm_requests_busy_total, dm_clients_refused_total,
+ *     dm_clients, dm_requests_inflight       admission (see servermgr.h)
+ *     dm_deadlines_computed_total            events scheduled
+ *     dm_parse_errors_total{source=}         bad trigger and rules records
+ *     dm_calendar_lookups_total{result=}     hits and misses of the
+ *                                            materialized calendar
+ *     dm_holiday_rule_lookups_total          days outside it
+ *     dm_batch_queue_blocks{queue=}          batch pipeline depth
+ *     dm_heap_allocations_total, dm_heap_bytes_total, dm_arena_bytes
+ *     dm_build_phase_seconds{phase=}         the last buildre()
+ *     dm_rules_generation                    rule set in use
+ *     dm_probe_calls_total{probe=}, dm_probe_duration_seconds{probe=}
+ *                                            hot paths (see metrics.h)
+ *
+ * Restrictions: The probes are reported only if the engine was built with
+ * DM_METRICS.
+ *
+ * Error Handling: startmetricsdump() returns PX_OK or a negative PX_E code.
+ * A dump that cannot be written is tried again at the next interval.
+ *
+ * References: Prometheus, "Exposition formats".
+ * Notes: A dump is written to a temporary file beside the named one and
+ * renamed over it, so a reader never sees half of one.
+ */
+
+#ifndef _PROMEXPORT_H_INCLUDED_
+#define _PROMEXPORT_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include "outputmgr.h"
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define PX_INTERVAL 15 /* default: seconds between dumps */
+#define PX_FIRSTBIT 8 /* smallest histogram bucket: 2^8 ns, 256 ns */
+#define PX_LASTBIT 36 /* largest: 2^36 ns, about 69 s */
+#define PX_CONTENTTYPE "text/plain; version=0.0.4"
+
+/*------------------------------------------------------------------------------
+ *  Prometheus exporter error codes
+ *----------------------------------------------------------------------------*/
+#define PX_OK 0
+#define PX_ETHREAD -1 /* the dump thread could not be started */
+#define PX_ERUNNING -2 /* a dump is already running */
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Writes every metric in the Prometheus text format.
+ * Parameters: The sink to write.
+ * Returns: OUT_OK or a negative OUT_E code, as the sink does.
+ */
+
+int writeprometheus (struct OutputSink *out);
+
+/*
+ * Description: Starts writing the metrics to a file every few seconds.
+ *
+ * Parameters: The file, and the seconds between dumps (0 or less for
+ * PX_INTERVAL).
+ *
+ * Returns: PX_OK, or a negative PX_E code.
+ */
+
+int startmetricsdump (const char *filename, int seconds);
+
+/*
+ * Description: Writes the metrics a last time and stops dumping them.
+ * Parameters: None.
+ * Returns: Nothing.
+ */
+
+void stopmetricsdump (void);
+
+#endif	/* _PROMEXPORT_H_INCLUDED_ */
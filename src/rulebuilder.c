@@ -7,7 +7,7 @@
  *
  * Version: 1.0.20
  * Created: Created: 08/18/2011
- * Last Modified: Sat Dec 19 00:01:16 2020
+ * Last Modified: Mon Oct 19 10:33:29 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -28,9 +28,24 @@
 #include "graphmgr.h"
 #include "eprocessor.h"
 #include "lexicalanalyzer.h"
+#include "rulereload.h"
+#include "arena.h"
+#include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* The holiday half of buildre(), run on its own thread. */
+struct HolidayPhase {
+    char *filename; /* the holiday file */
+    int result; /* 0 if the file was read, -1 if not */
+    double parsetime; /* seconds spent reading the file */
+    double calendartime; /* seconds spent building the calendar */
+};
 
 /* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
 
@@ -39,6 +54,62 @@ struct EventGraph jurisdevents; /* !VARIABLE DEFINITION! This is THE instance
                                  * jurisdiction's list of events.
                                  */ 
 
+struct CourtCalendar jurisdcalendar; /* !VARIABLE DEFINITION! This is THE
+                                      * materialized holiday calendar for the
+                                      * jurisdiction, built from the
+                                      * holidayhashtable.
+                                      */
+
+struct LocalRules jurisdlocalrules; /* !VARIABLE DEFINITION! The local rules
+                                     * read from the extras file.
+                                     */
+
+struct RuleView jurisdview; /* !VARIABLE DEFINITION! THE events in force for
+                             * the court: jurisdevents with jurisdlocalrules
+                             * applied.
+                             */
+
+struct EventGraph jurisdinforce; /* !VARIABLE DEFINITION! jurisdview copied
+                                  * into a graph of its own, which schedules
+                                  * are computed from; empty unless there are
+                                  * local rules.
+                                  */
+
+struct BuildTimings buildtimings; /* !VARIABLE DEFINITION! The time spent in
+                                   * each phase of the last buildre().
+                                   */
+
+static int localinforce; /* nonzero if jurisdinforce holds the events in
+                            force */
+static int wantphases; /* nonzero if buildre() is to time its finer phases */
+static int timingphases; /* nonzero while it does */
+static pthread_mutex_t phaselock = PTHREAD_MUTEX_INITIALIZER;
+    /* guards buildtimings.phases while the two halves of buildre() run */
+
+/* Names of the finer phases, in the order of enum BUILDPHASE. */
+static const char *phasenames[BP_NUMPHASES] = {
+    "getfile", "checkfile", "tokenize", "insert", "adjacency", "calendar",
+    "localview"};
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static void * holidayphase (void *arg);
+    /* Reads the holiday file and builds the calendar */
+
+static double elapsed (const struct timespec *start,
+                       const struct timespec *end);
+    /* Seconds between two clock readings */
+
+static void startphase (struct PhaseClock *clock);
+    /* Starts timing a phase, if phases are being timed */
+
+static void finishphase (int phase, struct PhaseClock *clock,
+                         unsigned long records);
+    /* Adds a phase's time to buildtimings, if phases are being timed */
+
+static FILE * timedgetfile (char *file_name);
+    /* getfile(), timed as BP_GETFILE */
+
 /* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
 
 /* 
@@ -52,40 +123,351 @@ struct EventGraph jurisdevents; /* !VARIABLE DEFINITION! This is THE instance
  * not be opened or found, -2 if the Events File could not be opened or found,
  * or -3 if the Extras File cound not be opened or found. 
  *
- * Algorithm:  
+ * Algorithm:  The holiday rules and calendar do not depend on the events
+ * (or the reverse) until dates are scheduled, so they are built at the same
+ * time: a second thread reads the holiday file and materializes the
+ * calendar while this thread reads the events file and then the local rules
+ * in the extras file.  The two join before the event graph is finalized.
+ * The local rules are applied over the finished graph to give jurisdview,
+ * and, if there are any, jurisdinforce (see applylocalrules()).
+ * If the thread cannot be started, the holiday phase simply runs first.
+ * The time spent in each phase is saved in buildtimings, and if
+ * timebuildphases() has been called, so are the finer phases.
  * References:  
- * Notes:  
+ * Notes:  Bad records do not stop the build.  They are skipped, and every
+ * error found in the files is reported once the files have been read.
+ * The rules of an earlier build are freed first, so it must not be called
+ * while schedules are computed from them, nor over a rule pack or
+ * snapshot's.
  *
  */
 
 int buildre(char *holiday, char *events, char *extras)
 {
-    enum FILETYPE ftype; /* variable to store the type of file being read */
-    char fields[MAXNUMFIELDS][MAXFIELDLEN]; /* the list of field names */
-    extern FILE *HOLIDAY_FILE;
     extern FILE *EVENT_FILE;
-    
-    /* Build Holiday Rules */
-    HOLIDAY_FILE = getfile(holiday);  
-    initializelist(holidayhashtable);
-    parsefile(HOLIDAY_FILE, holiday, ftype, fields, holidayhashtable);
-	closefile(HOLIDAY_FILE); 
+    FILE *extrasfile; /* the local rules file */
+    struct HolidayPhase hphase; /* the holiday half of the build */
+    pthread_t hthread; /* thread running the holiday half */
+    int threaded; /* nonzero if hthread was started */
+    struct timespec start, phasestart, now;
+    struct PhaseClock clock; /* the start of a finer phase */
+    int result = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    memset(&buildtimings, 0, sizeof(buildtimings));
+    timingphases = wantphases;
+    clearerrors(); /* report only this build's errors */
+
+    /* Release the rules of an earlier build; watch rebuilds in place */
+    freeeventgraph(&jurisdevents);
+    closerules(holidayhashtable);
+    freecalendar(&jurisdcalendar);
+
+    /* Build Holiday Rules and the calendar */
+    hphase.filename = holiday;
+    threaded = (pthread_create(&hthread, NULL, holidayphase, &hphase) == 0);
+    if (!threaded)
+        holidayphase(&hphase);
 
     /*  Build the Court Events */
-    EVENT_FILE = getfile(events); /* open the events file */
-    checkfile(EVENT_FILE); /* check filetype, version, and row headers */
-    init_eventgraph(jurisdevents); /* initialize the directed network graph */ 
-    parseevents(EVENT_FILE); /* process the events */ 
+    clock_gettime(CLOCK_MONOTONIC, &phasestart);
+    EVENT_FILE = timedgetfile(events); /* open the events file */
+    startphase(&clock);
+    init_eventgraph(&jurisdevents, 0); /* initialize the directed network
+                                          graph */ 
+    finishphase(BP_ADJACENCY, &clock, 0);
+    if (parsefile(EVENT_FILE, events, &jurisdevents) < 0)
+        result = -2; /* process the events */ 
     closefile(EVENT_FILE);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    buildtimings.eventparse = elapsed(&phasestart, &now);
 
     /* Build the Other Rules: Local Rules, Local-Local Rules, Etc. */
-    /*  EXTRAS_FILE = getfile(extras); / open the extras file
-        temporary commented out while developing eventprocessor*/
+    clock_gettime(CLOCK_MONOTONIC, &phasestart);
+    freeview(&jurisdview);
+    freelocalrules(&jurisdlocalrules);
+    if (extras != NULL && *extras != '\0') {
+        extrasfile = timedgetfile(extras); /* open the extras file */
+        if (parsefile(extrasfile, extras, &jurisdlocalrules) < 0 &&
+                result == 0)
+            result = -3;
+        closefile(extrasfile);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    buildtimings.localrules = elapsed(&phasestart, &now);
+
+    if (threaded)
+        pthread_join(hthread, NULL);
+    if (hphase.result != 0)
+        result = -1;
+    buildtimings.holidayparse = hphase.parsetime;
+    buildtimings.calendarbuild = hphase.calendartime;
+
+    /* Number the events and resolve their dependencies */
+    clock_gettime(CLOCK_MONOTONIC, &phasestart);
+    startphase(&clock);
+    finalizeeventgraph(&jurisdevents);
+    finishphase(BP_ADJACENCY, &clock, jurisdevents.listsize);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    buildtimings.finalize = elapsed(&phasestart, &now);
+
+    /* Apply the local rules over the jurisdiction's events */
+    phasestart = now;
+    startphase(&clock);
+    if (applylocalrules() < 0)
+        fprintf(stderr, "ERROR: Out of memory applying the local rules.\n");
+    finishphase(BP_LOCALVIEW, &clock, jurisdview.numevents);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    buildtimings.localrules += elapsed(&phasestart, &now);
+
+    /* Remember what the rules were built from, so they can be reloaded */
+    baselinerules(holiday, events);
+
+    if (errorcount() > 0)
+        reporterrors(stderr);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    buildtimings.total = elapsed(&start, &now);
+    timingphases = 0;
 
     printholidayrules(holidayhashtable);
+    return result;
+}
+
+
+/* 
+ * Name:  applylocalrules
+ *
+ * Description:  Applies the local rules over THE events again.
+ *
+ * Parameters:  None.
+ *
+ * Returns:  Zero, or -1 if memory could not be allocated.
+ *
+ * Algorithm:  jurisdview is rebuilt over jurisdevents.  Schedules are
+ * computed from an EventGraph, so if there are local rules the view is also
+ * copied into jurisdinforce; without them, jurisdevents is already the
+ * events in force and nothing is copied.
+ */
+
+int applylocalrules (void)
+{
+    localinforce = 0;
+    freeview(&jurisdview);
+    freeeventgraph(&jurisdinforce);
+    if (buildview(&jurisdview, &jurisdevents, &jurisdlocalrules) < 0)
+        return -1;
+    if (jurisdlocalrules.numrules > 0) {
+        if (viewgraph(&jurisdview, &jurisdinforce) < 0)
+            return -1;
+        localinforce = 1;
+    }
     return 0;
 }
 
+
+/* 
+ * Name:  eventsinforce
+ *
+ * Description:  Gives THE events to compute schedules from.
+ *
+ * Parameters:  None.
+ *
+ * Returns:  jurisdinforce if there are local rules in force, or else
+ * jurisdevents.
+ */
+
+struct EventGraph * eventsinforce (void)
+{
+    return localinforce ? &jurisdinforce : &jurisdevents;
+}
+
+
+/* 
+ * Name:  printbuildtimings
+ *
+ * Description:  Prints the time spent in each phase of the last buildre().
+ *
+ * Parameters:  The stream to print to.
+ *
+ * Returns:  Nothing.
+ *
+ * Notes:  The holiday phases run alongside the event phase, so the total can
+ * be less than the sum of the phases.  The finer phases are printed if
+ * timebuildphases() was called; they are added up over both threads.
+ */
+
+void printbuildtimings (FILE *out)
+{
+    const struct PhaseStats *stats;
+    int phase;
+
+    fprintf(out, "Build timings (ms):\n");
+    fprintf(out, "  holiday file     %10.3f\n", buildtimings.holidayparse * 1e3);
+    fprintf(out, "  calendar         %10.3f\n", buildtimings.calendarbuild * 1e3);
+    fprintf(out, "  events file      %10.3f\n", buildtimings.eventparse * 1e3);
+    fprintf(out, "  event graph      %10.3f\n", buildtimings.finalize * 1e3);
+    fprintf(out, "  local rules      %10.3f\n", buildtimings.localrules * 1e3);
+    fprintf(out, "  total            %10.3f\n", buildtimings.total * 1e3);
+    if (!wantphases)
+        return;
+
+    fprintf(out, "Build phases:       wall ms     cpu ms        bytes"
+            "    records     allocs\n");
+    for (phase = 0; phase < BP_NUMPHASES; phase++) {
+        stats = &buildtimings.phases[phase];
+        fprintf(out, "  %-12s %10.3f %10.3f %12llu %10lu %10lu\n",
+                phasenames[phase], stats->wall * 1e3, stats->cpu * 1e3,
+                stats->bytes, stats->records, stats->allocations);
+    }
+    return;
+}		/* -----  end of function printbuildtimings  ----- */
+
+/*
+ * Name:  printbuildtimingsjson
+ *
+ * Description:  Prints the timings of the last buildre() as one JSON
+ * object, for tracking them from one build to the next.
+ *
+ * Parameters:  The stream to print to.
+ *
+ * Returns:  Nothing.
+ *
+ * File Format:  Times are in seconds.
+ *     {"total_s": ..., "holiday_file_s": ..., "calendar_s": ...,
+ *      "events_file_s": ..., "event_graph_s": ..., "local_rules_s": ...,
+ *      "phases": {"getfile": {"wall_s": ..., "cpu_s": ..., "bytes": ...,
+ *                             "records": ..., "allocations": ...}, ...}}
+ * The phases are left out unless timebuildphases() was called.
+ */
+
+void printbuildtimingsjson (FILE *out)
+{
+    const struct PhaseStats *stats;
+    int phase;
+
+    fprintf(out, "{\"total_s\":%.6f,\"holiday_file_s\":%.6f,"
+            "\"calendar_s\":%.6f,\"events_file_s\":%.6f,"
+            "\"event_graph_s\":%.6f,\"local_rules_s\":%.6f",
+            buildtimings.total, buildtimings.holidayparse,
+            buildtimings.calendarbuild, buildtimings.eventparse,
+            buildtimings.finalize, buildtimings.localrules);
+    if (wantphases) {
+        fprintf(out, ",\"phases\":{");
+        for (phase = 0; phase < BP_NUMPHASES; phase++) {
+            stats = &buildtimings.phases[phase];
+            fprintf(out, "%s\"%s\":{\"wall_s\":%.6f,\"cpu_s\":%.6f,"
+                    "\"bytes\":%llu,\"records\":%lu,\"allocations\":%lu}",
+                    (phase > 0) ? "," : "", phasenames[phase], stats->wall,
+                    stats->cpu, stats->bytes, stats->records,
+                    stats->allocations);
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "}\n");
+    return;
+}		/* -----  end of function printbuildtimingsjson  ----- */
+
+/*
+ * Name:  timebuildphases
+ *
+ * Description:  Asks buildre() to time its finer phases as well.
+ *
+ * Parameters:  Nonzero to time them, zero not to.
+ *
+ * Returns:  Nothing.
+ */
+
+void timebuildphases (int on)
+{
+    wantphases = on;
+    return;
+}		/* -----  end of function timebuildphases  ----- */
+
+/*
+ * Name:  timingbuildphases
+ *
+ * Description:  Tells whether buildre() is timing its finer phases right
+ * now; parsefile() asks, to time the phases of each record.
+ *
+ * Returns:  Nonzero if it is.
+ */
+
+int timingbuildphases (void)
+{
+    return timingphases;
+}		/* -----  end of function timingbuildphases  ----- */
+
+/*
+ * Name:  readphaseclock
+ *
+ * Description:  Reads the wall clock, the calling thread's CPU clock, and
+ * its count of allocations.
+ *
+ * Parameters:  The PhaseClock to fill in.
+ *
+ * Returns:  Nothing.
+ */
+
+void readphaseclock (struct PhaseClock *clock)
+{
+    clock_gettime(CLOCK_MONOTONIC, &clock->wall);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &clock->cpu);
+    clock->allocations = threadallocations();
+    return;
+}		/* -----  end of function readphaseclock  ----- */
+
+/*
+ * Name:  endphase
+ *
+ * Description:  Adds the time and allocations since a clock reading to a
+ * phase's stats, and reads the clocks again.
+ *
+ * Parameters:  The phase's stats, and the reading it began at, which is
+ * replaced by the time it ended.
+ *
+ * Returns:  Nothing.
+ *
+ * Notes:  Since one phase ends as the next begins, timing a run of phases
+ * takes one reading per phase.
+ */
+
+void endphase (struct PhaseStats *stats, struct PhaseClock *clock)
+{
+    struct PhaseClock now;
+
+    readphaseclock(&now);
+    stats->wall += elapsed(&clock->wall, &now.wall);
+    stats->cpu += elapsed(&clock->cpu, &now.cpu);
+    stats->allocations += now.allocations - clock->allocations;
+    *clock = now;
+    return;
+}		/* -----  end of function endphase  ----- */
+
+/*
+ * Name:  addphase
+ *
+ * Description:  Adds a thread's stats of a phase to buildtimings.
+ *
+ * Parameters:  The phase, and its stats.
+ *
+ * Returns:  Nothing.
+ */
+
+void addphase (int phase, const struct PhaseStats *stats)
+{
+    struct PhaseStats *total = &buildtimings.phases[phase];
+
+    pthread_mutex_lock(&phaselock);
+    total->wall += stats->wall;
+    total->cpu += stats->cpu;
+    total->bytes += stats->bytes;
+    total->records += stats->records;
+    total->allocations += stats->allocations;
+    pthread_mutex_unlock(&phaselock);
+    return;
+}		/* -----  end of function addphase  ----- */
+
 /*
  * Name: getfile
  *
@@ -114,87 +496,82 @@ FILE * getfile(char *file_name)
  *
  * Description:  Verifies the name and version of an opened file.
  *
- * Parameters:  File handle, name of the file, and char * which the field
- * names will be copied into.
+ * Parameters:  File handle, name of the file, the array which the field
+ * names will be copied into, and a pointer to the number of field names.
  *
  * Returns:  Returns an enum FILETYPE, which is an integer whose value is
  * 0 if the file is a holiday rules file, 1 if the file is an events file,
- * and a 2 if the file is a local rules file.
+ * and a 2 if the file is a local rules file.  BAD_FILE is returned if the
+ * file is empty, is not a rules file, or is the wrong version; the reason is
+ * recorded in the error log.
  *
- * Algorithm:  
+ * Algorithm:  The first line holds the file name and version, separated by a
+ * field delimiter (and followed by empty fields).  The second line holds the
+ * field names.  On return the file is positioned on the first record.
  * References:  
  * Notes:  
  */
 
 enum FILETYPE checkfile (FILE *in_file, const char *filename,
-                         char *fields[MAXNUMFIELDS][])
+                         char fields[][MAXFIELDLEN], int *numfields)
 {
     char headers[MAXRECORDLENGTH]; /* buffer to read the file headers */
     char *name = NULL; /* pointer to file name */
     char *vers = NULL; /* pointer to file version */
+    enum FILETYPE ftype; /* the type of file */
     int index = 0; /* loop counter */
 
+    *numfields = 0;
+    seterrorcontext(filename, 1);
+
     /* read first line of file */
-    fgets(headers, sizeof(headers), in_file); /* get the first line */
-    if (headers == NULL)    /* if there is no line, the file is empty,
-                                    return an error */
-    {
-        printf("ERROR: %s is EMPTY\n", filename);
-        exit(8);
-    } else
+    if (fgets(headers, sizeof(headers), in_file) == NULL)
+    {   /* if there is no line, the file is empty, return an error */
+        recorderror(EMPTYFILE, 0);
+        return BAD_FILE;
+    }
+    headers[strcspn(headers, "\r\n")] = '\0';
+
+    name = &headers[0];
+    for (index = 1; headers[index] != '\0'; index++)
     {
-        name = &headers[0];
-        index = 1;
-        while (headers[index] != '\n')
+        if (headers[index] == FDELIMITER)
         {
-            if (headers[index] == FIELDDELIM)
-            {
-                headers[index] = '\0'; /* file is CSV, to covert field delimiter
-                                          to end of string character */
-                if (vers == NULL)
-                {
-                    vers = &headers[index+1];
-                    /* printf("## DEBUG ## Version = %s\n",vers); */
-                }
-            }
-            index++; /* increase the index */
-            if ((headers[index] == FIELDDELIM) &&
-                    (headers[index+1] == FIELDDELIM))
-                headers[index] = '\0';
-        }
-        /* printf("## DEBUG ## Version = %s\n",vers); */
-        if(strcmp(name, "Court Holiday Rules File") == 0) {
-		xxx;
-	} else if (strcmp(name, "Court Events File") == 0) {
-		asdfasdf
-	}
-	} else {
-            printf("ERROR: This is not a rules file: %s.\n", filename);
-            exit(8);
+            headers[index] = '\0'; /* file is CSV, to covert field delimiter
+                                      to end of string character */
+            if (vers == NULL)
+                vers = &headers[index+1];
         }
+    }
 
-        if(strcmp(vers, "V1.0") != 0)
-        {
-            printf("ERROR: This is not the correct version"
-            	   " of the court rules file: %s.\n", filename);
-            exit(8);
-        }
+    if (strcmp(name, "Court Holiday Rules File") == 0) {
+        ftype = H_FILE;
+    } else if (strcmp(name, "Court Events File") == 0) {
+        ftype = E_FILE;
+    } else if (strcmp(name, "Court Local Rules File") == 0) {
+        ftype = LOCAL_RUL_FILE;
+    } else {
+        recorderror(BADFILE, 1);
+        return BAD_FILE;
     }
 
-    /*  Get the field names and store them in the fields array of strings */
+    if (vers == NULL || strcmp(vers, "V1.0") != 0)
+    {
+        recorderror(BADVERSION, (vers == NULL) ? 0 : (int) (vers - headers) + 1);
+        return BAD_FILE;
+    }
 
-    fgets(headers, sizeof(headers), in_file); /* gets the next line of the file
-            which should contain the CSV field names. */
-    
-    strcpy(fields[index], ftotok(headers, FIELDDELIM, TDELIM));
-    index++;
+    /*  Get the field names and store them in the fields array of strings */
 
-    while(headers) { /* When headers = NULL then loop terminates */
-        strcpy(fields[index], ftotok('\0', FIELDDELIM, TDELIM));
-        index++;
+    seterrorcontext(filename, 2);
+    if (fgets(headers, sizeof(headers), in_file) == NULL ||
+            (*numfields = parsefieldnames(headers, fields)) == 0)
+    {   /* the next line should contain the CSV field names. */
+        recorderror(BADFILE, 0);
+        return BAD_FILE;
     }
 
-    return 0;
+    return ftype;
 }
 
 /*
@@ -202,18 +579,18 @@ enum FILETYPE checkfile (FILE *in_file, const char *filename,
  *
  * Description: Closes a file.
  *
- * Parameters: File handle (pointer to the file).
+ * Parameters: File handle (pointer to the file).  NULL is ignored, so a file
+ * that could not be opened can be passed.
  *
- * Returns: NULL pointer.
+ * Returns: Zero, or -1 if the file could not be closed.
  *                                                                           
  */
 
 int closefile(FILE *close_file)
 {
-    if( fclose(infile) == EOF ) { /* close input file   */
-    fprintf ( stderr, "Couldn't close file '%s'; %s\n",
-	    infile_file_name, strerror(errno) );
-    exit (EXIT_FAILURE);
+    if (close_file != NULL && fclose(close_file) == EOF) { /* close input file */
+        fprintf ( stderr, "Couldn't close file; %s\n", strerror(errno) );
+        return -1;
     }
     return 0;
 }		/* -----  end of function closefile  ----- */
@@ -237,6 +614,118 @@ void resetfile (FILE *infile)
 }		/* -----  end of function resetfile  ----- */
 
 
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/* 
+ * Name:  holidayphase
+ *
+ * Description:  Reads the holiday file into THE holiday hash table and
+ * builds the jurisdiction's calendar from it.
+ *
+ * Parameters:  A pointer to the HolidayPhase, which names the file and
+ * receives the result and timings.
+ *
+ * Returns:  NULL.
+ *
+ * Notes:  Runs on its own thread while buildre() reads the events file.  It
+ * touches only the holiday hash table and the calendar, which nothing else
+ * uses until the threads join.
+ */
+
+static void * holidayphase (void *arg)
+{
+    struct HolidayPhase *phase = arg;
+    struct timespec start, now;
+    struct PhaseClock clock;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    HOLIDAY_FILE = timedgetfile(phase->filename);
+    initializelist(holidayhashtable);
+    phase->result = (parsefile(HOLIDAY_FILE, phase->filename,
+                               holidayhashtable) < 0) ? -1 : 0;
+    closefile(HOLIDAY_FILE);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    phase->parsetime = elapsed(&start, &now);
+
+    start = now;
+    startphase(&clock);
+    buildcalendar(&jurisdcalendar, holidayhashtable, CAL_FIRSTYEAR,
+                  CAL_LASTYEAR);
+    materializecalendar(&jurisdcalendar);
+    finishphase(BP_CALENDAR, &clock, jurisdcalendar.numdays);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    phase->calendartime = elapsed(&start, &now);
+
+    return NULL;
+}		/* -----  end of function holidayphase  ----- */
+
+
+/* 
+ * Name:  elapsed
+ * Description:  Returns the seconds between two clock readings.
+ */
+
+static double elapsed (const struct timespec *start,
+                       const struct timespec *end)
+{
+    return (double) (end->tv_sec - start->tv_sec) +
+        (double) (end->tv_nsec - start->tv_nsec) / 1e9;
+}		/* -----  end of function elapsed  ----- */
+
+
+/*
+ * Name:  startphase
+ * Description:  Reads the clocks at the start of a phase, if buildre() is
+ * timing its phases.
+ */
+
+static void startphase (struct PhaseClock *clock)
+{
+    if (timingphases)
+        readphaseclock(clock);
+    return;
+}		/* -----  end of function startphase  ----- */
+
+
+/*
+ * Name:  finishphase
+ * Description:  Adds the time since startphase() to a phase of
+ * buildtimings, with the number of records, events, or days it handled, if
+ * buildre() is timing its phases.
+ */
+
+static void finishphase (int phase, struct PhaseClock *clock,
+                         unsigned long records)
+{
+    struct PhaseStats stats;
+
+    if (!timingphases)
+        return;
+    memset(&stats, 0, sizeof(stats));
+    endphase(&stats, clock);
+    stats.records = records;
+    addphase(phase, &stats);
+    return;
+}		/* -----  end of function finishphase  ----- */
+
+
+/*
+ * Name:  timedgetfile
+ * Description:  getfile(), with the time it takes added to BP_GETFILE.
+ */
+
+static FILE * timedgetfile (char *file_name)
+{
+    struct PhaseClock clock;
+    FILE *in_file;
+
+    startphase(&clock);
+    in_file = getfile(file_name);
+    finishphase(BP_GETFILE, &clock, 0);
+    return in_file;
+}		/* -----  end of function timedgetfile  ----- */
+
+
 #ifdef UNDEF
 #define UNDEF /* presently the remainder of source file has been removed from
                  compilation for testing. */
@@ -7,7 +7,7 @@
  *
  * Version: 1.0.20
  * Created: 01/29/2012 01:01:11 PM
- * Last Modified: Fri Dec 18 23:52:08 2020
+ * Last Modified: Mon Oct 19 10:33:29 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -30,12 +30,16 @@
  * HEADER FILE INCLUDES 
  *----------------------------------------------------------------------------*/
 #include "datetools.h"
+#include "courtcal.h"
+#include "lexicalanalyzer.h"
+#include "overlay.h"
 #include <stdio.h>
+#include <time.h>
 
 /*-----------------------------------------------------------------------------
  * EXPORTED SYMBOLIC CONSTANTS 
  *----------------------------------------------------------------------------*/
-enum FILETYPE {H_FILE, E_FILE, LOCAL_RUL_FILE};
+enum FILETYPE {H_FILE, E_FILE, LOCAL_RUL_FILE, BAD_FILE};
 
 /*-----------------------------------------------------------------------------
  * TYPE DEFINITIONS
@@ -54,6 +58,72 @@ struct HolidayNode *holidayhashtable[13];
           * EVERYWHERE.
           */
 
+extern struct EventGraph jurisdevents;
+    /* THE instance of the EventGraph for the jurisdiction; defined in
+     * rulebuilder.c. */
+
+extern struct CourtCalendar jurisdcalendar;
+    /* THE materialized holiday calendar for the jurisdiction; defined in
+     * rulebuilder.c. */
+
+/* The finer phases of buildre(), timed if timebuildphases() was called.
+The holiday and events files are read on two threads at once; each phase is
+added up over both. */
+enum BUILDPHASE {
+    BP_GETFILE, /* opening the rules files and reading their records */
+    BP_CHECKFILE, /* reading and checking the files' headers */
+    BP_TOKENIZE, /* splitting records into fields and converting them */
+    BP_INSERT, /* addholidayrule(), insertevent(), and addlocalrule() */
+    BP_ADJACENCY, /* initializing and filling the adjacency matrix */
+    BP_CALENDAR, /* building and materializing the calendar */
+    BP_LOCALVIEW, /* applying the local rules over the events */
+    BP_NUMPHASES
+};
+
+/* What one phase of buildre() took. */
+struct PhaseStats {
+    double wall; /* seconds */
+    double cpu; /* seconds of CPU time on the threads that ran it */
+    unsigned long long bytes; /* read from the rules files */
+    unsigned long records; /* records, events, or days handled */
+    unsigned long allocations; /* counted heap allocations (see arena.h) */
+};
+
+/* A reading of the clocks a phase is timed by. */
+struct PhaseClock {
+    struct timespec wall;
+    struct timespec cpu; /* the calling thread's CPU time */
+    unsigned long allocations; /* the calling thread's allocations */
+};
+
+/* Wall-clock seconds spent in each phase of buildre(). */
+struct BuildTimings {
+    double holidayparse; /* reading the holiday file */
+    double calendarbuild; /* building and materializing the calendar */
+    double eventparse; /* reading the events file */
+    double finalize; /* numbering events and resolving dependencies */
+    double localrules; /* reading and applying the local rules */
+    double total; /* all of buildre(); the holiday and event phases
+                     overlap, so this can be less than their sum */
+    struct PhaseStats phases[BP_NUMPHASES]; /* the finer phases; zero
+                                               unless timebuildphases() was
+                                               called */
+};
+
+extern struct LocalRules jurisdlocalrules;
+    /* The local rules read from the extras file; defined in rulebuilder.c. */
+
+extern struct RuleView jurisdview;
+    /* THE events in force for the court, with the local rules applied;
+     * defined in rulebuilder.c. */
+
+extern struct EventGraph jurisdinforce;
+    /* jurisdview copied into a graph to compute schedules from, if there are
+     * local rules; defined in rulebuilder.c.  Use eventsinforce(). */
+
+extern struct BuildTimings buildtimings;
+    /* The timings of the last buildre(); defined in rulebuilder.c. */
+
 /*-----------------------------------------------------------------------------
  * EXPORTED FUNCTION DECLARATIONS 
  *----------------------------------------------------------------------------*/
@@ -72,6 +142,26 @@ struct HolidayNode *holidayhashtable[13];
 
 int buildre(char *holiday, char *events, char *extras);
 
+/*
+ * Description: Applies the local rules over THE events again, after either
+ * has changed: rebuilds jurisdview and jurisdinforce.
+ * Parameters: None.
+ * Returns: Zero, or -1 if memory could not be allocated, in which case the
+ * local rules are not in force.
+ */
+
+int applylocalrules(void);
+
+/*
+ * Description: Gives THE events to compute schedules from, compile, or save:
+ * jurisdevents with the local rules applied.
+ * Parameters: None.
+ * Returns: jurisdinforce if there are local rules in force, or else
+ * jurisdevents itself.
+ */
+
+struct EventGraph * eventsinforce(void);
+
 /*
  * Description: Opens a file for reading.
  * Parameters: Character string representing the file name.
@@ -84,25 +174,88 @@ FILE * getfile(char *file_name);
 /* 
  * Description:  Verifies the name and version of an opened file.
  *
- * Parameters:  File handle, name of the file, and char * which the field names
- * will be copied into.
+ * Parameters:  File handle, name of the file, the array which the field names
+ * will be copied into, and a pointer to the number of field names.
  *
  * Returns:  Returns an enum FILETYPE, which is an integer whose value is 0 if
  * the file is a holiday rules file, 1 if the file is an events file, and a 2
- * if the file is a local rules file.
+ * if the file is a local rules file.  Returns BAD_FILE, and records the error,
+ * if the file cannot be used.
  */
 
-enum FILETYPE checkfile (FILE *in_file, const char *filename, char *fields);
+enum FILETYPE checkfile (FILE *in_file, const char *filename,
+                         char fields[][MAXFIELDLEN], int *numfields);
 
 
 /*
  * Description: Closes a file.
  * Parameters: File handle (pointer to the file).
- * Returns: NULL pointer.
+ * Returns: Zero, or -1 if the file could not be closed.
  */
 
 int closefile(FILE *close_file);
 
+
+/*
+ * Description: Prints the time spent in each phase of the last buildre().
+ * Parameters: The stream to print to.
+ * Returns: Nothing.
+ */
+
+void printbuildtimings(FILE *out);
+
+/*
+ * Description: Prints the timings of the last buildre() as a JSON object.
+ * Parameters: The stream to print to.
+ * Returns: Nothing.
+ */
+
+void printbuildtimingsjson(FILE *out);
+
+/*
+ * Description: Asks buildre() to time its finer phases (enum BUILDPHASE)
+ * as well.  It costs a few clock readings per record.
+ * Parameters: Nonzero to time them, zero not to.
+ * Returns: Nothing.
+ */
+
+void timebuildphases(int on);
+
+/*
+ * Description: Tells whether the finer phases of buildre() are being timed
+ * right now.
+ * Parameters: None.
+ * Returns: Nonzero if they are.
+ */
+
+int timingbuildphases(void);
+
+/*
+ * Description: Reads the clocks a phase is timed by.
+ * Parameters: The PhaseClock to fill in.
+ * Returns: Nothing.
+ */
+
+void readphaseclock(struct PhaseClock *clock);
+
+/*
+ * Description: Ends a phase: adds the time and allocations since a clock
+ * reading to a phase's stats, and reads the clocks again for the next
+ * phase.
+ * Parameters: The stats of the phase, and the reading it began at.
+ * Returns: Nothing.
+ */
+
+void endphase(struct PhaseStats *stats, struct PhaseClock *clock);
+
+/*
+ * Description: Adds a thread's stats of a phase to buildtimings.
+ * Parameters: The phase, and its stats.
+ * Returns: Nothing.
+ */
+
+void addphase(int phase, const struct PhaseStats *stats);
+
 /* 
  * Description:  returns the file pointer to the beginning of the file.
  * Parameters:  FILE *
@@ -0,0 +1,823 @@
+/*
+ * Filename: rulepack.c
+ * Project: DocketMaster
+ *
+ * Description: The rule pack module compiles a jurisdiction's holiday and
+ * event rules into a single binary file that can be mapped straight into
+ * memory and used in place, with no CSV parsing at startup.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:37:01 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: See rulepack.h.
+ * File Format: See rulepack.h.
+ * Restrictions:
+ *
+ * Error Handling: Functions return the negative RP_E codes.  A pack that is
+ * only partly written is never left under its final name: the pack is
+ * written to a temporary file which is renamed when complete.
+ *
+ * References:
+ * Notes:
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rulepack.h"
+#include "eprocessor.h"
+#include "arena.h"
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ########################### */
+
+#define PACKALIGN(x) (((x) + (RULEPACK_ALIGN-1)) & ~((uint64_t) RULEPACK_ALIGN-1))
+
+/* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ################ */
+
+#define STRHASHSIZE 1024 /* initial slots in the string dedupe table */
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* The string section under construction.  Identical strings (event names
+ * repeated as notice dependencies, categories, authorities) are stored once. */
+struct StringTable {
+    char *text; /* the section itself */
+    size_t len;
+    size_t cap;
+    uint32_t *slots; /* open-addressed hash of offsets + 1; 0 = empty */
+    size_t numslots;
+    size_t used;
+};
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static uint32_t addstring (struct StringTable *st, const char *s);
+static int comparenodes (const void *a, const void *b);
+static int writesection (FILE *out, const void *data, uint64_t size,
+                         uint64_t *posn);
+static int checksection (const struct RulePackHeader *hdr, size_t filesize,
+                         int section, size_t recsize);
+static int checkpackdata (const struct RulePack *pack);
+static void unpackevent (const struct RulePack *pack, int index,
+                         struct CourtEvent *event);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description: Compiles an event graph, a holiday hash table, and the
+ * calendar built from it into a rule pack file.
+ *
+ * Parameters: Name of the pack file to create, the event graph, the holiday
+ * hash table, and the materialized calendar.
+ *
+ * Returns: RP_OK if the pack was written, otherwise a negative RP_E code.
+ *
+ * Algorithm: (1) the event list is copied into an array sorted by
+ * shorttitle, which gives every event its pack index; (2) a map from
+ * adjacency matrix position to pack index is built; (3) each event's row of
+ * the matrix is flattened into the CSR edge arrays; (4) the holiday rules are
+ * copied out of the hash table; (5) the sections are written in order behind
+ * the header.
+ */
+
+int compilerulepack(const char *packname, struct EventGraph *graph,
+                    struct HolidayNode *holidays[],
+                    const struct CourtCalendar *cal)
+{
+    struct RulePackHeader hdr;
+    struct StringTable st;
+    struct CourtEventNode *node;
+    struct CourtEventNode **sorted = NULL; /* events in shorttitle order */
+    int *posnmap = NULL; /* matrix position -> pack index */
+    struct PackEvent *events = NULL;
+    uint32_t *rowstart = NULL;
+    struct PackEdge *edges = NULL;
+    struct HolidayRule *rules = NULL;
+    struct HolidayNode *hnode;
+    struct Dependency *dep;
+    char tmpname[FILENAME_MAX];
+    FILE *out = NULL;
+    int numevents, numedges, numrules, numposns;
+    int i, col, month;
+    uint64_t posn;
+    int result = RP_ENOMEM;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memset(&st, 0, sizeof(st));
+
+    /* Step 1. Sort the events by shorttitle. */
+    numevents = 0;
+    for (node = graph->eventlist; node != NULL; node = node->nextevent)
+        numevents++;
+    numposns = graph->dependencymatrix.triggeredby_cols;
+
+    sorted = malloc((numevents + 1) * sizeof(*sorted));
+    posnmap = malloc((numposns + 1) * sizeof(*posnmap));
+    events = calloc(numevents + 1, sizeof(*events));
+    rowstart = malloc((numevents + 1) * sizeof(*rowstart));
+    if (sorted == NULL || posnmap == NULL || events == NULL || rowstart == NULL)
+        goto cleanup;
+
+    i = 0;
+    for (node = graph->eventlist; node != NULL; node = node->nextevent)
+        sorted[i++] = node;
+    qsort(sorted, numevents, sizeof(*sorted), comparenodes);
+
+    /* Step 2. Map matrix positions to pack indices. */
+    for (i = 0; i < numposns; i++)
+        posnmap[i] = -1;
+    numedges = 0;
+    for (i = 0; i < numevents; i++) {
+        if (sorted[i]->eventposn >= 0 && sorted[i]->eventposn < numposns)
+            posnmap[sorted[i]->eventposn] = i;
+    }
+
+    /* Step 3. Copy the hot event fields and flatten the matrix rows. */
+    addstring(&st, ""); /* offset 0 is always the empty string */
+    for (i = 0; i < numevents; i++) {
+        struct CourtEvent *ev = &sorted[i]->eventdata;
+
+        events[i].shorttitle = addstring(&st, ev->shorttitle);
+        events[i].eventitle = addstring(&st, ev->eventitle);
+        events[i].ntc_dependency1 = addstring(&st, ev->ntc_dependency1);
+        events[i].ntc_dependency2 = addstring(&st, ev->ntc_dependency2);
+        events[i].eventcategory = addstring(&st, ev->eventcategory);
+        events[i].authority = addstring(&st, ev->authority);
+        events[i].description = addstring(&st, ev->description);
+        if (st.text == NULL)
+            goto cleanup;
+        events[i].eventflags = ev->eventflags;
+        events[i].countunits = ev->countunits;
+        events[i].ntcpd1 = ev->ntcpd1;
+        events[i].ntcpd2 = ev->ntcpd2;
+        events[i].late_early = ev->late_early;
+        events[i].customservicerule = ev->customservicerule;
+
+        rowstart[i] = numedges;
+        if (sorted[i]->eventposn < 0 ||
+                sorted[i]->eventposn >= graph->dependencymatrix.trigger_rows)
+            continue;
+        for (col = 0; col < numposns; col++) {
+            dep = &graph->dependencymatrix.rowptr[sorted[i]->eventposn][col];
+            if (dep->dependencyhandle != NULL && posnmap[col] >= 0 &&
+                    TEST_FLAG(dep->dependencyflag, TRIGGERS))
+                numedges++;
+        }
+    }
+    rowstart[numevents] = numedges;
+
+    edges = calloc(numedges + 1, sizeof(*edges));
+    if (edges == NULL)
+        goto cleanup;
+    numedges = 0;
+    for (i = 0; i < numevents; i++) {
+        if (sorted[i]->eventposn < 0 ||
+                sorted[i]->eventposn >= graph->dependencymatrix.trigger_rows)
+            continue;
+        for (col = 0; col < numposns; col++) {
+            dep = &graph->dependencymatrix.rowptr[sorted[i]->eventposn][col];
+            if (dep->dependencyhandle == NULL || posnmap[col] < 0 ||
+                    !TEST_FLAG(dep->dependencyflag, TRIGGERS))
+                continue;
+            edges[numedges].target = posnmap[col];
+            edges[numedges].dependencyflag = dep->dependencyflag;
+            edges[numedges].countperiod = dep->countperiod;
+            edges[numedges].countperiod_deft = dep->countperiod_deft;
+            edges[numedges].hasdeft = (dep->dependencyhandle_deft != NULL);
+            numedges++;
+        }
+    }
+
+    /* Step 4. Copy the holiday rules out of the hash table. */
+    numrules = 0;
+    for (month = 0; month < MONTHS; month++)
+        for (hnode = holidays[month]; hnode != NULL; hnode = hnode->nextrule)
+            numrules++;
+    rules = calloc(numrules + 1, sizeof(*rules));
+    if (rules == NULL)
+        goto cleanup;
+    i = 0;
+    for (month = 0; month < MONTHS; month++)
+        for (hnode = holidays[month]; hnode != NULL; hnode = hnode->nextrule)
+            rules[i++] = hnode->rule;
+
+    /* Step 5. Lay out and write the pack. */
+    memcpy(hdr.magic, RULEPACK_MAGIC, sizeof(hdr.magic));
+    hdr.version = RULEPACK_VERSION;
+    hdr.endiantag = RULEPACK_ENDIANTAG;
+    hdr.firstyear = cal->firstyear;
+    hdr.lastyear = cal->lastyear;
+    hdr.firstjdn = cal->firstjdn;
+    hdr.numdays = cal->numdays;
+
+    hdr.section[RP_CALENDAR].count = CALENDARWORDS(cal->numdays);
+    hdr.section[RP_CALENDAR].size = CALENDARWORDS(cal->numdays) *
+                                    sizeof(uint32_t);
+    hdr.section[RP_HOLIDAYS].count = numrules;
+    hdr.section[RP_HOLIDAYS].size = numrules * sizeof(*rules);
+    hdr.section[RP_EVENTS].count = numevents;
+    hdr.section[RP_EVENTS].size = numevents * sizeof(*events);
+    hdr.section[RP_ROWSTART].count = numevents + 1;
+    hdr.section[RP_ROWSTART].size = (numevents + 1) * sizeof(*rowstart);
+    hdr.section[RP_EDGES].count = numedges;
+    hdr.section[RP_EDGES].size = numedges * sizeof(*edges);
+    hdr.section[RP_STRINGS].count = 0;
+    hdr.section[RP_STRINGS].size = st.len;
+
+    posn = PACKALIGN(sizeof(hdr));
+    for (i = 0; i < RP_NUMSECTIONS; i++) {
+        hdr.section[i].offset = posn;
+        posn = PACKALIGN(posn + hdr.section[i].size);
+    }
+    hdr.filesize = posn;
+
+    snprintf(tmpname, sizeof(tmpname), "%s.tmp", packname);
+    if ((out = fopen(tmpname, "wb")) == NULL) {
+        fprintf(stderr, "ERROR: Rule pack %s cannot be created!\n", tmpname);
+        result = RP_EOPEN;
+        goto cleanup;
+    }
+
+    posn = 0;
+    result = RP_EWRITE;
+    if (writesection(out, &hdr, sizeof(hdr), &posn) != 0 ||
+        writesection(out, cal->holidaybits,
+                     hdr.section[RP_CALENDAR].size, &posn) != 0 ||
+        writesection(out, rules, hdr.section[RP_HOLIDAYS].size, &posn) != 0 ||
+        writesection(out, events, hdr.section[RP_EVENTS].size, &posn) != 0 ||
+        writesection(out, rowstart,
+                     hdr.section[RP_ROWSTART].size, &posn) != 0 ||
+        writesection(out, edges, hdr.section[RP_EDGES].size, &posn) != 0 ||
+        writesection(out, st.text, hdr.section[RP_STRINGS].size, &posn) != 0)
+        goto cleanup;
+
+    if (fclose(out) != 0) {
+        out = NULL;
+        goto cleanup;
+    }
+    out = NULL;
+    if (rename(tmpname, packname) != 0)
+        goto cleanup;
+    result = RP_OK;
+
+cleanup:
+    if (out != NULL) {
+        fclose(out);
+        remove(tmpname);
+    }
+    free(sorted);
+    free(posnmap);
+    free(events);
+    free(rowstart);
+    free(edges);
+    free(rules);
+    free(st.text);
+    free(st.slots);
+    return result;
+}		/* -----  end of function compilerulepack  ----- */
+
+
+/*
+ * Description: Maps a rule pack into memory and validates it.
+ *
+ * Parameters: Name of the pack file and the RulePack to fill in.
+ *
+ * Returns: RP_OK if the pack is ready to use, otherwise a negative RP_E code.
+ *
+ * Notes: Beyond the mmap(), the header, the CSR rows, the edge targets, and
+ * the string offsets are checked, so a damaged pack is rejected here rather
+ * than read out of bounds later, and the handful of holiday rules are
+ * relinked into a hash table, so that dates outside the calendar's span can
+ * still be answered.
+ */
+
+int openrulepack(const char *packname, struct RulePack *pack)
+{
+    const struct RulePackHeader *hdr;
+    struct stat sb;
+    char *base;
+    struct HolidayNode **tail[MONTHS]; /* end of each month's list */
+    int fd, i, month;
+
+    memset(pack, 0, sizeof(*pack));
+
+    if ((fd = open(packname, O_RDONLY)) < 0) {
+        fprintf(stderr, "ERROR: Rule pack %s does not exist ", packname);
+        fprintf(stderr, "or cannot be opened!\n");
+        return RP_EOPEN;
+    }
+    if (fstat(fd, &sb) != 0 || (size_t) sb.st_size < sizeof(*hdr)) {
+        close(fd);
+        return RP_EFORMAT;
+    }
+    base = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); /* the mapping keeps the file open */
+    if (base == MAP_FAILED)
+        return RP_EOPEN;
+
+    pack->base = base;
+    pack->size = sb.st_size;
+    hdr = (const struct RulePackHeader *) base;
+    pack->header = hdr;
+
+    if (memcmp(hdr->magic, RULEPACK_MAGIC, sizeof(hdr->magic)) != 0) {
+        closerulepack(pack);
+        return RP_EFORMAT;
+    }
+    if (hdr->version != RULEPACK_VERSION ||
+            hdr->endiantag != RULEPACK_ENDIANTAG) {
+        closerulepack(pack);
+        return RP_EVERSION;
+    }
+    if (hdr->filesize != (uint64_t) sb.st_size ||
+        checksection(hdr, pack->size, RP_CALENDAR, sizeof(uint32_t)) != 0 ||
+        checksection(hdr, pack->size, RP_HOLIDAYS,
+                     sizeof(struct HolidayRule)) != 0 ||
+        checksection(hdr, pack->size, RP_EVENTS,
+                     sizeof(struct PackEvent)) != 0 ||
+        checksection(hdr, pack->size, RP_ROWSTART, sizeof(uint32_t)) != 0 ||
+        checksection(hdr, pack->size, RP_EDGES,
+                     sizeof(struct PackEdge)) != 0 ||
+        checksection(hdr, pack->size, RP_STRINGS, 1) != 0 ||
+        hdr->section[RP_ROWSTART].count != hdr->section[RP_EVENTS].count + 1 ||
+        hdr->numdays < 0 ||
+        (uint64_t) hdr->numdays > hdr->section[RP_CALENDAR].size * 8 ||
+        hdr->section[RP_CALENDAR].count !=
+            (uint32_t) CALENDARWORDS(hdr->numdays) ||
+        hdr->section[RP_STRINGS].size == 0) {
+        closerulepack(pack);
+        return RP_EFORMAT;
+    }
+
+    pack->holidays = (const struct HolidayRule *)
+                     (base + hdr->section[RP_HOLIDAYS].offset);
+    pack->numholidays = hdr->section[RP_HOLIDAYS].count;
+    pack->events = (const struct PackEvent *)
+                   (base + hdr->section[RP_EVENTS].offset);
+    pack->numevents = hdr->section[RP_EVENTS].count;
+    pack->rowstart = (const uint32_t *) (base + hdr->section[RP_ROWSTART].offset);
+    pack->edges = (const struct PackEdge *)
+                  (base + hdr->section[RP_EDGES].offset);
+    pack->numedges = hdr->section[RP_EDGES].count;
+    pack->strings = base + hdr->section[RP_STRINGS].offset;
+    pack->stringsize = hdr->section[RP_STRINGS].size;
+
+    if (checkpackdata(pack) != 0) {
+        closerulepack(pack);
+        return RP_EFORMAT;
+    }
+
+    /* Relink the holiday rules, keeping each month's rules in file order. */
+    pack->holidaynodes = calloc(pack->numholidays + 1,
+                                sizeof(*pack->holidaynodes));
+    if (pack->holidaynodes == NULL) {
+        closerulepack(pack);
+        return RP_ENOMEM;
+    }
+    for (month = 0; month < MONTHS; month++)
+        tail[month] = &pack->holidaytable[month];
+    for (i = 0; i < pack->numholidays; i++) {
+        month = pack->holidays[i].month - 1;
+        if (month < 0 || month >= MONTHS)
+            continue;
+        pack->holidaynodes[i].rule = pack->holidays[i];
+        *tail[month] = &pack->holidaynodes[i];
+        tail[month] = &pack->holidaynodes[i].nextrule;
+    }
+
+    /* The calendar is a view straight onto the mapped bitmap. */
+    pack->calendar.firstyear = hdr->firstyear;
+    pack->calendar.lastyear = hdr->lastyear;
+    pack->calendar.firstjdn = hdr->firstjdn;
+    pack->calendar.numdays = hdr->numdays;
+    pack->calendar.holidaybits = (uint32_t *)
+                                 (base + hdr->section[RP_CALENDAR].offset);
+    pack->calendar.rules = pack->holidaytable;
+    pack->calendar.ownsbits = 0;
+
+    return RP_OK;
+}		/* -----  end of function openrulepack  ----- */
+
+
+/*
+ * Description: Unmaps a rule pack.
+ * Parameters: The pack.
+ * Returns: Nothing.
+ */
+
+void closerulepack(struct RulePack *pack)
+{
+    if (pack->base != NULL)
+        munmap(pack->base, pack->size);
+    free(pack->holidaynodes);
+    memset(pack, 0, sizeof(*pack));
+    return;
+}		/* -----  end of function closerulepack  ----- */
+
+
+/*
+ * Description: Looks up an event by its short title.
+ *
+ * Parameters: The pack and the short title to search for.
+ *
+ * Returns: The index of the event in pack->events, or -1 if not found.
+ *
+ * Algorithm: Binary search; compilerulepack() sorts the events by
+ * shorttitle.
+ */
+
+int rulepack_findevent(const struct RulePack *pack, const char *shorttitle)
+{
+    int low, high, mid, cmp;
+
+    low = 0;
+    high = pack->numevents - 1;
+    while (low <= high) {
+        mid = low + (high - low) / 2;
+        cmp = eventcmp(shorttitle,
+                       RULEPACK_STRING(pack, pack->events[mid].shorttitle));
+        if (cmp == 0)
+            return mid;
+        else if (cmp < 0)
+            high = mid - 1;
+        else
+            low = mid + 1;
+    }
+    return -1;
+}		/* -----  end of function rulepack_findevent  ----- */
+
+
+/*
+ * Description: Loads an event of a rule pack, and every event reachable from
+ * it, into an event graph.
+ *
+ * Parameters: The pack, the short title of the event that starts the chain,
+ * and the EventGraph to load.
+ *
+ * Returns: The number of events loaded, zero if the event is not in the
+ * pack, or -1 if memory could not be allocated.
+ *
+ * Algorithm: Breadth first over the CSR rows, starting at the event.  Only
+ * the events reached are unpacked; the rest of the pack is never touched,
+ * so the cost is proportional to the size of the chain.  The dependencies
+ * are rebuilt from the events' triggers when the graph is finalized.
+ */
+
+int rulepack_loadchain(const struct RulePack *pack, const char *trigger,
+                       struct EventGraph *graph)
+{
+    struct CourtEvent event;
+    unsigned char *loaded; /* nonzero for each event queued */
+    int *queue; /* the events reached, in BFS order */
+    int head, count, index;
+    uint32_t edge;
+
+    init_eventgraph(graph, 0);
+    index = rulepack_findevent(pack, trigger);
+    if (index < 0)
+        return 0;
+
+    loaded = calloc(pack->numevents, 1);
+    queue = malloc(pack->numevents * sizeof(int));
+    if (loaded == NULL || queue == NULL) {
+        free(loaded);
+        free(queue);
+        return -1;
+    }
+
+    count = 0;
+    queue[count++] = index;
+    loaded[index] = 1;
+    for (head = 0; head < count; head++) {
+        index = queue[head];
+        unpackevent(pack, index, &event);
+        graph->eventlist = insertevent(&event, graph->eventlist);
+        graph->listsize++;
+        for (edge = pack->rowstart[index]; edge < pack->rowstart[index + 1];
+                edge++) {
+            if (!loaded[pack->edges[edge].target]) {
+                loaded[pack->edges[edge].target] = 1;
+                queue[count++] = pack->edges[edge].target;
+            }
+        }
+    }
+
+    free(loaded);
+    free(queue);
+    if (finalizeeventgraph(graph) < 0)
+        return -1;
+    return count;
+}		/* -----  end of function rulepack_loadchain  ----- */
+
+
+/*
+ * Description: Loads every event of a rule pack into an event graph.
+ *
+ * Parameters: The pack and the EventGraph to load.
+ *
+ * Returns: The number of events loaded, or -1 if memory could not be
+ * allocated.
+ *
+ * Algorithm: The events are copied straight out of the hot records and the
+ * string table; nothing is parsed.  The pack is already sorted by
+ * shorttitle, so each node is appended at the tail of the list and its pack
+ * index is its eventposn.  The matrix is then filled from the CSR rows in a
+ * single pass, so the load is linear in the size of the pack rather than
+ * quadratic in the number of events.
+ */
+
+int rulepack_loadgraph(const struct RulePack *pack, struct EventGraph *graph)
+{
+    struct CourtEventNode **nodes; /* pack index -> node */
+    struct CourtEventNode **tail; /* end of the event list */
+    const struct PackEdge *pe;
+    struct Dependency *dep;
+    int index;
+    uint32_t edge;
+
+    init_eventgraph(graph, 0);
+    nodes = countedmalloc((pack->numevents + 1) * sizeof(*nodes));
+    if (nodes == NULL)
+        return -1;
+
+    tail = &graph->eventlist;
+    for (index = 0; index < pack->numevents; index++) {
+        nodes[index] = countedmalloc(sizeof(struct CourtEventNode));
+        if (nodes[index] == NULL)
+            goto nomem;
+        unpackevent(pack, index, &nodes[index]->eventdata);
+        nodes[index]->eventposn = index;
+        nodes[index]->nextevent = NULL;
+        *tail = nodes[index];
+        tail = &nodes[index]->nextevent;
+        graph->listsize++;
+    }
+
+    if (resizeadjacencymatrix(graph, (pack->numevents > 0) ?
+                              pack->numevents : 1) != 0)
+        goto nomem;
+    for (index = 0; index < pack->numevents; index++) {
+        for (edge = pack->rowstart[index]; edge < pack->rowstart[index + 1];
+                edge++) {
+            pe = &pack->edges[edge];
+            dep = &graph->dependencymatrix.rowptr[index][pe->target];
+            if (dep->dependencyhandle == NULL)
+                graph->numedges++;
+            dep->dependencyhandle = &nodes[pe->target]->eventdata;
+            dep->dependencyhandle_deft = pe->hasdeft ?
+                                         dep->dependencyhandle : NULL;
+            dep->dependencyflag = pe->dependencyflag;
+            dep->countperiod = pe->countperiod;
+            dep->countperiod_deft = pe->countperiod_deft;
+        }
+    }
+
+    countedfree(nodes);
+    return pack->numevents;
+
+nomem:
+    countedfree(nodes);
+    freeeventgraph(graph);
+    return -1;
+}		/* -----  end of function rulepack_loadgraph  ----- */
+
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description: Checks that the data the sections of a pack point into stays
+ * inside the pack.
+ *
+ * Parameters: The pack, with its section pointers set.
+ *
+ * Returns: Zero if the pack is sound, -1 if any check fails: the CSR rows
+ * must start at zero, never decrease, and end at numedges; every edge must
+ * target an event of the pack; and every string offset must fall inside the
+ * NUL terminated string section.
+ */
+
+static int checkpackdata (const struct RulePack *pack)
+{
+    const struct PackEvent *pe;
+    int i;
+
+    if (pack->strings[pack->stringsize-1] != '\0' ||
+            pack->rowstart[0] != 0 ||
+            pack->rowstart[pack->numevents] != (uint32_t) pack->numedges)
+        return -1;
+    for (i = 0; i < pack->numevents; i++) {
+        if (pack->rowstart[i] > pack->rowstart[i + 1])
+            return -1;
+        pe = &pack->events[i];
+        if (pe->shorttitle >= pack->stringsize ||
+                pe->eventitle >= pack->stringsize ||
+                pe->ntc_dependency1 >= pack->stringsize ||
+                pe->ntc_dependency2 >= pack->stringsize ||
+                pe->eventcategory >= pack->stringsize ||
+                pe->authority >= pack->stringsize ||
+                pe->description >= pack->stringsize)
+            return -1;
+    }
+    for (i = 0; i < pack->numedges; i++)
+        if (pack->edges[i].target >= (uint32_t) pack->numevents)
+            return -1;
+    return 0;
+}		/* -----  end of function checkpackdata  ----- */
+
+
+/*
+ * Description: Copies an event out of a pack into a CourtEvent.
+ *
+ * Parameters: The pack, the index of the event in pack->events, and the
+ * event to fill in.
+ *
+ * Returns: Nothing.
+ */
+
+static void unpackevent (const struct RulePack *pack, int index,
+                         struct CourtEvent *event)
+{
+    const struct PackEvent *pe = &pack->events[index];
+
+    memset(event, 0, sizeof(*event));
+    strncpy(event->shorttitle, RULEPACK_STRING(pack, pe->shorttitle),
+            sizeof(event->shorttitle) - 1);
+    strncpy(event->eventitle, RULEPACK_STRING(pack, pe->eventitle),
+            sizeof(event->eventitle) - 1);
+    strncpy(event->ntc_dependency1, RULEPACK_STRING(pack, pe->ntc_dependency1),
+            sizeof(event->ntc_dependency1) - 1);
+    strncpy(event->ntc_dependency2, RULEPACK_STRING(pack, pe->ntc_dependency2),
+            sizeof(event->ntc_dependency2) - 1);
+    strncpy(event->eventcategory, RULEPACK_STRING(pack, pe->eventcategory),
+            sizeof(event->eventcategory) - 1);
+    strncpy(event->authority, RULEPACK_STRING(pack, pe->authority),
+            sizeof(event->authority) - 1);
+    strncpy(event->description, RULEPACK_STRING(pack, pe->description),
+            sizeof(event->description) - 1);
+    event->eventflags = pe->eventflags;
+    event->countunits = pe->countunits;
+    event->ntcpd1 = pe->ntcpd1;
+    event->ntcpd2 = pe->ntcpd2;
+    event->late_early = pe->late_early;
+    event->customservicerule = pe->customservicerule;
+    return;
+}		/* -----  end of function unpackevent  ----- */
+
+
+/*
+ * Description: Adds a string to the string table, reusing an identical
+ * string if one was already added.
+ *
+ * Parameters: The string table and the string.
+ *
+ * Returns: The offset of the string in the table.  On allocation failure the
+ * table's text is freed and set to NULL, which the caller checks.
+ */
+
+static uint32_t addstring (struct StringTable *st, const char *s)
+{
+    uint32_t hash = 2166136261u; /* FNV-1a */
+    const unsigned char *p;
+    size_t len, slot, i;
+    uint32_t off;
+
+    if (st->slots == NULL) {
+        st->numslots = STRHASHSIZE;
+        st->slots = calloc(st->numslots, sizeof(*st->slots));
+        if (st->slots == NULL)
+            goto nomem;
+    } else if (st->text == NULL) {
+        return 0; /* an earlier allocation failed */
+    }
+
+    for (p = (const unsigned char *) s; *p != '\0'; p++)
+        hash = (hash ^ *p) * 16777619u;
+    len = (const char *) p - s;
+
+    for (slot = hash & (st->numslots - 1); st->slots[slot] != 0;
+            slot = (slot + 1) & (st->numslots - 1)) {
+        if (strcmp(st->text + st->slots[slot] - 1, s) == 0)
+            return st->slots[slot] - 1;
+    }
+
+    if (st->len + len + 1 > st->cap) {
+        char *grown;
+        size_t newcap = st->cap ? st->cap * 2 : 4096;
+
+        while (newcap < st->len + len + 1)
+            newcap *= 2;
+        if ((grown = realloc(st->text, newcap)) == NULL)
+            goto nomem;
+        st->text = grown;
+        st->cap = newcap;
+    }
+    off = st->len;
+    memcpy(st->text + off, s, len + 1);
+    st->len += len + 1;
+    st->slots[slot] = off + 1;
+
+    /* Keep the table no more than half full. */
+    if (++st->used * 2 > st->numslots) {
+        uint32_t *old = st->slots;
+        size_t oldnum = st->numslots;
+
+        st->numslots *= 2;
+        if ((st->slots = calloc(st->numslots, sizeof(*st->slots))) == NULL) {
+            st->slots = old;
+            goto nomem;
+        }
+        for (i = 0; i < oldnum; i++) {
+            if (old[i] == 0)
+                continue;
+            hash = 2166136261u;
+            for (p = (const unsigned char *) st->text + old[i] - 1;
+                    *p != '\0'; p++)
+                hash = (hash ^ *p) * 16777619u;
+            for (slot = hash & (st->numslots - 1); st->slots[slot] != 0;
+                    slot = (slot + 1) & (st->numslots - 1))
+                ;
+            st->slots[slot] = old[i];
+        }
+        free(old);
+    }
+    return off;
+
+nomem:
+    free(st->text);
+    st->text = NULL;
+    return 0;
+}		/* -----  end of function addstring  ----- */
+
+
+/*
+ * Description: qsort() comparison of two event nodes by shorttitle.
+ */
+
+static int comparenodes (const void *a, const void *b)
+{
+    const struct CourtEventNode *na = *(struct CourtEventNode * const *) a;
+    const struct CourtEventNode *nb = *(struct CourtEventNode * const *) b;
+
+    return eventcmp(na->eventdata.shorttitle, nb->eventdata.shorttitle);
+}		/* -----  end of function comparenodes  ----- */
+
+
+/*
+ * Description: Writes one section of the pack, padding the file out to the
+ * next RULEPACK_ALIGN boundary.
+ *
+ * Parameters: Output file, data, size of the data, and the running file
+ * position.
+ *
+ * Returns: Zero if successful, -1 on a write error.
+ */
+
+static int writesection (FILE *out, const void *data, uint64_t size,
+                         uint64_t *posn)
+{
+    static const char zeros[RULEPACK_ALIGN];
+    uint64_t pad;
+
+    if (size > 0 && fwrite(data, 1, size, out) != size)
+        return -1;
+    *posn += size;
+    pad = PACKALIGN(*posn) - *posn;
+    if (pad > 0 && fwrite(zeros, 1, pad, out) != pad)
+        return -1;
+    *posn += pad;
+    return 0;
+}		/* -----  end of function writesection  ----- */
+
+
+/*
+ * Description: Checks that a section lies inside the file, is aligned, and
+ * holds a whole number of records.
+ *
+ * Returns: Zero if the section is sound, -1 otherwise.
+ */
+
+static int checksection (const struct RulePackHeader *hdr, size_t filesize,
+                         int section, size_t recsize)
+{
+    const struct RulePackSection *sec = &hdr->section[section];
+
+    if (sec->offset % RULEPACK_ALIGN != 0 || sec->offset > filesize ||
+            sec->size > filesize - sec->offset)
+        return -1;
+    if (recsize > 1 && sec->size != (uint64_t) sec->count * recsize)
+        return -1;
+    return 0;
+}		/* -----  end of function checksection  ----- */
@@ -0,0 +1,228 @@
+/*
+ * Filename: rulepack.h
+ * Project: DocketMaster
+ *
+ * Description: The rule pack module compiles a jurisdiction's holiday and
+ * event rules into a single binary file that can be mapped straight into
+ * memory and used in place, with no CSV parsing at startup.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:36:22 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: "docketmaster compile -h[holidays] -e[events] -o[pack]" builds the
+ * rules the usual way with buildre() and saves them with compilerulepack().
+ * "docketmaster -p[pack]" maps a pack with openrulepack() and loads its
+ * events with rulepack_loadgraph() instead of calling buildre().  "docketmaster chain -p[pack] -c[trigger]" loads a single chain
+ * of events from the pack with rulepack_loadchain().
+ *
+ * File Format: A pack is a RulePackHeader followed by its sections, each
+ * aligned to 8 bytes:
+ *
+ *   RP_CALENDAR  the CourtCalendar holiday bitmap (one bit per day)
+ *   RP_HOLIDAYS  the holiday rules, as struct HolidayRule records
+ *   RP_EVENTS    the "hot" part of each court event, as PackEvent records
+ *                sorted by shorttitle
+ *   RP_ROWSTART  CSR row index: the edges triggered by event i are
+ *                edges[rowstart[i]] through edges[rowstart[i+1]-1]
+ *   RP_EDGES     the dependencies, as PackEdge records
+ *   RP_STRINGS   every string the events refer to, NUL terminated
+ *
+ * All integers are in the byte order of the machine that compiled the pack.
+ * The header records an endian tag so a pack from a foreign machine is
+ * rejected instead of misread.
+ *
+ * Restrictions: A pack is tied to RULEPACK_VERSION.  Any change to the
+ * records below must bump the version.
+ *
+ * Error Handling: The functions return the negative RP_E codes below.
+ * References:
+ * Notes:
+ */
+
+#ifndef _RULEPACK_H_INCLUDED_
+#define _RULEPACK_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "graphmgr.h"
+#include "courtcal.h"
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define RULEPACK_MAGIC "DKTMPACK" /* first eight bytes of every pack */
+#define RULEPACK_VERSION 1
+#define RULEPACK_ENDIANTAG 0x01020304u
+#define RULEPACK_ALIGN 8
+
+/*------------------------------------------------------------------------------
+ *  Rule pack error codes
+ *----------------------------------------------------------------------------*/
+#define RP_OK 0
+#define RP_EOPEN -1 /* file could not be opened, created, or mapped */
+#define RP_EFORMAT -2 /* file is not a rule pack, or is truncated */
+#define RP_EVERSION -3 /* pack is from another version or byte order */
+#define RP_ENOMEM -4 /* out of memory */
+#define RP_EWRITE -5 /* pack could not be written */
+
+/* Sections of a rule pack */
+enum RULEPACK_SECTION {RP_CALENDAR, RP_HOLIDAYS, RP_EVENTS, RP_ROWSTART,
+                       RP_EDGES, RP_STRINGS, RP_NUMSECTIONS};
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+struct RulePackSection {
+    uint64_t offset; /* from the start of the file */
+    uint64_t size; /* in bytes */
+    uint32_t count; /* number of records */
+    uint32_t reserved;
+};
+
+struct RulePackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endiantag;
+    uint64_t filesize;
+    int32_t firstyear; /* materialized span of the calendar */
+    int32_t lastyear;
+    int32_t firstjdn;
+    int32_t numdays;
+    struct RulePackSection section[RP_NUMSECTIONS];
+};
+
+/* The "hot" fields of a CourtEvent.  The text fields are offsets into the
+ * string section. */
+struct PackEvent {
+    uint32_t shorttitle;
+    uint32_t eventitle;
+    uint32_t ntc_dependency1;
+    uint32_t ntc_dependency2;
+    uint32_t eventcategory;
+    uint32_t authority;
+    uint32_t description;
+    unsigned char eventflags;
+    unsigned char countunits;
+    signed char ntcpd1;
+    signed char ntcpd2;
+    signed char late_early;
+    struct ExtraServiceDays customservicerule;
+};
+
+/* A Dependency, stored in the row of its triggering event. */
+struct PackEdge {
+    uint32_t target; /* index of the triggered event in RP_EVENTS */
+    unsigned char dependencyflag;
+    signed char countperiod;
+    signed char countperiod_deft;
+    unsigned char hasdeft; /* nonzero if dependencyhandle_deft was set */
+};
+
+/* A rule pack mapped into memory.  Every pointer except holidaynodes points
+ * into the mapping.  Do not copy a RulePack by value: calendar.rules points at
+ * the holidaytable member of the pack it was opened into. */
+struct RulePack {
+    void *base; /* start of the mapping */
+    size_t size; /* size of the mapping */
+    const struct RulePackHeader *header;
+    const struct HolidayRule *holidays;
+    int numholidays;
+    const struct PackEvent *events;
+    int numevents;
+    const uint32_t *rowstart;
+    const struct PackEdge *edges;
+    int numedges;
+    const char *strings;
+    size_t stringsize;
+    struct CourtCalendar calendar; /* view over RP_CALENDAR */
+    struct HolidayNode *holidaytable[MONTHS]; /* holiday rules relinked for
+                                                 dates outside the calendar */
+    struct HolidayNode *holidaynodes; /* storage for holidaytable */
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Compiles an event graph, a holiday hash table, and the
+ * calendar built from it into a rule pack file.
+ *
+ * Parameters: Name of the pack file to create, the event graph, the holiday
+ * hash table, and the materialized calendar.
+ *
+ * Returns: RP_OK if the pack was written, otherwise a negative RP_E code.
+ */
+
+int compilerulepack(const char *packname, struct EventGraph *graph,
+                    struct HolidayNode *holidays[],
+                    const struct CourtCalendar *cal);
+
+/*
+ * Description: Maps a rule pack into memory and validates it.
+ *
+ * Parameters: Name of the pack file and the RulePack to fill in.
+ *
+ * Returns: RP_OK if the pack is ready to use, otherwise a negative RP_E code.
+ */
+
+int openrulepack(const char *packname, struct RulePack *pack);
+
+/*
+ * Description: Unmaps a rule pack.
+ * Parameters: The pack.
+ * Returns: Nothing.
+ */
+
+void closerulepack(struct RulePack *pack);
+
+/*
+ * Description: Looks up an event by its short title.
+ *
+ * Parameters: The pack and the short title to search for.
+ *
+ * Returns: The index of the event in pack->events, or -1 if not found.
+ */
+
+int rulepack_findevent(const struct RulePack *pack, const char *shorttitle);
+
+/*
+ * Description: Loads an event of a rule pack, and every event reachable from
+ * it, into an event graph.
+ *
+ * Parameters: The pack, the short title of the event that starts the chain
+ * (normally a CHAINHEAD event), and the EventGraph to load, which is
+ * initialized first.
+ *
+ * Returns: The number of events loaded, zero if the event is not in the
+ * pack, or -1 if memory could not be allocated.  The graph is finalized and
+ * belongs to the caller.
+ */
+
+int rulepack_loadchain(const struct RulePack *pack, const char *trigger,
+                       struct EventGraph *graph);
+
+/*
+ * Description: Loads every event of a rule pack into an event graph.
+ *
+ * Parameters: The pack and the EventGraph to load, which is initialized
+ * first.
+ *
+ * Returns: The number of events loaded, or -1 if memory could not be
+ * allocated.  The graph is finalized and belongs to the caller.
+ */
+
+int rulepack_loadgraph(const struct RulePack *pack, struct EventGraph *graph);
+
+/*
+ * Description: Returns the string stored at an offset in the string section.
+ */
+
+#define RULEPACK_STRING(pack, off) ((pack)->strings + (off))
+
+#endif	/* _RULEPACK_H_INCLUDED_ */
@@ -0,0 +1,711 @@
+/*
+ * Filename: rulereload.c
+ * Project: DocketMaster
+ *
+ * Description: The rule reload module brings the live holiday rules, court
+ * calendar, and event graph up to date after the rules files have been
+ * edited, without rebuilding them.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 09:06:54 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Called by the rule builder and by main().
+ * File Format:
+ * Restrictions:
+ * Error Handling:
+ * References: The record hash is the 64-bit FNV-1a hash (Fowler, Noll, and
+ * Vo).
+ * Notes:
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rulereload.h"
+#include "rulebuilder.h"
+#include "lexicalanalyzer.h"
+#include "eprocessor.h"
+
+/* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ################ */
+
+#define FNV_OFFSET 14695981039346656037ULL /* FNV-1a 64-bit offset basis */
+#define FNV_PRIME 1099511628211ULL /* FNV-1a 64-bit prime */
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* One record of a rules file and its hash. */
+struct RecordHash {
+    uint64_t hash;
+    char *record; /* the record, without its line ending */
+};
+
+/* Every record of a rules file, sorted by hash so two versions of the file
+can be compared in a single pass. */
+struct RecordSet {
+    char fileheader[MAXRECORDLENGTH]; /* file name and version line */
+    char fieldline[MAXRECORDLENGTH]; /* field names line */
+    struct RecordHash *records;
+    int count;
+};
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
+
+static struct RecordSet holidayrecords; /* the records the live holiday
+                                           rules were built from */
+static struct RecordSet eventrecords; /* the records the live event graph
+                                         was built from */
+static int baselined; /* nonzero once baselinerules() has succeeded */
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static int readrecords (const char *filename, struct RecordSet *set);
+    /* Reads and hashes every record of a rules file */
+
+static void freerecords (struct RecordSet *set);
+    /* Releases the records of a RecordSet */
+
+static int diffrecords (const struct RecordSet *oldset,
+                        const struct RecordSet *newset,
+                        const char ***removed, int *numremoved,
+                        const char ***added, int *numadded);
+    /* Lists the records only in the old set and only in the new set */
+
+static int applyholidays (const struct RecordSet *oldset,
+                          const struct RecordSet *newset,
+                          struct RuleDelta *delta);
+    /* Applies the changed holiday records to THE holiday hash table */
+
+static int applyevents (const struct RecordSet *oldset,
+                        const struct RecordSet *newset,
+                        struct EventGraph *graph, struct RuleDelta *delta);
+    /* Applies the changed event records to the event graph */
+
+static int removeholidayrule (struct HolidayNode **list,
+                              const struct HolidayRule *rule);
+    /* Unlinks and frees the node holding a rule */
+
+static int freeeventposn (struct EventGraph *graph);
+    /* Finds a free event position, growing the matrix if needed */
+
+static int markstale (struct EventGraph *graph,
+                      const struct CourtEvent *changed, int numchanged,
+                      struct RuleDelta *delta);
+    /* Marks the changed events and every event downstream of them */
+
+static int recordcmp (const void *rec1, const void *rec2);
+    /* qsort() comparison: by hash, then by text */
+
+static uint64_t hashrecord (const char *record);
+    /* FNV-1a hash of a record */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description: Hashes every record of the rules files the live structures
+ * were just built from, for later reloads to compare against.
+ *
+ * Parameters: Names of the holiday file and the events file.
+ *
+ * Returns: RL_OK if successful, otherwise a negative RL_E code.
+ */
+
+int baselinerules(const char *holiday, const char *events)
+{
+    struct RecordSet newholidays, newevents;
+    int status;
+
+    status = readrecords(holiday, &newholidays);
+    if (status != RL_OK)
+        return status;
+    status = readrecords(events, &newevents);
+    if (status != RL_OK) {
+        freerecords(&newholidays);
+        return status;
+    }
+
+    freerecords(&holidayrecords);
+    freerecords(&eventrecords);
+    holidayrecords = newholidays;
+    eventrecords = newevents;
+    baselined = 1;
+    return RL_OK;
+}		/* -----  end of function baselinerules  ----- */
+
+
+/*
+ * Description: Applies the changes made to the rules files since they were
+ * last built or reloaded to THE holiday hash table, calendar, and event
+ * graph.
+ *
+ * Parameters: Names of the holiday file and the events file, and the
+ * RuleDelta to fill in.
+ *
+ * Returns: RL_OK if successful, otherwise a negative RL_E code.  If RL_ENOMEM
+ * is returned, some of the changes may have been applied and the rules must
+ * be rebuilt with buildre().
+ *
+ * Algorithm: Both files are read and hashed again.  A record whose hash and
+ * text are unchanged is skipped without being parsed.  A record only in the
+ * old file is removed from the live structures; a record only in the new
+ * file is added.  An edited record shows up as one of each; for events the
+ * pair is matched by the event name and the event is replaced in place, so
+ * it keeps its position in the graph.  Only the calendar months whose
+ * holiday rules changed are recomputed.
+ */
+
+int reloadre(const char *holiday, const char *events,
+             struct RuleDelta *delta)
+{
+    struct RecordSet newholidays, newevents;
+    int status;
+
+    memset(delta, 0, sizeof(*delta));
+    if (!baselined)
+        return RL_ENOBASE;
+
+    clearerrors(); /* report only this reload's errors */
+    status = readrecords(holiday, &newholidays);
+    if (status != RL_OK)
+        return status;
+    status = readrecords(events, &newevents);
+    if (status != RL_OK) {
+        freerecords(&newholidays);
+        return status;
+    }
+
+    if (strcmp(newholidays.fileheader, holidayrecords.fileheader) != 0 ||
+            strcmp(newholidays.fieldline, holidayrecords.fieldline) != 0 ||
+            strcmp(newevents.fileheader, eventrecords.fileheader) != 0 ||
+            strcmp(newevents.fieldline, eventrecords.fieldline) != 0) {
+        freerecords(&newholidays);
+        freerecords(&newevents);
+        return RL_EFORMAT;
+    }
+
+    seterrorcontext(holiday, 0);
+    status = applyholidays(&holidayrecords, &newholidays, delta);
+    seterrorcontext(events, 0);
+    if (status == RL_OK)
+        status = applyevents(&eventrecords, &newevents, &jurisdevents, delta);
+    if (status == RL_OK && refreshcalendar(&jurisdcalendar,
+                                           delta->monthmask) != 0)
+        status = RL_ENOMEM;
+
+    if (status != RL_OK) {
+        freerecords(&newholidays);
+        freerecords(&newevents);
+        freeruledelta(delta);
+        baselined = 0; /* the live structures no longer match any file */
+        return status;
+    }
+
+    freerecords(&holidayrecords);
+    freerecords(&eventrecords);
+    holidayrecords = newholidays;
+    eventrecords = newevents;
+    return RL_OK;
+}		/* -----  end of function reloadre  ----- */
+
+
+/*
+ * Description: Releases the memory held by a RuleDelta.
+ * Parameters: The delta.
+ * Returns: Nothing.
+ */
+
+void freeruledelta(struct RuleDelta *delta)
+{
+    free(delta->staleevents);
+    memset(delta, 0, sizeof(*delta));
+    return;
+}		/* -----  end of function freeruledelta  ----- */
+
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description: Reads and hashes every record of a rules file.
+ *
+ * Parameters: Name of the file and the RecordSet to fill in.
+ *
+ * Returns: RL_OK, RL_EOPEN, RL_EFORMAT if the file has no header lines, or
+ * RL_ENOMEM.
+ *
+ * Notes: Blank lines are skipped.  Line endings are not part of a record, so
+ * a file saved with different line endings does not look changed.
+ */
+
+static int readrecords (const char *filename, struct RecordSet *set)
+{
+    FILE *in_file;
+    char line[MAXRECORDLENGTH];
+    struct RecordHash *grown;
+    size_t len;
+    int capacity;
+
+    memset(set, 0, sizeof(*set));
+    if ((in_file = fopen(filename, "r")) == NULL)
+        return RL_EOPEN;
+
+    if (fgets(set->fileheader, sizeof(set->fileheader), in_file) == NULL ||
+            fgets(set->fieldline, sizeof(set->fieldline), in_file) == NULL) {
+        fclose(in_file);
+        return RL_EFORMAT;
+    }
+    set->fileheader[strcspn(set->fileheader, "\r\n")] = '\0';
+    set->fieldline[strcspn(set->fieldline, "\r\n")] = '\0';
+
+    capacity = 0;
+    while (fgets(line, sizeof(line), in_file) != NULL) {
+        len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (len == 0)
+            continue;
+
+        if (set->count == capacity) {
+            capacity = (capacity > 0) ? capacity * 2 : 64;
+            grown = realloc(set->records, capacity * sizeof(*grown));
+            if (grown == NULL) {
+                fclose(in_file);
+                freerecords(set);
+                return RL_ENOMEM;
+            }
+            set->records = grown;
+        }
+
+        set->records[set->count].hash = hashrecord(line);
+        set->records[set->count].record = malloc(len + 1);
+        if (set->records[set->count].record == NULL) {
+            fclose(in_file);
+            freerecords(set);
+            return RL_ENOMEM;
+        }
+        memcpy(set->records[set->count].record, line, len + 1);
+        set->count++;
+    }
+    fclose(in_file);
+
+    qsort(set->records, set->count, sizeof(struct RecordHash), recordcmp);
+    return RL_OK;
+}		/* -----  end of function readrecords  ----- */
+
+
+/*
+ * Description: Releases the records of a RecordSet.
+ */
+
+static void freerecords (struct RecordSet *set)
+{
+    int index;
+
+    for (index = 0; index < set->count; index++)
+        free(set->records[index].record);
+    free(set->records);
+    memset(set, 0, sizeof(*set));
+    return;
+}		/* -----  end of function freerecords  ----- */
+
+
+/*
+ * Description: Lists the records only in the old set and only in the new
+ * set.
+ *
+ * Parameters: The two sets, and pointers that receive the two lists (which
+ * point into the sets) and their lengths.  The caller frees the lists.
+ *
+ * Returns: RL_OK or RL_ENOMEM.
+ *
+ * Algorithm: Both sets are sorted the same way, so they are merged like two
+ * sorted lists.  Duplicate records are matched one for one.
+ */
+
+static int diffrecords (const struct RecordSet *oldset,
+                        const struct RecordSet *newset,
+                        const char ***removed, int *numremoved,
+                        const char ***added, int *numadded)
+{
+    int oldindex, newindex, cmp;
+
+    *numremoved = 0;
+    *numadded = 0;
+    *removed = malloc((oldset->count + 1) * sizeof(char *));
+    *added = malloc((newset->count + 1) * sizeof(char *));
+    if (*removed == NULL || *added == NULL) {
+        free(*removed);
+        free(*added);
+        return RL_ENOMEM;
+    }
+
+    oldindex = 0;
+    newindex = 0;
+    while (oldindex < oldset->count || newindex < newset->count) {
+        if (newindex == newset->count)
+            cmp = -1;
+        else if (oldindex == oldset->count)
+            cmp = 1;
+        else
+            cmp = recordcmp(&oldset->records[oldindex],
+                            &newset->records[newindex]);
+
+        if (cmp < 0)
+            (*removed)[(*numremoved)++] = oldset->records[oldindex++].record;
+        else if (cmp > 0)
+            (*added)[(*numadded)++] = newset->records[newindex++].record;
+        else {
+            oldindex++;
+            newindex++;
+        }
+    }
+
+    return RL_OK;
+}		/* -----  end of function diffrecords  ----- */
+
+
+/*
+ * Description: Applies the changed holiday records to THE holiday hash
+ * table.
+ *
+ * Parameters: The baseline and new records, and the delta to update.
+ *
+ * Returns: RL_OK or RL_ENOMEM.
+ *
+ * Notes: The calendar is not touched here; the months recorded in the
+ * delta's monthmask are refreshed once all the rules are in place.
+ */
+
+static int applyholidays (const struct RecordSet *oldset,
+                          const struct RecordSet *newset,
+                          struct RuleDelta *delta)
+{
+    char fields[MAXNUMFIELDS][MAXFIELDLEN];
+    char buffer[MAXRECORDLENGTH];
+    struct HolidayRule rule;
+    const char **removed, **added;
+    int numremoved, numadded, numfields, index;
+
+    if (diffrecords(oldset, newset, &removed, &numremoved, &added,
+                    &numadded) != RL_OK)
+        return RL_ENOMEM;
+
+    strcpy(buffer, newset->fieldline);
+    numfields = parsefieldnames(buffer, fields);
+
+    for (index = 0; index < numremoved; index++) {
+        strcpy(buffer, removed[index]);
+        if (parseholidayrecord(buffer, fields, numfields, &rule) != 0)
+            continue; /* a bad record was never loaded */
+        if (removeholidayrule(&holidayhashtable[rule.month-1], &rule)) {
+            delta->holidaysremoved++;
+            delta->monthmask |= (1u << (rule.month-1));
+        }
+    }
+
+    for (index = 0; index < numadded; index++) {
+        strcpy(buffer, added[index]);
+        if (parseholidayrecord(buffer, fields, numfields, &rule) != 0)
+            continue;
+        holidayhashtable[rule.month-1] =
+            addholidayrule(holidayhashtable[rule.month-1], &rule);
+        delta->holidaysadded++;
+        delta->monthmask |= (1u << (rule.month-1));
+    }
+
+    free(removed);
+    free(added);
+    return RL_OK;
+}		/* -----  end of function applyholidays  ----- */
+
+
+/*
+ * Description: Applies the changed event records to the event graph.
+ *
+ * Parameters: The baseline and new records, the graph, and the delta to
+ * update.
+ *
+ * Returns: RL_OK or RL_ENOMEM.
+ *
+ * Algorithm: Removed events are deleted first, freeing their positions.  An
+ * added event that is already in the graph is an edited one: it is replaced
+ * in place and its triggers are relinked.  A new event takes the first free
+ * position, and any event already in the graph that names it as a trigger is
+ * relinked so the new dependency is picked up.
+ */
+
+static int applyevents (const struct RecordSet *oldset,
+                        const struct RecordSet *newset,
+                        struct EventGraph *graph, struct RuleDelta *delta)
+{
+    char fields[MAXNUMFIELDS][MAXFIELDLEN];
+    char buffer[MAXRECORDLENGTH];
+    struct CourtEvent *changed; /* every event removed or added */
+    struct CourtEvent *event;
+    struct CourtEventNode *node, *other;
+    const char **removed, **added;
+    int numremoved, numadded, numfields, numchanged, numold, index, posn;
+    int status = RL_OK;
+
+    if (diffrecords(oldset, newset, &removed, &numremoved, &added,
+                    &numadded) != RL_OK)
+        return RL_ENOMEM;
+    changed = malloc((numremoved + numadded + 1) * sizeof(struct CourtEvent));
+    if (changed == NULL) {
+        free(removed);
+        free(added);
+        return RL_ENOMEM;
+    }
+
+    strcpy(buffer, newset->fieldline);
+    numfields = parsefieldnames(buffer, fields);
+
+    /* Parse the removed records first, then the added ones, so each half of
+    the changed list can be searched for the other. */
+    numchanged = 0;
+    for (index = 0; index < numremoved; index++) {
+        strcpy(buffer, removed[index]);
+        if (parseeventrecord(buffer, fields, numfields,
+                             &changed[numchanged]) == 0)
+            numchanged++;
+    }
+    numold = numchanged;
+    for (index = 0; index < numadded; index++) {
+        strcpy(buffer, added[index]);
+        if (parseeventrecord(buffer, fields, numfields,
+                             &changed[numchanged]) == 0)
+            numchanged++;
+    }
+
+    /* Delete the events that are gone from the file altogether. */
+    for (index = 0; index < numold; index++) {
+        for (posn = numold; posn < numchanged; posn++)
+            if (eventcmp(changed[index].shorttitle,
+                         changed[posn].shorttitle) == 0)
+                break;
+        if (posn < numchanged)
+            continue; /* edited, not removed */
+        node = searchforevent(changed[index].shorttitle, graph->eventlist);
+        if (node != NULL && deleteevent(&node->eventdata, graph))
+            delta->eventsremoved++;
+    }
+
+    /* Replace the edited events and insert the new ones. */
+    for (index = numold; index < numchanged && status == RL_OK; index++) {
+        event = &changed[index];
+        node = searchforevent(event->shorttitle, graph->eventlist);
+        if (node != NULL) {
+            replaceevent(event, &node->eventdata);
+            linkevent(node, graph);
+            delta->eventschanged++;
+            continue;
+        }
+
+        if ((posn = freeeventposn(graph)) < 0) {
+            status = RL_ENOMEM;
+            break;
+        }
+        graph->eventlist = insertevent(event, graph->eventlist);
+        node = searchforevent(event->shorttitle, graph->eventlist);
+        if (node == NULL) {
+            status = RL_ENOMEM;
+            break;
+        }
+        node->eventposn = posn;
+        graph->listsize++;
+        linkevent(node, graph);
+        for (other = graph->eventlist; other != NULL;
+                other = other->nextevent)
+            if (other != node &&
+                    (eventcmp(other->eventdata.ntc_dependency1,
+                              event->shorttitle) == 0 ||
+                     eventcmp(other->eventdata.ntc_dependency2,
+                              event->shorttitle) == 0))
+                linkevent(other, graph);
+        delta->eventsadded++;
+    }
+
+    if (status == RL_OK)
+        status = markstale(graph, changed, numchanged, delta);
+
+    free(changed);
+    free(removed);
+    free(added);
+    return status;
+}		/* -----  end of function applyevents  ----- */
+
+
+/*
+ * Description: Unlinks and frees the node holding a rule.
+ *
+ * Parameters: The address of the head of the month's list and the rule.
+ *
+ * Returns: 1 if the rule was found and removed, 0 if it was not found.
+ */
+
+static int removeholidayrule (struct HolidayNode **list,
+                              const struct HolidayRule *rule)
+{
+    struct HolidayNode **link, *node;
+
+    for (link = list; *link != NULL; link = &(*link)->nextrule) {
+        node = *link;
+        if (node->rule.month == rule->month &&
+                node->rule.ruletype == rule->ruletype &&
+                node->rule.wkday == rule->wkday &&
+                node->rule.wknum == rule->wknum &&
+                node->rule.day == rule->day &&
+                strcmp(node->rule.holidayname, rule->holidayname) == 0 &&
+                strcmp(node->rule.authority, rule->authority) == 0) {
+            *link = node->nextrule;
+            free(node);
+            return 1;
+        }
+    }
+    return 0;
+}		/* -----  end of function removeholidayrule  ----- */
+
+
+/*
+ * Description: Finds a free event position, growing the matrix if needed.
+ *
+ * Parameters: The graph.
+ *
+ * Returns: The position, or -1 if the matrix could not be grown.
+ *
+ * Notes: Deleted events leave holes in the positions; they are reused before
+ * the matrix is grown.
+ */
+
+static int freeeventposn (struct EventGraph *graph)
+{
+    struct CourtEventNode *node;
+    unsigned char *used;
+    int size, posn;
+
+    size = graph->dependencymatrix.trigger_rows;
+    if (graph->listsize < size) {
+        if ((used = calloc(size, 1)) == NULL)
+            return -1;
+        for (node = graph->eventlist; node != NULL; node = node->nextevent)
+            if (node->eventposn >= 0 && node->eventposn < size)
+                used[node->eventposn] = 1;
+        for (posn = 0; posn < size && used[posn]; posn++)
+            ;
+        free(used);
+        if (posn < size)
+            return posn;
+    }
+
+    if (resizeadjacencymatrix(graph, (size > 0) ? size * 2 : 16) != 0)
+        return -1;
+    return size;
+}		/* -----  end of function freeeventposn  ----- */
+
+
+/*
+ * Description: Marks the changed events and every event downstream of them.
+ *
+ * Parameters: The graph, the list of events removed or added by the reload,
+ * and the delta to fill in.
+ *
+ * Returns: RL_OK or RL_ENOMEM.
+ *
+ * Algorithm: An event is stale if it was edited or added, or if it names a
+ * removed, edited, or added event as a trigger.  Staleness then flows along
+ * the TRIGGERS dependencies of the matrix, breadth first, so everything
+ * computed from a stale event is stale too.
+ */
+
+static int markstale (struct EventGraph *graph,
+                      const struct CourtEvent *changed, int numchanged,
+                      struct RuleDelta *delta)
+{
+    struct AdjacencyMatrix *matrix = &graph->dependencymatrix;
+    struct CourtEventNode *node;
+    int *queue; /* positions waiting to be visited */
+    int head, tail, index, row, col, size;
+
+    if (numchanged == 0)
+        return RL_OK;
+
+    size = matrix->trigger_rows;
+    delta->staleevents = calloc(size + 1, 1);
+    queue = malloc((size + 1) * sizeof(int));
+    if (delta->staleevents == NULL || queue == NULL) {
+        free(queue);
+        return RL_ENOMEM;
+    }
+    delta->numpositions = size;
+
+    tail = 0;
+    for (node = graph->eventlist; node != NULL; node = node->nextevent) {
+        for (index = 0; index < numchanged; index++)
+            if (eventcmp(node->eventdata.shorttitle,
+                         changed[index].shorttitle) == 0 ||
+                    eventcmp(node->eventdata.ntc_dependency1,
+                             changed[index].shorttitle) == 0 ||
+                    eventcmp(node->eventdata.ntc_dependency2,
+                             changed[index].shorttitle) == 0)
+                break;
+        if (index < numchanged && !delta->staleevents[node->eventposn]) {
+            delta->staleevents[node->eventposn] = 1;
+            queue[tail++] = node->eventposn;
+        }
+    }
+
+    for (head = 0; head < tail; head++) {
+        row = queue[head];
+        for (col = 0; col < matrix->triggeredby_cols; col++)
+            if (matrix->rowptr[row][col].dependencyhandle != NULL &&
+                    TEST_FLAG(matrix->rowptr[row][col].dependencyflag,
+                              TRIGGERS) &&
+                    !delta->staleevents[col]) {
+                delta->staleevents[col] = 1;
+                queue[tail++] = col;
+            }
+    }
+
+    delta->numstale = tail;
+    free(queue);
+    return RL_OK;
+}		/* -----  end of function markstale  ----- */
+
+
+/*
+ * Description: qsort() comparison for RecordHash: by hash, then by text, so
+ * records that collide on the hash still sort deterministically.
+ */
+
+static int recordcmp (const void *rec1, const void *rec2)
+{
+    const struct RecordHash *r1 = rec1;
+    const struct RecordHash *r2 = rec2;
+
+    if (r1->hash != r2->hash)
+        return (r1->hash < r2->hash) ? -1 : 1;
+    return strcmp(r1->record, r2->record);
+}		/* -----  end of function recordcmp  ----- */
+
+
+/*
+ * Description: FNV-1a hash of a record.
+ */
+
+static uint64_t hashrecord (const char *record)
+{
+    uint64_t hash = FNV_OFFSET;
+
+    while (*record != '\0') {
+        hash ^= (unsigned char) *record++;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}		/* -----  end of function hashrecord  ----- */
@@ -0,0 +1,124 @@
+/*
+ * Filename: rulereload.h
+ * Project: DocketMaster
+ *
+ * Description: The rule reload module brings the live holiday rules, court
+ * calendar, and event graph up to date after the rules files have been
+ * edited, without rebuilding them.  Every record of the files is hashed when
+ * the rules are built; on reload the files are hashed again and only the
+ * records that were added, removed, or changed are applied.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 09:04:10 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: buildre() records the baseline by calling baselinerules().  After
+ * the files change, reloadre() applies the differences and reports what was
+ * affected in a RuleDelta.
+ *
+ * File Format: Same holiday and events files read by buildre().
+ *
+ * Restrictions: Reloading only works on structures built by buildre().
+ * Rules restored from a rule pack or a snapshot live in a read-only (or
+ * private) mapping and have no baseline; reloadre() refuses them.  If the
+ * header or field-name lines of a file change, the records can no longer be
+ * compared and the rules must be rebuilt.
+ *
+ * Error Handling: The functions return the negative RL_E codes below.
+ * References:
+ * Notes:
+ */
+
+#ifndef _RULERELOAD_H_INCLUDED_
+#define _RULERELOAD_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include "graphmgr.h"
+#include "courtcal.h"
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+/*------------------------------------------------------------------------------
+ *  Reload error codes
+ *----------------------------------------------------------------------------*/
+#define RL_OK 0
+#define RL_EOPEN -1 /* a rules file could not be opened */
+#define RL_ENOBASE -2 /* the rules were not built by buildre() */
+#define RL_EFORMAT -3 /* a file's header or field names changed; rebuild */
+#define RL_ENOMEM -4 /* out of memory */
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+/* What a reload changed.  The calendar months and the events listed here are
+the only ones whose cached results are no longer good. */
+struct RuleDelta {
+    int holidaysadded;
+    int holidaysremoved;
+    int eventsadded;
+    int eventsremoved;
+    int eventschanged;
+    unsigned int monthmask; /* bit (month - 1) set for each month whose
+                               holiday rules changed; the ALLMONTHS bit means
+                               every month. */
+    unsigned char *staleevents; /* one entry per event position; nonzero if
+                                   the event, or any event upstream of it in
+                                   its chain, changed.  NULL if none did. */
+    int numstale; /* number of nonzero entries in staleevents */
+    int numpositions; /* number of entries in staleevents */
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Hashes every record of the rules files the live structures
+ * were just built from, for later reloads to compare against.
+ *
+ * Parameters: Names of the holiday file and the events file.
+ *
+ * Returns: RL_OK if successful, otherwise a negative RL_E code.
+ */
+
+int baselinerules(const char *holiday, const char *events);
+
+/*
+ * Description: Applies the changes made to the rules files since they were
+ * last built or reloaded to THE holiday hash table, calendar, and event
+ * graph.
+ *
+ * Parameters: Names of the holiday file and the events file, and the
+ * RuleDelta to fill in.
+ *
+ * Returns: RL_OK if successful, otherwise a negative RL_E code.  On RL_OK the
+ * caller must release the delta with freeruledelta().
+ */
+
+int reloadre(const char *holiday, const char *events,
+             struct RuleDelta *delta);
+
+/*
+ * Description: Releases the memory held by a RuleDelta.
+ *
+ * Parameters: The delta.
+ *
+ * Returns: Nothing.
+ */
+
+void freeruledelta(struct RuleDelta *delta);
+
+/*
+ * Description: Determines whether a reload made the results computed for an
+ * event stale.
+ */
+
+#define ISSTALEEVENT(delta, posn) \
+    ((delta)->staleevents != NULL && (posn) >= 0 && \
+     (posn) < (delta)->numpositions && (delta)->staleevents[(posn)])
+
+#endif	/* _RULERELOAD_H_INCLUDED_ */
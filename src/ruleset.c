@@ -0,0 +1,265 @@
+/*
+ * Filename: ruleset.c
+ * Project: DocketMaster
+ *
+ * Description: Publishing and reclaiming immutable rule sets.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:33:29 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Called by the server manager and by main() for the serve command.
+ * File Format:
+ * Restrictions:
+ * Error Handling:
+ * References: The read side is a form of read-copy-update: readers never
+ * lock, and a writer replaces the data rather than changing it, then waits
+ * for a grace period before the old copy can be reclaimed.
+ * Notes: A reader cannot load the current pointer and add to the set's
+ * count in one step, so a set could be freed between the two.  To close
+ * that window, a reader also counts itself in one of two pin counters while
+ * it pins.  A publisher swaps the pointer and then waits for each of the
+ * counters to empty, switching new readers to the other counter first so
+ * the one it waits for can empty.  Any reader that loaded the old pointer
+ * has added to the old set's count by then, so dropping the publisher's
+ * reference is safe.
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include "ruleset.h"
+#include "rulebuilder.h"
+#include "lexicalanalyzer.h"
+#include "eprocessor.h"
+#include "datetools.h"
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
+
+static struct RuleSet *current; /* the published set */
+static long pinning[2]; /* readers between loading current and adding to
+                           its count, by the phase they started in */
+static int phase; /* which of pinning new readers count themselves in */
+static unsigned long generations; /* sets published so far */
+static long live; /* sets not yet freed */
+
+static pthread_mutex_t publishlock = PTHREAD_MUTEX_INITIALIZER;
+    /* one publisher at a time */
+static pthread_mutex_t loadlock = PTHREAD_MUTEX_INITIALIZER;
+    /* one build at a time; the parser is not reentrant */
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static void freeruleset (struct RuleSet *set);
+    /* Frees a set and, if it owns them, its rules */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description:  Builds a rule set from the rules files.
+ *
+ * Parameters:  Names of the holiday file, the events file, and the extras
+ * file (NULL or empty if there is none), and where to put the set.
+ *
+ * Returns:  RS_OK, or a negative RS_E code.
+ *
+ * Algorithm:  The same steps as buildre(), into the set's own holiday table,
+ * calendar, and graph rather than THE global ones.  If there are local
+ * rules, the set's graph is then replaced by the events in force, as
+ * eventsinforce() gives them for THE rules.
+ */
+
+int loadruleset (const char *holiday, const char *events, const char *extras,
+                 struct RuleSet **set)
+{
+    struct RuleSet *newset;
+    struct LocalRules layer; /* the local rules of the extras file */
+    struct RuleView view;
+    struct EventGraph inforce; /* the set's events with the layer applied */
+    FILE *in_file;
+    int result = RS_OK;
+
+    *set = NULL;
+    memset(&layer, 0, sizeof(layer));
+    newset = calloc(1, sizeof(struct RuleSet));
+    if (newset == NULL)
+        return RS_ENOMEM;
+    newset->owned = 1;
+    newset->refs = 1;
+    newset->graph = &newset->events;
+    newset->cal = &newset->calendar;
+    __atomic_fetch_add(&live, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&loadlock);
+    clearerrors(); /* report only this load's errors */
+    initializelist(newset->holidays);
+    in_file = getfile((char *) holiday);
+    if (parsefile(in_file, holiday, newset->holidays) < 0)
+        result = RS_EOPEN;
+    closefile(in_file);
+
+    init_eventgraph(&newset->events, 0);
+    in_file = getfile((char *) events);
+    if (parsefile(in_file, events, &newset->events) < 0)
+        result = RS_EOPEN;
+    closefile(in_file);
+
+    if (extras != NULL && *extras != '\0') {
+        in_file = getfile((char *) extras);
+        if (parsefile(in_file, extras, &layer) < 0)
+            result = RS_EOPEN;
+        closefile(in_file);
+    }
+    pthread_mutex_unlock(&loadlock);
+
+    if (result == RS_OK &&
+            (finalizeeventgraph(&newset->events) < 0 ||
+             buildcalendar(&newset->calendar, newset->holidays,
+                           CAL_FIRSTYEAR, CAL_LASTYEAR) != 0 ||
+             materializecalendar(&newset->calendar) != 0))
+        result = RS_ENOMEM;
+    if (result == RS_OK && layer.numrules > 0) {
+        if (buildview(&view, &newset->events, &layer) < 0 ||
+                viewgraph(&view, &inforce) < 0) {
+            result = RS_ENOMEM;
+        } else {
+            freeeventgraph(&newset->events);
+            newset->events = inforce;
+        }
+        freeview(&view);
+    }
+    freelocalrules(&layer);
+    if (result != RS_OK) {
+        freeruleset(newset);
+        return result;
+    }
+    *set = newset;
+    return RS_OK;
+}		/* -----  end of function loadruleset  ----- */
+
+/*
+ * Description:  Makes a rule set of rules that are already built.
+ * Parameters:  The graph and calendar.
+ * Returns:  The set, or NULL if out of memory.
+ */
+
+struct RuleSet *wrapruleset (const struct EventGraph *graph,
+                             const struct CourtCalendar *cal)
+{
+    struct RuleSet *set;
+
+    set = calloc(1, sizeof(struct RuleSet));
+    if (set == NULL)
+        return NULL;
+    set->graph = graph;
+    set->cal = cal;
+    set->refs = 1;
+    __atomic_fetch_add(&live, 1, __ATOMIC_RELAXED);
+    return set;
+}		/* -----  end of function wrapruleset  ----- */
+
+/*
+ * Description:  Makes a rule set the current one.
+ *
+ * Parameters:  The set.
+ *
+ * Returns:  The set's generation.
+ *
+ * Algorithm:  See the notes at the top of this file.  The wait is for
+ * readers that are part way through pinruleset(), a few instructions, not
+ * for requests to finish.
+ */
+
+unsigned long publishruleset (struct RuleSet *set)
+{
+    struct RuleSet *old;
+    unsigned long generation;
+    int flip, waitfor;
+
+    pthread_mutex_lock(&publishlock);
+    generation = set->generation = ++generations;
+    old = __atomic_exchange_n(&current, set, __ATOMIC_SEQ_CST);
+    for (flip = 0; flip < 2; flip++) {
+        waitfor = __atomic_load_n(&phase, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&phase, !waitfor, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pinning[waitfor], __ATOMIC_SEQ_CST) != 0)
+            sched_yield();
+    }
+    pthread_mutex_unlock(&publishlock);
+
+    unpinruleset(old);
+    return generation;
+}		/* -----  end of function publishruleset  ----- */
+
+/*
+ * Description:  Pins the current rule set.
+ * Parameters:  None.
+ * Returns:  The set, or NULL if none has been published.
+ */
+
+struct RuleSet *pinruleset (void)
+{
+    struct RuleSet *set;
+    int counter;
+
+    counter = __atomic_load_n(&phase, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&pinning[counter], 1, __ATOMIC_SEQ_CST);
+    set = __atomic_load_n(&current, __ATOMIC_SEQ_CST);
+    if (set != NULL)
+        __atomic_fetch_add(&set->refs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&pinning[counter], 1, __ATOMIC_RELEASE);
+    return set;
+}		/* -----  end of function pinruleset  ----- */
+
+/*
+ * Description:  Unpins a rule set, freeing it if no one is using it.
+ * Parameters:  The set, or NULL.
+ * Returns:  Nothing.
+ */
+
+void unpinruleset (struct RuleSet *set)
+{
+    if (set != NULL && __atomic_sub_fetch(&set->refs, 1,
+                                          __ATOMIC_ACQ_REL) == 0)
+        freeruleset(set);
+    return;
+}		/* -----  end of function unpinruleset  ----- */
+
+/*
+ * Description:  Counts the rule sets not yet freed.
+ * Parameters:  None.
+ * Returns:  The number of sets.
+ */
+
+long liverulesets (void)
+{
+    return __atomic_load_n(&live, __ATOMIC_RELAXED);
+}		/* -----  end of function liverulesets  ----- */
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description:  Frees a set and, if it owns them, its rules.
+ */
+
+static void freeruleset (struct RuleSet *set)
+{
+    if (set->owned) {
+        freecalendar(&set->calendar);
+        freeeventgraph(&set->events);
+        closerules(set->holidays);
+    }
+    free(set);
+    __atomic_fetch_sub(&live, 1, __ATOMIC_RELAXED);
+    return;
+}		/* -----  end of function freeruleset  ----- */
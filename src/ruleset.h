@@ -0,0 +1,151 @@
+/*
+ * Filename: ruleset.h
+ * Project: DocketMaster
+ *
+ * Description: A rule set is one version of a jurisdiction's rules, its
+ * court calendar and event graph, that does not change once it has been
+ * built.  A long-running process publishes the rule set it computes from,
+ * and when the rules files are edited it builds a new set beside the old
+ * one and publishes that instead.  Each request pins the set that was
+ * current when it started and computes from it to the end, so a reload
+ * neither waits for requests nor makes them wait; the old set is released
+ * once the last request using it is done.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:33:29 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Build a set with loadruleset(), or wrap rules that are already
+ * built with wrapruleset(), and publishruleset() it.  To answer a request,
+ * pinruleset() the current set, compute from set->graph and set->cal, and
+ * unpinruleset() it.
+ *
+ * File Format: Same holiday, events, and extras files read by buildre().
+ *
+ * Restrictions: Nothing in a published set may be changed.  A set's graph
+ * is the events in force: the local rules of the extras file are already
+ * applied to it.
+ *
+ * Error Handling: loadruleset() returns RS_OK or a negative RS_E code.
+ * References:
+ * Notes:
+ */
+
+#ifndef _RULESET_H_INCLUDED_
+#define _RULESET_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include "graphmgr.h"
+#include "courtcal.h"
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+/*------------------------------------------------------------------------------
+ *  Rule set error codes
+ *----------------------------------------------------------------------------*/
+#define RS_OK 0
+#define RS_EOPEN -1 /* a rules file could not be read */
+#define RS_ENOMEM -2 /* out of memory */
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+struct RuleSet {
+    const struct EventGraph *graph; /* the rules to compute from */
+    const struct CourtCalendar *cal;
+    unsigned long generation; /* 1 for the first set published, and so on */
+    long refs; /* pins, plus one while the set is current; updated
+                  atomically */
+    int owned; /* nonzero if the set was built by loadruleset() and owns
+                  the rules below */
+    struct HolidayNode *holidays[13];
+    struct CourtCalendar calendar;
+    struct EventGraph events;
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Builds a rule set from the rules files.
+ *
+ * Parameters: Names of the holiday file, the events file, and the extras
+ * file (NULL or empty if there is none), and where to put the set.
+ *
+ * Returns: RS_OK, or a negative RS_E code.  The set is the caller's, with
+ * one reference, until it is published.
+ *
+ * Notes: Nothing global is changed, so the set may be built while requests
+ * are being answered from another.  Builds run one at a time.
+ */
+
+int loadruleset (const char *holiday, const char *events, const char *extras,
+                 struct RuleSet **set);
+
+/*
+ * Description: Makes a rule set of rules that are already built, such as
+ * THE events in force (see eventsinforce()) and calendar.
+ *
+ * Parameters: The graph and calendar, which must not change or be freed
+ * while the set is in use.
+ *
+ * Returns: The set, with one reference, or NULL if out of memory.  Freeing
+ * the set does not free the graph or calendar.
+ */
+
+struct RuleSet *wrapruleset (const struct EventGraph *graph,
+                             const struct CourtCalendar *cal);
+
+/*
+ * Description: Makes a rule set the current one.
+ *
+ * Parameters: The set, whose reference passes to this module.
+ *
+ * Returns: The set's generation.
+ *
+ * Notes: Returns once no request can still be pinning the set it replaced.
+ * That set is freed when the last request that pinned it unpins it, which
+ * may be before this returns.
+ */
+
+unsigned long publishruleset (struct RuleSet *set);
+
+/*
+ * Description: Pins the current rule set so it is not freed while in use.
+ *
+ * Parameters: None.
+ *
+ * Returns: The set, or NULL if none has been published.  Never blocks, and
+ * takes no lock.
+ */
+
+struct RuleSet *pinruleset (void);
+
+/*
+ * Description: Unpins a rule set, freeing it if it is no longer current and
+ * no one else has it pinned.
+ *
+ * Parameters: The set, or NULL.
+ *
+ * Returns: Nothing.
+ */
+
+void unpinruleset (struct RuleSet *set);
+
+/*
+ * Description: Counts the rule sets that have been built or wrapped and not
+ * yet freed.
+ *
+ * Parameters: None.
+ *
+ * Returns: The number of sets.
+ */
+
+long liverulesets (void);
+
+#endif	/* _RULESET_H_INCLUDED_ */
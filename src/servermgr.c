@@ -0,0 +1,712 @@
+/*
+ * Filename: servermgr.c
+ * Project: DocketMaster
+ *
+ * Description: The server manager answers deadline and schedule requests
+ * over a local socket.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:06:33 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Called by main() for the serve command.
+ * File Format: See servermgr.h.
+ * Restrictions:
+ * Error Handling: A client that breaks the framing is disconnected; nothing
+ * a client sends stops the server.
+ * References:
+ * Notes: Each client has its own thread.  The thread reads as many requests
+ * as have arrived, answers them all into one buffer, and sends the buffer
+ * with one write, so a client that pipelines its requests gets its answers
+ * in as few system calls as possible.  The buffer and the client's arena
+ * are kept for as long as it is connected, so a client's requests stop
+ * allocating once the first few have grown them to fit.
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "servermgr.h"
+#include "batchmgr.h"
+#include "outputmgr.h"
+#include "arena.h"
+#include "ruleset.h"
+#include "metrics.h"
+#include "promexport.h"
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* A running server, shared by its threads. */
+struct Server {
+    pthread_mutex_t lock; /* guards the rest */
+    pthread_cond_t idle; /* signaled when a client disconnects */
+    int numclients;
+    int clientfds[SV_MAXCLIENTS];
+};
+
+/* One connected client. */
+struct Client {
+    struct Server *server;
+    int fd;
+    char input[SV_BUFSIZE]; /* requests read but not yet answered */
+    size_t have; /* bytes in input */
+    struct ServerSession session;
+};
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
+
+static volatile sig_atomic_t stopping; /* set by SIGINT and SIGTERM */
+
+static uint64_t latency[LAT_BUCKETS]; /* requests answered, by the time
+                                         taken; updated atomically */
+static uint64_t latencyns; /* the time taken by all of them */
+
+static struct ServerLimits limits = {SV_MAXCLIENTS, SV_MAXINFLIGHT,
+                                     SV_MAXPIPELINE};
+
+/* Admission counters; updated atomically */
+static int clients;
+static long inflight;
+static unsigned long admitted;
+static unsigned long busy;
+static unsigned long refused;
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static void * serveclient (void *arg);
+    /* Answers a client's requests until it disconnects */
+
+static int answerschedule (struct ServerSession *session,
+                           const struct RuleSet *rules,
+                           const unsigned char *request, size_t len);
+    /* Computes the schedule a request asks for */
+
+static int sendall (int fd, const char *data, size_t len);
+    /* Sends all of the bytes */
+
+static void sendbusy (int fd);
+    /* Tells a client it is being turned away */
+
+static int addclient (struct Server *server, int fd);
+    /* Records a client as connected */
+
+static void removeclient (struct Server *server, int fd);
+    /* Records a client as disconnected */
+
+static void onsignal (int signum);
+    /* Asks the server to stop */
+
+static void recordlatency (uint64_t ns);
+    /* Counts a request in the latency histogram */
+
+static void putprobes (struct OutputSink *out);
+    /* Writes the counts of the hot path probes */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description:  Answers requests on a local socket until the process is
+ * interrupted or terminated.
+ *
+ * Parameters:  The path of the socket.
+ *
+ * Returns:  SV_OK once stopped, or a negative SV_E code.
+ *
+ * Algorithm:  The calling thread accepts connections and starts a thread for
+ * each client.  It wakes twice a second to see whether a signal has asked it
+ * to stop; if one has, it stops accepting, shuts down every client's
+ * connection, and waits for their threads to finish.
+ */
+
+int runserver (const char *socketpath)
+{
+    struct Server server;
+    struct sockaddr_un addr;
+    struct sigaction action, oldint, oldterm;
+    struct pollfd listener;
+    struct Client *client;
+    pthread_attr_t attr;
+    pthread_t thread;
+    int listenfd, fd, index;
+
+    if (strlen(socketpath) >= sizeof(addr.sun_path))
+        return SV_ESOCKET;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketpath);
+
+    listenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenfd < 0)
+        return SV_ESOCKET;
+    unlink(socketpath);
+    if (bind(listenfd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+            listen(listenfd, SOMAXCONN) != 0) {
+        close(listenfd);
+        return SV_ESOCKET;
+    }
+
+    memset(&server, 0, sizeof(server));
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.idle, NULL);
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    stopping = 0;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onsignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &oldint);
+    sigaction(SIGTERM, &action, &oldterm);
+
+    listener.fd = listenfd;
+    listener.events = POLLIN;
+    while (!stopping) {
+        if (poll(&listener, 1, 500) <= 0)
+            continue;
+        fd = accept(listenfd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        if (addclient(&server, fd) != 0) {
+            refuseclient();
+            sendbusy(fd);
+            close(fd);
+            continue;
+        }
+        client = countedmalloc(sizeof(struct Client));
+        if (client == NULL) {
+            removeclient(&server, fd);
+            continue;
+        }
+        client->server = &server;
+        client->fd = fd;
+        client->have = 0;
+        if (pthread_create(&thread, &attr, serveclient, client) != 0) {
+            removeclient(&server, fd);
+            countedfree(client);
+        }
+    }
+
+    close(listenfd);
+    unlink(socketpath);
+    pthread_mutex_lock(&server.lock);
+    for (index = 0; index < server.numclients; index++)
+        shutdown(server.clientfds[index], SHUT_RDWR);
+    while (server.numclients > 0)
+        pthread_cond_wait(&server.idle, &server.lock);
+    pthread_mutex_unlock(&server.lock);
+
+    sigaction(SIGINT, &oldint, NULL);
+    sigaction(SIGTERM, &oldterm, NULL);
+    pthread_attr_destroy(&attr);
+    pthread_cond_destroy(&server.idle);
+    pthread_mutex_destroy(&server.lock);
+    return SV_OK;
+}		/* -----  end of function runserver  ----- */
+
+/*
+ * Description:  Reports the time taken to answer the requests so far.
+ * Parameters:  The report to fill in.
+ * Returns:  Nothing.
+ */
+
+void serverlatency (struct LatencyReport *report)
+{
+    uint64_t counts[LAT_BUCKETS], total;
+    int index;
+
+    total = 0;
+    for (index = 0; index < LAT_BUCKETS; index++) {
+        counts[index] = __atomic_load_n(&latency[index], __ATOMIC_RELAXED);
+        total += counts[index];
+    }
+    report->requests = (unsigned long) total;
+    report->p50 = histpercentile(counts, total, 0.50) / 1000.0;
+    report->p99 = histpercentile(counts, total, 0.99) / 1000.0;
+    return;
+}		/* -----  end of function serverlatency  ----- */
+
+/*
+ * Description:  Reports the time taken to answer the requests so far as a
+ * histogram.
+ * Parameters:  The ProbeStats to fill in.
+ * Returns:  Nothing.
+ */
+
+void serverhistogram (struct ProbeStats *stats)
+{
+    int index;
+
+    memset(stats, 0, sizeof(struct ProbeStats));
+    for (index = 0; index < LAT_BUCKETS; index++) {
+        stats->counts[index] = __atomic_load_n(&latency[index],
+                                               __ATOMIC_RELAXED);
+        stats->timed += stats->counts[index];
+    }
+    stats->calls = stats->timed;
+    stats->totalns = __atomic_load_n(&latencyns, __ATOMIC_RELAXED);
+    return;
+}		/* -----  end of function serverhistogram  ----- */
+
+/*
+ * Description:  Sets the server's limits.
+ * Parameters:  The limits; zero or less for the default.
+ * Returns:  Nothing.
+ */
+
+void setserverlimits (const struct ServerLimits *newlimits)
+{
+    limits.maxclients = (newlimits->maxclients > 0 &&
+                         newlimits->maxclients < SV_MAXCLIENTS) ?
+        newlimits->maxclients : SV_MAXCLIENTS;
+    limits.maxinflight = (newlimits->maxinflight > 0) ?
+        newlimits->maxinflight : SV_MAXINFLIGHT;
+    limits.maxpipeline = (newlimits->maxpipeline > 0) ?
+        newlimits->maxpipeline : SV_MAXPIPELINE;
+    return;
+}		/* -----  end of function setserverlimits  ----- */
+
+/*
+ * Description:  Reports the server's limits.
+ * Parameters:  The limits to fill in.
+ * Returns:  Nothing.
+ */
+
+void getserverlimits (struct ServerLimits *report)
+{
+    *report = limits;
+    return;
+}		/* -----  end of function getserverlimits  ----- */
+
+/*
+ * Description:  Reports the clients and requests under way and turned away.
+ * Parameters:  The report to fill in.
+ * Returns:  Nothing.
+ */
+
+void serveradmission (struct AdmissionReport *report)
+{
+    report->clients = __atomic_load_n(&clients, __ATOMIC_RELAXED);
+    report->inflight = __atomic_load_n(&inflight, __ATOMIC_RELAXED);
+    report->admitted = __atomic_load_n(&admitted, __ATOMIC_RELAXED);
+    report->busy = __atomic_load_n(&busy, __ATOMIC_RELAXED);
+    report->refused = __atomic_load_n(&refused, __ATOMIC_RELAXED);
+    return;
+}		/* -----  end of function serveradmission  ----- */
+
+/*
+ * Description:  Admits a request to be computed if the server is under its
+ * maxinflight limit.
+ *
+ * Parameters:  None.
+ *
+ * Returns:  Nonzero if admitted, or zero if the server is busy.
+ *
+ * Algorithm:  The count is taken first and given back if it went over the
+ * limit, so two requests can never both take the last place.
+ */
+
+int admitrequest (void)
+{
+    if (__atomic_add_fetch(&inflight, 1, __ATOMIC_RELAXED) >
+            limits.maxinflight) {
+        __atomic_fetch_sub(&inflight, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&busy, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    __atomic_fetch_add(&admitted, 1, __ATOMIC_RELAXED);
+    return 1;
+}		/* -----  end of function admitrequest  ----- */
+
+/*
+ * Description:  Counts an admitted request as finished.
+ */
+
+void finishrequest (void)
+{
+    __atomic_fetch_sub(&inflight, 1, __ATOMIC_RELAXED);
+    return;
+}		/* -----  end of function finishrequest  ----- */
+
+/*
+ * Description:  Counts a client turned away.
+ */
+
+void refuseclient (void)
+{
+    __atomic_fetch_add(&refused, 1, __ATOMIC_RELAXED);
+    return;
+}		/* -----  end of function refuseclient  ----- */
+
+/*
+ * Description:  Sets up a session to answer requests.
+ * Parameters:  The session.
+ * Returns:  SV_OK, or SV_ENOMEM.
+ */
+
+int opensession (struct ServerSession *session)
+{
+    if (arenainit(&session->arena, SV_ARENASIZE) != AR_OK)
+        return SV_ENOMEM;
+    if (sinkopenmemory(&session->output) != OUT_OK) {
+        arenafree(&session->arena);
+        return SV_ENOMEM;
+    }
+    return SV_OK;
+}		/* -----  end of function opensession  ----- */
+
+/*
+ * Description:  Answers one request, adding the response to the session's
+ * output.
+ *
+ * Parameters:  The session, and the request and its length, less the length
+ * prefix.
+ *
+ * Returns:  Nothing.
+ *
+ * Algorithm:  Room for the response's length and status is left in the
+ * output, the response is written after it, and the length and status are
+ * filled in once the response is done.  A schedule is computed from the
+ * rule set current when the request began, which stays pinned until the
+ * request is answered even if new rules are published meanwhile.
+ */
+
+void answerrequest (struct ServerSession *session,
+                    const unsigned char *request, size_t len)
+{
+    struct OutputSink *out = &session->output;
+    struct RuleSet *rules;
+    struct LatencyReport report;
+    struct AllocStats allocs;
+    struct AdmissionReport admission;
+    uint64_t start;
+    uint32_t framelen;
+    size_t header;
+    int status;
+
+    start = metricclock();
+    header = out->used;
+    sinkwrite(out, "\0\0\0\0", sizeof(framelen) + 1);
+
+    status = SV_STATUS_BADREQUEST;
+    rules = NULL;
+    if (request[0] == SV_OP_SCHEDULE && len >= 2 &&
+            request[1] <= SCHED_BINARY) {
+        if (!admitrequest()) {
+            status = SV_STATUS_BUSY;
+            sinkputs(out, "server busy");
+        } else {
+            if ((rules = pinruleset()) == NULL) {
+                status = SV_STATUS_NOEVENT;
+                sinkputs(out, "no rules loaded");
+            } else {
+                status = answerschedule(session, rules, request, len);
+            }
+            finishrequest();
+        }
+    } else if (request[0] == SV_OP_STATS && len == 1) {
+        status = SV_STATUS_OK;
+        serverlatency(&report);
+        allocstats(&allocs);
+        serveradmission(&admission);
+        rules = pinruleset();
+        sinkprintf(out, "requests %lu\np50_us %.1f\np99_us %.1f\n"
+                   "heap_allocations %lu\nheap_bytes %llu\n"
+                   "arena_bytes %llu\nrules_generation %lu\n",
+                   report.requests, report.p50, report.p99,
+                   allocs.allocations, allocs.bytes, allocs.arenabytes,
+                   (rules != NULL) ? rules->generation : 0UL);
+        sinkprintf(out, "clients %d\nmax_clients %d\ninflight %ld\n"
+                   "max_inflight %d\nadmitted %lu\nrejected_busy %lu\n"
+                   "refused_clients %lu\n",
+                   admission.clients, limits.maxclients, admission.inflight,
+                   limits.maxinflight, admission.admitted, admission.busy,
+                   admission.refused);
+        putprobes(out);
+    } else if (request[0] == SV_OP_METRICS && len == 1) {
+        status = SV_STATUS_OK;
+        writeprometheus(out);
+    } else {
+        sinkputs(out, "bad request");
+    }
+    unpinruleset(rules);
+    arenareset(&session->arena);
+
+    if (out->error != OUT_OK)
+        return;
+    framelen = htonl((uint32_t) (out->used - header - sizeof(framelen)));
+    memcpy(out->buffer + header, &framelen, sizeof(framelen));
+    out->buffer[header + sizeof(framelen)] = (char) status;
+    recordlatency(metricclock() - start);
+    return;
+}		/* -----  end of function answerrequest  ----- */
+
+/*
+ * Description:  Releases a session's memory.
+ * Parameters:  The session.
+ * Returns:  Nothing.
+ */
+
+void closesession (struct ServerSession *session)
+{
+    sinkclose(&session->output);
+    arenafree(&session->arena);
+    return;
+}		/* -----  end of function closesession  ----- */
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description:  A client's thread: answers its requests until it
+ * disconnects, breaks the framing, or the server stops.
+ */
+
+static void * serveclient (void *arg)
+{
+    struct Client *client = arg;
+    struct Server *server = client->server;
+    uint32_t framelen;
+    size_t start;
+    ssize_t got;
+    int owed, maxpipeline;
+
+    if (opensession(&client->session) != SV_OK)
+        goto nosession;
+    maxpipeline = limits.maxpipeline;
+
+    while ((got = read(client->fd, client->input + client->have,
+                       SV_BUFSIZE - client->have)) > 0) {
+        client->have += got;
+        start = 0;
+        owed = 0;
+        while (client->have - start >= sizeof(framelen)) {
+            memcpy(&framelen, client->input + start, sizeof(framelen));
+            framelen = ntohl(framelen);
+            if (framelen == 0 || framelen > SV_MAXFRAME)
+                goto disconnect;
+            if (client->have - start - sizeof(framelen) < framelen)
+                break;
+            answerrequest(&client->session, (unsigned char *) client->input +
+                          start + sizeof(framelen), framelen);
+            start += sizeof(framelen) + framelen;
+            if (++owed == maxpipeline) {
+                /* Send what is owed before answering more, so a client
+                 * that does not read is not answered either. */
+                if (client->session.output.error != OUT_OK ||
+                        sendall(client->fd, client->session.output.buffer,
+                                client->session.output.used) != 0)
+                    goto disconnect;
+                sinkrewind(&client->session.output);
+                owed = 0;
+            }
+        }
+        memmove(client->input, client->input + start, client->have - start);
+        client->have -= start;
+
+        if (client->session.output.error != OUT_OK ||
+                sendall(client->fd, client->session.output.buffer,
+                        client->session.output.used) != 0)
+            goto disconnect;
+        sinkrewind(&client->session.output);
+    }
+
+disconnect:
+    closesession(&client->session);
+nosession:
+    removeclient(server, client->fd);
+    countedfree(client);
+    return NULL;
+}		/* -----  end of function serveclient  ----- */
+
+/*
+ * Description:  Computes the schedule a request asks for, and writes it or
+ * the reason it could not be computed to the session's output.
+ *
+ * Parameters:  The session, the rule set pinned for the request, and the
+ * request and its length.
+ *
+ * Returns:  The status of the response.
+ *
+ * Notes:  The request's text, trigger record, and schedule come from the
+ * arena, and the response is built in the output's buffer, which is kept
+ * from one request to the next; so once the arena and the buffer have grown
+ * to fit, a request allocates nothing.
+ */
+
+static int answerschedule (struct ServerSession *session,
+                           const struct RuleSet *rules,
+                           const unsigned char *request, size_t len)
+{
+    struct OutputSink *out = &session->output;
+    struct TriggerRecord *record;
+    struct ScheduledEvent *schedule;
+    char *line;
+    int count, maxevents;
+
+    maxevents = (rules->graph->listsize > 0) ? rules->graph->listsize : 1;
+    line = arenaalloc(&session->arena, len - 1);
+    record = arenaalloc(&session->arena, sizeof(struct TriggerRecord));
+    schedule = arenaalloc(&session->arena,
+                          maxevents * sizeof(struct ScheduledEvent));
+    if (line == NULL || record == NULL || schedule == NULL) {
+        sinkputs(out, "out of memory");
+        return SV_STATUS_NOMEM;
+    }
+
+    memcpy(line, request + 2, len - 2);
+    line[len - 2] = '\0';
+    if (parsetrigger(line, record) != BT_OK) {
+        sinkputs(out, "bad trigger record");
+        return SV_STATUS_BADREQUEST;
+    }
+    count = computetrigger(rules->graph, rules->cal, record, schedule,
+                           maxevents);
+    if (count < 0) {
+        sinkputs(out, "no such event");
+        return SV_STATUS_NOEVENT;
+    }
+    writeschedule(out, (enum SCHEDFORMAT) request[1], record->caseid,
+                  schedule, count);
+    return SV_STATUS_OK;
+}		/* -----  end of function answerschedule  ----- */
+
+/*
+ * Description:  Sends all of the bytes to a client.
+ * Returns:  Zero, or -1 if the client has gone.
+ */
+
+static int sendall (int fd, const char *data, size_t len)
+{
+    ssize_t sent;
+
+    while (len > 0) {
+        sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return -1;
+        data += sent;
+        len -= sent;
+    }
+    return 0;
+}		/* -----  end of function sendall  ----- */
+
+/*
+ * Description:  Tells a client that is being turned away that the server
+ * is busy, with one SV_STATUS_BUSY response.  The client's socket is not
+ * waited on: if the response does not fit in it, it is not sent.
+ */
+
+static void sendbusy (int fd)
+{
+    static const char response[] = "\0\0\0\014\004server busy";
+
+    send(fd, response, sizeof(response) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+    return;
+}		/* -----  end of function sendbusy  ----- */
+
+/*
+ * Description:  Records a client as connected.
+ * Returns:  Zero, or -1 if maxclients are already connected.
+ */
+
+static int addclient (struct Server *server, int fd)
+{
+    int result = -1;
+
+    pthread_mutex_lock(&server->lock);
+    if (server->numclients < limits.maxclients) {
+        server->clientfds[server->numclients++] = fd;
+        __atomic_fetch_add(&clients, 1, __ATOMIC_RELAXED);
+        result = 0;
+    }
+    pthread_mutex_unlock(&server->lock);
+    return result;
+}		/* -----  end of function addclient  ----- */
+
+/*
+ * Description:  Records a client as disconnected and closes its connection.
+ */
+
+static void removeclient (struct Server *server, int fd)
+{
+    int index;
+
+    pthread_mutex_lock(&server->lock);
+    for (index = 0; index < server->numclients; index++)
+        if (server->clientfds[index] == fd) {
+            server->clientfds[index] =
+                server->clientfds[--server->numclients];
+            __atomic_fetch_sub(&clients, 1, __ATOMIC_RELAXED);
+            break;
+        }
+    close(fd);
+    pthread_cond_signal(&server->idle);
+    pthread_mutex_unlock(&server->lock);
+    return;
+}		/* -----  end of function removeclient  ----- */
+
+/*
+ * Description:  Signal handler for SIGINT and SIGTERM.
+ */
+
+static void onsignal (int signum)
+{
+    (void) signum;
+    stopping = 1;
+    return;
+}		/* -----  end of function onsignal  ----- */
+
+/*
+ * Description:  Counts a request in the latency histogram.
+ * Parameters:  The time the request took, in nanoseconds.
+ */
+
+static void recordlatency (uint64_t ns)
+{
+    __atomic_fetch_add(&latency[latencybucket(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&latencyns, ns, __ATOMIC_RELAXED);
+    return;
+}		/* -----  end of function recordlatency  ----- */
+
+/*
+ * Description:  Writes a line of calls and percentile times for each hot
+ * path probe that has been called.  None has unless the engine was built
+ * with DM_METRICS.
+ * Parameters:  The output.
+ */
+
+static void putprobes (struct OutputSink *out)
+{
+    struct ProbeStats stats;
+    int probe;
+
+    for (probe = 0; probe < MP_NUMPROBES; probe++) {
+        probestats(probe, &stats);
+        if (stats.calls == 0)
+            continue;
+        sinkprintf(out, "probe_%s_calls %llu\nprobe_%s_p50_ns %.0f\n"
+                   "probe_%s_p99_ns %.0f\n", probename(probe), stats.calls,
+                   probename(probe),
+                   histpercentile(stats.counts, stats.timed, 0.50),
+                   probename(probe),
+                   histpercentile(stats.counts, stats.timed, 0.99));
+    }
+    return;
+}		/* -----  end of function putprobes  ----- */
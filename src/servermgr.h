@@ -0,0 +1,262 @@
+/*
+ * Filename: servermgr.h
+ * Project: DocketMaster
+ *
+ * Description: The server manager keeps the rules loaded and answers
+ * deadline and schedule requests over a local (Unix domain) socket, so a
+ * client pays for building the rules once rather than on every question.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:06:33 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Publish a rule set (see ruleset.h), then call runserver(), which
+ * returns once the process gets SIGINT or SIGTERM.  New rule sets may be
+ * published while it runs; requests already under way finish with the
+ * rules they started with.
+ *
+ * File Format: Every request and response is a frame: its length, as a
+ * 32-bit number in network byte order, and then that many bytes.
+ *
+ * A request is an operation byte followed by its arguments:
+ *     'S' format record   Computes a schedule, or a single deadline.  The
+ *                         format is one byte, an enum SCHEDFORMAT, and the
+ *                         record is a trigger record as read by the batch
+ *                         command (see batchmgr.h).
+ *     'T'                 Reports the number of requests answered, the
+ *                         50th and 99th percentile time taken, the heap
+ *                         allocations made, the generation of the rules in
+ *                         use, and the clients and requests under way and
+ *                         turned away, as text.
+ *     'P'                 Reports every metric in the Prometheus text
+ *                         format (see promexport.h).
+ *
+ * A response is a status byte (SV_STATUS) followed by the schedule written
+ * in the format asked for, the report, or the reason for an error.  A
+ * client may send any number of requests without waiting; they are
+ * answered in order, but no more than the limit's maxpipeline are answered
+ * before their responses are sent, so a client that does not read its
+ * responses stops being answered.
+ *
+ * A server under more load than its limits (struct ServerLimits) says so
+ * rather than queueing the work: a client over maxclients gets one
+ * SV_STATUS_BUSY response and is disconnected, and a schedule request
+ * that would make more than maxinflight under way at once is answered
+ * SV_STATUS_BUSY at once.  The client may try again later.
+ *
+ * Restrictions: Requests are at most SV_MAXFRAME bytes; a client that sends
+ * a longer one is disconnected.
+ *
+ * Error Handling: runserver() returns SV_OK or a negative SV_E code.
+ * References:
+ * Notes:
+ */
+
+#ifndef _SERVERMGR_H_INCLUDED_
+#define _SERVERMGR_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include "eprocessor.h"
+#include "outputmgr.h"
+#include "arena.h"
+#include "metrics.h"
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define SV_SOCKETPATH "/tmp/docketmaster.sock" /* default socket */
+#define SV_MAXFRAME 1024 /* longest request, less its length */
+#define SV_BUFSIZE (64 * 1024) /* requests read from a client at once */
+#define SV_MAXCLIENTS 64 /* clients connected at once */
+#define SV_ARENASIZE (16 * 1024) /* first size of each client's arena */
+#define SV_MAXINFLIGHT 64 /* default: schedules computed at once, all
+                             clients together */
+#define SV_MAXPIPELINE 64 /* default: responses a client is owed before they
+                             are sent */
+
+#define SV_OP_SCHEDULE 'S'
+#define SV_OP_STATS 'T'
+#define SV_OP_METRICS 'P'
+
+/*------------------------------------------------------------------------------
+ *  Response status
+ *----------------------------------------------------------------------------*/
+#define SV_STATUS_OK 0
+#define SV_STATUS_BADREQUEST 1 /* unknown operation, or bad trigger record */
+#define SV_STATUS_NOEVENT 2 /* trigger or event not in the rules, or no rules
+                               published */
+#define SV_STATUS_NOMEM 3 /* out of memory */
+#define SV_STATUS_BUSY 4 /* over the server's limits; try again later */
+
+/*------------------------------------------------------------------------------
+ *  Server error codes
+ *----------------------------------------------------------------------------*/
+#define SV_OK 0
+#define SV_ESOCKET -1 /* the socket could not be created */
+#define SV_ENOMEM -2 /* out of memory */
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+/* The time taken to answer requests, from the whole request being read to
+the response being ready to send. */
+struct LatencyReport {
+    unsigned long requests; /* requests answered */
+    double p50; /* microseconds */
+    double p99;
+};
+
+/* How much work a server takes on at once.  A limit of zero or less means
+the default. */
+struct ServerLimits {
+    int maxclients; /* clients connected at once, at most SV_MAXCLIENTS */
+    int maxinflight; /* schedules being computed at once */
+    int maxpipeline; /* responses a client is owed before they are sent */
+};
+
+/* Clients and requests under way and turned away.  The counts are since
+the process started. */
+struct AdmissionReport {
+    int clients; /* connected to the socket now */
+    long inflight; /* schedules being computed now */
+    unsigned long admitted; /* schedule requests computed */
+    unsigned long busy; /* schedule requests turned away as over
+                           maxinflight */
+    unsigned long refused; /* clients turned away as over maxclients, or
+                              over HT_MAXCONNS for HTTP */
+};
+
+/* What a connection needs to answer requests.  The memory a request needs
+comes from the arena, which is reset once the request is answered, so after
+its first few requests a session answers without allocating. */
+struct ServerSession {
+    struct Arena arena;
+    struct OutputSink output; /* responses not yet sent */
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Answers requests on a local socket until the process is
+ * interrupted or terminated.
+ *
+ * Parameters: The path of the socket, which is replaced if it exists.
+ *
+ * Returns: SV_OK once stopped, or a negative SV_E code.
+ *
+ * Notes: Schedules are computed from the current rule set (see ruleset.h),
+ * which may be replaced at any time while the server runs.
+ */
+
+int runserver (const char *socketpath);
+
+/*
+ * Description: Reports the time taken to answer the requests so far.
+ * Parameters: The report to fill in.
+ * Returns: Nothing.
+ */
+
+void serverlatency (struct LatencyReport *report);
+
+/*
+ * Description: Reports the time taken to answer the requests so far as a
+ * histogram.
+ *
+ * Parameters: The ProbeStats to fill in: calls and timed are both the
+ * requests answered.
+ *
+ * Returns: Nothing.
+ */
+
+void serverhistogram (struct ProbeStats *stats);
+
+/*
+ * Description: Sets the server's limits.
+ *
+ * Parameters: The limits.
+ *
+ * Returns: Nothing.
+ *
+ * Notes: The limits should be set before runserver() or starthttp() is
+ * called; clients already connected may go on with the limits they started
+ * with.
+ */
+
+void setserverlimits (const struct ServerLimits *limits);
+
+/*
+ * Description: Reports the server's limits.
+ * Parameters: The limits to fill in.
+ * Returns: Nothing.
+ */
+
+void getserverlimits (struct ServerLimits *limits);
+
+/*
+ * Description: Reports the clients and requests under way and turned away.
+ * Parameters: The report to fill in.
+ * Returns: Nothing.
+ */
+
+void serveradmission (struct AdmissionReport *report);
+
+/*
+ * Description: Admits a request to be computed, if the server is under its
+ * maxinflight limit.
+ *
+ * Parameters: None.
+ *
+ * Returns: Nonzero if admitted, in which case finishrequest() must be
+ * called once it is computed; zero if the server is busy.
+ */
+
+int admitrequest (void);
+
+/*
+ * Description: Counts an admitted request as finished.
+ */
+
+void finishrequest (void);
+
+/*
+ * Description: Counts a client turned away for being over a limit on
+ * connections.
+ */
+
+void refuseclient (void);
+
+/*
+ * Description: Sets up a session to answer requests.
+ * Parameters: The session.
+ * Returns: SV_OK, or SV_ENOMEM.
+ */
+
+int opensession (struct ServerSession *session);
+
+/*
+ * Description: Answers one request, adding the response, framed, to the
+ * session's output.
+ *
+ * Parameters: The session, and the request and its length, less the length
+ * prefix.
+ *
+ * Returns: Nothing.  The caller sends the output and sinkrewind()s it.
+ */
+
+void answerrequest (struct ServerSession *session,
+                    const unsigned char *request, size_t len);
+
+/*
+ * Description: Releases a session's memory.
+ * Parameters: The session.
+ * Returns: Nothing.
+ */
+
+void closesession (struct ServerSession *session);
+
+#endif	/* _SERVERMGR_H_INCLUDED_ */
@@ -0,0 +1,568 @@
+/*
+ * Filename: snapshot.c
+ * Project: DocketMaster
+ *
+ * Description: The snapshot module saves the fully built in-memory state of
+ * the docketing engine to a file and restores it with a single mmap() and a
+ * pointer fix-up pass.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:38:22 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: See snapshot.h.
+ * File Format: See snapshot.h.
+ * Restrictions:
+ *
+ * Error Handling: Functions return the negative SN_E codes.  The snapshot is
+ * written to a temporary file that is renamed when complete, so a reader
+ * never sees a partial snapshot.
+ *
+ * References:
+ * Notes:
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+/* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ########################### */
+
+#define IMAGEALIGN(x, a) (((x) + ((a)-1)) & ~((uint64_t) (a)-1))
+
+#define IMAGEAT(img, off, type) ((type *) ((img)->data + (off)))
+    /* IMAGEAT converts an image offset into a pointer to the object at that
+    offset.  The pointer is only good until the next imagealloc(). */
+
+#define FIELDOFF(base, type, member) ((base) + offsetof(type, member))
+    /* FIELDOFF is the image offset of a member of a struct stored at base. */
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* The snapshot image under construction. */
+struct Image {
+    char *data;
+    uint64_t len;
+    uint64_t cap;
+    uint64_t *relocs; /* image offsets of the pointers in the image */
+    uint64_t numrelocs;
+    uint64_t relcap;
+    int failed; /* set if any allocation failed */
+};
+
+/* Where an event node was placed in the image, so Dependency handles can be
+ * redirected to the copy. */
+struct NodeMap {
+    const void *addr;
+    uint64_t off;
+};
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static uint64_t imagealloc (struct Image *img, uint64_t size, uint64_t align);
+static uint64_t imagecopy (struct Image *img, const void *src, uint64_t size,
+                           uint64_t align);
+static void imageptr (struct Image *img, uint64_t field, uint64_t target);
+static uint64_t findnode (const struct NodeMap *map, int count,
+                          const void *addr);
+static int checkspan (const char *base, uint64_t imagesize, const void *ptr,
+                      uint64_t count, uint64_t recsize);
+static int checkroot (const char *base, uint64_t imagesize,
+                      const struct SnapshotRoot *root);
+static int comparemap (const void *a, const void *b);
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description: Saves the engine state to a snapshot file.
+ *
+ * Parameters: Name of the file to create, the holiday hash table, the event
+ * graph, and the materialized calendar.
+ *
+ * Returns: SN_OK if the snapshot was written, otherwise a negative SN_E code.
+ *
+ * Algorithm: Every structure reachable from the three roots is copied into
+ * one contiguous image.  Each pointer in the copy is replaced by the image
+ * offset of its target, and its own offset is added to the relocation table.
+ * Pointers that were NULL stay 0.
+ */
+
+int savesnapshot(const char *filename, struct HolidayNode *holidays[],
+                 struct EventGraph *graph, const struct CourtCalendar *cal)
+{
+    struct Image img;
+    struct SnapshotHeader *hdr;
+    struct SnapshotRoot *root;
+    struct HolidayNode *hnode;
+    struct CourtEventNode *enode;
+    struct Dependency *dep;
+    struct NodeMap *map = NULL;
+    char tmpname[FILENAME_MAX];
+    FILE *out = NULL;
+    uint64_t rootoff, prevfield, off, matoff, rowoff, relocoff;
+    uint64_t rows, cols, cell;
+    int month, numnodes, i;
+    int result = SN_ENOMEM;
+
+    memset(&img, 0, sizeof(img));
+
+    /* The header and the root come first. */
+    imagealloc(&img, sizeof(struct SnapshotHeader), 8);
+    rootoff = imagealloc(&img, sizeof(struct SnapshotRoot), sizeof(void *));
+    if (img.failed)
+        goto cleanup;
+    root = IMAGEAT(&img, rootoff, struct SnapshotRoot);
+    root->graph = *graph; /* every pointer member is overwritten below */
+    root->calendar = *cal;
+
+    /* The holiday hash table: one chain of HolidayNodes per month. */
+    for (month = 0; month < MONTHS; month++) {
+        prevfield = rootoff + offsetof(struct SnapshotRoot, holidays) +
+                    month * sizeof(struct HolidayNode *);
+        for (hnode = holidays[month]; hnode != NULL; hnode = hnode->nextrule) {
+            off = imagecopy(&img, hnode, sizeof(*hnode), sizeof(void *));
+            imageptr(&img, prevfield, off);
+            prevfield = FIELDOFF(off, struct HolidayNode, nextrule);
+        }
+        imageptr(&img, prevfield, 0);
+    }
+
+    /* The event list, remembering where each node went. */
+    numnodes = 0;
+    for (enode = graph->eventlist; enode != NULL; enode = enode->nextevent)
+        numnodes++;
+    if ((map = malloc((numnodes + 1) * sizeof(*map))) == NULL)
+        goto cleanup;
+    prevfield = FIELDOFF(rootoff, struct SnapshotRoot, graph.eventlist);
+    i = 0;
+    for (enode = graph->eventlist; enode != NULL; enode = enode->nextevent) {
+        off = imagecopy(&img, enode, sizeof(*enode), sizeof(void *));
+        imageptr(&img, prevfield, off);
+        prevfield = FIELDOFF(off, struct CourtEventNode, nextevent);
+        map[i].addr = &enode->eventdata;
+        map[i].off = FIELDOFF(off, struct CourtEventNode, eventdata);
+        i++;
+    }
+    imageptr(&img, prevfield, 0);
+    qsort(map, numnodes, sizeof(*map), comparemap);
+
+    /* The adjacency matrix and its row pointers. */
+    rows = graph->dependencymatrix.trigger_rows;
+    cols = graph->dependencymatrix.triggeredby_cols;
+    matoff = rowoff = 0;
+    if (graph->dependencymatrix.matrixptr != NULL && rows > 0 && cols > 0) {
+        matoff = imagecopy(&img, graph->dependencymatrix.matrixptr,
+                           rows * cols * sizeof(struct Dependency),
+                           sizeof(void *));
+        for (cell = 0; cell < rows * cols && !img.failed; cell++) {
+            off = matoff + cell * sizeof(struct Dependency);
+            dep = &graph->dependencymatrix.matrixptr[cell];
+            imageptr(&img, FIELDOFF(off, struct Dependency, dependencyhandle),
+                     findnode(map, numnodes, dep->dependencyhandle));
+            imageptr(&img,
+                     FIELDOFF(off, struct Dependency, dependencyhandle_deft),
+                     findnode(map, numnodes, dep->dependencyhandle_deft));
+        }
+        rowoff = imagealloc(&img, rows * sizeof(struct Dependency *),
+                            sizeof(void *));
+        for (cell = 0; cell < rows && !img.failed; cell++)
+            imageptr(&img, rowoff + cell * sizeof(struct Dependency *),
+                     matoff + cell * cols * sizeof(struct Dependency));
+    }
+    imageptr(&img, FIELDOFF(rootoff, struct SnapshotRoot,
+                            graph.dependencymatrix.matrixptr), matoff);
+    imageptr(&img, FIELDOFF(rootoff, struct SnapshotRoot,
+                            graph.dependencymatrix.rowptr), rowoff);
+
+    /* The calendar.  Its tables hold no pointers, so they go last. */
+    imageptr(&img, FIELDOFF(rootoff, struct SnapshotRoot, calendar.rules),
+             FIELDOFF(rootoff, struct SnapshotRoot, holidays));
+    off = 0;
+    if (cal->holidaybits != NULL)
+        off = imagecopy(&img, cal->holidaybits,
+                        CALENDARWORDS(cal->numdays) * sizeof(uint32_t), 8);
+    imageptr(&img, FIELDOFF(rootoff, struct SnapshotRoot,
+                            calendar.holidaybits), off);
+    off = 0;
+    if (cal->courtrank != NULL)
+        off = imagecopy(&img, cal->courtrank,
+                        (cal->numdays + 1) * sizeof(int32_t), 8);
+    imageptr(&img, FIELDOFF(rootoff, struct SnapshotRoot,
+                            calendar.courtrank), off);
+    off = 0;
+    if (cal->courtdays != NULL)
+        off = imagecopy(&img, cal->courtdays,
+                        (cal->numdays + 1) * sizeof(int32_t), 8);
+    imageptr(&img, FIELDOFF(rootoff, struct SnapshotRoot,
+                            calendar.courtdays), off);
+    if (img.failed)
+        goto cleanup;
+
+    /* Nothing in the restored state belongs to the allocator. */
+    root = IMAGEAT(&img, rootoff, struct SnapshotRoot);
+    root->calendar.ownsbits = 0;
+    root->calendar.ownstables = 0;
+
+    /* Fill in the header and write the image and relocation table. */
+    relocoff = IMAGEALIGN(img.len, 8);
+    hdr = IMAGEAT(&img, 0, struct SnapshotHeader);
+    memcpy(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic));
+    hdr->version = SNAPSHOT_VERSION;
+    hdr->endiantag = SNAPSHOT_ENDIANTAG;
+    hdr->ptrsize = sizeof(void *);
+    hdr->rootoffset = rootoff;
+    hdr->relocoffset = relocoff;
+    hdr->reloccount = img.numrelocs;
+    hdr->filesize = relocoff + img.numrelocs * sizeof(uint64_t);
+
+    snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+    if ((out = fopen(tmpname, "wb")) == NULL) {
+        fprintf(stderr, "ERROR: Snapshot %s cannot be created!\n", tmpname);
+        result = SN_EOPEN;
+        goto cleanup;
+    }
+    result = SN_EWRITE;
+    if (fwrite(img.data, 1, img.len, out) != img.len)
+        goto cleanup;
+    for (off = img.len; off < relocoff; off++)
+        if (fputc(0, out) == EOF)
+            goto cleanup;
+    if (img.numrelocs > 0 && fwrite(img.relocs, sizeof(uint64_t),
+                                    img.numrelocs, out) != img.numrelocs)
+        goto cleanup;
+    if (fclose(out) != 0) {
+        out = NULL;
+        remove(tmpname);
+        goto cleanup;
+    }
+    out = NULL;
+    if (rename(tmpname, filename) != 0)
+        goto cleanup;
+    result = SN_OK;
+
+cleanup:
+    if (out != NULL) {
+        fclose(out);
+        remove(tmpname);
+    }
+    free(map);
+    free(img.data);
+    free(img.relocs);
+    return result;
+}		/* -----  end of function savesnapshot  ----- */
+
+
+/*
+ * Description: Maps a snapshot file and fixes up its pointers.
+ *
+ * Parameters: Name of the snapshot file and the Snapshot to fill in.
+ *
+ * Returns: SN_OK if the state is ready to use through snap->root, otherwise
+ * a negative SN_E code.
+ *
+ * Algorithm: The file is mapped private and writable, so the fix-up writes
+ * go to copy-on-write pages and never reach the file.  Each relocation entry
+ * names a pointer field holding an image offset; adding the mapping's base
+ * address turns it back into a pointer.  The sizes in the root are then
+ * checked against the image, so a damaged file cannot send the matrix or
+ * calendar lookups past the end of the mapping.
+ */
+
+int loadsnapshot(const char *filename, struct Snapshot *snap)
+{
+    const struct SnapshotHeader *hdr;
+    const uint64_t *relocs;
+    struct stat sb;
+    char *base;
+    uintptr_t value;
+    uint64_t i;
+    int fd;
+
+    memset(snap, 0, sizeof(*snap));
+
+    if ((fd = open(filename, O_RDONLY)) < 0) {
+        fprintf(stderr, "ERROR: Snapshot %s does not exist ", filename);
+        fprintf(stderr, "or cannot be opened!\n");
+        return SN_EOPEN;
+    }
+    if (fstat(fd, &sb) != 0 || (size_t) sb.st_size < sizeof(*hdr)) {
+        close(fd);
+        return SN_EFORMAT;
+    }
+    base = mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return SN_EOPEN;
+    snap->base = base;
+    snap->size = sb.st_size;
+
+    hdr = (const struct SnapshotHeader *) base;
+    if (memcmp(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic)) != 0) {
+        closesnapshot(snap);
+        return SN_EFORMAT;
+    }
+    if (hdr->version != SNAPSHOT_VERSION ||
+            hdr->endiantag != SNAPSHOT_ENDIANTAG ||
+            hdr->ptrsize != sizeof(void *)) {
+        closesnapshot(snap);
+        return SN_EVERSION;
+    }
+    if (hdr->filesize != (uint64_t) sb.st_size ||
+            hdr->relocoffset > hdr->filesize ||
+            hdr->reloccount > (hdr->filesize - hdr->relocoffset) /
+                              sizeof(uint64_t) ||
+            hdr->rootoffset % sizeof(void *) != 0 ||
+            hdr->rootoffset + sizeof(struct SnapshotRoot) > hdr->relocoffset) {
+        closesnapshot(snap);
+        return SN_EFORMAT;
+    }
+
+    /* The fix-up pass. */
+    relocs = (const uint64_t *) (base + hdr->relocoffset);
+    for (i = 0; i < hdr->reloccount; i++) {
+        if (relocs[i] % sizeof(void *) != 0 ||
+                relocs[i] + sizeof(void *) > hdr->relocoffset) {
+            closesnapshot(snap);
+            return SN_EFORMAT;
+        }
+        memcpy(&value, base + relocs[i], sizeof(value));
+        if (value >= hdr->relocoffset) {
+            closesnapshot(snap);
+            return SN_EFORMAT;
+        }
+        value += (uintptr_t) base;
+        memcpy(base + relocs[i], &value, sizeof(value));
+    }
+
+    if (checkroot(base, hdr->relocoffset, (const struct SnapshotRoot *)
+                  (base + hdr->rootoffset)) != 0) {
+        closesnapshot(snap);
+        return SN_EFORMAT;
+    }
+
+    snap->root = (struct SnapshotRoot *) (base + hdr->rootoffset);
+    return SN_OK;
+}		/* -----  end of function loadsnapshot  ----- */
+
+
+/*
+ * Description: Unmaps a snapshot.
+ * Parameters: The snapshot.
+ * Returns: Nothing.
+ */
+
+void closesnapshot(struct Snapshot *snap)
+{
+    if (snap->base != NULL)
+        munmap(snap->base, snap->size);
+    memset(snap, 0, sizeof(*snap));
+    return;
+}		/* -----  end of function closesnapshot  ----- */
+
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description: Reserves zero-filled space in the image.
+ *
+ * Parameters: The image, the number of bytes, and the alignment.
+ *
+ * Returns: The image offset of the space.  On allocation failure img->failed
+ * is set and 0 is returned.
+ */
+
+static uint64_t imagealloc (struct Image *img, uint64_t size, uint64_t align)
+{
+    uint64_t off, newcap;
+    char *grown;
+
+    if (img->failed)
+        return 0;
+
+    off = IMAGEALIGN(img->len, align);
+    if (off + size > img->cap) {
+        newcap = img->cap ? img->cap : 65536;
+        while (newcap < off + size)
+            newcap *= 2;
+        if ((grown = realloc(img->data, newcap)) == NULL) {
+            img->failed = 1;
+            return 0;
+        }
+        img->data = grown;
+        img->cap = newcap;
+    }
+    memset(img->data + img->len, 0, off + size - img->len);
+    img->len = off + size;
+    return off;
+}		/* -----  end of function imagealloc  ----- */
+
+
+/*
+ * Description: Copies an object into the image.
+ * Returns: The image offset of the copy, or 0 on allocation failure.
+ */
+
+static uint64_t imagecopy (struct Image *img, const void *src, uint64_t size,
+                           uint64_t align)
+{
+    uint64_t off;
+
+    off = imagealloc(img, size, align);
+    if (!img->failed)
+        memcpy(img->data + off, src, size);
+    return off;
+}		/* -----  end of function imagecopy  ----- */
+
+
+/*
+ * Description: Stores a pointer in the image as the offset of its target and
+ * records it in the relocation table.
+ *
+ * Parameters: The image, the image offset of the pointer field, and the
+ * image offset of the target (0 for NULL).
+ */
+
+static void imageptr (struct Image *img, uint64_t field, uint64_t target)
+{
+    uintptr_t value = (uintptr_t) target;
+    uint64_t *grown;
+
+    if (img->failed)
+        return;
+
+    memcpy(img->data + field, &value, sizeof(value));
+    if (target == 0)
+        return;
+
+    if (img->numrelocs == img->relcap) {
+        img->relcap = img->relcap ? img->relcap * 2 : 1024;
+        grown = realloc(img->relocs, img->relcap * sizeof(uint64_t));
+        if (grown == NULL) {
+            img->failed = 1;
+            return;
+        }
+        img->relocs = grown;
+    }
+    img->relocs[img->numrelocs++] = field;
+    return;
+}		/* -----  end of function imageptr  ----- */
+
+
+/*
+ * Description: Checks that an array restored from a snapshot lies inside
+ * the image.
+ *
+ * Parameters: The start of the mapping, the size of the image, the fixed-up
+ * pointer to the array (NULL is allowed), its number of elements, and the
+ * size of each.
+ *
+ * Returns: Zero if the array fits, -1 if it runs past the image.
+ */
+
+static int checkspan (const char *base, uint64_t imagesize, const void *ptr,
+                      uint64_t count, uint64_t recsize)
+{
+    uint64_t off;
+
+    if (ptr == NULL)
+        return 0;
+    off = (uint64_t) ((const char *) ptr - base);
+    if (off > imagesize || count > (imagesize - off) / recsize)
+        return -1;
+    return 0;
+}		/* -----  end of function checkspan  ----- */
+
+
+/*
+ * Description: Checks the sizes recorded in a restored root against the
+ * image.
+ *
+ * Parameters: The start of the mapping, the size of the image, and the
+ * fixed-up root.
+ *
+ * Returns: Zero if the root is sound, -1 if not: the matrix dimensions must
+ * be non-negative, the matrix and its row pointers must fit the image, each
+ * row must start where savesnapshot() put it, and the calendar's tables must
+ * hold numdays days and no more than numdays + 1 court days.
+ */
+
+static int checkroot (const char *base, uint64_t imagesize,
+                      const struct SnapshotRoot *root)
+{
+    const struct AdjacencyMatrix *matrix = &root->graph.dependencymatrix;
+    const struct CourtCalendar *cal = &root->calendar;
+    uint64_t rows, cols, row;
+
+    if (matrix->trigger_rows < 0 || matrix->triggeredby_cols < 0 ||
+            cal->numdays < 0 || cal->numcourtdays < 0 ||
+            (uint64_t) cal->numcourtdays > (uint64_t) cal->numdays + 1)
+        return -1;
+    rows = matrix->trigger_rows;
+    cols = matrix->triggeredby_cols;
+
+    if ((matrix->matrixptr == NULL) != (matrix->rowptr == NULL) ||
+            checkspan(base, imagesize, matrix->matrixptr, rows * cols,
+                      sizeof(struct Dependency)) != 0 ||
+            checkspan(base, imagesize, matrix->rowptr, rows,
+                      sizeof(struct Dependency *)) != 0)
+        return -1;
+    if (matrix->rowptr != NULL)
+        for (row = 0; row < rows; row++)
+            if (matrix->rowptr[row] != matrix->matrixptr + row * cols)
+                return -1;
+
+    if (checkspan(base, imagesize, cal->holidaybits,
+                  CALENDARWORDS((uint64_t) cal->numdays),
+                  sizeof(uint32_t)) != 0 ||
+            checkspan(base, imagesize, cal->courtrank,
+                      (uint64_t) cal->numdays + 1, sizeof(int32_t)) != 0 ||
+            checkspan(base, imagesize, cal->courtdays,
+                      (uint64_t) cal->numdays + 1, sizeof(int32_t)) != 0)
+        return -1;
+    return 0;
+}		/* -----  end of function checkroot  ----- */
+
+
+/*
+ * Description: Finds where an event was copied in the image.
+ * Returns: Its image offset, or 0 if addr is NULL or not an event in the list.
+ */
+
+static uint64_t findnode (const struct NodeMap *map, int count,
+                          const void *addr)
+{
+    struct NodeMap key;
+    const struct NodeMap *found;
+
+    if (addr == NULL)
+        return 0;
+    key.addr = addr;
+    found = bsearch(&key, map, count, sizeof(*map), comparemap);
+    return (found != NULL) ? found->off : 0;
+}		/* -----  end of function findnode  ----- */
+
+
+/*
+ * Description: Orders NodeMap entries by address.
+ */
+
+static int comparemap (const void *a, const void *b)
+{
+    uintptr_t x = (uintptr_t) ((const struct NodeMap *) a)->addr;
+    uintptr_t y = (uintptr_t) ((const struct NodeMap *) b)->addr;
+
+    return (x > y) - (x < y);
+}		/* -----  end of function comparemap  ----- */
@@ -0,0 +1,133 @@
+/*
+ * Filename: snapshot.h
+ * Project: DocketMaster
+ *
+ * Description: The snapshot module saves the fully built in-memory state of
+ * the docketing engine for a jurisdiction (the holiday hash table, the event
+ * graph, and the materialized calendar with its offset tables) to a file, and
+ * restores it with a single mmap() followed by a pointer fix-up pass.  A
+ * restart after a deploy does not rebuild anything.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 09:41:52 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: "docketmaster snapshot -h[holidays] -e[events] -o[snapshot]" builds
+ * the engine and saves it.  "docketmaster -s[snapshot]" restores it.
+ *
+ * File Format: A SnapshotHeader, followed by an image of the engine's data
+ * structures exactly as they are laid out in memory, except that every
+ * pointer holds an offset from the start of the file instead of an address.
+ * The relocation table at the end lists the file offset of every such
+ * pointer.  NULL pointers are stored as 0 and are not relocated.  The image
+ * is ordered so that the structures holding pointers come first and the
+ * large pointer-free tables (bitmap, offset tables) come last; only the
+ * pages holding pointers are written to during the fix-up pass.
+ *
+ * Restrictions: A snapshot can only be restored by the same build of the
+ * program on the same kind of machine (the header records the snapshot
+ * version, pointer size, and byte order).  The restored structures live in
+ * the mapping: they must not be passed to free().
+ *
+ * Error Handling: The functions return the negative SN_E codes below.
+ * References:
+ * Notes:
+ */
+
+#ifndef _SNAPSHOT_H_INCLUDED_
+#define _SNAPSHOT_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "graphmgr.h"
+#include "courtcal.h"
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define SNAPSHOT_MAGIC "DKTMSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ENDIANTAG 0x01020304u
+
+/*------------------------------------------------------------------------------
+ *  Snapshot error codes
+ *----------------------------------------------------------------------------*/
+#define SN_OK 0
+#define SN_EOPEN -1 /* file could not be opened, created, or mapped */
+#define SN_EFORMAT -2 /* file is not a snapshot, or is damaged */
+#define SN_EVERSION -3 /* snapshot is from another version or machine */
+#define SN_ENOMEM -4 /* out of memory */
+#define SN_EWRITE -5 /* snapshot could not be written */
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endiantag;
+    uint32_t ptrsize; /* sizeof(void *) of the machine that wrote it */
+    uint32_t reserved;
+    uint64_t filesize;
+    uint64_t rootoffset; /* file offset of the SnapshotRoot */
+    uint64_t relocoffset; /* file offset of the relocation table */
+    uint64_t reloccount; /* number of uint64_t entries in the table */
+};
+
+/* The engine state captured in a snapshot. */
+struct SnapshotRoot {
+    struct HolidayNode *holidays[MONTHS];
+    struct EventGraph graph;
+    struct CourtCalendar calendar;
+};
+
+/* A restored snapshot. */
+struct Snapshot {
+    void *base; /* start of the mapping */
+    size_t size;
+    struct SnapshotRoot *root; /* points into the mapping */
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Saves the engine state to a snapshot file.
+ *
+ * Parameters: Name of the file to create, the holiday hash table, the event
+ * graph, and the materialized calendar.
+ *
+ * Returns: SN_OK if the snapshot was written, otherwise a negative SN_E code.
+ */
+
+int savesnapshot(const char *filename, struct HolidayNode *holidays[],
+                 struct EventGraph *graph, const struct CourtCalendar *cal);
+
+/*
+ * Description: Maps a snapshot file and fixes up its pointers.
+ *
+ * Parameters: Name of the snapshot file and the Snapshot to fill in.
+ *
+ * Returns: SN_OK if the state is ready to use through snap->root, otherwise
+ * a negative SN_E code.
+ */
+
+int loadsnapshot(const char *filename, struct Snapshot *snap);
+
+/*
+ * Description: Unmaps a snapshot.  Nothing restored from it may be used
+ * afterward.
+ *
+ * Parameters: The snapshot.
+ *
+ * Returns: Nothing.
+ */
+
+void closesnapshot(struct Snapshot *snap);
+
+#endif	/* _SNAPSHOT_H_INCLUDED_ */
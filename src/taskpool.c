@@ -0,0 +1,522 @@
+/*
+ * Filename: taskpool.c
+ * Project: DocketMaster
+ *
+ * Description: A pool of worker threads that share out tasks by work
+ * stealing.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 09:39:25 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Called by the batch and export managers.
+ * File Format:
+ * Restrictions:
+ * Error Handling:
+ * References: See taskpool.h.
+ * Notes: Each worker's queue is a deque: the worker pushes and pops tasks at
+ * its bottom, newest first, which keeps the data a task just touched in the
+ * worker's cache; thieves take from the top, oldest first, which for a split
+ * range is the largest piece left.  Each deque has its own lock.  Tasks are
+ * a few hundred microseconds of work or more, so a lock that is almost never
+ * contended costs nothing measurable and is far easier to get right than a
+ * lock-free deque.
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "taskpool.h"
+
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+struct Task {
+    TaskFunction function;
+    void *arg;
+    long first, last; /* range still to do */
+    long grain; /* most of the range one call does; zero for a plain task */
+    struct TaskGroup *group;
+};
+
+/* Tasks waiting to run.  top and bottom only grow; a task's slot is its
+number modulo capacity. */
+struct TaskDeque {
+    pthread_mutex_t lock;
+    struct Task *tasks;
+    long capacity;
+    long top; /* oldest task, taken by thieves */
+    long bottom; /* one past the newest, taken by the owner */
+};
+
+struct Worker {
+    struct TaskPool *pool;
+    struct TaskDeque deque;
+    pthread_t thread;
+    unsigned int seed; /* picks whom to steal from first */
+};
+
+struct TaskPool {
+    struct Worker *workers;
+    int numslots; /* workers allocated */
+    int numworkers; /* threads running */
+    struct TaskDeque injected; /* tasks spawned from outside the pool */
+    long queued; /* tasks in all of the deques; atomic */
+    int sleepers; /* workers waiting for tasks; atomic */
+    int stop; /* set by tpfree() */
+    pthread_mutex_t lock; /* guards the sleeping workers */
+    pthread_cond_t wake; /* signaled when a task is queued */
+};
+
+/* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
+
+static _Thread_local struct Worker *currentworker; /* the worker this thread
+                                                      is, if any */
+
+static struct TaskPool *sharedpool;
+static pthread_once_t sharedonce = PTHREAD_ONCE_INIT;
+
+/* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+static void * workerloop (void *arg);
+    /* Thread of a worker: runs tasks until the pool stops */
+
+static void pushtask (struct TaskPool *pool, const struct Task *task);
+    /* Queues a task where the current thread will find it first */
+
+static int findtask (struct TaskPool *pool, struct Task *task);
+    /* Takes a task from the current worker's deque, or steals one */
+
+static void runtask (struct TaskPool *pool, struct Task *task);
+    /* Runs a task, splitting off the rest of a range first */
+
+static int initdeque (struct TaskDeque *deque);
+    /* Sets up an empty deque */
+
+static int popbottom (struct TaskDeque *deque, struct Task *task);
+    /* Takes the newest task of a deque */
+
+static int poptop (struct TaskDeque *deque, struct Task *task);
+    /* Takes the oldest task of a deque */
+
+static void makeshared (void);
+    /* Makes the shared pool */
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description:  Makes a task pool.
+ *
+ * Parameters:  The number of worker threads, or 0 for one per processor.
+ *
+ * Returns:  The pool, or NULL if out of memory.
+ *
+ * Notes:  Fewer threads than asked for may start; if none do, the tasks
+ * are run by whichever thread calls tpwait().
+ */
+
+struct TaskPool *tpnew (int numworkers)
+{
+    struct TaskPool *pool;
+    int index;
+
+    if (numworkers <= 0)
+        numworkers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (numworkers < 1)
+        numworkers = 1;
+    if (numworkers > TP_MAXWORKERS)
+        numworkers = TP_MAXWORKERS;
+
+    pool = calloc(1, sizeof(struct TaskPool));
+    if (pool == NULL)
+        return NULL;
+    pool->workers = calloc(numworkers, sizeof(struct Worker));
+    if (pool->workers == NULL || initdeque(&pool->injected) != 0)
+        goto nomemory;
+    pool->numslots = numworkers;
+    for (index = 0; index < numworkers; index++) {
+        pool->workers[index].pool = pool;
+        pool->workers[index].seed = 2654435761u * (index + 1);
+        if (initdeque(&pool->workers[index].deque) != 0)
+            goto nomemory;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    /* numworkers is raised as each thread starts, so that no thread steals
+     * from a worker whose thread did not start. */
+    for (index = 0; index < numworkers; index++) {
+        if (pthread_create(&pool->workers[index].thread, NULL, workerloop,
+                           &pool->workers[index]) != 0)
+            break;
+        __atomic_store_n(&pool->numworkers, index + 1, __ATOMIC_SEQ_CST);
+    }
+    return pool;
+
+nomemory:
+    if (pool->workers != NULL)
+        for (index = 0; index < numworkers; index++)
+            free(pool->workers[index].deque.tasks);
+    free(pool->workers);
+    free(pool->injected.tasks);
+    free(pool);
+    return NULL;
+}		/* -----  end of function tpnew  ----- */
+
+/*
+ * Description:  Returns the pool shared by the whole program.
+ */
+
+struct TaskPool *tpshared (void)
+{
+    pthread_once(&sharedonce, makeshared);
+    return sharedpool;
+}		/* -----  end of function tpshared  ----- */
+
+/*
+ * Description:  Starts a task.
+ * Parameters:  The pool, the group to count it in, and the function and its
+ * argument.
+ * Returns:  Nothing.
+ */
+
+void tpspawn (struct TaskPool *pool, struct TaskGroup *group,
+              TaskFunction function, void *arg)
+{
+    struct Task task;
+
+    if (pool == NULL) {
+        function(arg, 0, 0);
+        return;
+    }
+    task.function = function;
+    task.arg = arg;
+    task.first = task.last = 0;
+    task.grain = 0;
+    task.group = group;
+    __atomic_add_fetch(&group->pending, 1, __ATOMIC_SEQ_CST);
+    pushtask(pool, &task);
+    return;
+}		/* -----  end of function tpspawn  ----- */
+
+/*
+ * Description:  Waits until every task of a group has finished.
+ *
+ * Algorithm:  Rather than sleep, the waiting thread runs tasks, its own
+ * first and then any it can steal, so waiting inside a task cannot tie up
+ * the pool.  With nothing left to run it yields until the group's last
+ * tasks finish on other workers.
+ */
+
+void tpwait (struct TaskPool *pool, struct TaskGroup *group)
+{
+    struct Task task;
+
+    if (pool == NULL)
+        return;
+    while (__atomic_load_n(&group->pending, __ATOMIC_SEQ_CST) > 0) {
+        if (findtask(pool, &task))
+            runtask(pool, &task);
+        else
+            sched_yield();
+    }
+    return;
+}		/* -----  end of function tpwait  ----- */
+
+/*
+ * Description:  Calls a function for every number in a range, in parallel.
+ *
+ * Parameters:  The pool, the range, the most numbers one call handles, and
+ * the function and its argument.
+ *
+ * Algorithm:  The whole range is one task, run at once by the calling
+ * thread.  Running a range task splits it in half, queues the upper half as
+ * a new task, and goes on with the lower half until it is no longer than
+ * grain.  Idle workers steal the upper halves, the largest first, and split
+ * them the same way, so a range of uneven work spreads itself over the
+ * pool.
+ */
+
+void tpparallelfor (struct TaskPool *pool, long first, long last, long grain,
+                    TaskFunction function, void *arg)
+{
+    struct TaskGroup group;
+    struct Task task;
+
+    if (first >= last)
+        return;
+    if (pool == NULL) {
+        function(arg, first, last);
+        return;
+    }
+    task.function = function;
+    task.arg = arg;
+    task.first = first;
+    task.last = last;
+    task.grain = (grain > 0) ? grain : 1;
+    task.group = &group;
+    group.pending = 1;
+    runtask(pool, &task);
+    tpwait(pool, &group);
+    return;
+}		/* -----  end of function tpparallelfor  ----- */
+
+/*
+ * Description:  Returns the number of worker threads of a pool.
+ */
+
+int tpnumworkers (const struct TaskPool *pool)
+{
+    return __atomic_load_n(&pool->numworkers, __ATOMIC_SEQ_CST);
+}		/* -----  end of function tpnumworkers  ----- */
+
+/*
+ * Description:  Stops the workers of a pool and releases it.
+ */
+
+void tpfree (struct TaskPool *pool)
+{
+    int index;
+
+    if (pool == NULL || pool == sharedpool)
+        return;
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (index = 0; index < pool->numworkers; index++)
+        pthread_join(pool->workers[index].thread, NULL);
+
+    for (index = 0; index < pool->numslots; index++) {
+        pthread_mutex_destroy(&pool->workers[index].deque.lock);
+        free(pool->workers[index].deque.tasks);
+    }
+    pthread_mutex_destroy(&pool->injected.lock);
+    free(pool->injected.tasks);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+    return;
+}		/* -----  end of function tpfree  ----- */
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description:  Thread of a worker: runs tasks until the pool stops and no
+ * tasks are left, sleeping while there are none.
+ *
+ * Notes:  A worker announces that it is going to sleep (sleepers) before it
+ * checks queued one last time, and pushtask() raises queued before it
+ * checks sleepers, so a task queued as a worker goes to sleep always either
+ * is seen by the worker or wakes it.
+ */
+
+static void * workerloop (void *arg)
+{
+    struct Worker *self = arg;
+    struct TaskPool *pool = self->pool;
+    struct Task task;
+
+    currentworker = self;
+    for (;;) {
+        if (findtask(pool, &task)) {
+            runtask(pool, &task);
+            continue;
+        }
+        pthread_mutex_lock(&pool->lock);
+        __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0 &&
+               !pool->stop)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        if (pool->stop && __atomic_load_n(&pool->queued,
+                                          __ATOMIC_SEQ_CST) == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}		/* -----  end of function workerloop  ----- */
+
+/*
+ * Description:  Queues a task: on the current worker's deque if the thread
+ * is a worker of this pool, or else on the pool's deque for tasks from
+ * outside.
+ *
+ * Notes:  If the deque cannot grow, the task is run at once instead.
+ */
+
+static void pushtask (struct TaskPool *pool, const struct Task *task)
+{
+    struct TaskDeque *deque;
+    struct Task *grown;
+    long count, index;
+
+    if (currentworker != NULL && currentworker->pool == pool)
+        deque = &currentworker->deque;
+    else
+        deque = &pool->injected;
+
+    pthread_mutex_lock(&deque->lock);
+    count = deque->bottom - deque->top;
+    if (count == deque->capacity) {
+        grown = malloc(2 * deque->capacity * sizeof(struct Task));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&deque->lock);
+            runtask(pool, (struct Task *) task);
+            return;
+        }
+        for (index = 0; index < count; index++)
+            grown[index] = deque->tasks[(deque->top + index) %
+                                        deque->capacity];
+        free(deque->tasks);
+        deque->tasks = grown;
+        deque->capacity *= 2;
+        deque->top = 0;
+        deque->bottom = count;
+    }
+    deque->tasks[deque->bottom % deque->capacity] = *task;
+    deque->bottom++;
+    pthread_mutex_unlock(&deque->lock);
+
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return;
+}		/* -----  end of function pushtask  ----- */
+
+/*
+ * Description:  Finds a task to run: the newest of the current worker's own,
+ * or else the oldest of the tasks from outside the pool, or else the oldest
+ * of another worker's, starting from a random worker.
+ *
+ * Returns:  1 if a task was found, 0 if every deque is empty.
+ */
+
+static int findtask (struct TaskPool *pool, struct Task *task)
+{
+    struct Worker *self = currentworker;
+    int numworkers, start, index, found;
+
+    if (self != NULL && self->pool != pool)
+        self = NULL;
+    found = (self != NULL && popbottom(&self->deque, task)) ||
+        poptop(&pool->injected, task);
+
+    numworkers = __atomic_load_n(&pool->numworkers, __ATOMIC_SEQ_CST);
+    if (!found && numworkers > 0) {
+        start = 0;
+        if (self != NULL) {
+            self->seed = self->seed * 1103515245u + 12345u;
+            start = (int) ((self->seed >> 16) % (unsigned int) numworkers);
+        }
+        for (index = 0; index < numworkers && !found; index++)
+            found = poptop(&pool->workers[(start + index) %
+                                          numworkers].deque, task);
+    }
+    if (found)
+        __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+    return found;
+}		/* -----  end of function findtask  ----- */
+
+/*
+ * Description:  Runs a task and counts it finished in its group.  A range
+ * task longer than its grain first splits off and queues its upper half,
+ * again and again, until what is left is no longer than the grain.
+ */
+
+static void runtask (struct TaskPool *pool, struct Task *task)
+{
+    struct Task upper;
+    long middle;
+
+    while (task->grain > 0 && task->last - task->first > task->grain) {
+        middle = task->first + (task->last - task->first) / 2;
+        upper = *task;
+        upper.first = middle;
+        task->last = middle;
+        __atomic_add_fetch(&task->group->pending, 1, __ATOMIC_SEQ_CST);
+        pushtask(pool, &upper);
+    }
+    task->function(task->arg, task->first, task->last);
+    __atomic_sub_fetch(&task->group->pending, 1, __ATOMIC_SEQ_CST);
+    return;
+}		/* -----  end of function runtask  ----- */
+
+/*
+ * Description:  Sets up an empty deque.
+ * Returns:  Zero, or -1 if out of memory.
+ */
+
+static int initdeque (struct TaskDeque *deque)
+{
+    deque->tasks = malloc(TP_FIRSTDEQUE * sizeof(struct Task));
+    if (deque->tasks == NULL)
+        return -1;
+    deque->capacity = TP_FIRSTDEQUE;
+    deque->top = deque->bottom = 0;
+    pthread_mutex_init(&deque->lock, NULL);
+    return 0;
+}		/* -----  end of function initdeque  ----- */
+
+/*
+ * Description:  Takes the newest task of a deque.
+ * Returns:  1 if there was one, 0 if the deque was empty.
+ */
+
+static int popbottom (struct TaskDeque *deque, struct Task *task)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        deque->bottom--;
+        *task = deque->tasks[deque->bottom % deque->capacity];
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}		/* -----  end of function popbottom  ----- */
+
+/*
+ * Description:  Takes the oldest task of a deque.
+ * Returns:  1 if there was one, 0 if the deque was empty.
+ */
+
+static int poptop (struct TaskDeque *deque, struct Task *task)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        *task = deque->tasks[deque->top % deque->capacity];
+        deque->top++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}		/* -----  end of function poptop  ----- */
+
+/*
+ * Description:  Makes the shared pool, once.
+ */
+
+static void makeshared (void)
+{
+    sharedpool = tpnew(0);
+    return;
+}		/* -----  end of function makeshared  ----- */
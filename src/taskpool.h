@@ -0,0 +1,128 @@
+/*
+ * Filename: taskpool.h
+ * Project: DocketMaster
+ *
+ * Description: The task pool runs small pieces of work (tasks) on a fixed
+ * set of worker threads.  Each worker keeps its own queue of tasks and, when
+ * it runs out, steals from the others, so work that turns out to be uneven
+ * (a three-event small-claims matter next to a 400-event complex case) still
+ * keeps every worker busy.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 09:39:25 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Use the shared pool, tpshared(), or make one with tpnew().  Start
+ * tasks with tpspawn(), from any thread or from inside another task, each
+ * counted in a TaskGroup, and wait for the group with tpwait().
+ * tpparallelfor() runs a function over a range of numbers, split into
+ * pieces that idle workers steal.
+ *
+ * File Format:
+ * Restrictions: A task must not block waiting on another task except
+ * through tpwait(), which runs other tasks while it waits.
+ *
+ * Error Handling: tpnew() and tpshared() return NULL if out of memory.  A
+ * NULL pool may still be passed to the other functions, which then run the
+ * tasks on the calling thread as they are started.  A pool that could not
+ * start any threads also works: tpwait() runs the tasks itself.
+ *
+ * References: Blumofe and Leiserson, "Scheduling Multithreaded Computations
+ * by Work Stealing," J. ACM 46(5), 1999.
+ * Notes:
+ */
+
+#ifndef _TASKPOOL_H_INCLUDED_
+#define _TASKPOOL_H_INCLUDED_
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+#define TP_FIRSTDEQUE 64 /* tasks a worker's queue holds before it grows */
+#define TP_MAXWORKERS 64 /* most threads in a pool */
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+/* The work of a task: called with its argument and, for tpparallelfor(),
+the part of the range to do. */
+typedef void (*TaskFunction) (void *arg, long first, long last);
+
+/* Tasks that are waited for together.  Set pending to zero before use. */
+struct TaskGroup {
+    long pending; /* tasks spawned and not yet finished */
+};
+
+struct TaskPool; /* opaque */
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Makes a task pool.
+ * Parameters: The number of worker threads, or 0 for one per processor.
+ * Returns: The pool, or NULL if out of memory.
+ */
+
+struct TaskPool *tpnew (int numworkers);
+
+/*
+ * Description: Returns the pool shared by the whole program, making it the
+ * first time, with one worker per processor.
+ */
+
+struct TaskPool *tpshared (void);
+
+/*
+ * Description: Starts a task.
+ *
+ * Parameters: The pool, the group to count the task in, and the function
+ * and its argument.  The function is called with first and last zero.
+ *
+ * Returns: Nothing.
+ *
+ * Notes: Called from a worker, the task goes on that worker's own queue, to
+ * be run next unless another worker steals it first.
+ */
+
+void tpspawn (struct TaskPool *pool, struct TaskGroup *group,
+              TaskFunction function, void *arg);
+
+/*
+ * Description: Waits until every task of a group has finished, running
+ * tasks of the pool in the meantime.
+ */
+
+void tpwait (struct TaskPool *pool, struct TaskGroup *group);
+
+/*
+ * Description: Calls a function for every number in a range, in parallel,
+ * and waits for all of the calls to finish.
+ *
+ * Parameters: The pool, the range (first through last - 1), the most
+ * numbers one call handles, and the function and its argument.  The
+ * function is called with a piece of the range no longer than grain.
+ *
+ * Returns: Nothing.
+ */
+
+void tpparallelfor (struct TaskPool *pool, long first, long last, long grain,
+                    TaskFunction function, void *arg);
+
+/*
+ * Description: Returns the number of worker threads of a pool.
+ */
+
+int tpnumworkers (const struct TaskPool *pool);
+
+/*
+ * Description: Stops the workers of a pool, once their queues are empty,
+ * and releases it.  The shared pool is never released.
+ */
+
+void tpfree (struct TaskPool *pool);
+
+#endif	/* _TASKPOOL_H_INCLUDED_ */
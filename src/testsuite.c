@@ -7,7 +7,7 @@
  *
  * Version: 1.0.20
  * Created:  01/29/2012 11:13:22 AM
- * Last Modified: Wed Dec 16 16:57:59 2020
+ * Last Modified: Mon Oct 19 10:34:14 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -25,21 +25,81 @@
 
 /* #####   HEADER FILE INCLUDES   ########################################### */
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "testsuite.h"
+#include "exportmgr.h"
+#include "taskpool.h"
+#include "servermgr.h"
+#include "rulebuilder.h"
+#include "ruleset.h"
+#include "batchmgr.h"
+#include "eprocessor.h"
+#include "metrics.h"
 
 
 /* #####   MACROS  -  LOCAL TO THIS SOURCE FILE   ########################### */
 
 /* #####   SYMBOLIC CONSTANTS -  LOCAL TO THIS SOURCE FILE   ################ */
 
+#define EXPORTTESTEVENTS 100000 /* VEVENTs written by testsuite_export */
+#define SHARDTESTCASES 10000 /* cases exported by testsuite_shardexport */
+#define SHARDTESTEVENTS 20 /* deadlines of each case */
+#define POOLTESTCASES 20000 /* cases computed by testsuite_taskpool */
+#define POOLTESTDEPTH 12 /* levels of nested tasks in testsuite_taskpool */
+#define SERVERTESTWARMUP 100 /* requests before testsuite_serverallocs counts */
+#define SERVERTESTREQUESTS 100000 /* requests it counts the allocations of */
+#define SWAPTESTREADERS 4 /* threads computing in testsuite_ruleswap */
+#define SWAPTESTRELOADS 5000 /* rule sets it publishes while they do */
+#define SWAPTESTLOADEVERY 100 /* one set in this many is built from the
+                                 files, and owns its rules */
+#define METRICTESTTHREADS 4 /* threads counting in testsuite_metrics */
+#define METRICTESTCALLS 100000 /* calls each of them counts */
+
 /* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ################# */
 
 /* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
 
 /* #####   VARIABLES  -  LOCAL TO THIS SOURCE FILE   ######################## */
 
+/* #####   DATA TYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
+
+/* A task of the nested spawn test. */
+struct TreeTask {
+    struct TaskPool *pool;
+    int depth; /* levels of tasks still to spawn below this one */
+    long *leaves; /* counts the tasks at the bottom */
+};
+
+/* A reader thread of the rule swap test. */
+struct SwapReader {
+    const struct TriggerRecord *record; /* what to compute */
+    int expected; /* events in its schedule */
+    int stop; /* set when the reloads are done */
+    unsigned long reads; /* schedules computed */
+    unsigned long errors; /* wrong schedules, or generations out of order */
+};
+
 /* #####   PROTOTYPES  -  LOCAL TO THIS SOURCE FILE   ####################### */
 
+static void poolcases (void *arg, long first, long last);
+    /* Simulated case schedules of uneven size, for testsuite_taskpool */
+
+static void pooltree (void *arg, long first, long last);
+    /* Task that spawns two more, for testsuite_taskpool */
+
+static unsigned long poolcase (long index);
+    /* The simulated schedule of one case */
+
+static void * swapreader (void *arg);
+    /* Computes schedules from pinned rule sets, for testsuite_ruleswap */
+
+static void * metricthread (void *arg);
+    /* Counts calls to a probe, for testsuite_metrics */
+
 /* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
 
 void testsuite_dates(void)
@@ -471,6 +531,648 @@ void testsuite_courtdays(void)
     return;
 }
 
+/*
+ * Description:  Measures how fast the exporter writes VEVENTs.  The events
+ * carry text that must be escaped and folded, and go to /dev/null so the
+ * disk does not count.
+ * Returns:  The number of checks that failed: 1 if the export did.
+ */
+
+int testsuite_export(void)
+{
+    struct ExportFile exp;
+    struct CourtEvent event;
+    struct ExportItem items[64]; /* one batch of deadlines */
+    struct timespec start, stop;
+    double seconds;
+    int written, index, result;
+
+    memset(&event, 0, sizeof(event));
+    strcpy(event.shorttitle, "Opp Due");
+    strcpy(event.eventitle, "Opposition to motion, due");
+    strcpy(event.description, "Last day to file and serve opposition "
+           "papers; the papers must include any declarations, exhibits, "
+           "and a proposed order.");
+    strcpy(event.authority, "Cal. Code Civ. Proc. \\ 1005(b)");
+    strcpy(event.eventcategory, "Deadline");
+    for (index = 0; index < 64; index++) {
+        items[index].caseid = "CV-2026-000123";
+        items[index].event = &event;
+        items[index].jdn = 2461333 + index;
+    }
+
+    printf("\n\n\n^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+    printf("This function tests the speed of the calendar exporter.\n");
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = newexportfile(&exp, "/dev/null");
+    if (result == EX_OK) {
+        writeheaders(&exp);
+        for (written = 0; written < EXPORTTESTEVENTS; written += 64)
+            write_cal_items(&exp, items, 64);
+        writeenders(&exp);
+        written = (int) exp.numevents;
+        result = closexportfile(&exp);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    if (result != EX_OK) {
+        printf("The export failed (%d) (FAIL).\n", result);
+    } else {
+        seconds = (stop.tv_sec - start.tv_sec) +
+            (stop.tv_nsec - start.tv_nsec) / 1e9;
+        printf("Exported %d events in %.3f seconds (%.0f events/sec).\n",
+               written, seconds, (seconds > 0) ? written / seconds : 0.0);
+    }
+    printf("^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+
+    return (result != EX_OK);
+}
+
+
+/*
+ * Description:  Measures how fast a firm-wide export is written: one file for
+ * each of SHARDTESTCASES cases, across all processors.  The files go to a
+ * temporary directory which is removed afterward.
+ * Returns:  The number of checks that failed: 1 if any shard could not be
+ * written.
+ */
+
+int testsuite_shardexport(void)
+{
+    static char caseids[SHARDTESTCASES][16];
+    struct ExportShard *shards;
+    struct ExportItem *items;
+    struct CourtEvent event;
+    struct timespec start, stop;
+    char directory[] = "/tmp/dktmstrXXXXXX";
+    char filename[FILENAME_MAX];
+    double seconds;
+    unsigned long events;
+    int index, failed;
+
+    printf("\n\n\n^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+    printf("This function tests the speed of a sharded export.\n");
+
+    shards = malloc(SHARDTESTCASES * sizeof(struct ExportShard));
+    items = malloc(SHARDTESTCASES * SHARDTESTEVENTS * sizeof(struct ExportItem));
+    if (shards == NULL || items == NULL || mkdtemp(directory) == NULL) {
+        printf("The test could not be set up (FAIL).\n");
+        free(shards);
+        free(items);
+        return 1;
+    }
+
+    memset(&event, 0, sizeof(event));
+    strcpy(event.shorttitle, "Opp Due");
+    strcpy(event.eventitle, "Opposition to motion, due");
+    strcpy(event.authority, "Cal. Code Civ. Proc. 1005(b)");
+    for (index = 0; index < SHARDTESTCASES * SHARDTESTEVENTS; index++) {
+        items[index].caseid = caseids[index / SHARDTESTEVENTS];
+        items[index].event = &event;
+        items[index].jdn = 2461333 + index % 365;
+    }
+    for (index = 0; index < SHARDTESTCASES; index++) {
+        snprintf(caseids[index], sizeof(caseids[index]), "CV-2026-%05d",
+                 index);
+        shards[index].name = caseids[index];
+        shards[index].items = &items[index * SHARDTESTEVENTS];
+        shards[index].numitems = SHARDTESTEVENTS;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    failed = exportshards(directory, shards, SHARDTESTCASES, 0);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    seconds = (stop.tv_sec - start.tv_sec) +
+        (stop.tv_nsec - start.tv_nsec) / 1e9;
+    events = 0;
+    for (index = 0; index < SHARDTESTCASES; index++)
+        events += shards[index].numevents;
+    if (failed != 0)
+        printf("%d shards could not be written (FAIL).\n", failed);
+    printf("Exported %d cases (%lu events) in %.3f seconds\n",
+           SHARDTESTCASES, events, seconds);
+    if (seconds > 0)
+        printf("(%.0f cases/sec, %.0f events/sec).\n",
+               SHARDTESTCASES / seconds, events / seconds);
+
+    for (index = 0; index < SHARDTESTCASES; index++)
+        if (shardfilename(filename, sizeof(filename), directory,
+                          caseids[index]) != NULL)
+            remove(filename);
+    snprintf(filename, sizeof(filename), "%s/%s", directory, SHARDINDEXNAME);
+    remove(filename);
+    rmdir(directory);
+    free(shards);
+    free(items);
+    printf("^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+
+    return (failed != 0);
+}
+
+/*
+ * Description:  Tests the task pool.  A range of simulated cases, where one
+ * case in a hundred is a hundred times the work of the others, is computed
+ * with tpparallelfor() and checked against the same computation done
+ * serially, and a tree of tasks spawned from within tasks is checked to
+ * have run every task.
+ * Returns:  The number of checks that failed.
+ */
+
+int testsuite_taskpool(void)
+{
+    struct TaskPool *pool;
+    struct TaskGroup group;
+    struct TreeTask root;
+    struct timespec start, stop;
+    unsigned long *results, serial, parallel;
+    double serialtime, paralleltime;
+    long index, leaves;
+    int failures;
+
+    printf("\n\n\n^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+    printf("This function tests the work-stealing task pool.\n");
+
+    pool = tpshared();
+    results = malloc(POOLTESTCASES * sizeof(unsigned long));
+    if (pool == NULL || results == NULL) {
+        printf("The test could not be set up (FAIL).\n");
+        free(results);
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    serial = 0;
+    for (index = 0; index < POOLTESTCASES; index++)
+        serial += poolcase(index);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    serialtime = (stop.tv_sec - start.tv_sec) +
+        (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    tpparallelfor(pool, 0, POOLTESTCASES, 16, poolcases, results);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    paralleltime = (stop.tv_sec - start.tv_sec) +
+        (stop.tv_nsec - start.tv_nsec) / 1e9;
+    parallel = 0;
+    for (index = 0; index < POOLTESTCASES; index++)
+        parallel += results[index];
+
+    printf("%d workers: %d cases in %.3f seconds, %.3f serially (%.1fx).\n",
+           tpnumworkers(pool), POOLTESTCASES, paralleltime, serialtime,
+           (paralleltime > 0) ? serialtime / paralleltime : 0.0);
+    printf("Parallel results %s the serial ones (%s).\n",
+           (parallel == serial) ? "match" : "DO NOT MATCH",
+           (parallel == serial) ? "PASS" : "FAIL");
+    failures = (parallel != serial);
+
+    leaves = 0;
+    root.pool = pool;
+    root.depth = POOLTESTDEPTH;
+    root.leaves = &leaves;
+    group.pending = 0;
+    tpspawn(pool, &group, pooltree, &root);
+    tpwait(pool, &group);
+    printf("Nested spawns ran %ld of %ld leaf tasks (%s).\n", leaves,
+           1L << POOLTESTDEPTH,
+           (leaves == 1L << POOLTESTDEPTH) ? "PASS" : "FAIL");
+    failures += (leaves != 1L << POOLTESTDEPTH);
+
+    free(results);
+    printf("^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+
+    return failures;
+}
+
+/*
+ * Description:  Tests that the server answers requests without allocating.
+ * After SERVERTESTWARMUP requests for the schedule of the first event, the
+ * heap allocations made while answering SERVERTESTREQUESTS more are counted;
+ * there must be none.
+ * Parameters:  None.  The rules must have been built or loaded.
+ * Returns:  The number of checks that failed.
+ */
+
+int testsuite_serverallocs(void)
+{
+    struct ServerSession session;
+    struct EventGraph *events = eventsinforce();
+    struct RuleSet *rules;
+    struct AllocStats before, after;
+    unsigned char request[SV_MAXFRAME];
+    int len, index, status;
+
+    printf("\n\n\n^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+    printf("This function tests that a warmed-up server computes schedules\n");
+    printf("without allocating memory.\n");
+
+    if (events->eventlist == NULL) {
+        printf("No events are loaded (FAIL).\n");
+        return 1;
+    }
+    if ((rules = pinruleset()) == NULL &&
+            (rules = wrapruleset(events, &jurisdcalendar)) != NULL)
+        publishruleset(rules);
+    else
+        unpinruleset(rules);
+    if (rules == NULL || opensession(&session) != SV_OK) {
+        printf("The test could not be set up (FAIL).\n");
+        return 1;
+    }
+    request[0] = SV_OP_SCHEDULE;
+    request[1] = SCHED_JSONL;
+    len = 2 + snprintf((char *) request + 2, sizeof(request) - 2,
+                       "CV-2026-000123,%s,11/20/2026,mail",
+                       events->eventlist->eventdata.shorttitle);
+
+    for (index = 0; index < SERVERTESTWARMUP; index++) {
+        answerrequest(&session, request, len);
+        sinkrewind(&session.output);
+    }
+    allocstats(&before);
+    status = -1;
+    for (index = 0; index < SERVERTESTREQUESTS; index++) {
+        answerrequest(&session, request, len);
+        status = (session.output.used > 4) ? session.output.buffer[4] : -1;
+        sinkrewind(&session.output);
+    }
+    allocstats(&after);
+    closesession(&session);
+
+    printf("%d requests for \"%s\" answered with status %d.\n",
+           SERVERTESTREQUESTS, events->eventlist->eventdata.shorttitle,
+           status);
+    printf("Heap allocations while answering them: %lu (%s).\n",
+           after.allocations - before.allocations,
+           (after.allocations == before.allocations) ? "PASS" : "FAIL");
+    printf("^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+
+    return (after.allocations != before.allocations);
+}
+
+/*
+ * Description:  Tests that rule sets can be published while schedules are
+ * computed from them.  SWAPTESTREADERS threads compute the same schedule
+ * from whatever set is current while SWAPTESTRELOADS new sets are
+ * published.  If the rules were built from files, one set in
+ * SWAPTESTLOADEVERY is built from them again with loadruleset(), so the
+ * sets freed under the readers include ones that own their graph and
+ * calendar.  Every schedule must be right, the generations each thread
+ * sees must never go back, and every set replaced must be freed.
+ * Parameters:  The holiday, events, and extras files the rules were built
+ * from, or NULLs if they were loaded from a rule pack or snapshot.  The rules
+ * must have been built or loaded.
+ * Returns:  The number of checks that failed.
+ */
+
+int testsuite_ruleswap(const char *holidayfile, const char *eventsfile,
+                       const char *extrasfile)
+{
+    struct SwapReader reader;
+    struct TriggerRecord record;
+    struct ScheduledEvent *schedule;
+    struct EventGraph *events = eventsinforce();
+    struct RuleSet *rules;
+    pthread_t threads[SWAPTESTREADERS];
+    char line[BATCH_LINELEN];
+    long before, leftover;
+    int index, started, reloads, loaded, result;
+
+    printf("\n\n\n^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+    printf("This function tests publishing new rules while schedules are\n");
+    printf("being computed from the old ones.\n");
+
+    if (events->eventlist == NULL) {
+        printf("No events are loaded (FAIL).\n");
+        return 1;
+    }
+    snprintf(line, sizeof(line), "CV-2026-000123,%s,11/20/2026,mail",
+             events->eventlist->eventdata.shorttitle);
+    schedule = malloc(events->listsize * sizeof(struct ScheduledEvent));
+    if (schedule == NULL || parsetrigger(line, &record) != BT_OK) {
+        printf("The test could not be set up (FAIL).\n");
+        free(schedule);
+        return 1;
+    }
+    memset(&reader, 0, sizeof(reader));
+    reader.record = &record;
+    reader.expected = computetrigger(events, &jurisdcalendar, &record,
+                                     schedule, events->listsize);
+    free(schedule);
+
+    /* The readers pin whatever set is current, so there must be one. */
+    before = liverulesets();
+    if ((rules = wrapruleset(events, &jurisdcalendar)) == NULL) {
+        printf("The test could not be set up (FAIL).\n");
+        return 1;
+    }
+    publishruleset(rules);
+    started = 0;
+    for (index = 0; index < SWAPTESTREADERS; index++)
+        if (pthread_create(&threads[started], NULL, swapreader,
+                           &reader) == 0)
+            started++;
+    loaded = 0;
+    result = RS_OK;
+    for (reloads = 0; reloads < SWAPTESTRELOADS; reloads++) {
+        if (holidayfile != NULL && eventsfile != NULL &&
+                reloads % SWAPTESTLOADEVERY == 0) {
+            result = loadruleset(holidayfile, eventsfile, extrasfile, &rules);
+            if (result != RS_OK)
+                break;
+            loaded++;
+        } else if ((rules = wrapruleset(events, &jurisdcalendar)) == NULL) {
+            result = RS_ENOMEM;
+            break;
+        }
+        publishruleset(rules);
+    }
+    __atomic_store_n(&reader.stop, 1, __ATOMIC_RELEASE);
+    for (index = 0; index < started; index++)
+        pthread_join(threads[index], NULL);
+
+    printf("%d readers computed %lu schedules during %d reloads, %d of "
+           "them built from the files.\n", started, reader.reads, reloads,
+           loaded);
+    if (result != RS_OK)
+        printf("Reload %d could not be built (%d) (FAIL).\n", reloads + 1,
+               result);
+    printf("Wrong schedules or generations: %lu (%s).\n", reader.errors,
+           (reader.errors == 0) ? "PASS" : "FAIL");
+    leftover = liverulesets() - ((before > 0) ? before : 1);
+    printf("Rule sets left unreclaimed: %ld (%s).\n", leftover,
+           (leftover == 0) ? "PASS" : "FAIL");
+    printf("^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+
+    return (result != RS_OK) + (reader.errors != 0) + (leftover != 0);
+}
+
+/*
+ * Description:  Tests the metrics.  Times around each power of two must
+ * fall in the latency bucket whose limits hold them, and the calls counted
+ * by METRICTESTTHREADS threads that then exit must all be kept.
+ * Parameters:  None.
+ * Returns:  The number of checks that failed.
+ */
+
+int testsuite_metrics(void)
+{
+    struct ProbeStats before, after;
+    pthread_t threads[METRICTESTTHREADS];
+    uint64_t ns;
+    int index, started, bucket, misfiled, shift, lost;
+
+    printf("\n\n\n^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+    printf("This function tests the latency histograms, and that the probe\n");
+    printf("counts of threads that have exited are kept.\n");
+
+    /* Every time must fall in the one bucket whose limits hold it. */
+    misfiled = 0;
+    for (shift = 0; shift < LAT_MAXBITS; shift++)
+        for (index = -2; index <= 2; index++) {
+            ns = ((uint64_t) 1 << shift) + index;
+            if (ns >= ((uint64_t) 1 << LAT_MAXBITS))
+                continue;
+            bucket = latencybucket(ns);
+            if (bucket < 0 || bucket >= LAT_BUCKETS ||
+                    bucketlimit(bucket) < (double) ns ||
+                    (bucket > 0 && bucketlimit(bucket - 1) >= (double) ns))
+                misfiled++;
+        }
+    printf("Times in the wrong bucket: %d (%s).\n", misfiled,
+           (misfiled == 0) ? "PASS" : "FAIL");
+
+    probestats(MP_EXPORT, &before);
+    started = 0;
+    for (index = 0; index < METRICTESTTHREADS; index++)
+        if (pthread_create(&threads[started], NULL, metricthread, NULL) == 0)
+            started++;
+    for (index = 0; index < started; index++)
+        pthread_join(threads[index], NULL);
+    probestats(MP_EXPORT, &after);
+
+    printf("%d threads counted %llu calls of %d.\n", started,
+           after.calls - before.calls, started * METRICTESTCALLS);
+    lost = (after.calls - before.calls !=
+            (unsigned long long) started * METRICTESTCALLS ||
+            after.timed - before.timed !=
+            (unsigned long long) started * METRICTESTCALLS);
+    printf("Calls lost: %lld (%s).\n", (long long) started *
+           METRICTESTCALLS - (long long) (after.calls - before.calls),
+           lost ? "FAIL" : "PASS");
+    printf("^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+
+    return (misfiled != 0) + lost;
+}
+
+/*
+ * Description:  Tests that the local rules change the deadlines computed.
+ * A base graph has a motion and an opposition due two weeks after it; a
+ * local rule that gives the opposition three weeks must move its deadline
+ * later, and one that masks it must take it out of the motion's chain.
+ * Parameters:  None.  The calendar must have been built or loaded.
+ * Returns:  The number of checks that failed.
+ */
+
+int testsuite_localrules(void)
+{
+    struct CourtEvent motion, opposition;
+    struct EventGraph base, local;
+    struct LocalRules layer;
+    struct RuleView view;
+    struct TriggerRecord record;
+    struct ScheduledEvent schedule[2];
+    int basejdn, localjdn, failures;
+
+    printf("\n\n\n^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+    printf("This function tests that a local rule changes a deadline.\n");
+
+    memset(&motion, 0, sizeof(motion));
+    strcpy(motion.shorttitle, "Motion");
+    strcpy(motion.eventitle, "Motion filed and served");
+    opposition = motion;
+    strcpy(opposition.shorttitle, "Opp Due");
+    strcpy(opposition.eventitle, "Opposition to motion, due");
+    strcpy(opposition.ntc_dependency1, "Motion");
+    opposition.ntcpd1 = 2;
+    opposition.countunits = COUNT_WEEKS;
+
+    memset(&layer, 0, sizeof(layer));
+    init_eventgraph(&base, 0);
+    base.eventlist = insertevent(&motion, base.eventlist);
+    base.eventlist = insertevent(&opposition, base.eventlist);
+    if (finalizeeventgraph(&base) != 1 ||
+            filltrigger("CV-2026-000123", "Motion", "11/20/2026", NULL, NULL,
+                        "Opp Due", &record) != BT_OK) {
+        printf("The test could not be set up (FAIL).\n");
+        freeeventgraph(&base);
+        return 1;
+    }
+    basejdn = (computetrigger(&base, &jurisdcalendar, &record, schedule,
+                              2) == 1) ? schedule[0].jdn : -1;
+
+    /* Three weeks in this court */
+    opposition.ntcpd1 = 3;
+    localjdn = -1;
+    if (addlocalrule(&layer, &opposition, LOCAL_OVERRIDE) == 0 &&
+            buildview(&view, &base, &layer) == 0) {
+        if (viewgraph(&view, &local) >= 0) {
+            if (computetrigger(&local, &jurisdcalendar, &record, schedule,
+                               2) == 1)
+                localjdn = schedule[0].jdn;
+            freeeventgraph(&local);
+        }
+        freeview(&view);
+    }
+    printf("Opposition due on day %d, %d with the local rule (%s).\n",
+           basejdn, localjdn,
+           (basejdn > 0 && localjdn > basejdn) ? "PASS" : "FAIL");
+    failures = !(basejdn > 0 && localjdn > basejdn);
+
+    /* Not due at all in this court */
+    freelocalrules(&layer);
+    localjdn = -1;
+    if (addlocalrule(&layer, &opposition, LOCAL_MASK) == 0 &&
+            buildview(&view, &base, &layer) == 0) {
+        if (viewgraph(&view, &local) >= 0) {
+            localjdn = computetrigger(&local, &jurisdcalendar, &record,
+                                      schedule, 2);
+            freeeventgraph(&local);
+        }
+        freeview(&view);
+    }
+    printf("Masked opposition left in the chain: %s (%s).\n",
+           (localjdn == BT_ENOEVENT) ? "no" : "yes",
+           (localjdn == BT_ENOEVENT) ? "PASS" : "FAIL");
+    failures += (localjdn != BT_ENOEVENT);
+
+    freelocalrules(&layer);
+    freeeventgraph(&base);
+    printf("^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n");
+
+    return failures;
+}
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
+
+/*
+ * Description:  Computes simulated cases first through last - 1 into the
+ * results array.
+ */
+
+static void poolcases (void *arg, long first, long last)
+{
+    unsigned long *results = arg;
+    long index;
+
+    for (index = first; index < last; index++)
+        results[index] = poolcase(index);
+    return;
+}
+
+/*
+ * Description:  Spawns two tasks one level down and waits for them, or
+ * counts itself at the bottom of the tree.
+ */
+
+static void pooltree (void *arg, long first, long last)
+{
+    struct TreeTask *task = arg;
+    struct TreeTask child;
+    struct TaskGroup group;
+
+    (void) first;
+    (void) last;
+    if (task->depth == 0) {
+        __atomic_add_fetch(task->leaves, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    child = *task;
+    child.depth--;
+    group.pending = 0;
+    tpspawn(task->pool, &group, pooltree, &child);
+    tpspawn(task->pool, &group, pooltree, &child);
+    tpwait(task->pool, &group);
+    return;
+}
+
+/*
+ * Description:  The simulated schedule of one case: a hash chained over the
+ * case's events, 3 events for most cases and 400 for one in a hundred.
+ */
+
+static unsigned long poolcase (long index)
+{
+    unsigned long hash;
+    int events, event, step;
+
+    events = (index % 100 == 0) ? 400 : 3;
+    hash = (unsigned long) index;
+    for (event = 0; event < events; event++)
+        for (step = 0; step < 200; step++)
+            hash = hash * 6364136223846793005UL + 1442695040888963407UL;
+    return hash;
+}
+
+/*
+ * Description:  A reader thread of testsuite_ruleswap: pins the current
+ * rule set, computes a schedule from it, checks the schedule, and unpins the
+ * set, until told to stop.  The generations it sees must never go back, and
+ * there must always be a set to pin.
+ */
+
+static void * swapreader (void *arg)
+{
+    struct SwapReader *reader = arg;
+    struct ScheduledEvent *schedule;
+    struct RuleSet *rules;
+    unsigned long reads, errors, generation, last;
+    int count, maxevents;
+
+    maxevents = eventsinforce()->listsize;
+    schedule = malloc(maxevents * sizeof(struct ScheduledEvent));
+    if (schedule == NULL)
+        return NULL;
+    reads = errors = last = 0;
+    while (!__atomic_load_n(&reader->stop, __ATOMIC_ACQUIRE)) {
+        rules = pinruleset();
+        if (rules == NULL) {
+            errors++; /* nothing published */
+            reads++;
+            continue;
+        }
+        generation = rules->generation;
+        count = computetrigger(rules->graph, rules->cal, reader->record,
+                               schedule, maxevents);
+        if (count != reader->expected || generation < last ||
+                rules->generation != generation)
+            errors++;
+        last = generation;
+        unpinruleset(rules);
+        reads++;
+    }
+    free(schedule);
+    __atomic_fetch_add(&reader->reads, reads, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&reader->errors, errors, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+/*
+ * Description:  A thread of testsuite_metrics: counts and times
+ * METRICTESTCALLS calls to the export probe, which times every call, then
+ * exits.
+ */
+
+static void * metricthread (void *arg)
+{
+    int index;
+
+    (void) arg;
+    for (index = 0; index < METRICTESTCALLS; index++)
+        probestop(MP_EXPORT, probestart(MP_EXPORT));
+    return NULL;
+}
 
 #ifdef UNDEF /* presently this entire source file is removed from compilation
                 for testing. */
@@ -588,4 +1290,3 @@ void testsuite (void)
 
 
 /* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ############# */
-
@@ -7,7 +7,7 @@
  *
  * Version: 1.0.20
  * Created:  01/29/2012 11:10:47 AM
- * Last Modified: Wed Dec 16 14:28:05 2020
+ * Last Modified: Mon Oct 19 10:34:14 2026
  *
  * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
  * Organization: Dark Matter Computing
@@ -26,10 +26,22 @@
 #ifndef _TESTSUITE_H_INCLUDED_
 #define _TESTSUITE_H_INCLUDED_
 
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include "datetools.h"
+
 void testsuite_dates(void);
 void testsuite_checkholidays(void);
 void holidayprinttest(struct DateTime *dt);
 void testsuite_courtdays(void);
+int testsuite_export(void);
+int testsuite_shardexport(void);
+int testsuite_taskpool(void);
+int testsuite_serverallocs(void);
+int testsuite_ruleswap(const char *holidayfile, const char *eventsfile,
+                       const char *extrasfile);
+int testsuite_metrics(void);
+int testsuite_localrules(void);
 
 #endif	/* _TESTSUITE_H_INCLUDED_ */
 
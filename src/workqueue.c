@@ -0,0 +1,152 @@
+/*
+ * Filename: workqueue.c
+ * Project: DocketMaster
+ *
+ * Description: A bounded queue of work items shared by threads.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:06:33 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: Called by the batch processor.
+ * File Format:
+ * Restrictions:
+ * Error Handling:
+ * References:
+ * Notes:
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <stdlib.h>
+#include "workqueue.h"
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   #################### */
+
+/*
+ * Description:  Sets up an empty queue.
+ * Parameters:  The queue and the most items it holds.
+ * Returns:  WQ_OK, or WQ_ENOMEM.
+ */
+
+int wqinit (struct WorkQueue *queue, int depth)
+{
+    if (depth < 1)
+        depth = 1;
+    queue->items = malloc(depth * sizeof(void *));
+    if (queue->items == NULL)
+        return WQ_ENOMEM;
+    queue->depth = depth;
+    queue->head = 0;
+    queue->count = 0;
+    queue->closed = 0;
+    queue->highwater = 0;
+    queue->putwaits = queue->getwaits = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->notempty, NULL);
+    pthread_cond_init(&queue->notfull, NULL);
+    return WQ_OK;
+}		/* -----  end of function wqinit  ----- */
+
+/*
+ * Description:  Adds an item to the end of a queue, waiting while it is
+ * full.
+ * Parameters:  The queue and the item.
+ * Returns:  WQ_OK, or WQ_ECLOSED if the queue is closed.
+ */
+
+int wqput (struct WorkQueue *queue, void *item)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == queue->depth && !queue->closed)
+        queue->putwaits++;
+    while (queue->count == queue->depth && !queue->closed)
+        pthread_cond_wait(&queue->notfull, &queue->lock);
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->lock);
+        return WQ_ECLOSED;
+    }
+    queue->items[(queue->head + queue->count) % queue->depth] = item;
+    queue->count++;
+    if (queue->count > queue->highwater)
+        queue->highwater = queue->count;
+    pthread_cond_signal(&queue->notempty);
+    pthread_mutex_unlock(&queue->lock);
+    return WQ_OK;
+}		/* -----  end of function wqput  ----- */
+
+/*
+ * Description:  Takes the item at the front of a queue, waiting while it is
+ * empty.
+ * Parameters:  The queue.
+ * Returns:  The item, or NULL if the queue is closed and empty.
+ */
+
+void *wqget (struct WorkQueue *queue)
+{
+    void *item = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == 0 && !queue->closed)
+        queue->getwaits++;
+    while (queue->count == 0 && !queue->closed)
+        pthread_cond_wait(&queue->notempty, &queue->lock);
+    if (queue->count > 0) {
+        item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->depth;
+        queue->count--;
+        pthread_cond_signal(&queue->notfull);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return item;
+}		/* -----  end of function wqget  ----- */
+
+/*
+ * Description:  Counts the items in a queue.
+ * Parameters:  The queue.
+ * Returns:  The number of items.
+ */
+
+int wqcount (struct WorkQueue *queue)
+{
+    int count;
+
+    pthread_mutex_lock(&queue->lock);
+    count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}		/* -----  end of function wqcount  ----- */
+
+/*
+ * Description:  Closes a queue and wakes every thread waiting on it.
+ */
+
+void wqclose (struct WorkQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->notempty);
+    pthread_cond_broadcast(&queue->notfull);
+    pthread_mutex_unlock(&queue->lock);
+    return;
+}		/* -----  end of function wqclose  ----- */
+
+/*
+ * Description:  Releases a queue.
+ */
+
+void wqfree (struct WorkQueue *queue)
+{
+    pthread_cond_destroy(&queue->notfull);
+    pthread_cond_destroy(&queue->notempty);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->items);
+    queue->items = NULL;
+    return;
+}		/* -----  end of function wqfree  ----- */
@@ -0,0 +1,115 @@
+/*
+ * Filename: workqueue.h
+ * Project: DocketMaster
+ *
+ * Description: A work queue hands pointers from the threads that produce
+ * work to the threads that do it.  The queue holds a fixed number of items,
+ * so a producer that gets ahead of its consumers waits for them instead of
+ * piling up work in memory.
+ *
+ * Version: 1.0.20
+ * Created: 10/19/2026
+ * Last Modified: Mon Oct 19 10:06:33 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2026, Thomas H. Vidal
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Usage: wqinit() a queue with its depth, wqput() and wqget() items from any
+ * number of threads, wqclose() it when no more items are coming, and
+ * wqfree() it once every thread is done with it.
+ *
+ * File Format:
+ * Restrictions: Items are never NULL; wqget() returns NULL only once the
+ * queue is closed and empty.  The counts of waits and the high water mark
+ * are kept under the lock; read them once the threads are done.
+ *
+ * Error Handling: The functions return WQ_OK or a negative WQ_E code.
+ * References:
+ * Notes:
+ */
+
+#ifndef _WORKQUEUE_H_INCLUDED_
+#define _WORKQUEUE_H_INCLUDED_
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#include <pthread.h>
+
+/* #####   EXPORTED SYMBOLIC CONSTANTS   #################################### */
+
+/*------------------------------------------------------------------------------
+ *  Work queue error codes
+ *----------------------------------------------------------------------------*/
+#define WQ_OK 0
+#define WQ_ECLOSED -1 /* the queue has been closed */
+#define WQ_ENOMEM -2 /* out of memory */
+
+/* #####   EXPORTED DATA TYPES   ############################################ */
+
+struct WorkQueue {
+    pthread_mutex_t lock; /* guards everything below */
+    pthread_cond_t notempty; /* signaled when an item is put or on close */
+    pthread_cond_t notfull; /* signaled when an item is taken or on close */
+    void **items; /* ring of depth items */
+    int depth;
+    int head; /* the next item to get */
+    int count; /* items in the queue */
+    int closed; /* nonzero once wqclose() has been called */
+    int highwater; /* most items the queue has held at once */
+    unsigned long putwaits; /* wqput() calls that waited for room */
+    unsigned long getwaits; /* wqget() calls that waited for an item */
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ################################# */
+
+/*
+ * Description: Sets up an empty queue.
+ * Parameters: The queue and the most items it holds.
+ * Returns: WQ_OK, or WQ_ENOMEM.
+ */
+
+int wqinit (struct WorkQueue *queue, int depth);
+
+/*
+ * Description: Adds an item to the end of a queue, waiting while it is full.
+ * Parameters: The queue and the item.
+ * Returns: WQ_OK, or WQ_ECLOSED if the queue is closed.
+ */
+
+int wqput (struct WorkQueue *queue, void *item);
+
+/*
+ * Description: Takes the item at the front of a queue, waiting while it is
+ * empty.
+ * Parameters: The queue.
+ * Returns: The item, or NULL if the queue is closed and empty.
+ */
+
+void *wqget (struct WorkQueue *queue);
+
+/*
+ * Description: Counts the items in a queue, which may change as soon as
+ * they are counted.
+ * Parameters: The queue.
+ * Returns: The number of items.
+ */
+
+int wqcount (struct WorkQueue *queue);
+
+/*
+ * Description: Closes a queue.  Items already in it can still be taken;
+ * threads waiting to put one give up.
+ */
+
+void wqclose (struct WorkQueue *queue);
+
+/*
+ * Description: Releases a queue.  The items left in it are not released.
+ */
+
+void wqfree (struct WorkQueue *queue);
+
+#endif	/* _WORKQUEUE_H_INCLUDED_ */